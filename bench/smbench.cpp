@@ -0,0 +1,1374 @@
+/* smbench
+    Host benchmark suite for the SerialMonUtils library hot paths: LOGMSG throughput (immediate, deferred, binary,
+    filtered by level or tag, rate limited and collapsed messages, and written to log sinks), input ingestion by
+    serialMonInputClass::getCmdLine(), command line parameter parsing, serialMonCmdClass::processCommands() dispatch
+    latency (for one session, for a path through a menu tree, for a long resumable command, and for two independent
+    sessions on separate streams), pasted commands vs. batches and scripts, text vs. framed binary command rate and
+    round trip (frame mode), output staging (serialMonOutClass), watch-variable streaming, parameter lookup in a
+    500-entry registry, task dispatch by the scheduler (serialMonSchedClass) with 128 tasks, plus the number
+    formatting/parsing functions, the overhead of profiling probes, and borrowing a buffer from the scratch arena (with
+    the static RAM of the objects).
+    Built by the "native" environment in platformio.ini, using the host stand-in for the Arduino core in host/:
+      pio run -e native && .pio/build/native/program [name-filter]
+    Each benchmark prints one line of JSON to stdout, e.g.
+      {"bench":"log_immediate","iters":200000,"ns_per_op":85.2,"max_ns":4100,"bytes_per_op":27.0,"writes_per_op":1.00,
+        "packets_per_op":1.00}
+    where ns_per_op is the mean time per operation, max_ns is the longest single measured operation (or batch, for
+    benchmarks that time batches), bytes_per_op, writes_per_op and packets_per_op count output to Serial (packets as
+    64-byte USB packets, with each write sent as a separate transfer), and the remaining fields
+    are benchmark-specific. Output from the library itself is
+    sent to the (host stand-in) Serial object, and is counted but not printed. If a name filter is given, only the
+    benchmarks whose names contain it are run.
+*/
+#include <Arduino.h>
+#include <elapsedMillis.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SerialMonLog.h"
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+#include "SerialMonProbe.h"
+#include "SerialMonWatch.h"
+#include "SerialMonParam.h"
+#include "SerialMonOut.h"
+#include "SerialMonSched.h"
+#include "SerialMonSink.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+serialMonCmdClass smCmd;
+elapsedMillis sysTimer;
+
+static const char *nameFilter = NULL;
+static volatile uint32_t sink;  // prevents the compiler from removing benchmarked work
+
+  // accumulates the timing of a single benchmark
+struct benchStruct {
+  const char *name;
+  uint32_t iters;
+  double totalNs;
+  double maxNs;
+  uint64_t bytes;               // Serial output bytes written while timed
+  uint32_t writes;              // Serial write() calls while timed
+  uint32_t packets;             // Serial USB packets while timed (see hostStreamClass::usbPackets)
+  std::chrono::steady_clock::time_point start;
+  uint64_t startBytes;
+  uint32_t startWrites;
+  uint32_t startPackets;
+};
+
+  // initializes a benchmark, and returns false if it is excluded by the name filter
+static bool benchStart(benchStruct *b, const char *name) {
+  b->name = name;
+  b->iters = 0;
+  b->totalNs = b->maxNs = 0;
+  b->bytes = b->writes = b->packets = 0;
+  return ((nameFilter == NULL) || (strstr(name, nameFilter) != NULL));
+}
+
+static inline void timerStart(benchStruct *b) {
+  b->startBytes = Serial.bytesWritten;
+  b->startWrites = Serial.writeCalls;
+  b->startPackets = Serial.usbPackets;
+  b->start = std::chrono::steady_clock::now();
+}
+
+static inline void timerStop(benchStruct *b, uint32_t ops) {
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - b->start).count();
+
+  b->totalNs += ns;
+  if (ns > b->maxNs)
+    b->maxNs = ns;
+  b->iters += ops;
+  b->bytes += Serial.bytesWritten - b->startBytes;
+  b->writes += Serial.writeCalls - b->startWrites;
+  b->packets += Serial.usbPackets - b->startPackets;
+}
+
+  // prints the result of a benchmark as a JSON line, with an optional extra (preformatted) field list
+static void benchReport(benchStruct *b, const char *extra) {
+  printf("{\"bench\":\"%s\",\"iters\":%u,\"ns_per_op\":%.1f,\"max_ns\":%.0f,\"bytes_per_op\":%.1f,\"writes_per_op\":%.2f,"
+          "\"packets_per_op\":%.2f%s%s}\n", b->name, b->iters, b->totalNs / b->iters, b->maxNs, (double) b->bytes / b->iters,
+          (double) b->writes / b->iters, (double) b->packets / b->iters, (extra[0] != '\0') ? "," : "", extra);
+}
+
+static void resetLog() {
+  while (smLog.pending() > 0)
+    smLog.drain(logRingLen);
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  smLog.deferred = false;
+  smLog.binary = false;
+  smLog.binaryResync();
+  smLog.dropCount = smLog.dropBytes = smLog.overflowCount = 0;
+}
+
+
+/* LOGMSG benchmarks */
+
+static void benchLogImmediate() {
+  benchStruct b;
+
+  if (!benchStart(&b, "log_immediate"))
+    return;
+  resetLog();
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG(1, "sensor %u value %d", i, -(int32_t) i);
+    timerStop(&b, 1);
+  }
+  benchReport(&b, "");
+}
+
+static void benchLogFiltered() {
+  benchStruct b;
+
+  if (!benchStart(&b, "log_filtered"))
+    return;
+  resetLog();
+  timerStart(&b);
+  for (uint32_t i = 0; i < 1000000; i++) {
+    LOGMSG(5, "sensor %u value %d", i, -(int32_t) i);    // above logLevel: never printed
+  }
+  timerStop(&b, 1000000);
+  benchReport(&b, "");
+}
+
+  // same as log_filtered, for a tagged message rejected by its tag's level (while another tag is verbose)
+static void benchLogFilteredTag() {
+  benchStruct b;
+
+  if (!benchStart(&b, "log_filtered_tag"))
+    return;
+  resetLog();
+  smLog.tagLevel[3] = 1;
+  smLog.tagLevel[7] = 9;
+  timerStart(&b);
+  for (uint32_t i = 0; i < 1000000; i++) {
+    LOGMSG_TAG(3, 5, "sensor %u value %d", i, -(int32_t) i);   // above the level of tag 3: never printed
+  }
+  timerStop(&b, 1000000);
+  benchReport(&b, "");
+  smLog.setTagLevels(0);
+}
+
+static void benchLogDeferred() {
+  benchStruct capture;
+  benchStruct drain;
+  bool captureWanted = benchStart(&capture, "log_deferred_capture");
+  bool drainWanted = benchStart(&drain, "log_deferred_drain");
+
+  if (!captureWanted && !drainWanted)
+    return;
+  resetLog();
+  smLog.deferred = true;
+  for (uint32_t i = 0; i < 20000; i++) {
+    timerStart(&capture);
+    for (uint8_t j = 0; j < (logRingLen - 1); j++)
+      LOGMSG(1, "sensor %u value %d temp %f", i, -(int32_t) j, 21.5f);
+    timerStop(&capture, logRingLen - 1);
+    timerStart(&drain);
+    smLog.drain(logRingLen);
+    timerStop(&drain, logRingLen - 1);
+  }
+  if (captureWanted)
+    benchReport(&capture, "");
+  if (drainWanted)
+    benchReport(&drain, "");
+}
+
+static void benchLogBinary() {
+  benchStruct b;
+
+  if (!benchStart(&b, "log_binary"))
+    return;
+  resetLog();
+  smLog.binary = true;
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG(1, "sensor %u value %d", i, -(int32_t) i);
+    timerStop(&b, 1);
+  }
+  benchReport(&b, "");
+  resetLog();
+}
+
+  // LOGMSG with a slow host link (10 KB/s, 512-byte TX buffer), so that messages are queued and dropped
+static void benchLogThrottled() {
+  benchStruct b;
+  char extra[120];
+
+  if (!benchStart(&b, "log_throttled"))
+    return;
+  resetLog();
+  Serial.txBufSize = 512;
+  Serial.txBytesPerMs = 10;
+  for (uint32_t i = 0; i < 100000; i++) {
+    timerStart(&b);
+    LOGMSG(1, "sensor %u value %d", i, -(int32_t) i);
+    timerStop(&b, 1);
+  }
+  snprintf(extra, sizeof(extra), "\"printed_bytes\":%u,\"dropped\":%u,\"overflows\":%u,\"tx_overrun\":%u",
+            (uint32_t) b.bytes, smLog.dropCount, smLog.overflowCount, (uint32_t) Serial.txOverrun);
+  Serial.txBufSize = 0;
+  benchReport(&b, extra);
+  resetLog();
+}
+
+
+  // LOGMSG_RL call site that is firing continuously: mostly suppressed, after a burst of 3
+static void benchLogRateLimit() {
+  benchStruct b;
+  char extra[40];
+
+  if (!benchStart(&b, "log_ratelimit"))
+    return;
+  resetLog();
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG_RL(1, 3, 1000, "sensor fault %u", 7);
+    timerStop(&b, 1);
+  }
+  snprintf(extra, sizeof(extra), "\"suppressed\":%u", smLog.suppressCount);
+  benchReport(&b, extra);
+}
+
+  // identical messages with collapseRepeats set: mostly counted as repeats
+static void benchLogCollapse() {
+  benchStruct b;
+
+  if (!benchStart(&b, "log_collapse"))
+    return;
+  resetLog();
+  smLog.collapseRepeats = true;
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG(1, "sensor fault %u at %s", 7, "pump");
+    timerStop(&b, 1);
+  }
+  smLog.collapseRepeats = false;
+  benchReport(&b, "");
+}
+
+
+  // recording messages in the history ring while logging is disabled (e.g. while a command menu is active)
+static void benchLogHistory() {
+  static logEntryStruct hist[64];
+  benchStruct b;
+  char extra[40];
+
+  if (!benchStart(&b, "log_history_capture"))
+    return;
+  resetLog();
+  smLog.enable = false;
+  smLog.setHistory(hist);
+  smLog.history = true;
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG(1, "sensor %u value %d temp %f", i, -(int32_t) i, 21.5f);
+    timerStop(&b, 1);
+  }
+  smLog.history = false;
+  smLog.clearHistory();
+  smLog.setHistory(NULL, 0);
+  snprintf(extra, sizeof(extra), "\"bytes_per_entry\":%u", (unsigned int) sizeof(logEntryStruct));
+  benchReport(&b, extra);
+}
+
+  // state of a single LOGISR producer thread
+struct isrProducerStruct {
+  uint32_t id;
+  uint32_t count;
+  double totalNs;
+  double maxNs;
+};
+
+static uint32_t isrProducersDone;         // number of producer threads that have finished
+
+static void isrProducer(isrProducerStruct *p) {
+  for (uint32_t seq = 0; seq < p->count; seq++) {
+    auto start = std::chrono::steady_clock::now();
+    LOGISR(1, "isr %u %u %u", p->id, seq, (p->id * 2654435761u) ^ seq);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    p->totalNs += ns;
+    if (ns > p->maxNs)
+      p->maxNs = ns;
+    if ((seq % 8) == 7)                   // give the consumer a chance to run, even on a single core
+      std::this_thread::yield();
+  }
+  __atomic_fetch_add(&isrProducersDone, 1, __ATOMIC_RELEASE);
+}
+
+  // LOGISR stress test: several producer threads enqueue while the main thread drains. Every printed record is
+  // checked: its check value must match, and each producer's sequence numbers must increase. Records that fail are
+  // counted as "torn", and received + dropped must equal the number sent.
+static void benchLogIsr(const char *name, uint32_t numThreads) {
+  const uint32_t perThread = 50000;
+  std::vector<isrProducerStruct> producers(numThreads);
+  std::vector<std::thread> threads;
+  std::vector<int64_t> lastSeq(numThreads, -1);
+  benchStruct b;
+  char extra[120];
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  unsigned int id, seq, check;
+  const char *lineP;
+
+  if (!benchStart(&b, name))
+    return;
+  resetLog();
+  smLog.isrDropCount = 0;
+  isrProducersDone = 0;
+  Serial.capture = true;
+  Serial.output.clear();
+  for (uint32_t i = 0; i < numThreads; i++) {
+    producers[i] = {i, perThread, 0, 0};
+    threads.push_back(std::thread(isrProducer, &producers[i]));
+  }
+  while (__atomic_load_n(&isrProducersDone, __ATOMIC_ACQUIRE) < numThreads)
+    smLog.drain(logRingLen);
+  for (uint32_t i = 0; i < numThreads; i++)
+    threads[i].join();
+  do {                                    // print anything left in the queue and ring buffer
+    smLog.drain(logRingLen);
+  } while (smLog.pending() > 0);
+  Serial.capture = false;
+  for (lineP = Serial.output.c_str(); (lineP = strstr(lineP, "isr ")) != NULL; lineP++) {
+    if ((sscanf(lineP, "isr %u %u %u", &id, &seq, &check) != 3) || (id >= numThreads) ||
+          (check != ((id * 2654435761u) ^ seq)) || ((int64_t) seq <= lastSeq[id]))
+      torn++;
+    else
+      lastSeq[id] = seq;
+    received++;
+  }
+  Serial.output.clear();
+  for (uint32_t i = 0; i < numThreads; i++) {
+    b.totalNs += producers[i].totalNs;
+    if (producers[i].maxNs > b.maxNs)
+      b.maxNs = producers[i].maxNs;
+    b.iters += producers[i].count;
+  }
+  snprintf(extra, sizeof(extra), "\"threads\":%u,\"received\":%u,\"dropped\":%u,\"torn\":%u,\"lost\":%d",
+            numThreads, received, smLog.isrDropCount, torn, (int) (b.iters - received - smLog.isrDropCount));
+  benchReport(&b, extra);
+}
+
+
+/* Log sink benchmarks: sustained LOGMSG throughput to a block-buffered log file (a host file standing in for a file
+    on an SD card), with logging to Serial disabled, and a message fanned out to three sinks (ring, file, second
+    serial port) by one logger, compared with three loggers with one sink each, which format it three times. */
+
+  // Print object that writes to a host file, in place of a File on an SD card
+class benchFileClass : public Print {
+public:
+  FILE *fp;
+  size_t write(uint8_t c) { return (write(&c, 1)); }
+  size_t write(const uint8_t *buf, size_t len) { return (fwrite(buf, 1, len, fp)); }
+  using Print::write;
+  void flush() { fflush(fp); }
+};
+
+static serialMonLogClass sinkLogs[3];
+static serialMonLogFileClass sinkFile;
+static serialMonLogRingClass sinkRing;
+static char sinkRingText[4096];
+static logSinkStruct benchSinks[] = {   // each sink can only be added to one logger, so the contexts are repeated
+  LOG_SINK_INIT("ring", logSinkRing, &sinkRing, 2), LOG_SINK_INIT("file", logSinkFile, &sinkFile, 2),
+  LOG_SINK_INIT("uart", logSinkStream, &Serial1, 2),
+  LOG_SINK_INIT("ring", logSinkRing, &sinkRing, 2), LOG_SINK_INIT("file", logSinkFile, &sinkFile, 2),
+  LOG_SINK_INIT("uart", logSinkStream, &Serial1, 2)
+};
+
+static void benchLogSinkFile() {
+  benchFileClass file;
+  benchStruct b;
+  char extra[160];
+
+  if (!benchStart(&b, "log_sink_file"))
+    return;
+  file.fp = tmpfile();
+  sinkFile.begin(&file);
+  sinkFile.blockCount = sinkFile.writeCount = 0;
+  sinkLogs[0].setTimeStamp(&sysTimer);
+  sinkLogs[0].addSink(&benchSinks[1]);  // enable is false: messages are only written to the file
+  for (uint32_t i = 0; i < 200000; i++) {
+    timerStart(&b);
+    LOGMSG_TO(sinkLogs[0], 1, "sensor %u value %d temp %f", i, -(int32_t) i, 21.5f);
+    sinkFile.poll();
+    timerStop(&b, 1);
+  }
+  sinkFile.flush();
+  snprintf(extra, sizeof(extra), "\"msgs_per_sec\":%.0f,\"file_bytes\":%ld,\"blocks\":%u,\"file_writes\":%u,"
+            "\"dropped\":%u", 1e9 * b.iters / b.totalNs, ftell(file.fp), sinkFile.blockCount, sinkFile.writeCount,
+            benchSinks[1].drops);
+  benchReport(&b, extra);
+  sinkLogs[0].removeSink(&benchSinks[1]);
+  sinkFile.begin(NULL);
+  fclose(file.fp);
+}
+
+static void benchLogSinkFanout() {
+  benchFileClass file;
+  benchStruct b;
+  char extra[80];
+  double fanoutNs = 0;
+
+  file.fp = tmpfile();
+  sinkFile.begin(&file);
+  sinkRing.setBuffer(sinkRingText);
+  for (uint8_t i = 0; i < 3; i++) {
+    sinkLogs[i].setTimeStamp(&sysTimer);
+    sinkLogs[0].addSink(&benchSinks[i]);
+    sinkLogs[i].addSink(&benchSinks[3 + i]);
+  }
+  if (benchStart(&b, "log_sink_fanout3")) {
+    for (uint32_t i = 0; i < 200000; i++) {
+      timerStart(&b);
+      LOGMSG_TO(sinkLogs[0], 1, "sensor %u value %d temp %f", i, -(int32_t) i, 21.5f);
+      sinkFile.poll();
+      timerStop(&b, 1);
+    }
+    fanoutNs = b.totalNs / b.iters;
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "log_sink_separate3")) {
+    for (uint32_t i = 0; i < 200000; i++) {
+      timerStart(&b);
+      for (uint8_t j = 0; j < 3; j++)
+        LOGMSG_TO(sinkLogs[j], 1, "sensor %u value %d temp %f", i, -(int32_t) i, 21.5f);
+      sinkFile.poll();
+      timerStop(&b, 1);
+    }
+    snprintf(extra, sizeof(extra), "\"saved_ns_per_msg\":%.1f", (fanoutNs > 0) ? (b.totalNs / b.iters - fanoutNs) : 0);
+    benchReport(&b, extra);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    sinkLogs[0].removeSink(&benchSinks[i]);
+    sinkLogs[i].removeSink(&benchSinks[3 + i]);
+  }
+  sinkFile.begin(NULL);
+  fclose(file.fp);
+}
+
+
+/* Command line input benchmarks */
+
+  // ingestion rate of complete lines, without a per-call budget
+static void benchGetCmdLine() {
+  static const char line[] = "f 1.25 -42 0x1F word \"quoted string\"\n";
+  serialMonInputClass input;
+  benchStruct b;
+  char extra[40];
+
+  if (!benchStart(&b, "input_getcmdline"))
+    return;
+  input.maxBytesPerCall = 0;
+  input.maxMicrosPerCall = 0;
+  for (uint32_t i = 0; i < 100000; i++) {
+    Serial.feed(line);
+    timerStart(&b);
+    input.startBudget();
+    sink += input.getCmdLine();
+    timerStop(&b, 1);
+  }
+  snprintf(extra, sizeof(extra), "\"ns_per_byte\":%.2f", b.totalNs / b.iters / (sizeof(line) - 1));
+  benchReport(&b, extra);
+}
+
+  // worst-case time per call while a large block of text is pasted, with the default per-call budget
+static void benchPasteLatency() {
+  serialMonInputClass input;
+  benchStruct b;
+  char extra[40];
+  uint32_t lines = 0;
+
+  if (!benchStart(&b, "input_paste_latency"))
+    return;
+  for (uint32_t i = 0; i < 20000; i++)
+    Serial.feed("i 12345 this line is a bit longer than most commands would be\n");
+  while (Serial.available() > 0) {
+    timerStart(&b);
+    input.startBudget();
+    while (input.getCmdLine())
+      lines++;
+    timerStop(&b, 1);
+  }
+  snprintf(extra, sizeof(extra), "\"lines\":%u", lines);
+  benchReport(&b, extra);
+}
+
+  // parsing the parameters of an already-tokenized command line
+static void benchParamParse() {
+  serialMonInputClass input;
+  benchStruct b;
+  bool error;
+
+  if (!benchStart(&b, "param_parse"))
+    return;
+  input.maxBytesPerCall = 0;
+  input.maxMicrosPerCall = 0;
+  for (uint32_t i = 0; i < 100000; i++) {
+    Serial.feed("1.25 -42 0x1F 3.14159 word\n");
+    input.startBudget();
+    input.getCmdLine();
+    timerStart(&b);
+    sink += (uint32_t) input.getFloatParam(&error);
+    sink += input.getIntParam(&error);
+    sink += input.getInt32Param(&error);
+    sink += input.getFixedParam(3, &error);
+    sink += (uint32_t) (uintptr_t) input.getWordParam(&error);
+    timerStop(&b, 5);
+  }
+  benchReport(&b, "");
+}
+
+
+/* Command dispatch benchmark */
+
+static void cmdNop(cmdArgsStruct *args) {
+  sink += args->count;
+}
+
+constexpr cmdEntryStruct benchEntries[] = {
+  {"a", "", cmdNop, NULL},
+  {"b", "i", cmdNop, NULL},
+  {"c", "ff", cmdNop, NULL},
+  {"gain", "fI", cmdNop, NULL},
+  {"list", "", cmdNop, NULL},
+  {"mode", "w", cmdNop, NULL},
+  {"p", "iiii", cmdNop, NULL},
+  {"rate", "i", cmdNop, NULL},
+  {"s", "", cmdNop, NULL},
+  {"set", "wf", cmdNop, NULL},
+  {"t", "", cmdNop, NULL},
+  {"x", "", cmdNop, NULL}
+};
+CMD_TABLE_SORTED(benchEntries);
+const cmdTableStruct benchTable = {"Bench", benchEntries, sizeof(benchEntries) / sizeof(benchEntries[0]), NULL};
+
+static const char *benchCmds[] = {"gain 1.5 3\n", "set speed 2.25\n", "p 1 2 3 4\n", "mode fast\n", "zzz\n"};
+
+static void benchMenu(execTypeEnum execType) {
+  smCmd.tableMenu(execType, &benchTable);
+}
+
+  // latency of processCommands() for a call that receives, parses, dispatches and re-prompts one command
+static void benchDispatch() {
+  benchStruct b;
+
+  if (!benchStart(&b, "cmd_dispatch"))
+    return;
+  smCmd.initMenu(benchMenu);
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);            // enter command mode
+  for (uint32_t i = 0; i < 100000; i++) {
+    Serial.feed(benchCmds[i % (sizeof(benchCmds) / sizeof(benchCmds[0]))]);
+    timerStart(&b);
+    smCmd.processCommands(true);
+    timerStop(&b, 1);
+  }
+  benchReport(&b, "");
+  smCmd.exit();
+}
+
+
+  // a 4-level menu tree (Bench/L1/L2/L3), for navigation by path
+constexpr cmdTableStruct benchLevel3 = {"L3", benchEntries, sizeof(benchEntries) / sizeof(benchEntries[0]), NULL};
+constexpr cmdEntryStruct benchLevel2Entries[] = {CMD_SUBMENU("c", benchLevel3), {"x", "", cmdNop, NULL}};
+constexpr cmdTableStruct benchLevel2 = {"L2", benchLevel2Entries, 2, NULL};
+constexpr cmdEntryStruct benchLevel1Entries[] = {CMD_SUBMENU("b", benchLevel2), {"x", "", cmdNop, NULL}};
+constexpr cmdTableStruct benchLevel1 = {"L1", benchLevel1Entries, 2, NULL};
+constexpr cmdEntryStruct benchRootEntries[] = {CMD_SUBMENU("a", benchLevel1), {"x", "", cmdNop, NULL}};
+constexpr cmdTableStruct benchRoot = {"Bench", benchRootEntries, 2, NULL};
+CMD_MENU_TREE(benchRoot);
+
+  // latency of processCommands() for a line that enters a 3-level path of submenus and executes a command there,
+  // printing the breadcrumb prompt (each line is followed by an untimed <ESC> x 3 to return to the root menu)
+static void benchMenuPath() {
+  benchStruct b;
+  char extra[40];
+
+  if (!benchStart(&b, "cmd_menu_path"))
+    return;
+  smCmd.initMenu(&benchRoot);
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);            // enter command mode
+  for (uint32_t i = 0; i < 100000; i++) {
+    Serial.feed("a b c set speed 2.25\n");
+    timerStart(&b);
+    smCmd.processCommands(true);
+    timerStop(&b, 1);
+    snprintf(extra, sizeof(extra), "\"depth\":%u", smCmd.getMenuDepth());
+    Serial.feed("\x1B\x1B\x1B");
+    smCmd.processCommands(true);
+  }
+  benchReport(&b, extra);
+  smCmd.exit();
+}
+
+
+/* Resumable command benchmarks: a long command of 2000 steps of ~10 us each (~20 ms in total), run as a resumable
+    command and, for comparison, synchronously in its handler. ns_per_op and max_ns are the mean and max latency of
+    the processCommands() calls made until the command finishes, i.e. the time for which the main loop is stalled. */
+
+struct benchLongStruct {
+  uint32_t pos;                           // next step
+  uint32_t end;                           // number of steps
+  bool cancelled;                         // set when the step function sees args->cancel
+};
+static benchLongStruct benchLong;
+
+static void benchLongWork() {
+  uint32_t start = micros();
+
+  while ((uint32_t) (micros() - start) < 10)
+    sink++;
+}
+
+static cmdStepEnum benchLongStep(cmdArgsStruct *args) {
+  benchLongStruct *st = (benchLongStruct *) args->state;
+
+  if (args->cancel) {
+    st->cancelled = true;
+    return (CMD_DONE);
+  }
+  benchLongWork();
+  return ((++st->pos < st->end) ? CMD_CONTINUE : CMD_DONE);
+}
+
+static void cmdLongResumable(cmdArgsStruct *args) {
+  benchLong.pos = 0;
+  benchLong.end = args->param[0].i;
+  benchLong.cancelled = false;
+  args->cmd->resume(args, benchLongStep, &benchLong);
+}
+
+static void cmdLongBlocking(cmdArgsStruct *args) {
+  for (benchLong.pos = 0; benchLong.pos < (uint32_t) args->param[0].i; benchLong.pos++)
+    benchLongWork();
+}
+
+constexpr cmdEntryStruct benchLongEntries[] = {
+  {"b", "i", cmdLongBlocking, NULL},
+  {"r", "i", cmdLongResumable, NULL}
+};
+CMD_TABLE_SORTED(benchLongEntries);
+constexpr cmdTableStruct benchLongTable = {"Long", benchLongEntries, 2, NULL};
+
+static void benchResumable() {
+  benchStruct b;
+  char extra[80];
+  uint32_t calls;
+
+  smCmd.initMenu(&benchLongTable);
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);            // enter command mode
+  if (benchStart(&b, "cmd_resumable")) {
+    Serial.feed("r 2000\n");
+    for (calls = 0; (calls == 0) || smCmd.busy(); calls++) {
+      timerStart(&b);
+      smCmd.processCommands(true);
+      timerStop(&b, 1);
+    }
+    snprintf(extra, sizeof(extra), "\"steps\":%u,\"budget_us\":%u", benchLong.pos, smCmd.maxStepMicrosPerCall);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "cmd_resumable_cancel")) {
+    Serial.feed("r 2000\n");
+    for (calls = 0; (calls == 0) || smCmd.busy(); calls++) {
+      if (calls == 5)
+        Serial.feed("\x1B");             // cancel after 5 calls
+      timerStart(&b);
+      smCmd.processCommands(true);
+      timerStop(&b, 1);
+    }
+    snprintf(extra, sizeof(extra), "\"steps\":%u,\"cancelled\":%s", benchLong.pos,
+              benchLong.cancelled ? "true" : "false");
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "cmd_blocking")) {
+    Serial.feed("b 2000\n");
+    timerStart(&b);
+    smCmd.processCommands(true);
+    timerStop(&b, 1);
+    snprintf(extra, sizeof(extra), "\"steps\":%u", benchLong.pos);
+    benchReport(&b, extra);
+  }
+  smCmd.exit();
+}
+
+
+
+/* Batch benchmarks: 100 configuration commands pasted line by line (with echo and a prompt after each), pasted as a
+    batch between "{" and "}" lines, and run as a script. Each measures all calls to processCommands() until the last
+    command has been executed (and the batch summary printed); ns_per_op and bytes_per_op are per command. */
+
+const uint16_t benchBatchLines = 100;
+
+static void benchBatchText(std::string *text) {
+  for (uint16_t i = 0; i < benchBatchLines; i++)
+    *text += benchCmds[i % 4];            // the commands that succeed
+}
+
+static void benchBatch() {
+  std::string lines;
+  std::string batch;
+  benchStruct b;
+  char extra[80];
+  uint32_t calls;
+
+  benchBatchText(&lines);
+  batch = std::string(batchStartLine) + "\n" + lines + batchEndLine + "\n";
+  smCmd.initMenu(&benchTable);
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);            // enter command mode
+  if (benchStart(&b, "cmd_paste_interactive")) {
+    for (uint32_t i = 0; i < 200; i++) {
+      Serial.feed(lines.c_str());
+      timerStart(&b);
+      while (Serial.available() > 0)
+        smCmd.processCommands(true);
+      timerStop(&b, benchBatchLines);
+    }
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "cmd_paste_batch")) {
+    for (uint32_t i = 0; i < 200; i++) {
+      Serial.feed(batch.c_str());
+      timerStart(&b);
+      for (calls = 0; Serial.available() > 0; calls++)
+        smCmd.processCommands(true);
+      timerStop(&b, benchBatchLines);
+    }
+    snprintf(extra, sizeof(extra), "\"calls_per_batch\":%u,\"batch_active\":%s", calls,
+              smCmd.batchActive() ? "true" : "false");
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "cmd_script")) {
+    for (uint32_t i = 0; i < 200; i++) {
+      timerStart(&b);
+      smCmd.runScript(lines.c_str(), true);
+      for (calls = 0; smCmd.busy(); calls++)
+        smCmd.processCommands(true);
+      timerStop(&b, benchBatchLines);
+    }
+    snprintf(extra, sizeof(extra), "\"calls_per_script\":%u", calls);
+    benchReport(&b, extra);
+  }
+  smCmd.exit();
+}
+
+/* Two independent sessions (command object + logger) on two streams, driven from the same loop */
+
+serialMonCmdClass usbCmd;
+serialMonCmdClass uartCmd;
+serialMonLogClass usbLog;
+serialMonLogClass uartLog;
+static uint32_t usbCount;
+static uint32_t uartCount;
+
+static void cmdSessionNum(cmdArgsStruct *args) {
+  bool usb = (args->cmd == &usbCmd);
+
+  if (usb)
+    usbCount++;
+  else
+    uartCount++;
+  args->cmd->getStream()->println(usb ? "ok usb" : "ok uart");
+}
+
+static void cmdSessionLog(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (args->cmd == &usbCmd) ? &usbLog : &uartLog;
+
+  LOGMSG_TO(*logP, 2, "log %s %d", (args->cmd == &usbCmd) ? "usb" : "uart", (int) args->param[0].i);
+}
+
+constexpr cmdEntryStruct sessionEntries[] = {
+  {"l", "i", cmdSessionLog, NULL},
+  {"n", "i", cmdSessionNum, NULL}
+};
+CMD_TABLE_SORTED(sessionEntries);
+const cmdTableStruct sessionTable = {"S", sessionEntries, sizeof(sessionEntries) / sizeof(sessionEntries[0]), NULL};
+
+  // counts the lines of a captured stream output that contain a tag, and the lines that contain another tag
+static void countTags(const std::string &out, const char *tag, const char *otherTag, uint32_t *found, uint32_t *wrong) {
+  for (const char *lineP = strstr(out.c_str(), tag); lineP != NULL; lineP = strstr(lineP + 1, tag))
+    (*found)++;
+  for (const char *lineP = strstr(out.c_str(), otherTag); lineP != NULL; lineP = strstr(lineP + 1, otherTag))
+    (*wrong)++;
+}
+
+  // processCommands() latency for a pair of sessions on Serial and Serial1, with a check that each session's commands,
+  // menu output and log messages (logged at level 2, printed only by the UART logger) stay on its own stream
+static void benchTwoSessions() {
+  const uint32_t iters = 50000;
+  benchStruct b;
+  char extra[120];
+  uint32_t usbOk = 0, uartOk = 0, usbLogs = 0, uartLogs = 0, wrong = 0;
+
+  if (!benchStart(&b, "cmd_two_sessions"))
+    return;
+  usbCmd.setStream(&Serial);
+  uartCmd.setStream(&Serial1);
+  usbCmd.initMenu(&sessionTable);
+  uartCmd.initMenu(&sessionTable);
+  usbLog.setStream(&Serial);
+  uartLog.setStream(&Serial1);
+  usbLog.enable = uartLog.enable = true;
+  usbLog.logLevel = 1;
+  uartLog.logLevel = 2;
+  usbCount = uartCount = 0;
+  Serial.capture = Serial1.capture = true;
+  Serial.output.clear();
+  Serial1.output.clear();
+  Serial.feed("\x1B");
+  Serial1.feed("\x1B");
+  for (uint32_t i = 0; i < iters; i++) {
+    Serial.feed((i & 1) ? "n 1\n" : "l 1\n");
+    Serial1.feed((i & 1) ? "l 2\n" : "n 2\n");
+    timerStart(&b);
+    usbCmd.processCommands(true);
+    uartCmd.processCommands(true);
+    timerStop(&b, 2);
+  }
+  Serial.capture = Serial1.capture = false;
+  countTags(Serial.output, "ok usb", "uart", &usbOk, &wrong);
+  countTags(Serial.output, "log usb", "log uart", &usbLogs, &wrong);
+  countTags(Serial1.output, "ok uart", "usb", &uartOk, &wrong);
+  countTags(Serial1.output, "log uart", "log usb", &uartLogs, &wrong);
+  snprintf(extra, sizeof(extra), "\"usb_cmds\":%u,\"uart_cmds\":%u,\"usb_logs\":%u,\"uart_logs\":%u,\"wrong_stream\":%u",
+            usbOk, uartOk, usbLogs, uartLogs, wrong);
+  benchReport(&b, extra);
+  Serial.output.clear();
+  Serial1.output.clear();
+}
+
+
+/* Frame mode benchmarks: a test rig driving a command session on Serial with "g <int>" commands (whose handler
+    replies "ok <int>"), in text mode and in frame mode (see SerialMonFrame.h). Round trip: one command per call to
+    processCommands(), so ns_per_op is the latency from a complete request to its complete reply. Pipelined: 2000
+    commands sent at once, and executed by as many calls as needed; cmds_per_sec is the resulting command rate.
+    Replies are checked: text replies by counting them, and frame replies by decoding them (CRC, sequence number and
+    status). */
+
+serialMonCmdClass rigCmd;
+
+static void cmdRigGet(cmdArgsStruct *args) {
+  args->cmd->getStream()->print("ok ");
+  args->cmd->getStream()->println(args->param[0].i);
+}
+
+static void cmdRigExit(cmdArgsStruct *args) {
+  args->cmd->exit();
+}
+
+constexpr cmdEntryStruct rigEntries[] = {
+  {"g", "i", cmdRigGet, NULL},
+  {"x", "", cmdRigExit, NULL}
+};
+CMD_TABLE_SORTED(rigEntries);
+constexpr cmdTableStruct rigTable = {"Rig", rigEntries, sizeof(rigEntries) / sizeof(rigEntries[0]), NULL};
+
+  // appends a request frame to a string
+static void rigRequest(std::string *out, uint8_t seq, const char *text) {
+  uint8_t frame[maxFrameLen];
+  uint8_t code[maxFrameCode];
+  uint16_t len = 0;
+  uint16_t crc;
+
+  frame[len++] = seq;
+  memcpy(frame + len, text, strlen(text));
+  len += strlen(text);
+  crc = smCrc16(frame, len);
+  frame[len++] = crc & 0xFF;
+  frame[len++] = crc >> 8;
+  out->append((const char *) code, smCobsEncode(frame, len, code));
+  out->push_back('\0');
+}
+
+  // decodes the reply frames in a captured output, and counts those with status FRAME_OK and sequence numbers
+  // starting at firstSeq (and the rest as bad); the FRAME_READY reply is skipped
+static uint32_t rigReplies(const std::string &out, uint8_t firstSeq, uint32_t *bad) {
+  uint8_t buf[256];
+  uint32_t good = 0;
+  uint8_t seq = firstSeq;
+  size_t start = 0;
+  size_t end;
+  int16_t len;
+
+  for (; (end = out.find('\0', start)) != std::string::npos; start = end + 1) {
+    if ((end == start) || ((end - start) > sizeof(buf)))
+      continue;
+    memcpy(buf, out.data() + start, end - start);
+    len = smCobsDecode(buf, end - start);
+    if ((len >= 4) && (buf[1] == FRAME_READY))
+      continue;
+    if ((len < 4) || (smCrc16(buf, len - 2) != (buf[len - 2] | (buf[len - 1] << 8))) || (buf[0] != seq) ||
+        (buf[1] != FRAME_OK) || (memcmp(buf + 2, "ok ", 3) != 0))
+      (*bad)++;
+    else
+      good++;
+    seq++;
+  }
+  return (good);
+}
+
+static void benchFrames() {
+  const uint32_t pipelined = 2000;
+  std::string requests;
+  benchStruct b;
+  char extra[120];
+  char line[24];
+  uint32_t ok;
+  uint32_t bad;
+
+  rigCmd.setStream(&Serial);
+  rigCmd.initMenu(&rigTable);
+  Serial.output.clear();
+  Serial.feed("\x1B");
+  rigCmd.processCommands(true);           // enter command mode (text)
+  if (benchStart(&b, "cmd_text_roundtrip")) {
+    for (uint32_t i = 0; i < 20000; i++) {
+      Serial.feed("g 42\n");
+      timerStart(&b);
+      rigCmd.processCommands(true);
+      timerStop(&b, 1);
+    }
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "cmd_text_pipelined")) {
+    for (uint32_t i = 0; i < pipelined; i++) {
+      snprintf(line, sizeof(line), "g %u\n", i);
+      requests += line;
+    }
+    Serial.capture = true;
+    Serial.feed(requests.c_str());
+    timerStart(&b);
+    while (Serial.available() > 0)
+      rigCmd.processCommands(true);
+    timerStop(&b, pipelined);
+    Serial.capture = false;
+    ok = bad = 0;
+    countTags(Serial.output, "ok ", "Unknown", &ok, &bad);
+    snprintf(extra, sizeof(extra), "\"cmds_per_sec\":%.0f,\"replies\":%u,\"errors\":%u", 1e9 * b.iters / b.totalNs,
+              ok, bad);
+    benchReport(&b, extra);
+    Serial.output.clear();
+  }
+  Serial.feed(frameMagic);
+  Serial.feed("\n");
+  rigCmd.processCommands(true);           // enter frame mode
+  if (benchStart(&b, "cmd_frame_roundtrip")) {
+    Serial.capture = true;
+    for (uint32_t i = 0; i < 20000; i++) {
+      requests.clear();
+      rigRequest(&requests, i, "g 42");
+      Serial.feed((const uint8_t *) requests.data(), requests.size());
+      timerStart(&b);
+      rigCmd.processCommands(true);
+      timerStop(&b, 1);
+    }
+    Serial.capture = false;
+    ok = bad = 0;
+    ok = rigReplies(Serial.output, 0, &bad);
+    snprintf(extra, sizeof(extra), "\"replies\":%u,\"bad\":%u", ok, bad);
+    benchReport(&b, extra);
+    Serial.output.clear();
+  }
+  if (benchStart(&b, "cmd_frame_pipelined")) {
+    requests.clear();
+    for (uint32_t i = 0; i < pipelined; i++) {
+      snprintf(line, sizeof(line), "g %u", i);
+      rigRequest(&requests, i, line);
+    }
+    Serial.capture = true;
+    Serial.feed((const uint8_t *) requests.data(), requests.size());
+    timerStart(&b);
+    while (Serial.available() > 0)
+      rigCmd.processCommands(true);
+    timerStop(&b, pipelined);
+    Serial.capture = false;
+    ok = bad = 0;
+    ok = rigReplies(Serial.output, 0, &bad);
+    snprintf(extra, sizeof(extra), "\"cmds_per_sec\":%.0f,\"replies\":%u,\"bad\":%u,\"rx_errors\":%u",
+              1e9 * b.iters / b.totalNs, ok, bad, rigCmd.frame.rxErrors);
+    benchReport(&b, extra);
+    Serial.output.clear();
+  }
+  requests.clear();
+  rigRequest(&requests, 0, "x");          // exit (and return to text mode)
+  Serial.feed((const uint8_t *) requests.data(), requests.size());
+  rigCmd.processCommands(true);
+  Serial.output.clear();
+}
+
+/* Output staging benchmarks: LOGMSG and command dispatch output passed through a serialMonOutClass, to compare the
+    number of writes to Serial (i.e. USB packets) with log_immediate and cmd_dispatch. Each is timed as a single
+    batch that ends with a flush. */
+
+static void benchStaged() {
+  serialMonOutClass out;
+  serialMonLogClass log;
+  serialMonCmdClass cmd;
+  benchStruct b;
+
+  out.begin(&Serial);
+  if (benchStart(&b, "out_staged_log")) {
+    log.setTimeStamp(&sysTimer);
+    log.setStream(&out);
+    log.enable = true;
+    log.logLevel = 1;
+    timerStart(&b);
+    for (uint32_t i = 0; i < 200000; i++)
+      LOGMSG_TO(log, 1, "sensor %u value %d", i, -(int32_t) i);
+    out.flush();
+    timerStop(&b, 200000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "out_staged_dispatch")) {
+    cmd.setStream(&out);
+    cmd.initMenu(&benchTable);
+    Serial.feed("\x1B");
+    cmd.processCommands(true);            // enter command mode
+    out.flush();
+    timerStart(&b);
+    for (uint32_t i = 0; i < 100000; i++) {
+      Serial.feed(benchCmds[i % (sizeof(benchCmds) / sizeof(benchCmds[0]))]);
+      cmd.processCommands(true);
+      out.poll();
+    }
+    out.flush();
+    timerStop(&b, 100000);
+    benchReport(&b, "");
+    cmd.exit();
+  }
+}
+
+
+/* Watch-variable streaming benchmarks: 8 selected variables, of which 2 change on every sample (a counter and a
+    slowly varying float), as CSV lines and as binary delta frames. The sample period is 0, so every call to sample()
+    sends a frame. */
+
+static uint32_t watchCounter, watchConst1, watchConst2;
+static int16_t watchConst3;
+static float watchFloat, watchConst4;
+static bool watchFlag;
+static uint8_t watchConst5;
+constexpr watchVarStruct benchWatchVars[] = {
+  WATCH_VAR(watchCounter), WATCH_VAR(watchConst1), WATCH_VAR(watchConst2), WATCH_VAR(watchConst3),
+  WATCH_VAR(watchFloat), WATCH_VAR(watchConst4), WATCH_VAR(watchFlag), WATCH_VAR(watchConst5)
+};
+
+static void benchWatch(const char *name, bool binary) {
+  serialMonWatchClass watch;
+  benchStruct b;
+  char extra[80];
+
+  if (!benchStart(&b, name))
+    return;
+  watchConst1 = 123456; watchConst2 = 7; watchConst3 = -300; watchConst4 = 2.5f; watchFlag = true; watchConst5 = 9;
+  watch.init(benchWatchVars, sizeof(benchWatchVars) / sizeof(benchWatchVars[0]));
+  for (uint8_t i = 0; i < watch.count(); i++)
+    watch.select(watch.getVar(i)->name);
+  watch.binary = binary;
+  watch.start(0);
+  watch.sample();                 // header and first (full) frame
+  for (uint32_t i = 0; i < 100000; i++) {
+    watchCounter++;
+    watchFloat += 0.01f;
+    timerStart(&b);
+    watch.sample();
+    timerStop(&b, 1);
+  }
+  snprintf(extra, sizeof(extra), "\"frames\":%u,\"skipped\":%u", watch.frameCount, watch.skipCount);
+  benchReport(&b, extra);
+}
+
+
+/* Parameter registry benchmarks: lookup by name in a table of 500 parameters ("p000" - "p499"), by binary search
+    (smParamFind()) and by a linear search for comparison, and the complete set path (lookup, parse, range check). */
+
+static float benchParamVals[500];
+#define BENCH_PARAM(h, t, u) PARAM_NAMED("p" #h #t #u, benchParamVals[h * 100 + t * 10 + u], 0, 1000, "")
+#define BENCH_PARAM10(h, t) BENCH_PARAM(h, t, 0), BENCH_PARAM(h, t, 1), BENCH_PARAM(h, t, 2), BENCH_PARAM(h, t, 3), \
+                            BENCH_PARAM(h, t, 4), BENCH_PARAM(h, t, 5), BENCH_PARAM(h, t, 6), BENCH_PARAM(h, t, 7), \
+                            BENCH_PARAM(h, t, 8), BENCH_PARAM(h, t, 9)
+#define BENCH_PARAM100(h) BENCH_PARAM10(h, 0), BENCH_PARAM10(h, 1), BENCH_PARAM10(h, 2), BENCH_PARAM10(h, 3), \
+                          BENCH_PARAM10(h, 4), BENCH_PARAM10(h, 5), BENCH_PARAM10(h, 6), BENCH_PARAM10(h, 7), \
+                          BENCH_PARAM10(h, 8), BENCH_PARAM10(h, 9)
+constexpr paramEntryStruct benchParams[] = {
+  BENCH_PARAM100(0), BENCH_PARAM100(1), BENCH_PARAM100(2), BENCH_PARAM100(3), BENCH_PARAM100(4)
+};
+PARAM_TABLE_SORTED(benchParams);
+static const paramTableStruct benchParamTable = {benchParams, sizeof(benchParams) / sizeof(benchParams[0])};
+
+static void benchParamRegistry() {
+  benchStruct b;
+  char names[500][5];
+  char extra[80];
+  uint32_t found = 0;
+  uint32_t errors = 0;
+
+  for (uint16_t i = 0; i < 500; i++)
+    snprintf(names[i], sizeof(names[i]), "p%03u", i);
+  if (benchStart(&b, "param_lookup_500")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      found += (smParamFind(&benchParamTable, names[(i * 7) % 500]) != NULL);
+    timerStop(&b, 1000000);
+    snprintf(extra, sizeof(extra), "\"found\":%u", found);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "param_lookup_500_linear")) {
+    found = 0;
+    timerStart(&b);
+    for (uint32_t i = 0; i < 100000; i++) {
+      for (uint16_t j = 0; j < benchParamTable.count; j++) {
+        if (strcmp(benchParams[j].name, names[(i * 7) % 500]) == 0) {
+          found++;
+          break;
+        }
+      }
+    }
+    timerStop(&b, 100000);
+    snprintf(extra, sizeof(extra), "\"found\":%u", found);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "param_set_500")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      errors += !smParamSet(smParamFind(&benchParamTable, names[(i * 7) % 500]), "12.5");
+    timerStop(&b, 1000000);
+    snprintf(extra, sizeof(extra), "\"errors\":%u", errors);
+    benchReport(&b, extra);
+  }
+}
+
+
+/* Scheduler benchmarks: 128 periodic tasks, run for 100000 simulated ms with one call to run() per ms, with a mix of
+    fast and slow periods (1 ms to 5 s) and with slow periods only (50 ms to 10 s). Most of the periods wrap around
+    the timer wheel. The cost per ms is compared with the equivalent hand-rolled polling of 128 timers, which checks
+    every timer on every pass (and keeps no statistics). */
+
+static const uint16_t benchTaskCount = 128;
+static const uint32_t benchTaskPeriodsMixed[] = {1, 2, 5, 10, 20, 50, 100, 250, 1000, 5000};
+static const uint32_t benchTaskPeriodsSlow[] = {50, 100, 100, 200, 250, 500, 1000, 2000, 5000, 10000};
+static const uint32_t benchSchedMs = 100000;
+static schedTaskStruct benchTasks[benchTaskCount];
+static char benchTaskNames[benchTaskCount][5];
+
+static void benchTaskFunc(schedTaskStruct *task) {
+  sink += task->periodMs;
+}
+
+static void benchSched(const char *wheelName, const char *pollName, const uint32_t *periods) {
+  serialMonSchedClass sched;
+  benchStruct b;
+  char extra[120];
+  uint32_t base;
+  uint32_t lateMax = 0;
+  uint32_t overruns = 0;
+  uint32_t last[benchTaskCount];
+  uint32_t period[benchTaskCount];
+  uint32_t dispatches = 0;
+
+  if (benchStart(&b, wheelName)) {
+    base = millis();
+    for (uint16_t i = 0; i < benchTaskCount; i++) {
+      snprintf(benchTaskNames[i], sizeof(benchTaskNames[i]), "t%03u", i);
+      benchTasks[i] = SCHED_TASK_INIT(benchTaskNames[i], benchTaskFunc, NULL);
+      sched.every(&benchTasks[i], periods[i % 10]);
+    }
+    sched.resetStats();
+    timerStart(&b);
+    for (uint32_t t = 1; t <= benchSchedMs; t++)
+      sched.run(base + t);
+    timerStop(&b, benchSchedMs);
+    for (uint16_t i = 0; i < benchTaskCount; i++) {
+      if (benchTasks[i].lateMax > lateMax)
+        lateMax = benchTasks[i].lateMax;
+      overruns += benchTasks[i].overruns;
+      sched.cancel(&benchTasks[i]);
+    }
+    snprintf(extra, sizeof(extra), "\"dispatches_per_ms\":%.2f,\"ns_per_dispatch\":%.1f,\"late_max_ms\":%u,\"overruns\":%u",
+              (double) sched.dispatchCount / b.iters, b.totalNs / sched.dispatchCount, lateMax, overruns);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, pollName)) {
+    for (uint16_t i = 0; i < benchTaskCount; i++) {
+      last[i] = 0;
+      period[i] = periods[i % 10];
+      benchTasks[i].periodMs = period[i];
+    }
+    timerStart(&b);
+    for (uint32_t t = 1; t <= benchSchedMs; t++) {
+      for (uint16_t i = 0; i < benchTaskCount; i++) {
+        if (t - last[i] >= period[i]) {
+          last[i] += period[i];
+          benchTaskFunc(&benchTasks[i]);
+          dispatches++;
+        }
+      }
+    }
+    timerStop(&b, benchSchedMs);
+    snprintf(extra, sizeof(extra), "\"dispatches_per_ms\":%.2f,\"ns_per_dispatch\":%.1f", (double) dispatches / b.iters,
+              b.totalNs / dispatches);
+    benchReport(&b, extra);
+  }
+}
+
+
+/* Number formatting/parsing benchmarks (with the equivalent C library calls for comparison) */
+
+static void benchNumbers() {
+  benchStruct b;
+  char buf[maxNumLen];
+  float f;
+  int32_t v;
+
+  if (benchStart(&b, "num_format_timestamp")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      sink += smFormatTimestamp(buf, i * 7);
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "num_format_timestamp_snprintf")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      sink += snprintf(buf, sizeof(buf), "[%5.3f] ", (float) (i * 7) / 1000);
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "num_format_float")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      sink += smFormatFloat(buf, (float) i * 0.37f, 2);
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "num_parse_float")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++) {
+      smParseFloat("-1234.5678", &f);
+      sink += (uint32_t) f;
+    }
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "num_parse_float_strtof")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      sink += (uint32_t) strtof("-1234.5678", NULL);
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+  if (benchStart(&b, "num_parse_fixed")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++) {
+      smParseFixed("-1234.5678", 3, &v);
+      sink += v;
+    }
+    timerStop(&b, 1000000);
+    benchReport(&b, "");
+  }
+}
+
+
+/* Profiling probe overhead benchmarks: the cost of an (otherwise empty) timed scope, a counter and a sample value */
+
+static void benchProbes() {
+  benchStruct b;
+  probeStruct *probe;
+  char extra[80];
+
+  if (benchStart(&b, "probe_scope")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++) {
+      SMPROBE_SCOPE("bench_scope");
+      sink += i;
+    }
+    timerStop(&b, 1000000);
+    probe = smProbeFind("bench_scope");
+    snprintf(extra, sizeof(extra), "\"count\":%u,\"min_ticks\":%u", probe->count, probe->min);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "probe_count")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      SMPROBE_COUNT("bench_count");
+    timerStop(&b, 1000000);
+    snprintf(extra, sizeof(extra), "\"count\":%u", smProbeFind("bench_count")->count);
+    benchReport(&b, extra);
+  }
+  if (benchStart(&b, "probe_value")) {
+    timerStart(&b);
+    for (uint32_t i = 0; i < 1000000; i++)
+      SMPROBE_VALUE("bench_value", i);
+    timerStop(&b, 1000000);
+    snprintf(extra, sizeof(extra), "\"max\":%u", smProbeFind("bench_value")->max);
+    benchReport(&b, extra);
+  }
+}
+
+
+/* Scratch arena benchmark: the cost of borrowing and giving back a line buffer, plus the static RAM of the
+   SerialMonUtils objects and the arena use of the whole run (so it is run last) */
+
+static void benchScratch() {
+  benchStruct b;
+  char extra[160];
+
+  if (!benchStart(&b, "scratch_line"))
+    return;
+  timerStart(&b);
+  for (uint32_t i = 0; i < 1000000; i++) {
+    scratchBufClass line(logLineLen);
+    line.p[0] = (char) i;
+    sink += line.len;
+  }
+  timerStop(&b, 1000000);
+  snprintf(extra, sizeof(extra), "\"log_bytes\":%u,\"cmd_bytes\":%u,\"watch_bytes\":%u,\"arena_bytes\":%u,\"peak\":%u,"
+            "\"fails\":%u", (unsigned int) sizeof(serialMonLogClass), (unsigned int) sizeof(serialMonCmdClass),
+            (unsigned int) sizeof(serialMonWatchClass), scratchLen, smScratch.peak, smScratch.failCount);
+  benchReport(&b, extra);
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    nameFilter = argv[1];
+  smLog.setTimeStamp(&sysTimer);
+  benchLogImmediate();
+  benchLogFiltered();
+  benchLogFilteredTag();
+  benchLogDeferred();
+  benchLogBinary();
+  benchLogThrottled();
+  benchLogRateLimit();
+  benchLogCollapse();
+  benchLogHistory();
+  benchLogIsr("log_isr_1thread", 1);
+  benchLogIsr("log_isr_4threads", 4);
+  benchLogSinkFile();
+  benchLogSinkFanout();
+  benchGetCmdLine();
+  benchPasteLatency();
+  benchParamParse();
+  benchDispatch();
+  benchMenuPath();
+  benchResumable();
+  benchBatch();
+  benchTwoSessions();
+  benchFrames();
+  benchStaged();
+  benchWatch("watch_sample_csv", false);
+  benchWatch("watch_sample_binary", true);
+  benchParamRegistry();
+  benchSched("sched_wheel_128_mixed", "sched_poll_128_mixed", benchTaskPeriodsMixed);
+  benchSched("sched_wheel_128_slow", "sched_poll_128_slow", benchTaskPeriodsSlow);
+  benchNumbers();
+  benchProbes();
+  benchScratch();
+  return (0);
+}
@@ -1,96 +1,154 @@
 /* Menu.cpp
-    Example implementation of user menu functions. The example includes a top-level (main) menu and one sub-menu
-    that is accessed via a single-character command from the main menu. 
+    Example implementation of a menu tree. The main menu is a command table whose entries either execute a command or
+    enter a submenu (the built-in log, parameter, probe, script, scheduler and watch menus), and one sub-menu is
+    implemented by a user menu function. 
 */
 #include <Arduino.h>
 #include "SerialMonCmd.h"
 #include "SerialMonLog.h"
+#include "SerialMonLogMenu.h"
+#include "SerialMonParam.h"
+#include "SerialMonProbe.h"
+#include "SerialMonSched.h"
+#include "SerialMonScratch.h"
+#include "SerialMonWatch.h"
 #include "Menu.h"
 
 extern serialMonCmdClass smCmd;       // object defined in main.cpp
 extern serialMonLogClass smLog;       // object defined in main.cpp
-char msgBuf[80];                      // temp buffer for assembling example output strings
+extern serialMonWatchClass smWatch;   // object defined in main.cpp
+extern serialMonSchedClass smSched;   // object defined in main.cpp
+extern serialMonLogRingClass logRing; // object defined in main.cpp
+extern uint32_t logMsgPeriod;         // variable defined in main.cpp
+const uint8_t msgBufLen = 80;         // size of the temp buffers for assembling example output strings, which are
+                                      //    borrowed from the scratch arena shared with the library (SerialMonScratch.h)
 
 
-/* menuMain()
-    Example of a top-level user menu function. Called by serialMonCmdClass::processCommands() which provides a single 
-    parameter of type execTypeEnum. This parameter specifies one of three execution scenarios for mainMenu():
-      PROMPT - Just print a menu-specific prompt, using the serialMonCmdClass::menuPrompt() function
-      COMMAND - Parse the command line that was assembled by processCommands() using the parsing functions provided by the 
-                  serialMonInput class, and then execute the desired config/control actions. The actions could include
-                  activating a lower-level command menu, using serialMonCmdClass:nextMenu().
-      ESCAPE - Take appropriate actions to exit the current menu, such as to "pop up" a level in a multi-level menu structure.
-                This is triggered when the user presses the <ESC> key when the command line is empty. In this example,
-                <ESC> is not used to exit the main menu. Instead, an "exit" ('x') command is defined to do this. 
+  // Configuration parameters (see SerialMonParam.h), which can be read and written from the parameter menu ('c'
+  // command). Entries must be sorted by name; this is checked at compile time by PARAM_TABLE_SORTED.
+constexpr paramEntryStruct params[] = {
+  PARAM_NAMED("logLevel", smLog.logLevel, 0, 255, ""),
+  PARAM(logMsgPeriod, 10, 60000, "ms")
+};
+PARAM_TABLE_SORTED(params);
+constexpr paramTableStruct paramTable = {params, sizeof(params) / sizeof(params[0])};
+
+  // Scripts that can be run from the script menu ('r' command). Each line is executed from the main menu, e.g.
+  // "r r slow" sets both parameters, and prints the execution time of each command.
+constexpr cmdScriptStruct scripts[] = {
+  {"fast", "# frequent log messages\nc set logLevel 1\nc set logMsgPeriod 100\n"},
+  {"slow", "# default log messages\nc set logLevel 1\nc set logMsgPeriod 1000\n"}
+};
+constexpr cmdScriptTableStruct scriptTable = {scripts, sizeof(scripts) / sizeof(scripts[0])};
+
+  // Built-in submenus, entered from the main menu (<ESC> returns to the main menu)
+constexpr cmdTableStruct paramMenu = {"Config", paramMenuEntries, paramMenuCount, (void *) &paramTable};
+constexpr cmdTableStruct logMenu = {"Log", logMenuEntries, logMenuCount, &smLog};               // SerialMonLogMenu.h
+constexpr cmdTableStruct schedMenu = {"Sched", schedMenuEntries, schedMenuCount, &smSched};     // SerialMonSched.h
+constexpr cmdTableStruct scriptMenu = {"Script", scriptMenuEntries, scriptMenuCount, (void *) &scriptTable};
+constexpr cmdTableStruct watchMenu = {"Watch", watchMenuEntries, watchMenuCount, &smWatch};     // SerialMonWatch.h
+
+
+/* Command handler functions for the main menu. Each is called by serialMonCmdClass::dispatch() with the parameters
+    that have been parsed and validated according to the parameter signature in the command table below. 
   Parameters: 
-    execTypeEnum execType: see above
+    cmdArgsStruct *args: parsed parameters (see SerialMonCmd.h)
   Returns: None
 */
-void menuMain(execTypeEnum execType) {
-  char cmdChar;       // command character parsed from the command line buffer
-  bool error;         // indicates error condition detected by parameter parsing functions
-  float fParam[2];    // two floating-point parameters for the example 'f' command
-  int iParam;         // one integer parameter for the example 'i' command
+void cmdDump(cmdArgsStruct *args) {     // example 'd' command that prints the messages kept by the in-memory log sink
+  if (logRing.dump(args->cmd->getStream()) == 0)
+    args->cmd->getStream()->println("No messages");
+}
 
-  switch (execType) {
-    case PROMPT:        // Just print the menu prompt and return
-      smCmd.menuPrompt("Main", "Commands: f <float> <float>, i <int>, t, x");   // example prompt/cue messages for this menu
-    break;
-        // Parse and execute a command line. Note that a loop could be used to parse multiple commands per command line
-    case COMMAND:       
-      cmdChar = smCmd.input.getCmdChar();   // find the first command character in the line 
-      switch (cmdChar) {    // take actions based on the command character
-        case 'f':   // example 'f' command that accepts two float parameters
-          fParam[0] = smCmd.input.getFloatParam(&error);  // get the first float value and check for error
-          if (error) {
-            Serial.println("Invalid or missing float parameter");
-            return;   // don't do anything else if error
-          }
-          fParam[1] = smCmd.input.getFloatParam(&error);  // get second float param
-          if (error) {
-            Serial.println("Invalid or missing float parameter");
-            return;
-          }           // both parameters read with no errors
-            // assemble and print string to indicate what command is being executed
-          sprintf(msgBuf, "Executing: f (%3.2f, %3.2f)", fParam[0], fParam[1]); // replace this with program-specific actions
-          Serial.println(msgBuf);
-        break;
-        case 'i':   // example 'i' command that accepts one int parameter
-          iParam = smCmd.input.getIntParam(&error);   // get int param and check for error
-          if (error) {
-            Serial.println("Invalid or missing integer parameter");
-            return;
-          }
-          sprintf(msgBuf, "Executing: i (%i)", iParam);   // replace with program-specific action
-          Serial.println(msgBuf);
-        break;
-        case 't':   // example 't' command that activates a lower-level menu 
-          smCmd.nextMenu(menuLevel1);   // transition to menuLevel1
-        break;
-        case 'x':   // 'x' command to exit main menu and terminate menu command mode
-          smCmd.exit();
-        break;
-        case '\0':  // if <RETURN> is pressed with empty line, discard line and do nothing
-        break;
-        default:  // any other cmdChar than those handled above
-          Serial.print("Unknown command: ");
-          Serial.println(cmdChar);
-        break;
-      }
-    break;
-    case ESCAPE:    // don't do anything for ESCAPE from main menu; Use the 'x' command to exit
-    break;
-    default:
-    break;
-  }
+void cmdFloat(cmdArgsStruct *args) {    // example 'f' command that accepts two float parameters
+  scratchBufClass msgBuf(msgBufLen);
+
+    // assemble and print string to indicate what command is being executed
+  snprintf(msgBuf.p, msgBuf.len, "Executing: f (%3.2f, %3.2f)", args->param[0].f, args->param[1].f);
+                                        // replace this with program-specific actions
+  args->cmd->getStream()->println(msgBuf.p);  // print to the stream of the session that dispatched the command
+}
+
+void cmdInt(cmdArgsStruct *args) {      // example 'i' command that accepts one int parameter
+  scratchBufClass msgBuf(msgBufLen);
+
+  snprintf(msgBuf.p, msgBuf.len, "Executing: i (%i)", (int) args->param[0].i);   // replace with program-specific action
+  args->cmd->getStream()->println(msgBuf.p);
 }
 
+  // state of the example 'n' command, a resumable command that runs in steps over many calls to processCommands()
+struct countStruct {
+  int32_t next;                         // next number to print
+  int32_t last;                         // last number to print
+};
+countStruct countState;
+
+cmdStepEnum countStep(cmdArgsStruct *args) {  // prints one number per step (<ESC> cancels)
+  countStruct *count = (countStruct *) args->state;
+  Stream *outP = args->cmd->getStream();
+
+  if (args->cancel)                     // nothing to clean up
+    return (CMD_DONE);
+  if (outP->availableForWrite() < 16)   // wait for room in the output stream, rather than block
+    return (CMD_WAIT);
+  outP->println(count->next);
+  return ((count->next++ < count->last) ? CMD_CONTINUE : CMD_DONE);
+}
+
+void cmdCount(cmdArgsStruct *args) {    // example 'n' command that prints 1 to <count> without stalling the main loop
+  countState.next = 1;
+  countState.last = args->param[0].i;
+  if (countState.last > 0)
+    args->cmd->resume(args, countStep, &countState);
+}
+
+void cmdTest(cmdArgsStruct *args) {     // example 't' command that activates a lower-level user menu function
+  args->cmd->nextMenu(menuLevel1);      // transition to menuLevel1
+}
+
+void cmdExit(cmdArgsStruct *args) {     // 'x' command to exit main menu and terminate menu command mode
+  args->cmd->exit();
+}
+
+  // Command table for the main menu: keyword, parameter signature, handler, parameter help (NULL = generated), or a
+  // submenu. Entries must be sorted by keyword; this is checked at compile time by CMD_TABLE_SORTED. A submenu can be
+  // entered with a command after it in the same line, e.g. "w a loopCount" adds loopCount to the watch selection (and
+  // stays in the main menu), or alone, e.g. "w" enters the watch menu.
+constexpr cmdEntryStruct mainEntries[] = {
+  CMD_SUBMENU("c", paramMenu),
+  {"d", "", cmdDump, NULL},
+  {"f", "ff", cmdFloat, NULL},
+  {"i", "i", cmdInt, NULL},
+  CMD_SUBMENU("l", logMenu),
+  {"n", "i", cmdCount, "<count>"},
+  CMD_SUBMENU("p", probeMenu),
+  CMD_SUBMENU("r", scriptMenu),
+  CMD_SUBMENU("s", schedMenu),
+  {"t", "", cmdTest, NULL},
+  CMD_SUBMENU("w", watchMenu),
+  {"x", "", cmdExit, NULL}
+};
+CMD_TABLE_SORTED(mainEntries);
+  // root of the menu tree (see main.cpp); CMD_MENU_TREE checks that the tree fits in the navigation stack
+constexpr cmdTableStruct mainTable = {"Main", mainEntries, sizeof(mainEntries) / sizeof(mainEntries[0]), NULL};
+CMD_MENU_TREE(mainTable);
+
 
 /* menuLevel1()
-    Example of a lower-level user menu function. Takes action based on the parameter, similar to menuMain) above. 
+    Example of a lower-level user menu function, as an alternative to a command table. Called by
+    serialMonCmdClass::processCommands() which provides a single parameter of type execTypeEnum. This parameter
+    specifies one of three execution scenarios:
+      PROMPT - Just print a menu-specific prompt, using the serialMonCmdClass::menuPrompt() function
+      COMMAND - Parse the command line that was assembled by processCommands() using the parsing functions provided by the 
+                  serialMonInput class, and then execute the desired config/control actions. The actions could include
+                  activating a lower-level command menu, using serialMonCmdClass:nextMenu().
+      ESCAPE - Take appropriate actions to exit the current menu, such as to "pop up" a level in a multi-level menu structure.
+                This is triggered when the user presses the <ESC> key when the command line is empty. Unlike table
+                menus, which are popped from the navigation stack automatically, a user menu function must name the
+                menu to return to. 
     In this simple example, this menu implements no commands, and can be exited with <ESC> 
   Parameters: 
-    execTypeEnum execType: see menuMain()
+    execTypeEnum execType: see above
   Returns: None
 */
 void menuLevel1(execTypeEnum execType) {
@@ -106,13 +164,13 @@ void menuLevel1(execTypeEnum execType) {
         case '\0':
         break;
         default:
-          Serial.print("Unknown command: ");
-          Serial.println(cmdChar);
+          smCmd.getStream()->print("Unknown command: ");   // to the session's stream, which may not be Serial
+          smCmd.getStream()->println(cmdChar);
         break;
       }
     break;
     case ESCAPE:
-      smCmd.nextMenu(menuMain);   // go back up to menuMain() if <ESC> is pressed with empty line
+      smCmd.nextMenu(&mainTable); // go back up to the main menu if <ESC> is pressed with empty line
     break;
     default:
     break;
@@ -1,7 +1,7 @@
 #include <Arduino.h>
 #include "SerialMonCmd.h"
 
-void menuMain(execTypeEnum execType);
+extern const cmdTableStruct mainTable;    // root of the menu tree
 void menuLevel1(execTypeEnum execType);
 void menuMevel2(execTypeEnum execType);
 
@@ -6,49 +6,100 @@
 #include <elapsedMillis.h>      // system library that implements 1-ms resolution timers
 #include "SerialMonLog.h"       // header file for library containing log message functions
 #include "SerialMonCmd.h"       // header file for library to implement command menu functions
+#include "SerialMonProbe.h"     // header file for profiling probes (see the 'p' command in the main menu)
+#include "SerialMonWatch.h"     // header file for watch-variable streaming (see the 'w' command in the main menu)
+#include "SerialMonOut.h"       // header file for output staging (coalesces output into whole USB packets)
+#include "SerialMonSched.h"     // header file for the task scheduler (see the 's' command in the main menu)
+#include "SerialMonSink.h"      // header file for log sinks (additional destinations for log messages)
 #include "Menu.h"              // header file for example user menu functions
 
 
 serialMonLogClass smLog;        // object used to print log messages to serial monitor (see SerialMonLog.h) [Don't change name!]
 serialMonCmdClass smCmd;        // object used to implement serial monitor command menus (SerialMonCommands.h)
+serialMonWatchClass smWatch;    // object used to stream watched variables (SerialMonWatch.h)
+serialMonOutClass smOut;        // output staging stream between the objects above and Serial (SerialMonOut.h)
+serialMonSchedClass smSched;    // scheduler that runs the tasks below from the main loop (SerialMonSched.h)
+serialMonLogRingClass logRing;  // in-memory ring of recent log lines, written by a sink of smLog (SerialMonSink.h)
 
   // Variables and constants used to implement this example program
 elapsedMillis sysTimer;         // ms-resolution free-running "system timer" used to generate log message timestamps
-elapsedMillis loopTimer;        // timer used to control rate of main loop execution
-elapsedMillis logTimer;         // timer used to generate periodic log messages for example
-const uint32_t loopPeriod = 10;     // 10-ms period for main loop
-const uint32_t logMsgPeriod = 1000; // 1-second period for log messages
+const uint32_t loopPeriod = 10;     // 10-ms period for the main task
+const uint32_t drainPeriod = 5; // 5-ms period for the log drain task
+uint32_t logMsgPeriod = 1000;   // 1-second period for log messages (can be changed from the config menu)
 uint16_t logMsgNum;             // used to count log periodic messages
 bool serialCmdEnable = true;    // variable that can be used to enable/disable command menus
+uint32_t loopCount;             // number of main task executions
+const uint8_t tagMsg = 1;       // tag of the example log messages (set its level with "l t msg <level>")
+logEntryStruct logHist[32];     // smLog's history ring (see the 'l' command in the main menu), 28 bytes per entry
+char logHistText[256];          // copies of the string arguments of the messages in smLog's history ring
+batchCmdStruct batchLog[16];    // smCmd's record of the commands of a batch or script, listed in its summary
+char logText[1024];             // logRing's text: messages up to level 2, even while a command menu is active
+                                // (print them with the 'd' command in the main menu, set the level with "l s ring 3")
+logSinkStruct ringSink = LOG_SINK_INIT("ring", logSinkRing, &logRing, 2);   // library sink function
+
+  // variables that can be selected and streamed from the watch menu
+constexpr watchVarStruct watchVars[] = {WATCH_VAR(logMsgNum), WATCH_VAR(loopCount), WATCH_VAR(serialCmdEnable)};
+
+void taskMain(schedTaskStruct *task);
+void taskLogMsg(schedTaskStruct *task);
+
+  // tasks run by smSched (their statistics can be viewed with the scheduler menu)
+schedTaskStruct mainTask = SCHED_TASK_INIT("main", taskMain, NULL);
+schedTaskStruct logMsgTask = SCHED_TASK_INIT("logmsg", taskLogMsg, NULL);
+schedTaskStruct drainTask = SCHED_TASK_INIT("drain", schedTaskLogDrain, &smLog);  // library task function
 
 void setup() {
   Serial.begin(115200);         // set baud rate for serial monitor
   while (!Serial);              // wait for serial monitor to initialize
+  smOut.begin(&Serial);         // send all output through the staging stream, so that short prints are coalesced
+  smLog.setStream(&smOut);
+  smCmd.setStream(&smOut);
+  smWatch.setStream(&smOut);
   sysTimer = 0;                 // initialize the free-running system timer to 0
   smLog.setTimeStamp(&sysTimer);    // specify the system timer is to be used to generate log message timestamps
   smLog.logLevel = 1;           // set the log message criticality level to 1 (print messages with criticality of 0 - 1)
   smLog.enable = true;          // enable log message printing
+  smLog.setHistory(logHist, logHistText);   // keep recent messages (up to level 2) in the history ring, even if they
+  smLog.history = true;                     //    aren't printed (see the 'l' command in the main menu)
+  smLog.histLevel = 2;
+  smLog.setTagName(tagMsg, "msg");  // messages tagged tagMsg are filtered by their own level, instead of logLevel
+  smLog.tagLevel[tagMsg] = 1;
+  logRing.setBuffer(logText);   // keep a copy of the log in memory, whether or not it is printed
+  smLog.addSink(&ringSink);
   LOGMSG(1, "This should print: %u", 5);      // example log message, criticality level 1
   LOGMSG(2, "This shouldn't print: %u", 10);  // example log message, criticality level 2 (less critical)
-  smCmd.initMenu(menuMain);     // specify root command menu (SerialUI.cpp)
-  logMsgNum = 0;                // intialize log message counter used in main loop
-  loopTimer = 0;                // initialize main loop timer
+  smCmd.initMenu(&mainTable);   // specify root command menu (Menu.cpp)
+  smCmd.setBatchLog(batchLog);  // list the execution time of each command in the summary of a batch or script
+  smWatch.init(watchVars, sizeof(watchVars) / sizeof(watchVars[0]));  // register the watchable variables
+  logMsgNum = 0;                // intialize log message counter used in the log message task
+  smSched.every(&mainTask, loopPeriod);       // start the tasks
+  smSched.every(&logMsgTask, logMsgPeriod);
+  smSched.every(&drainTask, drainPeriod);
+}
+
+  // Main task, executed every loopPeriod ms, to illustrate usage of log and menu functions
+void taskMain(schedTaskStruct *) {
+  SMPROBE_SCOPE("loop");                    // measure the execution time of the main task
+  smCmd.processCommands(serialCmdEnable);   // execute the current command menu (if enabled and active)
+  smLog.enable = !smCmd.cmdMode;            // temporarily disable log messages when a command menu is active
+                                            // (they are still recorded in the history, and can be replayed)
+  loopCount++;
+  smWatch.sample();                         // stream the selected watch variables (if started)
+
+  // Perform all other "normal" program functions here, or in tasks of their own.
+  // For more guidance, see https://electricfiredesign.com/2021/03/18/simple-multi-tasking-for-arduino/
+
+}
+
+  // Example task that generates a periodic log message, every logMsgPeriod ms
+void taskLogMsg(schedTaskStruct *task) {
+  LOGMSG_TAG(tagMsg, 1, "log message %u", logMsgNum++);  // print the example log message
+  task->periodMs = logMsgPeriod;            // follow changes to the period made from the config menu
 }
 
-  // Very simple main loop to illustrate usage of log and menu functions
+  // Very simple main loop: everything else is done by the scheduled tasks
 void loop() {
-  if (loopTimer >= loopPeriod) {            // if it's time to execute the main loop functions (every 10ms)
-    loopTimer = 0;                          // reinitialize the loop timer
-    smCmd.processCommands(serialCmdEnable); // execute the current command menu (if enabled and active)
-    smLog.enable = !smCmd.cmdMode;          // temporarily disable log messages when a command menu is active
-
-    // Perform all other "normal" program functions here. 
-    // For more guidance, see https://electricfiredesign.com/2021/03/18/simple-multi-tasking-for-arduino/
-
-  }
-  if (logTimer >= logMsgPeriod) {           // if it's time to generate a periodic log message (example)
-    logTimer = 0;                           // reinitialize the log message timer
-    LOGMSG(1, "log message %u", logMsgNum++); // print the example log message
-  }
+  smSched.run();                            // execute the tasks that are due
+  smOut.poll();                             // send any partial packet of output that has been held for 2 ms
 }
 
@@ -0,0 +1,107 @@
+/* Arduino.h (host stand-in)
+    Minimal stand-in for the parts of the Arduino/Teensy core used by the SerialMonUtils library, so that the library
+    can be built and measured on the host (see the "native" environment in platformio.ini). Only used for host builds;
+    target builds use the real core headers.
+    Serial is a hostStreamClass object (see below), which takes its input from a queue filled by the test/benchmark
+    program, and captures and/or counts its output. Its TX buffer can be throttled to simulate a slow host link.
+    hostAdvanceTime() moves millis() and micros() forward without waiting, so that tests can check time-dependent
+    behaviour (e.g. a throttled TX buffer draining, or a rate limit refilling) deterministically.
+*/
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <deque>
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+void hostAdvanceTime(uint32_t us);
+
+  // Subset of the Arduino Print class
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len);
+  virtual int availableForWrite() { return (0); }
+  virtual void flush() {}
+  size_t write(const char *str) { return (write((const uint8_t *) str, strlen(str))); }
+  size_t write(const char *buf, size_t len) { return (write((const uint8_t *) buf, len)); }
+  size_t print(const char *str) { return (write(str)); }
+  size_t print(char c) { return (write((uint8_t) c)); }
+  size_t print(int val) { return (printNum("%d", val)); }
+  size_t print(unsigned int val) { return (printNum("%u", val)); }
+  size_t print(long val) { return (printNum("%ld", val)); }
+  size_t print(unsigned long val) { return (printNum("%lu", val)); }
+  size_t print(double val, int digits = 2);
+  size_t println() { return (write((const uint8_t *) "\r\n", 2)); }
+  template <typename T> size_t println(T val) { size_t n = print(val); return (n + println()); }
+  size_t println(double val, int digits) { size_t n = print(val, digits); return (n + println()); }
+private:
+  template <typename T> size_t printNum(const char *fmt, T val) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), fmt, val);
+    return (write(buf));
+  }
+};
+
+  // Subset of the Arduino Stream class
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+/* hostStreamClass
+    Host stand-in for a serial port. Input is queued by calling feed(). Output is counted (writeCalls, bytesWritten,
+    usbPackets) and, if capture is true, appended to the "output" string. If txBufSize is non-zero, the TX buffer has
+    that many bytes and drains at txBytesPerMs (so availableForWrite() reports a throttled amount of free space, and
+    bytes written when the buffer is full are counted in txOverrun).
+*/
+class hostStreamClass : public Stream {
+  std::deque<uint8_t> rxQueue;    // bytes waiting to be read
+  uint32_t txPending;             // bytes in the simulated TX buffer
+  uint32_t txDrainMicros;         // time of the last TX buffer drain calculation
+  void drainTx();
+public:
+  hostStreamClass() {
+    txPending = 0; txDrainMicros = 0; txBufSize = 0; txBytesPerMs = 0; capture = false; usbPacketSize = 64; resetCounts();
+  }
+  std::string output;             // captured output (if capture is true)
+  bool capture;                   // if true, output is appended to the output string
+  uint32_t txBufSize;             // size of the simulated TX buffer (0 = unlimited)
+  uint32_t txBytesPerMs;          // drain rate of the simulated TX buffer (0 = drains instantly)
+  uint32_t writeCalls;            // number of write() calls
+  uint32_t usbPackets;            // number of USB packets, if each write() is sent as a separate USB CDC transfer of
+                                  //    usbPacketSize-byte packets (as when the device sends as soon as it is written)
+  uint16_t usbPacketSize;         // USB bulk packet size used for usbPackets (default 64)
+  uint64_t bytesWritten;          // number of bytes written
+  uint64_t txOverrun;             // number of bytes written when the simulated TX buffer was full
+  void feed(const char *str) { feed((const uint8_t *) str, strlen(str)); }
+  void feed(const uint8_t *buf, size_t len) { rxQueue.insert(rxQueue.end(), buf, buf + len); }
+  void resetCounts() { writeCalls = 0; usbPackets = 0; bytesWritten = 0; txOverrun = 0; }
+  int available() { return ((int) rxQueue.size()); }
+  int read();
+  int peek() { return (rxQueue.empty() ? -1 : rxQueue.front()); }
+  size_t write(uint8_t c) { return (write(&c, 1)); }
+  size_t write(const uint8_t *buf, size_t len);
+  using Print::write;
+  int availableForWrite();
+  void begin(uint32_t baud) { (void) baud; }
+  operator bool() { return (true); }
+};
+
+extern hostStreamClass Serial;
+extern hostStreamClass Serial1;
+
+#endif  // _HOST_ARDUINO_H
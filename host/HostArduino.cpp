@@ -0,0 +1,127 @@
+/* HostArduino
+    Implementation of the host stand-in for the Arduino core (see host/Arduino.h). Time is taken from the host's
+    steady (monotonic) clock, starting at 0 when the program starts, plus any time added by hostAdvanceTime().
+*/
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+hostStreamClass Serial;
+hostStreamClass Serial1;
+
+  // time of the first call, which may be made by the constructor of a global object (e.g. an elapsedMillis timer)
+static std::chrono::steady_clock::time_point startTime() {
+  static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return (start);
+}
+
+static std::atomic<uint64_t> advanceMicros(0);   // time added by hostAdvanceTime()
+
+  // microseconds since the first call
+static uint64_t hostMicros() {
+  return ((uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+          startTime()).count() + advanceMicros.load());
+}
+
+uint32_t millis() {
+  return ((uint32_t) (hostMicros() / 1000));
+}
+
+uint32_t micros() {
+  return ((uint32_t) hostMicros());
+}
+
+void hostAdvanceTime(uint32_t us) {
+  advanceMicros += us;
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+
+size_t Print::write(const uint8_t *buf, size_t len) {
+  size_t n = 0;
+
+  while (len--)
+    n += write(*buf++);
+  return (n);
+}
+
+size_t Print::print(double val, int digits) {
+  char buf[40];
+
+  snprintf(buf, sizeof(buf), "%.*f", digits, val);
+  return (write(buf));
+}
+
+
+/* hostStreamClass::read()
+    Returns the next queued input byte, or -1 if none
+*/
+int hostStreamClass::read() {
+  int c;
+
+  if (rxQueue.empty())
+    return (-1);
+  c = rxQueue.front();
+  rxQueue.pop_front();
+  return (c);
+}
+
+
+/* hostStreamClass::drainTx()
+    Updates the number of bytes in the simulated TX buffer, based on the drain rate and the time since the last update
+*/
+void hostStreamClass::drainTx() {
+  uint32_t now = micros();
+  uint64_t drained;
+
+  if (txBytesPerMs == 0) {
+    txPending = 0;
+    return;
+  }
+  drained = ((uint64_t) (uint32_t) (now - txDrainMicros) * txBytesPerMs) / 1000;
+  if (drained == 0)
+    return;
+  txPending = (drained >= txPending) ? 0 : (txPending - (uint32_t) drained);
+  txDrainMicros = now;
+}
+
+
+/* hostStreamClass::write()
+    Counts (and optionally captures) a block of output bytes
+*/
+size_t hostStreamClass::write(const uint8_t *buf, size_t len) {
+  uint32_t room;
+
+  writeCalls++;
+  usbPackets += (len + usbPacketSize - 1) / usbPacketSize;
+  bytesWritten += len;
+  if (txBufSize != 0) {
+    drainTx();
+    room = (txPending < txBufSize) ? (txBufSize - txPending) : 0;
+    if (len > room)
+      txOverrun += len - room;
+    txPending += len;
+  }
+  if (capture)
+    output.append((const char *) buf, len);
+  return (len);
+}
+
+
+/* hostStreamClass::availableForWrite()
+    Returns the free space in the simulated TX buffer (a large constant if the buffer is unlimited)
+*/
+int hostStreamClass::availableForWrite() {
+  if (txBufSize == 0)
+    return (4096);
+  drainTx();
+  return ((txPending < txBufSize) ? (int) (txBufSize - txPending) : 0);
+}
@@ -0,0 +1,31 @@
+/* elapsedMillis.h (host stand-in)
+    Host version of the Teensy elapsedMillis and elapsedMicros timer classes (see host/Arduino.h)
+*/
+#ifndef _HOST_ELAPSEDMILLIS_H
+#define _HOST_ELAPSEDMILLIS_H
+
+#include <Arduino.h>
+
+class elapsedMillis {
+  uint32_t ms;
+public:
+  elapsedMillis() { ms = millis(); }
+  elapsedMillis(uint32_t val) { ms = millis() - val; }
+  operator uint32_t() const { return (millis() - ms); }
+  elapsedMillis &operator=(uint32_t val) { ms = millis() - val; return (*this); }
+  elapsedMillis &operator+=(uint32_t val) { ms -= val; return (*this); }
+  elapsedMillis &operator-=(uint32_t val) { ms += val; return (*this); }
+};
+
+class elapsedMicros {
+  uint32_t us;
+public:
+  elapsedMicros() { us = micros(); }
+  elapsedMicros(uint32_t val) { us = micros() - val; }
+  operator uint32_t() const { return (micros() - us); }
+  elapsedMicros &operator=(uint32_t val) { us = micros() - val; return (*this); }
+  elapsedMicros &operator+=(uint32_t val) { us -= val; return (*this); }
+  elapsedMicros &operator-=(uint32_t val) { us += val; return (*this); }
+};
+
+#endif  // _HOST_ELAPSEDMILLIS_H
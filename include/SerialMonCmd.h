@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "SerialMonInput.h"
+#include "SerialMonFrame.h"
 
 #ifndef _SERIALMONCOMMANDS_TYPES      // prevent multiple redefinition of types in this header
 #define _SERIALMONCOMMANDS_TYPES
@@ -10,18 +11,254 @@ enum execTypeEnum {PROMPT,  // just print the cue/prompt for the user menu
                   COMMAND,  // parse and execute the menu-specific commands from the command line
                   ESCAPE};  // initiate transition to "next level up" menu
 
+const uint8_t maxCmdParams = 4;       // max number of parameters for a command table entry
+const uint16_t maxPromptLen = 160;    // size of the buffer used to assemble a prompt (longer prompts take several
+                                      //    writes), taken from the scratch arena (see SerialMonScratch.h)
+const uint8_t maxMenuDepth = 8;       // size of the menu navigation stack (max number of nested table menus)
+const uint8_t maxBatchText = 24;      // size of the buffer holding the start of each listed command line
+const char batchStartLine[] = "{";    // command line that starts a batch of commands read from the stream
+const char batchStopLine[] = "{!";    // same, but the batch stops at the first command that fails
+const char batchEndLine[] = "}";      // command line that ends a batch, and prints its summary
+
+class serialMonCmdClass;
+struct cmdTableStruct;
+
+  // a single parsed command parameter; the member used depends on the parameter signature (see cmdEntryStruct)
+union cmdParamUnion {
+  float f;          // 'f' or 'F' (float) parameter
+  int32_t i;        // 'i' or 'I' (integer) parameter
+  const char *s;    // 'w' or 'W' (word) parameter, pointing into the (null-terminated) command line buffer
+};
+
+  // enum returned by the step function of a resumable command (see serialMonCmdClass::resume())
+enum cmdStepEnum {CMD_CONTINUE,   // more work to do: call again (within the same call to processCommands() if the
+                                  //    time budget allows)
+                  CMD_WAIT,       // waiting (e.g. for hardware, or room in the output stream): call again in the next
+                                  //    call to processCommands()
+                  CMD_DONE};      // finished (or cancelled)
+
+  // parameters passed to a command table handler function (and to the step function of a resumable command)
+struct cmdArgsStruct {
+  serialMonCmdClass *cmd;               // command object that dispatched the command
+  void *context;                        // context pointer from the command table (cmdTableStruct::context)
+  uint8_t count;                        // number of parameters parsed (may be less than the signature if optional)
+  cmdParamUnion param[maxCmdParams];    // parsed parameters, in signature order ('w' parameters point into the command
+                                        //    line, so are only valid in the handler, not in a step function)
+  void *state;                          // state object of a resumable command (see serialMonCmdClass::resume())
+  bool cancel;                          // set when a resumable command has been cancelled with <ESC>: the step
+                                        //    function should clean up and return CMD_DONE
+};
+
+  // a single entry in a command table. Command tables must be sorted by key (see CMD_TABLE_SORTED below)
+struct cmdEntryStruct {
+  const char *key;                      // command keyword: a single character or a short word
+  const char *params;                   // parameter signature, one char per parameter: 'f' float, 'i' integer, 'w' word;
+                                        //    uppercase for optional parameters, which must follow any required ones
+  void (*handler)(cmdArgsStruct *args); // function called to execute the command (calls args->cmd->fail() if the
+                                        //    command fails, see serialMonCmdClass::fail())
+  const char *help;                     // parameter description for the cue string (NULL: generated from params)
+  const cmdTableStruct *submenu = NULL; // table menu entered by this entry, instead of calling a handler (see CMD_SUBMENU)
+};
+
+  // a command table, used to implement a menu without writing a user menu function (see serialMonCmdClass::tableMenu())
+struct cmdTableStruct {
+  const char *prompt;                   // prompt string for the menu, e.g. "Main"
+  const cmdEntryStruct *entries;        // pointer to an array of entries, sorted by key
+  uint8_t count;                        // number of entries
+  void *context;                        // pointer passed to each handler (e.g. the object a built-in menu operates on)
+};
+
+/* cmdKeyCompare(), cmdEntriesSorted() [constexpr]
+    Compile-time string comparison of command keys, and a check that a command table is sorted by key (as required
+    for the binary search used by serialMonCmdClass::dispatch()). Used by the CMD_TABLE_SORTED macro. 
+*/
+constexpr int cmdKeyCompare(const char *a, const char *b) {
+  return ((*a != *b) ? ((uint8_t) *a - (uint8_t) *b) : ((*a == '\0') ? 0 : cmdKeyCompare(a + 1, b + 1)));
+}
+constexpr bool cmdEntriesSorted(const cmdEntryStruct *entries, uint8_t n) {
+  return ((n < 2) ? true : ((cmdKeyCompare(entries[0].key, entries[1].key) < 0) && cmdEntriesSorted(entries + 1, n - 1)));
+}
+
+/* CMD_TABLE_SORTED() [Macro]
+    Verifies at compile time that a constexpr array of cmdEntryStruct is sorted by key, with no duplicate keys
+  Parameters:
+    entries: name of the array
+  Example: CMD_TABLE_SORTED(mainEntries);
+*/
+#define CMD_TABLE_SORTED(entries) static_assert(cmdEntriesSorted(entries, sizeof(entries) / sizeof(entries[0])), \
+                                    #entries " must be sorted by key, with no duplicates")
+
+/* CMD_SUBMENU() [Macro]
+    Initializer for a command table entry that enters a submenu. With submenu entries, a complete menu tree can be
+    defined as constexpr command tables, with no user menu functions: serialMonCmdClass keeps a navigation stack of
+    the table menus that have been entered, <ESC> returns to the previous one, and the prompt shows the path from
+    the root, e.g. "<Main/Config/Motor>-> ". A submenu can also be entered by path in a single command line, e.g.
+    "cfg motor pid", and a command may follow the path, e.g. "cfg motor set 2" (which then returns to the current
+    menu).
+  Parameters:
+    const char *key: command keyword
+    table: name of the submenu's cmdTableStruct
+  Example: constexpr cmdEntryStruct mainEntries[] = {CMD_SUBMENU("cfg", cfgMenu), {"x", "", cmdExit, NULL}};
+*/
+#define CMD_SUBMENU(key, table) {(key), "", NULL, NULL, &(table)}
+
+/* cmdTableDepth(), cmdEntriesDepth() [constexpr]
+    Compile-time depth of a menu tree (the root table counts as 1), for checking that it fits in the navigation stack.
+    Used by the CMD_MENU_TREE macro.
+*/
+constexpr uint8_t cmdTableDepth(const cmdTableStruct *table);
+constexpr uint8_t cmdEntriesDepth(const cmdEntryStruct *entries, uint8_t n) {
+  return ((n == 0) ? 0 : ((entries[0].submenu == NULL) ? cmdEntriesDepth(entries + 1, n - 1) :
+          ((cmdTableDepth(entries[0].submenu) > cmdEntriesDepth(entries + 1, n - 1)) ? cmdTableDepth(entries[0].submenu) :
+          cmdEntriesDepth(entries + 1, n - 1))));
+}
+constexpr uint8_t cmdTableDepth(const cmdTableStruct *table) {
+  return (1 + cmdEntriesDepth(table->entries, table->count));
+}
+
+/* CMD_MENU_TREE() [Macro]
+    Verifies at compile time that a menu tree (a constexpr cmdTableStruct and the submenus it leads to) is no deeper
+    than maxMenuDepth, so that every menu in it can be entered
+  Parameters:
+    table: name of the root cmdTableStruct
+  Example: CMD_MENU_TREE(mainTable);
+*/
+#define CMD_MENU_TREE(table) static_assert(cmdTableDepth(&(table)) <= maxMenuDepth, \
+                              #table " menu tree is deeper than maxMenuDepth")
+
+  // execution record of a command in a batch, listed in the batch summary (see serialMonCmdClass::setBatchLog())
+struct batchCmdStruct {
+  uint32_t micros;                      // execution time (us), until the command finished if it was resumable
+  bool ok;                              // false if the command failed (table menu commands only)
+  char text[maxBatchText];              // start of the command line
+};
+
+  // state of a batch of commands (see serialMonCmdClass::runScript())
+struct batchStruct {
+  bool active;                          // indicates that a batch is being executed
+  bool stopOnError;                     // stop at the first command that fails
+  bool stopped;                         // the batch has been stopped (by an error or <ESC>): remaining lines are skipped
+  const char *scriptP;                  // next line of the script being run (NULL for a batch read from the stream)
+  uint16_t count;                       // number of commands executed
+  uint16_t errors;                      // number of commands that failed
+  uint16_t skipped;                     // number of command lines skipped after the batch was stopped
+  uint32_t startMicros;                 // time (micros()) at which the batch was started
+  uint32_t cmdMicros;                   // time (micros()) at which the command being executed was started
+  uint32_t execMicros;                  // sum of the execution times of all commands
+  bool savedCmdMode;                    // command mode, menu and echo state when the batch was started, restored at
+  bool savedEcho;                       //    the end of the batch
+  void (*savedFuncP)(execTypeEnum execType);
+  const cmdTableStruct *savedStack[maxMenuDepth];
+  uint8_t savedDepth;
+  batchCmdStruct *cmds;                 // records of the first cmdsLen commands (see serialMonCmdClass::setBatchLog())
+  uint8_t cmdsLen;                      // number of entries in cmds (0 if no batch log has been set)
+};
+
 class serialMonCmdClass {
+  Stream *streamP;                                // stream used for menu input and output (see setStream())
   void (*initMenuFuncP)(execTypeEnum execType);   // pointer to the "root" user menu function
-  void (*menuFuncP)(execTypeEnum execType);       // pointer to the current user menu function
+  const cmdTableStruct *initMenuTableP;           // pointer to the "root" command table, if the root menu is a table
+  void (*menuFuncP)(execTypeEnum execType);       // pointer to the current user menu function, if no table menu is active
+  const cmdTableStruct *menuStack[maxMenuDepth];  // navigation stack of the table menus entered (current one on top)
+  uint8_t menuDepth;                              // number of table menus on the navigation stack
+  void callMenu(execTypeEnum execType);
+  void rootMenu();
+  bool popMenu();
+  cmdStepEnum (*stepFuncP)(cmdArgsStruct *args);  // step function of the resumable command in progress (NULL if none)
+  cmdArgsStruct stepArgs;                         // parameters of the resumable command in progress
+  bool runCommand();
+  bool cancelReceived();
+  bool cmdOk;                                     // false if the last command failed (see fail())
+  uint8_t magicIdx;                               // number of characters of the frame mode magic sequence matched
+  bool framePending;                              // a request frame received while a command was in progress is waiting
+  bool frameCancel;                               // the command in progress was cancelled by a request frame
+  bool matchMagic(char c);
+  void startFrames();
+  void processFrames();
+  batchStruct batch;                              // batch of commands in progress (see runScript())
+  bool lineIs(const char *text);
+  void startBatch(const char *script, bool stopOnError);
+  void batchCommand();
+  void endBatchCommand();
+  void runScriptLine();
+  void stopBatch();
+  void endBatch();
+  void restoreMenu();
+  const cmdEntryStruct *findCmd(const cmdTableStruct *table, const char *key);
+  bool isPath(const cmdTableStruct *table);
 public:
-  serialMonCmdClass() { cmdMode = false; menuFuncP = NULL; }  // class object constructor
+  serialMonCmdClass() {                     // class object constructor
+    streamP = &Serial; cmdMode = false; initMenuFuncP = menuFuncP = NULL; initMenuTableP = NULL; menuDepth = 0;
+    stepFuncP = NULL; maxStepMicrosPerCall = 1000; frameMode = false; magicIdx = 0; cmdOk = true;
+    framePending = frameCancel = false;
+    batch.active = false; batch.scriptP = NULL; batch.cmds = NULL; batch.cmdsLen = 0;
+  }
   bool cmdMode;                             // indicates that menu command mode is active
+  bool frameMode;                           // indicates that frame mode is active (see SerialMonFrame.h)
   serialMonInputClass input;                // object used to read serial monitor input and assemble command line
+  uint32_t maxStepMicrosPerCall;            // time budget (us) per call to processCommands() for a resumable command
+  serialMonFrameClass frame;                // frame mode request decoder and reply encoder
+  void setStream(Stream *streamP);
+  Stream *getStream() { return (streamP); }
   void processCommands(bool enable);
   void initMenu(void (*fP)(execTypeEnum));
+  void initMenu(const cmdTableStruct *table);
   void nextMenu(void (*fP)(execTypeEnum));
+  bool nextMenu(const cmdTableStruct *table);
+  uint8_t getMenuDepth() { return (menuDepth); }
   void menuPrompt(const char *prompt, const char *cue);
+  void tablePrompt(const cmdTableStruct *table);
+  bool dispatch(const cmdTableStruct *table);
+  void tableMenu(execTypeEnum execType, const cmdTableStruct *table);
+  void resume(cmdArgsStruct *args, cmdStepEnum (*stepP)(cmdArgsStruct *args), void *state);
+  void fail() { cmdOk = false; }            // reports that the command being executed has failed (see dispatch())
+  bool busy() { return ((stepFuncP != NULL) || (batch.scriptP != NULL)); }
+  bool runScript(const char *script, bool stopOnError);
+  void setBatchLog(batchCmdStruct *cmds, uint8_t len);
+  template <size_t n>
+  void setBatchLog(batchCmdStruct (&cmds)[n]) {   // size taken from the array, e.g. setBatchLog(batchLog)
+    static_assert(n <= 255, "a batch log can have at most 255 entries");
+    setBatchLog(cmds, n);
+  }
+  bool batchActive() { return (batch.active); }
   void exit();
 };
 
+  // a named script: a sequence of command lines, run as a batch (see serialMonCmdClass::runScript())
+struct cmdScriptStruct {
+  const char *name;                     // script name
+  const char *text;                     // command lines, each terminated by '\n'
+};
+
+  // a list of scripts, used as the context of the built-in script menu
+struct cmdScriptTableStruct {
+  const cmdScriptStruct *scripts;       // pointer to an array of scripts
+  uint8_t count;                        // number of scripts
+};
+
+/* Built-in script menu
+    A command table for running the scripts of a cmdScriptTableStruct (the table's context). Scripts are string
+    constants compiled into the program (on Teensy 4.x, the text can be declared PROGMEM to keep it out of RAM), and
+    are run from the root menu, so that they can use menu paths (see CMD_SUBMENU), e.g.
+      constexpr cmdScriptStruct scripts[] = {{"bench", "# bench setup\ncfg motor set 2\ncfg pid 1.5 0.2 0\n"}};
+      constexpr cmdScriptTableStruct scriptTable = {scripts, sizeof(scripts) / sizeof(scripts[0])};
+      constexpr cmdTableStruct scriptMenu = {"Script", scriptMenuEntries, scriptMenuCount, (void *) &scriptTable};
+    Commands:
+      l                 list the scripts
+      r <name>          run a script, printing a summary at the end (with the execution time of each command, if the
+                        command object has a batch log, see serialMonCmdClass::setBatchLog())
+      s <name>          same, but stop at the first command that fails
+*/
+void scriptMenuList(cmdArgsStruct *args);
+void scriptMenuRun(cmdArgsStruct *args);
+void scriptMenuStop(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct scriptMenuEntries[] = {
+  {"l", "", scriptMenuList, NULL},
+  {"r", "w", scriptMenuRun, "<name>"},
+  {"s", "w", scriptMenuStop, "<name>"}
+};
+CMD_TABLE_SORTED(scriptMenuEntries);
+const uint8_t scriptMenuCount = sizeof(scriptMenuEntries) / sizeof(scriptMenuEntries[0]);
+
 #endif  // _SERIALMONCOMMANDS_TYPES
\ No newline at end of file
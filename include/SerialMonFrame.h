@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include "SerialMonInput.h"
+
+#ifndef _SERIALMONFRAME_TYPES     // prevent multiple redefinition of types in this header
+#define _SERIALMONFRAME_TYPES
+
+/* Frame mode
+    An alternate command session mode for machine-driven control (e.g. by a test rig). It is entered by sending the
+    magic sequence frameMagic followed by '\n' (in or out of menu command mode), and left by a command that exits
+    command mode (serialMonCmdClass::exit()). In frame mode, nothing is echoed and no prompts are printed. Each request
+    and reply is a frame, encoded with COBS (Consistent Overhead Byte Stuffing) so that it contains no zero bytes, and
+    terminated by a zero byte. Decoded, the frames are:
+      request: <seq> <command line> <crc16>
+      reply:   <seq> <status> <text> <crc16>
+    where seq is a sequence number chosen by the sender of the request and copied into its reply, the command line is
+    the same text as would be typed in text mode (or a single <ESC> character, to return to the previous menu), status
+    is a frameStatusEnum, text is the output of the command handler, and crc16 is the CRC-16/CCITT-FALSE of the
+    preceding bytes, low byte first. Output longer than maxFrameText is sent in several reply frames, all but the last
+    with status FRAME_PARTIAL. Requests may be pipelined: they are executed in order, each as soon as it has been
+    received, without waiting for the previous reply to be read. The menu handlers are the same as in text mode (their
+    output to the command object's stream becomes the reply text).
+    While a resumable command or a script is in progress (see serialMonCmdClass::resume()), the next request is
+    received but not executed until it has finished, unless it is a single <ESC> character: this cancels the command,
+    which is answered with FRAME_ERROR (and the text "Cancelled"), and the <ESC> request is then answered with
+    FRAME_OK. Requests pipelined behind another one are only read after that one has been executed, so a cancel
+    request must directly follow the request that started the command.
+*/
+const char frameMagic[] = "\x02SMF1";           // magic sequence (followed by '\n') that enters frame mode
+const uint8_t maxFrameText = 120;               // max text in a reply frame (longer output is split into several)
+const uint8_t maxFrameLen = maxInputLen + 2;    // max decoded request frame: seq, command line (< maxInputLen), crc16
+const uint8_t maxFrameCode = maxFrameLen + 1;   // max COBS-encoded request frame (without the zero terminator)
+
+  // enum indicating the status of a reply frame
+enum frameStatusEnum {FRAME_OK,       // command executed
+                      FRAME_ERROR,    // command failed (unknown, invalid parameter, fail(), cancelled); text says why
+                      FRAME_PARTIAL,  // more reply frames follow for the same request
+                      FRAME_BAD,      // request frame rejected (bad CRC, or too long); seq is 0 if it was unreadable
+                      FRAME_READY};   // frame mode has been entered (seq 0, sent in reply to the magic sequence)
+
+uint16_t smCrc16(const uint8_t *data, uint16_t len);
+uint16_t smCobsEncode(const uint8_t *src, uint16_t len, uint8_t *dst);
+int16_t smCobsDecode(uint8_t *buf, uint16_t len);
+
+/* serialMonFrameClass
+    Used by serialMonCmdClass to implement frame mode: receives and decodes request frames from a port, and collects
+    the output of a command handler (it is the command object's stream while frame mode is active) into reply frames,
+    which are written to the port in a single write() each.
+*/
+class serialMonFrameClass : public Stream {
+  Stream *portP;                                // underlying stream (serial port)
+  uint8_t rxBuf[maxFrameCode];                  // request frame being received (COBS-encoded, then decoded in place)
+  uint8_t rxLen;                                // number of bytes in rxBuf
+  bool rxOverflow;                              // indicates that the request frame being received is too long
+  uint8_t rxSeq;                                // sequence number of the last request received
+  uint8_t reply[maxFrameText + 4];              // reply frame being assembled (seq, status, text, crc16)
+  uint8_t replyLen;                             // number of text bytes in reply
+  void writeFrame(uint8_t *data, uint16_t len);
+  void sendFrame(uint8_t status);
+public:
+  uint32_t rxFrames;                            // number of valid request frames received
+  uint32_t rxErrors;                            // number of request frames rejected
+  uint32_t txFrames;                            // number of reply frames sent
+  serialMonFrameClass() {
+    portP = &Serial; rxLen = 0; rxOverflow = false; rxSeq = 0; replyLen = 0; rxFrames = rxErrors = txFrames = 0;
+  }
+  void begin(Stream *portP) { this->portP = portP; rxLen = 0; rxOverflow = false; replyLen = 0; }
+  Stream *getPort() { return (portP); }
+  bool receive(uint8_t c);
+  const char *text() { return ((const char *) rxBuf + 1); }   // command line of the last request received
+  bool isEscape() { return ((rxBuf[1] == escChar) && (rxBuf[2] == '\0')); }   // true if the request is a single <ESC>
+  void startReply() { reply[0] = rxSeq; replyLen = 0; }       // starts the reply to the last request received
+  void endReply(frameStatusEnum status);
+  void sendReady();
+  size_t write(uint8_t c) { return (write(&c, 1)); }
+  size_t write(const uint8_t *data, size_t size);
+  using Print::write;
+  int availableForWrite() { return (portP->availableForWrite()); }
+  int available() { return (0); }   // input is read from the port by serialMonCmdClass
+  int read() { return (-1); }
+  int peek() { return (-1); }
+};
+
+#endif  // _SERIALMONFRAME_TYPES
@@ -1,25 +1,92 @@
 #include <Arduino.h>
+#include "SerialMonScratch.h"
 
 #ifndef _SERIALMONINPUT_TYPES     // prevent multiple redefinition of types in this header
 #define _SERIALMONINPUT_TYPES
 
-const uint8_t maxInputLen = 80;   // maximum characters in a single command line (including terminating '\0')
+/* SERIALMON_INPUT_LEN
+    Size of the command line buffer of each serialMonInputClass object (i.e. of each command session), which is the
+    max number of characters in a command line plus one. Defaults to 80, and may be overridden with a build flag,
+    e.g. "-D SERIALMON_INPUT_LEN=48" (max 250, since a binary request frame must also fit in 255 bytes).
+    The size is the same for every session: the buffer is a member of serialMonInputClass (so a session can receive
+    input as soon as it is constructed), and the commands, menus and sessions all refer to serialMonInputClass and
+    serialMonCmdClass by pointer, which a template size parameter would turn into a different type for each size.
+*/
+#ifndef SERIALMON_INPUT_LEN
+#define SERIALMON_INPUT_LEN 80
+#endif
+
+const uint8_t maxInputLen = SERIALMON_INPUT_LEN;  // max characters in a single command line (including the '\0')
 const char escChar = '\x1B';      // ASCII ESC character, used for multiple purposes
+const uint8_t maxTokens = 16;     // maximum number of tokens (parameters) in a single command line
+const uint8_t maxEchoLen = 64;    // size of the buffer used to coalesce echoed characters into a single write (taken
+                                  //    from the scratch arena, see SerialMonScratch.h)
+
+static_assert((maxInputLen >= 8) && (maxInputLen <= 250), "SERIALMON_INPUT_LEN must be 8 - 250");
+
+  // enum indicating the type of a command line token, as determined by serialMonInputClass::tokenize()
+enum tokenTypeEnum {TOK_INT,      // decimal integer, with optional sign (e.g. -123)
+                    TOK_FLOAT,    // decimal number with a decimal point and/or exponent (e.g. 1.5, -.5, 2e3)
+                    TOK_HEX,      // hexadecimal integer (e.g. 0x1F)
+                    TOK_STRING,   // double-quoted string, which may contain blanks (quotes are not included)
+                    TOK_WORD,     // any other blank-delimited sequence of characters
+                    TOK_NONE};    // no token (returned at end of line)
+
+  // location and type of a single token within the command line buffer
+struct tokenStruct {
+  uint8_t offset;             // index of the first character in buf
+  uint8_t len;                // number of characters
+  uint8_t type;               // tokenTypeEnum
+};
 
 class serialMonInputClass {
+  Stream *streamP;            // stream used for command line input and echo (Serial unless changed by setStream())
   char buf[maxInputLen];      // buffer to hold a single command line
-  char *bufP;                 // pointer to buf, used both for adding and reading characters
-  void skipBlanks();  
-  void skipPast();        
-  bool scanToNum();
+  uint8_t lineLen;            // number of characters in buf (not including terminating '\0')
+  bool lineDone;              // indicates that the line in buf is complete, and should be discarded when reading resumes
+  uint16_t byteCount;         // number of bytes read since startBudget()
+  uint32_t startMicros;       // time (micros()) of the last call to startBudget()
+  tokenStruct tokens[maxTokens];  // tokens found in the completed command line
+  uint8_t numTokens;          // number of tokens in the completed command line
+  uint8_t tokenIdx;           // index of the next token to be read by the getXxx() functions
+  char *echoBuf;              // echoed characters (and erase sequences) not yet written to the stream
+  uint8_t echoBufLen;         // size of echoBuf (0 if there is none, outside of getCmdLine() and clearLine())
+  uint8_t echoLen;            // number of characters in echoBuf
+  bool readLine();
+  void echo(const char *s, uint8_t len);
+  void flushEcho();
+  void tokenize();
+  bool tokenToInt64(const tokenStruct *tokP, int64_t *val);
 public:
-  serialMonInputClass() { bufP = buf; *bufP = '\0'; }   // class object constructor; initialize buffer and bufP
+  serialMonInputClass() {     // class object constructor; initialize buffer
+    streamP = &Serial; resetLine(); maxBytesPerCall = 256; maxMicrosPerCall = 2000; startBudget();
+    echoBuf = NULL; echoBufLen = echoLen = 0; echoEnabled = true;
+  }
   bool escape;                // indicates a command line containing only an ESC character
+  bool echoEnabled;           // echo received characters to the stream (disabled e.g. during a batch of commands)
+  uint16_t maxBytesPerCall;   // max number of bytes read per budget period (0 = no limit)
+  uint32_t maxMicrosPerCall;  // max time (us) spent reading per budget period (0 = no limit)
+  void setStream(Stream *streamP);
+  Stream *getStream() { return (streamP); }
   bool getCmdLine();
+  void setLine(const char *text);
+  bool readChar(char *c);
+  void startBudget();
   float getFloatParam(bool *error); 
   int getIntParam(bool *error); 
+  int32_t getFixedParam(uint8_t decimals, bool *error);
+  int32_t getQ16Param(bool *error);
+  int32_t getInt32Param(bool *error);
+  int64_t getInt64Param(bool *error);
+  char *getWordParam(bool *error);
+  uint8_t tokenCount() { return (numTokens); }
+  uint8_t tokensLeft() { return (numTokens - tokenIdx); }
+  tokenTypeEnum peekType() { return ((tokenIdx < numTokens) ? (tokenTypeEnum) tokens[tokenIdx].type : TOK_NONE); }
+  tokenTypeEnum tokenType(uint8_t n) { return ((n < numTokens) ? (tokenTypeEnum) tokens[n].type : TOK_NONE); }
+  const char *tokenText(uint8_t n) { return ((n < numTokens) ? (buf + tokens[n].offset) : ""); }
   void eraseChar();
   void clearLine();
+  void resetLine();
   char getCmdChar();
 };
 
@@ -1,36 +1,651 @@
 #include <Arduino.h>
 #include <elapsedMillis.h>
+#include <type_traits>
+#include "SerialMonScratch.h"
+#include "SerialMonSink.h"
 
 #ifndef _SERIALMONLOG_TYPES       // prevent multiple redefinition of types in this header
 #define _SERIALMONLOG_TYPES
 
+/* SMLOG_MAX_LEVEL, SMLOG_MODULE_LEVEL
+    Compile-time ceilings for log message criticality levels. A LOGMSG call site with a msgLevel greater than either
+    ceiling compiles to nothing, so it costs no code space or execution time, and its format string is not stored in
+    flash. SMLOG_MAX_LEVEL applies to the whole program and is normally set with a build flag 
+    (e.g. "-D SMLOG_MAX_LEVEL=1"). SMLOG_MODULE_LEVEL applies to a single module (translation unit), and must be defined
+    before this header is included (e.g. "#define SMLOG_MODULE_LEVEL 0"). Below the ceiling, the runtime logLevel
+    continues to determine which messages are printed. 
+*/
+#ifndef SMLOG_MAX_LEVEL
+#define SMLOG_MAX_LEVEL 255
+#endif
+#ifndef SMLOG_MODULE_LEVEL
+#define SMLOG_MODULE_LEVEL SMLOG_MAX_LEVEL
+#endif
+#define SMLOG_CEILING (smLogMinLevel(SMLOG_MAX_LEVEL, SMLOG_MODULE_LEVEL))
+
+constexpr uint8_t smLogMinLevel(uint8_t a, uint8_t b) { return ((a < b) ? a : b); }
+
 /* LOGMSG() [Variadic Macro]
-    Optionally prints a timestamped log message, based on the criticality level of the message relative to the current system 
+    Optionally prints a timestamped log message, based on the criticality level of the message relative to the current system
     logging level determined by a referenced variable. Printing is also conditional upon a referenced variable that can
     globally enable/disable all log messages. This macro assumes the existence of a serialMonLogClass object named "smLog",
-    which should be defined globally for access by all functions that use this macro
+    which should be defined globally for access by all functions that use this macro (see LOGMSG_TO for other loggers).
+    The msgLevel is first compared to the compile-time ceiling (see SMLOG_MAX_LEVEL above). Since both are constants, the
+    compiler removes the entire call site if the message level is above the ceiling.
+    If smLog.deferred is true, the message is not formatted or printed immediately. Instead, the format string pointer,
+    timestamp and raw argument values are captured in a ring buffer, to be formatted and printed later by
+    serialMonLogClass::drain(). String (%s) arguments are captured as pointers, so in deferred mode they must be
+    static: string literals, or buffers whose contents don't change until the message has been printed. Otherwise, a
+    message that has to be queued (because it can't be printed immediately) gets copies of its string arguments (see
+    SMLOG_TEXT_LEN), so any string may be passed.
+    If smLog.history is true, messages with a level up to smLog.histLevel are also recorded in the history ring (see
+    serialMonLogClass::logMsg()), whether or not they are printed, with copies of their string arguments (see
+    serialMonLogClass::setHistory()). Messages are also written to any sinks that have
+    been added (see serialMonLogClass::addSink()), according to the level of each sink, whether or not they are
+    printed.
   Parameters:
     uint8_t msgLevel: message criticality level (0 = most critical)
     ...: variadic argument consisting of an sprintf format string followed by a variable number of variables
   Returns: None
   Example: LOGMSG(2, "The value of foo is %u", foo);    // Note that the '\n' may be omitted
 */
-#define LOGMSG(msgLevel, ...) if ((smLog.enable) && (msgLevel <= smLog.logLevel)) \
-                                    { sprintf(smLog.msgBuf, __VA_ARGS__); smLog.printLog(); }
+#define LOGMSG(msgLevel, ...) LOGMSG_TO(smLog, msgLevel, __VA_ARGS__)
+
+  // true if a message is to be written to at least one of the logger's sinks (see serialMonLogClass::addSink())
+#define SMLOG_SINK_WANTED(logger, msgLevel) ((int16_t) (msgLevel) <= (logger).sinkLevel)
+  // true if a message is to be printed, recorded in the history ring (see serialMonLogClass::logMsg()), or written
+  // to a sink
+#define SMLOG_WANTED(logger, msgLevel) ((((logger).enable) && ((msgLevel) <= (logger).logLevel)) || \
+                                          (((logger).history) && ((msgLevel) <= (logger).histLevel)) || \
+                                          SMLOG_SINK_WANTED(logger, msgLevel))
+  // same, for a tagged message (see LOGMSG_TAG): the tag is a constant, so its level is read like logLevel
+#define SMLOG_TAG_LEVEL(logger, tag) ((logger).tagLevel[(tag) & (maxLogTags - 1)])
+#define SMLOG_TAG_WANTED(logger, tag, msgLevel) \
+          ((((logger).enable) && ((msgLevel) <= SMLOG_TAG_LEVEL(logger, tag))) || \
+            (((logger).history) && ((msgLevel) <= (logger).histLevel)) || SMLOG_SINK_WANTED(logger, msgLevel))
+
+/* LOGMSG_TO(), LOGMSG_RL_TO(), LOGISR_TO() [Variadic Macros]
+    Same as LOGMSG, LOGMSG_RL and LOGISR, but print to a named serialMonLogClass object instead of "smLog". This allows
+    several independent loggers (e.g. one for USB serial and one for a hardware UART, see serialMonLogClass::setStream()),
+    each with its own logLevel and other settings. 
+  Parameters:
+    logger: name of a serialMonLogClass object
+    (remaining parameters as for LOGMSG, LOGMSG_RL and LOGISR)
+  Returns: None
+  Example: LOGMSG_TO(uartLog, 1, "Link state %u", state);
+*/
+#define LOGMSG_TO(logger, msgLevel, ...) if (((msgLevel) <= SMLOG_CEILING) && SMLOG_WANTED(logger, msgLevel)) \
+                                    { (logger).logMsg((msgLevel), __VA_ARGS__); }
+#define LOGMSG_RL_TO(logger, msgLevel, burst, periodMs, ...) if (((msgLevel) <= SMLOG_CEILING) && SMLOG_WANTED(logger, msgLevel)) \
+                                    { static logRateStruct smLogRate = {0, 0, (uint8_t) (burst)}; \
+                                      if ((logger).rateCheck(&smLogRate, (burst), (periodMs))) (logger).logMsg((msgLevel), __VA_ARGS__); }
+#define LOGISR_TO(logger, msgLevel, ...) if (((msgLevel) <= SMLOG_CEILING) && ((((logger).enable) && \
+                                    ((msgLevel) <= (logger).logLevel)) || SMLOG_SINK_WANTED(logger, msgLevel))) \
+                                    { (logger).logIsr((msgLevel), (logger).logLevel, __VA_ARGS__); }
+
+/* LOGMSG_TAG(), LOGMSG_TAG_TO(), LOGISR_TAG(), LOGISR_TAG_TO() [Variadic Macros]
+    Same as LOGMSG, LOGMSG_TO, LOGISR and LOGISR_TO, for a message that belongs to a subsystem identified by a tag
+    (0 - maxLogTags-1). A tagged message is filtered by the logging level of its tag (tagLevel[tag]) instead of
+    logLevel, so that verbose output can be enabled for one subsystem only. Since the tag is a constant, the check
+    costs the same as for an untagged message. Tag levels (and names, see setTagName()) can be changed from the
+    built-in log menu (see SerialMonLogMenu.h). The compile-time ceiling applies as for LOGMSG.
+  Parameters:
+    logger: name of a serialMonLogClass object (_TO macros only)
+    uint8_t tag: message tag (a constant, e.g. an enum value)
+    (remaining parameters as for LOGMSG and LOGISR)
+  Returns: None
+  Example: LOGMSG_TAG(tagMotor, 3, "Step rate %u", rate);
+*/
+#define LOGMSG_TAG(tag, msgLevel, ...) LOGMSG_TAG_TO(smLog, tag, msgLevel, __VA_ARGS__)
+#define LOGMSG_TAG_TO(logger, tag, msgLevel, ...) if (((msgLevel) <= SMLOG_CEILING) && \
+                                    SMLOG_TAG_WANTED(logger, tag, msgLevel)) \
+                                    { (logger).logMsgLimit((msgLevel), SMLOG_TAG_LEVEL(logger, tag), __VA_ARGS__); }
+#define LOGISR_TAG(tag, msgLevel, ...) LOGISR_TAG_TO(smLog, tag, msgLevel, __VA_ARGS__)
+#define LOGISR_TAG_TO(logger, tag, msgLevel, ...) if (((msgLevel) <= SMLOG_CEILING) && ((((logger).enable) && \
+                                    ((msgLevel) <= SMLOG_TAG_LEVEL(logger, tag))) || \
+                                    SMLOG_SINK_WANTED(logger, msgLevel))) \
+                                    { (logger).logIsr((msgLevel), SMLOG_TAG_LEVEL(logger, tag), __VA_ARGS__); }
+
+/* LOGMSG_RL() [Variadic Macro]
+    Same as LOGMSG, but rate limited per call site using a token bucket: up to "burst" messages may be printed
+    back-to-back, after which one more message is allowed every periodMs. The bucket state is a static variable created
+    by the macro, so each call site is limited independently. Suppressed messages are counted (in suppressCount and per
+    call site), and when the call site next prints, it first prints a "[N messages suppressed]" line.
+  Parameters:
+    uint8_t msgLevel: message criticality level (0 = most critical)
+    uint8_t burst: number of messages that may be printed without delay (1 - 255)
+    uint16_t periodMs: time (ms) to earn permission for one more message (must be non-zero)
+    ...: sprintf format string followed by a variable number of variables, as for LOGMSG
+  Returns: None
+  Example: LOGMSG_RL(1, 3, 1000, "Sensor fault %u", code);   // at most 3 messages, then 1 per second
+*/
+#define LOGMSG_RL(msgLevel, burst, periodMs, ...) LOGMSG_RL_TO(smLog, msgLevel, burst, periodMs, __VA_ARGS__)
+
+/* LOGISR() [Variadic Macro]
+    Same as LOGMSG, but safe to use in an interrupt handler or any other execution context that may preempt the main
+    loop (including a second thread on the host). The message is never formatted or printed by LOGISR: its format
+    string pointer, timestamp and raw arguments are copied into a slot of a lock-free multi-producer queue, and moved to
+    the ring buffer and printed by the next call to serialMonLogClass::drain() from the main loop (which also formats
+    it for the sinks, if any). If the queue is full, the message is discarded and counted in isrDropCount. Repeat
+    collapsing (collapseRepeats) does not apply. As in deferred mode, string (%s) arguments must be static.
+  Parameters:
+    uint8_t msgLevel: message criticality level (0 = most critical)
+    ...: sprintf format string (a string literal) followed by up to maxLogArgs variables
+  Returns: None
+  Example: LOGISR(1, "Encoder overflow at count %u", count);
+*/
+#define LOGISR(msgLevel, ...) LOGISR_TO(smLog, msgLevel, __VA_ARGS__)
+
+/* SMLOG_RING_LEN, SMLOG_ISR_QUEUE_LEN
+    Number of entries (28 bytes each on 32-bit targets) in the ring buffer of each serialMonLogClass object, which
+    holds deferred messages and messages waiting for room in the output buffer, and in its LOGISR queue (32 bytes
+    each; must be a power of 2). Both default to 16, and may be overridden with build flags (e.g. "-D SMLOG_RING_LEN=8
+    -D SMLOG_ISR_QUEUE_LEN=4") on targets that are short of RAM. The history ring is sized separately for each object
+    (see serialMonLogClass::setHistory()).
+    These sizes (and SMLOG_TEXT_LEN) are the same for every serialMonLogClass object, unlike the optional history
+    ring, because the ring, queue and pool are members that every object needs from construction (a message or LOGISR
+    entry may be queued at any time, even from an interrupt, before the program could supply them), and the LOG
+    macros, sinks and menus refer to serialMonLogClass by pointer or reference, which a template size parameter would
+    turn into a different type for each size.
+*/
+#ifndef SMLOG_RING_LEN
+#define SMLOG_RING_LEN 16
+#endif
+#ifndef SMLOG_ISR_QUEUE_LEN
+#define SMLOG_ISR_QUEUE_LEN 16
+#endif
+
+/* SMLOG_TEXT_LEN
+    Size of the string pool of each serialMonLogClass object, which holds copies of the string (%s) arguments of the
+    messages that are queued in the ring buffer because they couldn't be printed immediately (see
+    serialMonLogClass::outputMsg()). Defaults to 128 bytes, and may be overridden with a build flag (e.g. "-D
+    SMLOG_TEXT_LEN=64"). A queued message whose strings don't fit in the pool is discarded (as if the ring buffer were
+    full); with 0, every such message is discarded. Deferred messages don't use the pool.
+*/
+#ifndef SMLOG_TEXT_LEN
+#define SMLOG_TEXT_LEN 128
+#endif
 
 const uint8_t maxMsgLen = 100;      // max number of characters in a log message string, including the terminating '\0'
-const uint8_t maxTimestampLen = 10; // max number of chars in a timestamp string (float seconds), including '\0
+const uint8_t maxTimestampLen = 16; // max number of chars in a timestamp string ("[s.mmm] "), including '\0'
+const uint8_t logLineLen = maxTimestampLen + maxMsgLen + 1;   // size of a complete line (timestamp, message, CR/NL)
+const uint8_t maxLogArgs = 4;       // max number of format arguments captured per deferred log message
+const uint8_t logRingLen = SMLOG_RING_LEN;  // number of entries in the deferred log message ring buffer
+const uint8_t maxLogFormats = 32;   // number of format strings that can be interned for binary output (power of 2)
+const uint8_t isrQueueLen = SMLOG_ISR_QUEUE_LEN;  // number of slots in the LOGISR queue (power of 2)
+const uint8_t maxLogTags = 16;      // number of message tags, each with its own level (see LOGMSG_TAG; power of 2)
+const uint16_t logTextLen = SMLOG_TEXT_LEN;   // size of the string pool for the arguments of queued messages
+
+static_assert(logRingLen >= 2, "SMLOG_RING_LEN must be at least 2");
+static_assert((isrQueueLen & (isrQueueLen - 1)) == 0, "SMLOG_ISR_QUEUE_LEN must be a power of 2");
+static_assert(logLineLen <= scratchLen, "SERIALMON_SCRATCH_LEN is too small for a log message line");
+
+  // record type codes used by the binary log output format (see serialMonLogClass::printBinary())
+enum logRecordEnum {LOG_REC_SYNC = 0xA5,  // start of stream: followed by "SML1"; resets format IDs and timestamp
+                    LOG_REC_FMT = 0x01,   // format string definition: ID, length (varint), characters
+                    LOG_REC_MSG = 0x02,   // message with timestamp: ID, timestamp delta (varint), args (see below)
+                    LOG_REC_MSG_NOTS = 0x03,  // message without timestamp: ID, args
+                    LOG_REC_TEXT = 0x04}; // preformatted text line: length (varint), characters (including timestamp)
+
+#ifdef SERIALMON_NO_FLOAT_PRINTF           // see SerialMonNum.h
+const bool noFloatPrintf = true;          // immediate messages are captured and formatted by formatEntry(), not sprintf()
+#else
+const bool noFloatPrintf = false;
+#endif
+
+  // enum indicating what to do with a log message when the Serial output buffer and the ring buffer are both full
+enum logDropEnum {LOG_DROP_NEWEST,  // discard the new message
+                  LOG_DROP_OLDEST,  // discard the oldest queued message to make room for the new one
+                  LOG_BLOCK};       // wait up to blockMicros for output buffer space, then discard the new message
+
+  // enum indicating how a captured (deferred) log message argument is stored
+enum logArgTypeEnum {LOG_ARG_INT,   // signed integer, stored in logArgUnion::i
+                    LOG_ARG_UINT,   // unsigned integer (or char/bool), stored in logArgUnion::u
+                    LOG_ARG_FLOAT,  // float or double, stored (as float) in logArgUnion::f
+                    LOG_ARG_PTR};   // string or other pointer, stored in logArgUnion::s
+
+  // a single "raw" argument word captured by a deferred log message
+union logArgUnion {
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char *s;
+};
+
+  // a deferred log message, as captured by LOGMSG and later formatted by serialMonLogClass::drain()
+struct logEntryStruct {
+  const char *fmt;                  // pointer to the sprintf format string (must be a string literal or other static string)
+  uint32_t ts;                      // timestamp (ms) at the time of capture
+  uint8_t numArgs;                  // number of arguments captured (max = maxLogArgs)
+  uint8_t argTypes;                 // logArgTypeEnum for each argument, two bits per argument
+  uint8_t level;                    // message criticality level (history and LOGISR entries only)
+  bool hidden;                      // message wasn't printed because logging was disabled (history entries), or is
+                                    //    only to be written to the sinks, not printed (LOGISR entries)
+  logArgUnion args[maxLogArgs];     // raw argument values
+};
+
+  // a single slot in the LOGISR queue (see serialMonLogClass::logIsr())
+struct isrSlotStruct {
+  uint32_t seq;                     // sequence number indicating whether the slot is free or holds a complete entry
+  logEntryStruct entry;             // captured message
+};
+
+  // token bucket state for a single LOGMSG_RL call site (see serialMonLogClass::rateCheck())
+struct logRateStruct {
+  uint32_t lastMs;                  // time (millis()) from which the next token is being earned
+  uint32_t suppressed;              // number of messages suppressed since this call site last printed
+  uint8_t tokens;                   // number of messages that may be printed now
+};
+
+  // bit mask of the arguments of a log message (one bit per argument, up to maxLogArgs) that are strings (char
+  // pointers), so that their characters can be copied if the message is kept (see logTextPoolClass::keep())
+template <typename... argTs>
+struct logStrArgs {
+  static const uint8_t mask = 0;
+};
+template <typename T, typename... argTs>
+struct logStrArgs<T, argTs...> {
+  static const uint8_t mask = (std::is_pointer<T>::value &&
+                                std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type,
+                                              char>::value) | (logStrArgs<argTs...>::mask << 1);
+};
+
+/* logTextPoolClass
+    A pool of characters for the copies of the string arguments of log messages that are kept after the LOGMSG call
+    that logged them, so that they don't point to the caller's buffers (e.g. a local array, which no longer exists
+    when the message is printed). The copies for a message are taken as a single block from the head of the pool, and
+    released from its tail when the message is printed or discarded, in the same order as the messages.
+*/
+class logTextPoolClass {
+  char *buf;                          // pool of characters
+  uint16_t size;                      // number of characters in buf
+  uint16_t head;                      // index of the next character to be taken
+  uint16_t tail;                      // index of the oldest character in use (equal to head if none are in use)
+  char *take(uint16_t len);
+public:
+  logTextPoolClass() { buf = NULL; size = head = tail = 0; }
+  void setBuffer(char *buf, uint16_t size) { this->buf = buf; this->size = (buf != NULL) ? size : 0; head = tail = 0; }
+  bool keep(logEntryStruct *entry, uint8_t strMask);
+  void release(const logEntryStruct *entry);
+  void clear() { head = tail = 0; }
+  uint16_t bufSize() { return (size); }
+};
+
+  // helper used by serialMonLogClass::captureArgs() to store a single argument of any type into a logArgUnion
+template <typename T, bool isPtr = std::is_pointer<T>::value, bool isFloat = std::is_floating_point<T>::value>
+struct logArgPacker {                             // integer types (including char, bool and enums)
+  static logArgTypeEnum pack(logArgUnion *arg, T val) {
+    if (std::is_signed<T>::value) {
+      arg->i = (int32_t) val;
+      return (LOG_ARG_INT);
+    }
+    arg->u = (uint32_t) val;
+    return (LOG_ARG_UINT);
+  }
+};
+template <typename T>
+struct logArgPacker<T, true, false> {             // pointer types
+  static logArgTypeEnum pack(logArgUnion *arg, T val) { arg->s = (const char *) val; return (LOG_ARG_PTR); }
+};
+template <typename T>
+struct logArgPacker<T, false, true> {             // floating point types
+  static logArgTypeEnum pack(logArgUnion *arg, T val) { arg->f = (float) val; return (LOG_ARG_FLOAT); }
+};
 
 class serialMonLogClass {
+  Stream *streamP;                        // stream used for log output (Serial unless changed by setStream())
   elapsedMillis *timeStampP;              // pointer to an elapsedMillis timer to be used for log message timestamps
-  char tsBuf[maxTimestampLen];            // temporary buffer to assemble message timestamp
+  logEntryStruct ring[logRingLen];        // ring buffer of captured (deferred) log messages
+  uint8_t ringHead;                       // index of the next ring entry to be written by logMsg()
+  uint8_t ringTail;                       // index of the next ring entry to be formatted by drain()
+  bool ringFull;                          // indicates that the previous capture attempt found the ring full
+  char ringText[logTextLen];              // copies of the string arguments of queued messages
+  logTextPoolClass ringPool;              // pool using ringText
+  void popRing() { ringPool.release(&ring[ringTail]); ringTail = (ringTail + 1) % logRingLen; }  // remove oldest entry
+  bool keepQueued(logEntryStruct *entry, uint8_t strMask);
+  const char *fmtTable[maxLogFormats];    // format strings interned for binary output, indexed by format ID
+  bool binarySynced;                      // indicates that a LOG_REC_SYNC record has been sent
+  uint32_t binaryTs;                      // timestamp of the previous binary message, used for delta encoding
+  uint8_t formatTimestamp(char *buf, uint32_t ts);
+  uint32_t dropUnreported;                // number of dropped messages not yet reported by a "messages dropped" line
+  void formatEntry(const logEntryStruct *entry, char *buf, uint8_t size);
+  bool printLine(char *line);
+  bool printBinary(const logEntryStruct *entry, uint8_t *buf);
+  int16_t internFormat(const char *fmt, bool *isNew);
+  bool waitForRoom(uint16_t len);
+  void countDrop(uint16_t len);
+  bool reportDrops();
+  bool queueFull(const char *fmt);
+  logEntryStruct lastEntry;               // previous message (format and arguments), if collapseRepeats is set
+  char lastText[maxMsgLen];               // copies of the string arguments of lastEntry
+  logTextPoolClass lastPool;              // pool using lastText
+  uint32_t repeatCount;                   // number of unreported repeats of lastEntry
+  uint32_t repeatStartMs;                 // time (millis()) of the first unreported repeat
+  bool isRepeat(const logEntryStruct *entry, uint8_t strMask);
+  logEntryStruct *hist;                   // history ring of recent messages (raw, formatted only when dumped)
+  uint8_t histLen;                        // number of entries in hist (0 if no history ring has been set)
+  uint8_t histHead;                       // index of the next history entry to be written
+  uint8_t histCount;                      // number of valid history entries
+  logTextPoolClass histPool;              // copies of the string arguments of history entries (see setHistory())
+  void keepHistory(logEntryStruct *entry, uint8_t strMask);
+  isrSlotStruct isrQueue[isrQueueLen];    // lock-free queue of messages captured by LOGISR
+  uint32_t isrHead;                       // position of the next slot to be reserved by logIsr() (atomic)
+  uint32_t isrTail;                       // position of the next slot to be moved to the ring buffer by drain()
+  void drainIsr();
+  logSinkStruct *sinks;                   // list of sinks (see addSink())
+  void updateSinkLevel();
+  void writeSinks(uint8_t level, char *line);
+  void reportRepeats();
+  void reportSuppressed(uint32_t n);
+  void captureArgs(logEntryStruct *entry) { (void) entry; }
+  template <typename T, typename... argTs>
+  void captureArgs(logEntryStruct *entry, T arg, argTs... args) {
+    if (entry->numArgs < maxLogArgs) {    // silently ignore any arguments past maxLogArgs
+      entry->argTypes |= logArgPacker<T>::pack(&entry->args[entry->numArgs], arg) << (2 * entry->numArgs);
+      entry->numArgs++;
+    }
+    captureArgs(entry, args...);
+  }
 public:
-  char msgBuf[maxMsgLen];                 // temporary buffer to assemble log messages (must be public for access by macro)
   uint8_t logLevel;                       // current logging level (0 = most critical)
   bool enable;                            // enables/disables all log messages, regardless of criticality level
-  serialMonLogClass() { logLevel = 0; enable = false; }
-  void printLog();
+  bool deferred;                          // if true, LOGMSG captures messages for later output by drain() (string
+                                          //    arguments must then be static, see LOGMSG)
+  bool binary;                            // if true, log messages are output in the binary format instead of text
+  logDropEnum dropPolicy;                 // determines which message is discarded when the ring buffer is full
+  uint32_t blockMicros;                   // max time to wait for output buffer space if dropPolicy is LOG_BLOCK
+  uint32_t dropCount;                     // number of log messages discarded
+  uint32_t dropBytes;                     // number of bytes in discarded messages (estimated for unformatted messages)
+  uint32_t overflowCount;                 // number of times the ring buffer became full (each may drop several messages)
+  bool collapseRepeats;                   // if true, consecutive identical messages are collapsed (see logMsg())
+  uint16_t repeatFlushMs;                 // max time (ms) that collapsed repeats are held before being reported
+  uint32_t suppressCount;                 // number of messages suppressed by LOGMSG_RL rate limiting
+  uint32_t isrDropCount;                  // number of LOGISR messages discarded because the queue was full (atomic)
+  bool history;                           // if true, messages up to histLevel are recorded in the history ring
+  uint8_t histLevel;                      // max criticality level of messages recorded in the history ring
+  uint8_t tagLevel[maxLogTags];           // logging level of each message tag (see LOGMSG_TAG)
+  const char *tagName[maxLogTags];        // name of each message tag, for the log menu (NULL if not named)
+  int16_t sinkLevel;                      // max level of the sinks (-1 if there are none), maintained by addSink()
+  serialMonLogClass() {
+    streamP = &Serial; timeStampP = NULL; logLevel = 0; enable = false; deferred = false; binary = false;
+    dropPolicy = LOG_DROP_NEWEST; blockMicros = 0;
+    ringHead = ringTail = 0; ringFull = false; dropCount = dropBytes = dropUnreported = overflowCount = 0;
+    collapseRepeats = false; repeatFlushMs = 1000; suppressCount = repeatCount = 0; lastEntry.fmt = NULL;
+    isrHead = isrTail = isrDropCount = 0; ringPool.setBuffer(ringText, logTextLen);
+    lastPool.setBuffer(lastText, maxMsgLen);
+    history = false; histLevel = 255; hist = NULL; histLen = histHead = histCount = 0;
+    sinks = NULL; sinkLevel = -1;
+    for (uint8_t i = 0; i < isrQueueLen; i++)
+      isrQueue[i].seq = i;
+    for (uint8_t i = 0; i < maxLogTags; i++) {
+      tagLevel[i] = 0;
+      tagName[i] = NULL;
+    }
+    binaryResync();
+  }
+  void printMsg(const char *text);
   void setTimeStamp(elapsedMillis *timeStampP);
+  void setStream(Stream *streamP);
+  Stream *getStream() { return (streamP); }
+  uint8_t drain(uint8_t budget);
+  uint8_t pending();
+  void binaryResync();
+  void setHistory(logEntryStruct *entries, uint8_t len, char *text = NULL, uint16_t textLen = 0);
+  template <size_t n>
+  void setHistory(logEntryStruct (&entries)[n]) {   // size taken from the array, e.g. setHistory(logHist)
+    static_assert(n <= 255, "a history ring can have at most 255 entries");
+    setHistory(entries, n);
+  }
+  template <size_t n, size_t m>
+  void setHistory(logEntryStruct (&entries)[n], char (&text)[m]) {  // e.g. setHistory(logHist, logHistText)
+    static_assert(n <= 255, "a history ring can have at most 255 entries");
+    static_assert(m <= 65535, "a history text pool can have at most 65535 characters");
+    setHistory(entries, n, text, m);
+  }
+  uint8_t historySize() { return (histLen); }
+  uint8_t dumpHistory(Stream *outP, uint8_t count, uint8_t maxLevel, bool hiddenOnly);
+  uint8_t replayHidden(Stream *outP);
+  uint8_t historyCount(bool hiddenOnly);
+  void clearHistory();
+  void setTagName(uint8_t tag, const char *name);
+  int16_t findTag(const char *name);
+  void setTagLevels(uint8_t level);
+  void addSink(logSinkStruct *sink);
+  void removeSink(logSinkStruct *sink);
+  void setSinkLevel(logSinkStruct *sink, uint8_t level);
+  logSinkStruct *firstSink() { return (sinks); }
+  logSinkStruct *findSink(const char *name);
+
+/* serialMonLogClass::rateCheck()
+    Token bucket check used by the LOGMSG_RL macro for a single call site. Earns one token per periodMs (up to burst),
+    and spends one token per printed message. If the call site is allowed to print after suppressing messages, a
+    "[N messages suppressed]" line is printed first. 
+  Parameters:
+    logRateStruct *rate: call site state
+    uint8_t burst: max number of tokens
+    uint16_t periodMs: time to earn one token
+  Returns:
+    bool: true if the message should be printed
+*/
+  bool rateCheck(logRateStruct *rate, uint8_t burst, uint16_t periodMs) {
+    uint32_t now = millis();
+    uint32_t earned;
+
+    if (rate->tokens < burst) {
+      earned = (now - rate->lastMs) / periodMs;
+      if (earned >= (uint32_t) (burst - rate->tokens))
+        rate->tokens = burst;
+      else {
+        rate->tokens += earned;
+        rate->lastMs += earned * periodMs;
+      }
+    }
+    if (rate->tokens == burst)            // bucket is full, so the next token is earned starting now
+      rate->lastMs = now;
+    if (rate->tokens == 0) {
+      rate->suppressed++;
+      suppressCount++;
+      return (false);
+    }
+    rate->tokens--;
+    if (rate->suppressed != 0) {
+      reportSuppressed(rate->suppressed);
+      rate->suppressed = 0;
+    }
+    return (true);
+  }
+
+/* serialMonLogClass::logMsg(), logMsgLimit() [Variadic Templates]
+    logMsg() is called by the LOGMSG macro once the message has passed the enable and logLevel checks, or the history
+    and histLevel checks. logMsgLimit() is the same, with the logging level given as a parameter instead of logLevel
+    (LOGMSG_TAG passes the level of the message's tag). If history is set and the message level is no greater than
+    histLevel, the message is captured (in raw form, like a deferred message, but with copies of its string arguments)
+    in the history ring (if one has been set with setHistory()), overwriting the oldest entry when the ring is full.
+    The entry is marked as hidden if the
+    message would have been printed but for enable being false (e.g. while a command menu is active), so that it can
+    be printed later by replayHidden().
+    Messages are written to the sinks (see addSink()) according to their own levels, independently of enable and of
+    logLevel (or the tag's level), e.g. so that a log file gets messages while nothing is printed.
+    If collapseRepeats is set, a printed message with the same format string and argument values (for a string, the
+    same characters) as the previous message is not printed, but counted; a "[last message repeated N times]" line
+    is printed when a different message is logged, or when repeats have been held for repeatFlushMs (checked by
+    logMsg() and drain()). Otherwise the message is output by outputMsg().
+  Parameters:
+    uint8_t level: message criticality level
+    uint8_t limit: logging level (logMsgLimit() only)
+    const char *fmt: sprintf format string
+    ...: a variable number of format arguments
+  Returns: None
+*/
+  template <typename... argTs>
+  void logMsg(uint8_t level, const char *fmt, argTs... args) {
+    logMsgLimit(level, logLevel, fmt, args...);
+  }
+
+  template <typename... argTs>
+  void logMsgLimit(uint8_t level, uint8_t limit, const char *fmt, argTs... args) {
+    if (history && (level <= histLevel) && (histLen != 0)) {
+      logEntryStruct *entry = &hist[histHead];
+      if (histCount == histLen) {         // ring is full: the oldest entry is overwritten
+        histPool.release(entry);
+        histCount--;
+      }
+      entry->fmt = fmt;
+      entry->ts = (timeStampP != NULL) ? (uint32_t) *timeStampP : 0;
+      entry->numArgs = 0;
+      entry->argTypes = 0;
+      entry->level = level;
+      entry->hidden = !enable && (level <= limit);
+      captureArgs(entry, args...);
+      if (logStrArgs<argTs...>::mask != 0)
+        keepHistory(entry, logStrArgs<argTs...>::mask);
+      if (++histHead == histLen)
+        histHead = 0;
+      histCount++;
+    }
+    if ((!enable || (level > limit)) && !SMLOG_SINK_WANTED(*this, level))
+      return;
+    if (collapseRepeats) {
+      logEntryStruct entry;
+      entry.fmt = fmt;
+      entry.numArgs = 0;
+      entry.argTypes = 0;
+      captureArgs(&entry, args...);
+      if (isRepeat(&entry, logStrArgs<argTs...>::mask))
+        return;
+    }
+    outputMsg(level, enable && (level <= limit), fmt, args...);
+  }
+
+/* serialMonLogClass::logIsr() [Variadic Template]
+    Called by the LOGISR macro. Reserves a slot in the lock-free queue by advancing isrHead with an atomic
+    compare-and-swap, fills it in, then publishes it by storing the slot's sequence number. Each slot's sequence number
+    is its queue position while free, and position + 1 once it holds a complete entry, so drain() (the single consumer)
+    never reads a partly written entry, and producers never reuse a slot before drain() has released it. Doesn't
+    block, and doesn't access anything else shared with the main loop. 
+  Parameters:
+    uint8_t level: message criticality level
+    uint8_t limit: logging level (logLevel, or the level of the message's tag); a message above it, or captured
+      while logging is disabled, is only written to the sinks
+    const char *fmt: sprintf format string
+    ...: a variable number of format arguments
+  Returns: None
+*/
+  template <typename... argTs>
+  void logIsr(uint8_t level, uint8_t limit, const char *fmt, argTs... args) {
+    uint32_t pos = __atomic_load_n(&isrHead, __ATOMIC_RELAXED);
+    isrSlotStruct *slot;
+    int32_t diff;
+
+    for (;;) {
+      slot = &isrQueue[pos % isrQueueLen];
+      diff = (int32_t) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+      if (diff == 0) {                    // slot is free: try to reserve it
+        if (__atomic_compare_exchange_n(&isrHead, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;                          // (on failure, pos is updated to the current isrHead)
+      }
+      else if (diff < 0) {                // slot still holds an entry from the previous lap: queue is full
+        __atomic_fetch_add(&isrDropCount, 1, __ATOMIC_RELAXED);
+        return;
+      }
+      else                                // another producer reserved this slot first
+        pos = __atomic_load_n(&isrHead, __ATOMIC_RELAXED);
+    }
+    slot->entry.fmt = fmt;
+    slot->entry.ts = (timeStampP != NULL) ? (uint32_t) *timeStampP : 0;
+    slot->entry.numArgs = 0;
+    slot->entry.argTypes = 0;
+    slot->entry.level = level;
+    slot->entry.hidden = !enable || (level > limit);
+    captureArgs(&slot->entry, args...);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);  // publish the entry
+  }
+
+private:
+/* serialMonLogClass::formatMsg() [Variadic Template]
+    Formats a log message line (the timestamp, if any, followed by the message) into a buffer of logLineLen
+    characters. If SERIALMON_NO_FLOAT_PRINTF is defined, the arguments are captured and formatted by formatEntry()
+    instead of sprintf().
+  Parameters:
+    char *line: line buffer
+    uint32_t ts: timestamp in ms
+    const char *fmt: sprintf format string
+    ...: a variable number of format arguments
+  Returns: None
+*/
+  template <typename... argTs>
+  void formatMsg(char *line, uint32_t ts, const char *fmt, argTs... args) {
+    char *msgP = line + formatTimestamp(line, ts);
+
+    if (noFloatPrintf) {
+      logEntryStruct entry;
+      entry.fmt = fmt;
+      entry.numArgs = 0;
+      entry.argTypes = 0;
+      captureArgs(&entry, args...);
+      formatEntry(&entry, msgP, maxMsgLen);
+    }
+    else
+      snprintf(msgP, maxMsgLen, fmt, args...);
+  }
+
+/* serialMonLogClass::outputMsg() [Variadic Template]
+    Outputs a log message for logMsg(). If the message is to be written to any of the sinks, or printed immediately,
+    it is formatted once into a line buffer borrowed from the scratch arena (see SerialMonScratch.h), which is passed
+    to the sinks and then printed. A message is printed immediately if deferred mode and binary output are both
+    inactive, provided that the arena has room for it, no earlier messages are still queued and there is room in the
+    Serial output buffer. Otherwise, the message is captured in the ring buffer with a constant cost that doesn't
+    depend on the length of the formatted message. Messages that are not deferred are output immediately after
+    capture if possible; since they may remain queued after the caller has returned, their string arguments are
+    copied to the string pool (see keepQueued()). A queued message is formatted again when it is printed (by drain()),
+    even if it has already been formatted for the sinks, as keeping the formatted line would take logLineLen bytes
+    for each ring entry.
+  Parameters:
+    uint8_t level: message criticality level
+    bool toStream: true if the message is to be printed (otherwise it is only written to the sinks)
+    const char *fmt: sprintf format string
+    ...: a variable number of format arguments
+  Returns: None
+*/
+  template <typename... argTs>
+  void outputMsg(uint8_t level, bool toStream, const char *fmt, argTs... args) {
+    bool toSinks = SMLOG_SINK_WANTED(*this, level);
+    bool printNow = toStream && !deferred;  // print now, after capture, if there is room
+    bool immediate = printNow && !binary && (ringHead == ringTail);   // print now, without capture
+
+    if (toSinks || immediate) {
+      scratchBufClass line(logLineLen);   // (if the scratch arena has no room, the message is just queued)
+
+      if (line.len != 0)
+        formatMsg(line.p, (timeStampP != NULL) ? (uint32_t) *timeStampP : 0, fmt, args...);
+      if (toSinks)
+        writeSinks(level, (line.len != 0) ? line.p : NULL);
+      if (immediate) {
+        if ((line.len != 0) && printLine(line.p))
+          return;
+        printNow = false;                 // no room now, so just queue the message
+      }
+    }
+    if (!toStream)
+      return;
+    if (((ringHead + 1) % logRingLen) == ringTail) {  // no room in ring buffer
+      if (!queueFull(fmt))
+        return;
+    }
+    else
+      ringFull = false;
+    logEntryStruct *entry = &ring[ringHead];
+    entry->fmt = fmt;
+    entry->ts = (timeStampP != NULL) ? (uint32_t) *timeStampP : 0;
+    entry->numArgs = 0;
+    entry->argTypes = 0;
+    captureArgs(entry, args...);
+    if (!deferred && (logStrArgs<argTs...>::mask != 0) && !keepQueued(entry, logStrArgs<argTs...>::mask))
+      return;
+    ringHead = (ringHead + 1) % logRingLen;
+    if (printNow)
+      drain(logRingLen);
+  }
 };
 
 #endif    // _SERIALMONLOG_TYPES
\ No newline at end of file
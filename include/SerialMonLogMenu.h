@@ -0,0 +1,50 @@
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonLog.h"
+
+#ifndef _SERIALMONLOGMENU_TYPES   // prevent multiple redefinition of types in this header
+#define _SERIALMONLOGMENU_TYPES
+
+/* Built-in log menu
+    A command table (see SerialMonCmd.h) that gives access to a serialMonLogClass object's history ring and logging
+    levels, and to the levels of its sinks. To use it, define a cmdTableStruct with the logger as its context, and
+    enter it from another menu with a submenu entry (see CMD_SUBMENU) or serialMonCmdClass::nextMenu() (<ESC> returns
+    to the previous menu), e.g.
+      constexpr cmdTableStruct logMenu = {"Log", logMenuEntries, logMenuCount, &smLog};
+      constexpr cmdEntryStruct mainEntries[] = {CMD_SUBMENU("l", logMenu), ...};
+    Commands:
+      c                 clear the history
+      d [count] [level] dump the last count entries (default all) with a criticality level no greater than level
+      h [level]         set histLevel and enable the history (a negative level disables it); without a parameter,
+                        print the history status, including its memory cost
+      l [level]         set the logging level; without a parameter, print it
+      r                 replay the messages that were hidden while logging was disabled (e.g. while in command mode)
+      s [sink] [level]  set the level of a sink (see serialMonLogClass::addSink()); then print the level, and the
+                        number of lines written and dropped, of each sink
+      t [tag] [level] [others]
+                        set the level of a message tag (by name or number, see LOGMSG_TAG), and optionally of all
+                        other tags and untagged messages, e.g. "t motor 3 0"; "t * <level>" sets all levels; then print
+                        the levels of untagged messages, of the named tags, and of the given tag ("t" or "t *" alone
+                        only prints them)
+*/
+void logMenuClear(cmdArgsStruct *args);
+void logMenuDump(cmdArgsStruct *args);
+void logMenuHistory(cmdArgsStruct *args);
+void logMenuLevel(cmdArgsStruct *args);
+void logMenuReplay(cmdArgsStruct *args);
+void logMenuSinks(cmdArgsStruct *args);
+void logMenuTags(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct logMenuEntries[] = {
+  {"c", "", logMenuClear, NULL},
+  {"d", "II", logMenuDump, "[count] [level]"},
+  {"h", "I", logMenuHistory, "[level]"},
+  {"l", "I", logMenuLevel, "[level]"},
+  {"r", "", logMenuReplay, NULL},
+  {"s", "WI", logMenuSinks, "[sink] [level]"},
+  {"t", "WII", logMenuTags, "[tag] [level] [others]"}
+};
+CMD_TABLE_SORTED(logMenuEntries);
+const uint8_t logMenuCount = sizeof(logMenuEntries) / sizeof(logMenuEntries[0]);
+
+#endif  // _SERIALMONLOGMENU_TYPES
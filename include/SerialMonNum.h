@@ -0,0 +1,27 @@
+#include <Arduino.h>
+
+#ifndef _SERIALMONNUM_TYPES       // prevent multiple redefinition of types in this header
+#define _SERIALMONNUM_TYPES
+
+/* SERIALMON_NO_FLOAT_PRINTF
+    If defined (e.g. with the build flag "-D SERIALMON_NO_FLOAT_PRINTF"), the SerialMonUtils library never passes a
+    floating point value to sprintf() or any other printf-family function, and never calls atof()/strtof(). Floating
+    point log message arguments (%f, %e, %g) are formatted with smFormatFloat() instead. This allows a program that
+    doesn't otherwise use floating point printf to be linked without it.
+*/
+
+const uint8_t maxNumLen = 25;     // buffer size sufficient for any number formatted by the functions below
+
+uint8_t smFormatUint(char *buf, uint32_t val);
+uint8_t smFormatInt(char *buf, int32_t val);
+uint8_t smFormatFixed(char *buf, int32_t val, uint8_t decimals);
+uint8_t smFormatFloat(char *buf, float val, uint8_t decimals);
+uint8_t smFormatSig(char *buf, double val, uint8_t digits);
+uint8_t smFormatTimestamp(char *buf, uint32_t ms);
+bool smParseFloat(const char *s, float *val);
+bool smParseDouble(const char *s, double *val);
+bool smParseFixed(const char *s, uint8_t decimals, int32_t *val);
+bool smParseQ16(const char *s, int32_t *val);
+bool smPutVarint(uint8_t **bPP, uint8_t *endP, uint32_t val);
+
+#endif  // _SERIALMONNUM_TYPES
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+
+#ifndef _SERIALMONOUT_TYPES       // prevent multiple redefinition of types in this header
+#define _SERIALMONOUT_TYPES
+
+/* SERIALMON_OUT_PACKET
+    USB packet size used by serialMonOutClass to align its writes. Defaults to 512 bytes (a USB high-speed bulk
+    packet) on Teensy 4.x, and 64 bytes (a USB full-speed bulk packet) on other boards. May be overridden with a
+    build flag, e.g. "-D SERIALMON_OUT_PACKET=64".
+*/
+#ifndef SERIALMON_OUT_PACKET
+#if defined(ARDUINO_TEENSY40) || defined(ARDUINO_TEENSY41)
+#define SERIALMON_OUT_PACKET 512
+#else
+#define SERIALMON_OUT_PACKET 64
+#endif
+#endif
+
+const uint16_t outPacketSize = SERIALMON_OUT_PACKET;  // writes to the underlying stream are multiples of this size
+const uint16_t outBufLen = 2 * outPacketSize;         // size of the staging buffer
+
+/* serialMonOutClass
+    An output staging stream that sits between the SerialMonUtils objects (or any other code that prints) and a
+    serial port, e.g.
+      smOut.begin(&Serial); smLog.setStream(&smOut); smCmd.setStream(&smOut);
+    Output is collected in a staging buffer and passed to the underlying stream in as few write() calls as possible,
+    each a multiple of outPacketSize bytes, so that many short prints don't each become a USB packet. The remainder
+    of a partial packet is written by poll() once it has been held for flushMicros, or by flush(). Input (available(),
+    read(), peek()) is passed straight through to the underlying stream.
+    Writing never blocks unless the staging buffer is full and the underlying stream has no room either, and
+    availableForWrite() reports the space that can be written without blocking, so non-blocking writers such as
+    serialMonLogClass work as before.
+*/
+class serialMonOutClass : public Stream {
+  Stream *streamP;                  // underlying stream
+  uint8_t buf[outBufLen];           // staging buffer
+  uint16_t len;                     // number of bytes in buf
+  uint32_t firstMicros;             // time (micros()) at which the oldest byte in buf was written
+  void send(uint16_t n);
+public:
+  uint32_t flushMicros;             // max time (us) that a partial packet is held before poll() writes it
+  uint32_t writeCount;              // number of write() calls made to the underlying stream
+  serialMonOutClass() { streamP = &Serial; len = 0; firstMicros = 0; flushMicros = 2000; writeCount = 0; }
+  void begin(Stream *streamP) { this->streamP = streamP; }
+  Stream *getStream() { return (streamP); }
+  size_t write(uint8_t c) { return (write(&c, 1)); }
+  size_t write(const uint8_t *data, size_t size);
+  using Print::write;
+  int availableForWrite();
+  void flush();
+  void poll();
+  uint16_t pending() { return (len); }
+  int available() { return (streamP->available()); }
+  int read() { return (streamP->read()); }
+  int peek() { return (streamP->peek()); }
+};
+
+#endif  // _SERIALMONOUT_TYPES
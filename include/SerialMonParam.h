@@ -0,0 +1,88 @@
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonWatch.h"
+
+#ifndef _SERIALMONPARAM_TYPES     // prevent multiple redefinition of types in this header
+#define _SERIALMONPARAM_TYPES
+
+  // a single named configuration parameter. A program registers its parameters with a constexpr table of these,
+  // sorted by name (see PARAM_TABLE_SORTED), so that the table is kept in flash and can be searched by name
+struct paramEntryStruct {
+  const char *name;                 // parameter name, used by the get/set commands
+  volatile void *ptr;               // pointer to the variable
+  uint8_t type;                     // watchTypeEnum (see SerialMonWatch.h): integers of up to 32 bits, bool, float or
+                                    //    double (set and formatted with the full precision of its type)
+  float min;                        // smallest value accepted by smParamSet()
+  float max;                        // largest value accepted by smParamSet()
+  const char *units;                // units, shown by the list command (e.g. "ms"; "" for none)
+};
+
+  // a parameter table, passed to the smParamXxx() functions and as the context of the built-in parameter menu
+struct paramTableStruct {
+  const paramEntryStruct *entries;  // pointer to an array of entries, sorted by name
+  uint16_t count;                   // number of entries
+};
+
+/* PARAM(), PARAM_NAMED() [Macros]
+    Initializers for a paramEntryStruct, named after the variable (PARAM) or explicitly (PARAM_NAMED). The type of the
+    variable is determined at compile time (see smWatchTypeOf()).
+  Parameters:
+    var: a global or static variable
+    const char *name: parameter name (a string literal)
+    float min, max: range of values accepted by smParamSet()
+    const char *units: units string
+  Example: constexpr paramEntryStruct params[] = {PARAM(gain, 0, 10, ""), PARAM(period, 1, 1000, "ms")};
+*/
+#define PARAM(var, min, max, units) {#var, &(var), smWatchTypeOf(&(var)), (min), (max), (units)}
+#define PARAM_NAMED(name, var, min, max, units) {(name), &(var), smWatchTypeOf(&(var)), (min), (max), (units)}
+
+/* paramEntriesSorted() [constexpr]
+    Compile-time check that a parameter table is sorted by name, with no duplicates. The table is split in halves, so
+    that the recursion depth is only log2 of the table size. Used by the PARAM_TABLE_SORTED macro.
+*/
+constexpr bool paramEntriesSorted(const paramEntryStruct *entries, uint16_t n) {
+  return ((n < 2) ? true : (paramEntriesSorted(entries, n / 2) &&
+          (cmdKeyCompare(entries[n / 2 - 1].name, entries[n / 2].name) < 0) && paramEntriesSorted(entries + n / 2, n - n / 2)));
+}
+
+/* PARAM_TABLE_SORTED() [Macro]
+    Verifies at compile time that a constexpr array of paramEntryStruct is sorted by name, with no duplicate names
+  Parameters:
+    entries: name of the array
+  Example: PARAM_TABLE_SORTED(params);
+*/
+#define PARAM_TABLE_SORTED(entries) static_assert(paramEntriesSorted(entries, sizeof(entries) / sizeof(entries[0])), \
+                                      #entries " must be sorted by name, with no duplicates")
+
+const paramEntryStruct *smParamFind(const paramTableStruct *table, const char *name);
+uint8_t smParamFormat(char *buf, const paramEntryStruct *param);
+bool smParamSet(const paramEntryStruct *param, const char *text);
+
+/* Built-in parameter menu
+    A command table (see SerialMonCmd.h) for reading and writing the parameters in a parameter table. To use it,
+    define a cmdTableStruct with the paramTableStruct as its context, and enter it from another menu with a submenu
+    entry (see CMD_SUBMENU) or serialMonCmdClass::nextMenu() (<ESC> returns to the previous menu), e.g.
+      constexpr paramTableStruct paramTable = {params, sizeof(params) / sizeof(params[0])};
+      constexpr cmdTableStruct paramMenu = {"Param", paramMenuEntries, paramMenuCount, (void *) &paramTable};
+    Commands:
+      dump              print all parameters as "set <name> <value>" lines: pasting these lines back into the menu
+                        restores the configuration in one transfer
+      get <name>        print the value of a parameter
+      list [prefix]     list the parameters (whose names start with prefix), with their values, ranges and units
+      set <name> <value>  set a parameter (the value must be within the parameter's range)
+*/
+void paramMenuDump(cmdArgsStruct *args);
+void paramMenuGet(cmdArgsStruct *args);
+void paramMenuList(cmdArgsStruct *args);
+void paramMenuSet(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct paramMenuEntries[] = {
+  {"dump", "", paramMenuDump, NULL},
+  {"get", "w", paramMenuGet, "<name>"},
+  {"list", "W", paramMenuList, "[prefix]"},
+  {"set", "ww", paramMenuSet, "<name> <value>"}
+};
+CMD_TABLE_SORTED(paramMenuEntries);
+const uint8_t paramMenuCount = sizeof(paramMenuEntries) / sizeof(paramMenuEntries[0]);
+
+#endif  // _SERIALMONPARAM_TYPES
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#if !defined(ARM_DWT_CYCCNT) && !defined(ARDUINO)
+#include <chrono>
+#endif
+
+#ifndef _SERIALMONPROBE_TYPES     // prevent multiple redefinition of types in this header
+#define _SERIALMONPROBE_TYPES
+
+const uint8_t probeHistBins = 33;   // number of log2 histogram bins: [0], [1], [2 - 3], [4 - 7] ... [2^31 - 2^32-1]
+
+  // enum indicating how a probe is used
+enum probeTypeEnum {PROBE_TIMER,    // records the duration (in ticks) of a scope, see SMPROBE_SCOPE
+                    PROBE_VALUE,    // records arbitrary sample values, see SMPROBE_VALUE
+                    PROBE_COUNTER}; // only counts events, see SMPROBE_COUNT
+
+  // statistics for a single named probe. Probes are created (statically) by the SMPROBE_xxx macros, and are added to a
+  // list of all probes the first time they record something
+struct probeStruct {
+  const char *name;                 // probe name (must be a string literal or other static string)
+  uint8_t type;                     // probeTypeEnum
+  bool listed;                      // indicates that the probe has been added to the list of all probes
+  probeStruct *next;                // next probe in the list
+  uint32_t count;                   // number of samples (or events)
+  uint32_t min;                     // smallest sample
+  uint32_t max;                     // largest sample
+  uint64_t total;                   // sum of all samples
+  uint32_t hist[probeHistBins];     // number of samples in each log2 bin
+};
+
+/* smProbeTicks(), smProbeTicksPerUs()
+    Time source for timer probes: the Cortex-M7 DWT cycle counter on Teensy 4.x (which is enabled by the Teensy
+    startup code), micros() on other Arduino boards, and a steady (monotonic) clock with ns ticks on the host. 
+*/
+#if defined(ARM_DWT_CYCCNT)
+inline uint32_t smProbeTicks() { return (ARM_DWT_CYCCNT); }
+inline uint32_t smProbeTicksPerUs() { return (F_CPU_ACTUAL / 1000000); }
+#elif defined(ARDUINO)
+inline uint32_t smProbeTicks() { return (micros()); }
+inline uint32_t smProbeTicksPerUs() { return (1); }
+#else
+inline uint32_t smProbeTicks() {
+  return ((uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+inline uint32_t smProbeTicksPerUs() { return (1000); }
+#endif
+
+void smProbeRecord(probeStruct *probe, uint32_t value);
+probeStruct *smProbeFirst();
+probeStruct *smProbeFind(const char *name);
+void smProbeReset(probeStruct *probe);
+
+  // records the time from its construction to its destruction in a timer probe (used by SMPROBE_SCOPE)
+class serialMonProbeScopeClass {
+  probeStruct *probeP;
+  uint32_t start;
+public:
+  serialMonProbeScopeClass(probeStruct *probeP) { this->probeP = probeP; start = smProbeTicks(); }
+  ~serialMonProbeScopeClass() { smProbeRecord(probeP, smProbeTicks() - start); }
+};
+
+/* SMPROBE_SCOPE(), SMPROBE_VALUE(), SMPROBE_COUNT() [Macros]
+    Lightweight profiling probes. Each use of a macro creates a static probeStruct named by the name parameter, so
+    the same name may not be used for different probe types. Results can be viewed and reset with the built-in probe
+    menu (probeMenu, see below). Probes are intended for use in the main loop only (not in interrupt handlers).
+    If SMPROBE_DISABLE is defined (e.g. with the build flag "-D SMPROBE_DISABLE"), the macros compile to nothing.
+      SMPROBE_SCOPE(name): records the time from this point to the end of the enclosing scope, in ticks (see
+                            smProbeTicks())
+      SMPROBE_VALUE(name, value): records a sample value (uint32_t), e.g. a queue depth or a number of bytes
+      SMPROBE_COUNT(name): counts an event
+  Parameters:
+    const char *name: probe name (a string literal)
+    uint32_t value: sample value
+  Example: void loop() { SMPROBE_SCOPE("loop"); ... }
+*/
+#define SMPROBE_CAT2(a, b) a##b
+#define SMPROBE_CAT(a, b) SMPROBE_CAT2(a, b)
+#define SMPROBE_INIT(name, type) {(name), (type), false, NULL, 0, 0, 0, 0, {0}}
+#ifndef SMPROBE_DISABLE
+#define SMPROBE_SCOPE(name) static probeStruct SMPROBE_CAT(smProbe, __LINE__) = SMPROBE_INIT(name, PROBE_TIMER); \
+                              serialMonProbeScopeClass SMPROBE_CAT(smProbeScope, __LINE__)(&SMPROBE_CAT(smProbe, __LINE__))
+#define SMPROBE_VALUE(name, value) do { static probeStruct smProbeV = SMPROBE_INIT(name, PROBE_VALUE); \
+                                      smProbeRecord(&smProbeV, (value)); } while (0)
+#define SMPROBE_COUNT(name) do { static probeStruct smProbeC = SMPROBE_INIT(name, PROBE_COUNTER); \
+                                  smProbeRecord(&smProbeC, 0); } while (0)
+#else
+#define SMPROBE_SCOPE(name)
+#define SMPROBE_VALUE(name, value) do { } while (0)
+#define SMPROBE_COUNT(name) do { } while (0)
+#endif
+
+/* Built-in probe menu
+    A command table (see SerialMonCmd.h) for viewing and resetting all probes. Enter it from another menu with a
+    submenu entry, CMD_SUBMENU("p", probeMenu), or with serialMonCmdClass::nextMenu(&probeMenu) (<ESC> returns to the
+    previous menu).
+    Commands:
+      h <name>          print the log2 histogram of a probe
+      l                 list all probes: count, and min/mean/max (times in us)
+      r [name]          reset one probe, or all probes
+*/
+void probeMenuHist(cmdArgsStruct *args);
+void probeMenuList(cmdArgsStruct *args);
+void probeMenuReset(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct probeMenuEntries[] = {
+  {"h", "w", probeMenuHist, "<name>"},
+  {"l", "", probeMenuList, NULL},
+  {"r", "W", probeMenuReset, "[name]"}
+};
+CMD_TABLE_SORTED(probeMenuEntries);
+constexpr cmdTableStruct probeMenu = {"Probes", probeMenuEntries, sizeof(probeMenuEntries) / sizeof(probeMenuEntries[0]),
+                                      NULL};
+
+#endif  // _SERIALMONPROBE_TYPES
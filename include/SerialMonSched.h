@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+
+#ifndef _SERIALMONSCHED_TYPES     // prevent multiple redefinition of types in this header
+#define _SERIALMONSCHED_TYPES
+
+const uint8_t schedWheelSlots = 64;   // number of 1-ms slots in the timer wheel (power of 2)
+
+  // enum indicating the state of a scheduled task
+enum taskStateEnum {TASK_IDLE,        // not scheduled
+                    TASK_WAITING,     // waiting in the timer wheel
+                    TASK_RUNNING};    // being executed by serialMonSchedClass::run()
+
+  // a task executed by serialMonSchedClass. Tasks are declared statically by the program (see SCHED_TASK_INIT), and
+  // linked into the timer wheel when started, so the scheduler needs no memory of its own for them
+struct schedTaskStruct {
+  const char *name;                   // task name, shown by the scheduler menu
+  void (*func)(struct schedTaskStruct *task);   // function called to execute the task
+  void *context;                      // pointer for use by func (e.g. the object it operates on)
+  uint32_t periodMs;                  // period in ms (0 = one-shot); may be changed by func to change the period
+  uint32_t due;                       // time (millis()) at which the task is next due
+  uint8_t state;                      // taskStateEnum
+  struct schedTaskStruct *next;       // next task in the same wheel slot
+  struct schedTaskStruct **prevP;     // pointer to the pointer to this task (in the previous task, or the slot)
+  struct schedTaskStruct *nextTask;   // next task in the list of all tasks that have been started
+  bool listed;                        // indicates that the task is in the list of all tasks
+  uint32_t runs;                      // number of times executed
+  uint32_t lateMax;                   // max lateness (ms) of the start of an execution, relative to its due time
+  uint32_t lateTotal;                 // sum of the lateness of all executions (for the mean)
+  uint32_t overruns;                  // number of periods missed because an execution was too late or too long
+  uint32_t runMaxUs;                  // longest execution time (us)
+  uint32_t runTotalUs;                // sum of all execution times (us)
+};
+
+/* SCHED_TASK_INIT() [Macro]
+    Initializer for a schedTaskStruct
+  Parameters:
+    const char *name: task name (a string literal)
+    void (*func)(schedTaskStruct *): task function
+    void *context: pointer passed to the task function in task->context
+  Example: schedTaskStruct blinkTask = SCHED_TASK_INIT("blink", blink, NULL);
+*/
+#define SCHED_TASK_INIT(name, func, context) {(name), (func), (context), 0, 0, TASK_IDLE, NULL, NULL, NULL, false, \
+                                                0, 0, 0, 0, 0, 0}
+
+/* serialMonSchedClass
+    A cooperative scheduler for periodic and one-shot tasks, based on a timer wheel of schedWheelSlots 1-ms slots.
+    Starting or cancelling a task is O(1), and each call to run() only visits the slots for the ms that have elapsed
+    since the previous call (and, in each, only the tasks due in that slot, plus any that are due a multiple of
+    schedWheelSlots ms later). Tasks are run in the main loop by run(), so they must not block; a task that runs late
+    or for longer than its period is counted in its statistics, which can be viewed with the scheduler menu.
+*/
+class serialMonSchedClass {
+  schedTaskStruct *wheel[schedWheelSlots];  // list of the waiting tasks in each slot
+  schedTaskStruct *taskList;          // list of all tasks that have been started
+  uint32_t curTick;                   // next ms to be processed by run()
+  void link(schedTaskStruct *task);
+  void unlink(schedTaskStruct *task);
+  uint32_t execute(schedTaskStruct *task, uint32_t now, uint32_t startUs);
+public:
+  uint32_t ticks;                     // number of slots (ms) processed by run()
+  uint32_t dispatchCount;             // number of task executions
+  serialMonSchedClass() {
+    for (uint8_t i = 0; i < schedWheelSlots; i++)
+      wheel[i] = NULL;
+    taskList = NULL; curTick = millis(); ticks = dispatchCount = 0;
+  }
+  void start(schedTaskStruct *task, uint32_t delayMs, uint32_t periodMs);
+  void every(schedTaskStruct *task, uint32_t periodMs) { start(task, periodMs, periodMs); }
+  void after(schedTaskStruct *task, uint32_t delayMs) { start(task, delayMs, 0); }
+  void cancel(schedTaskStruct *task);
+  void run() { run(millis()); }
+  void run(uint32_t now);
+  schedTaskStruct *firstTask() { return (taskList); }
+  void resetStats();
+};
+
+  // ready-made task functions for the SerialMonUtils objects (the object is the task's context)
+void schedTaskCmd(schedTaskStruct *task);       // calls serialMonCmdClass::processCommands(true)
+void schedTaskLogDrain(schedTaskStruct *task);  // calls serialMonLogClass::drain(logRingLen)
+void schedTaskLogFile(schedTaskStruct *task);   // calls serialMonLogFileClass::poll()
+
+/* Built-in scheduler menu
+    A command table (see SerialMonCmd.h) for viewing the task statistics of a serialMonSchedClass object (the
+    table's context), e.g.
+      constexpr cmdTableStruct schedMenu = {"Sched", schedMenuEntries, schedMenuCount, &smSched};
+    Commands:
+      l                 list all tasks: period, runs, lateness (mean/max ms), overruns, execution time (mean/max us)
+      r                 reset the statistics
+*/
+void schedMenuList(cmdArgsStruct *args);
+void schedMenuReset(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct schedMenuEntries[] = {
+  {"l", "", schedMenuList, NULL},
+  {"r", "", schedMenuReset, NULL}
+};
+CMD_TABLE_SORTED(schedMenuEntries);
+const uint8_t schedMenuCount = sizeof(schedMenuEntries) / sizeof(schedMenuEntries[0]);
+
+#endif  // _SERIALMONSCHED_TYPES
@@ -0,0 +1,64 @@
+#include <Arduino.h>
+
+#ifndef _SERIALMONSCRATCH_TYPES   // prevent multiple redefinition of types in this header
+#define _SERIALMONSCRATCH_TYPES
+
+/* SERIALMON_SCRATCH_LEN
+    Size of the scratch arena shared by all of the SerialMonUtils objects (see serialMonScratchClass below). Defaults
+    to 256 bytes, which is enough for a line printed by a command handler and a log message printed at the same time.
+    May be overridden with a build flag, e.g. "-D SERIALMON_SCRATCH_LEN=192"; smScratch.peak shows how much of it a
+    program actually uses.
+*/
+#ifndef SERIALMON_SCRATCH_LEN
+#define SERIALMON_SCRATCH_LEN 256
+#endif
+
+const uint16_t scratchLen = SERIALMON_SCRATCH_LEN;  // size of the scratch arena
+
+/* serialMonScratchClass
+    A single arena of memory for the short-lived buffers that are used to assemble output: a log message line, the
+    characters echoed by one call to getCmdLine(), a prompt, a watch frame, or a line printed by a command handler.
+    None of these are kept from one call to the next, so instead of each object carrying buffers of its own (which
+    adds up with several loggers and command sessions), they borrow them from the arena in turn (see scratchBufClass).
+    Buffers are given back in the reverse order in which they were taken, so a buffer can be borrowed while another
+    is in use (e.g. by a log message printed from a command handler), as long as the arena has room for both. A
+    request that doesn't fit fails, and is counted in failCount; each of the library's users of the arena then falls
+    back to something that needs no buffer (e.g. a log message is queued in raw form, to be printed by drain()).
+    The arena must only be used from the main loop, not from interrupt handlers (LOGISR doesn't use it).
+*/
+class serialMonScratchClass {
+  char buf[scratchLen];                 // the arena
+  uint16_t used;                        // number of bytes in use (taken from the start of buf)
+public:
+  uint16_t peak;                        // max number of bytes that have been in use at one time
+  uint32_t failCount;                   // number of requests that couldn't be met
+  char none[1];                         // empty string returned by take() for a request that can't be met
+  serialMonScratchClass() { used = peak = 0; failCount = 0; none[0] = '\0'; }
+  char *take(uint16_t len, uint16_t minLen, uint16_t *got);
+  void give(char *p);
+  uint16_t available() { return (scratchLen - used); }
+};
+
+extern serialMonScratchClass smScratch;   // the arena (defined in SerialMonScratch.cpp)
+
+/* scratchBufClass
+    A buffer borrowed from the scratch arena for the lifetime of the object (normally a local variable), e.g.
+      scratchBufClass line(80);
+      snprintf(line.p, line.len, "Speed %u", speed);
+      args->cmd->getStream()->println(line.p);
+    If the arena doesn't have room for at least minLen bytes, len is 0 and p points to an empty string, so that
+    snprintf() writes nothing and printing p prints nothing. A command handler is the first user of the arena (nothing
+    else is borrowed while a command is dispatched), so its first buffer only fails if it is larger than the arena.
+*/
+class scratchBufClass {
+public:
+  char *p;                              // buffer
+  uint16_t len;                         // size of the buffer (0 if it couldn't be borrowed)
+  scratchBufClass(uint16_t len) { p = smScratch.take(len, len, &this->len); }
+  scratchBufClass(uint16_t len, uint16_t minLen) { p = smScratch.take(len, minLen, &this->len); }  // up to len bytes
+  ~scratchBufClass() { smScratch.give(p); }
+  scratchBufClass(const scratchBufClass &) = delete;
+  scratchBufClass &operator=(const scratchBufClass &) = delete;
+};
+
+#endif  // _SERIALMONSCRATCH_TYPES
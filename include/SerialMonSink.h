@@ -0,0 +1,103 @@
+#include <Arduino.h>
+
+#ifndef _SERIALMONSINK_TYPES      // prevent multiple redefinition of types in this header
+#define _SERIALMONSINK_TYPES
+
+/* SMLOG_FILE_BLOCK
+    Size of the blocks written by serialMonLogFileClass (see below). Defaults to 512 bytes, the sector size of an SD
+    card, so that each write to a file on an SD card fills whole sectors. May be overridden with a build flag, e.g.
+    "-D SMLOG_FILE_BLOCK=256" for a flash file system with smaller pages.
+*/
+#ifndef SMLOG_FILE_BLOCK
+#define SMLOG_FILE_BLOCK 512
+#endif
+
+const uint16_t fileBlockLen = SMLOG_FILE_BLOCK;   // size of a block written by serialMonLogFileClass
+
+  // a log sink: an additional destination for the text lines of a serialMonLogClass object (see
+  // serialMonLogClass::addSink()). Sinks are declared statically by the program (see LOG_SINK_INIT), and linked into
+  // the logger's list of sinks when added, so the logger needs no memory of its own for them
+struct logSinkStruct {
+  const char *name;                   // sink name, shown by the log menu
+  bool (*func)(struct logSinkStruct *sink, const char *line, uint8_t len);  // writes a line; false if there's no room
+  void *context;                      // pointer for use by func (e.g. the stream or object it writes to)
+  uint8_t level;                      // max criticality level of the messages written to the sink
+  struct logSinkStruct *next;         // next sink of the same logger
+  uint32_t lines;                     // number of lines written
+  uint32_t drops;                     // number of lines discarded because the sink had no room for them
+};
+
+/* LOG_SINK_INIT() [Macro]
+    Initializer for a logSinkStruct
+  Parameters:
+    const char *name: sink name (a string literal)
+    bool (*func)(logSinkStruct *, const char *, uint8_t): sink function (e.g. one of the ready-made functions below)
+    void *context: pointer passed to the sink function in sink->context
+    uint8_t level: max criticality level of the messages written to the sink
+  Example: logSinkStruct uartSink = LOG_SINK_INIT("uart", logSinkStream, &Serial1, 2);
+*/
+#define LOG_SINK_INIT(name, func, context, level) {(name), (func), (context), (level), NULL, 0, 0}
+
+/* serialMonLogRingClass
+    An in-memory ring of recent log lines, in a character array provided by the program (so that messages can be
+    kept, e.g. while no serial monitor is connected, and printed later). When the ring is full, the oldest lines are
+    overwritten.
+*/
+class serialMonLogRingClass {
+  char *buf;                          // ring of characters (lines ending with <CR><NL>)
+  uint16_t size;                      // number of characters in buf (0 if no array has been set)
+  uint16_t head;                      // index of the next character to be written
+  uint16_t used;                      // number of valid characters
+public:
+  serialMonLogRingClass() { buf = NULL; size = head = used = 0; }
+  void setBuffer(char *buf, uint16_t size);
+  template <size_t n>
+  void setBuffer(char (&buf)[n]) {    // size taken from the array, e.g. setBuffer(logText)
+    static_assert(n <= 65535, "a log ring can have at most 65535 characters");
+    setBuffer(buf, n);
+  }
+  bool write(const char *line, uint8_t len);
+  uint16_t dump(Stream *outP);
+  uint16_t count() { return (used); }
+  void clear() { head = used = 0; }
+};
+
+/* serialMonLogFileClass
+    A block-buffered writer for a log file (or any other Print object, e.g. a File on an SD card or a flash file
+    system, or an ordinary file on the host). Lines are copied into two blocks of fileBlockLen bytes; a block that
+    becomes full is written by poll() as a single write() of fileBlockLen bytes, while lines are copied into the
+    other. So writing a line never waits for the file, and the file only sees whole-block writes, except for the
+    partial block written by flush(), or by poll() once it has been held for flushMs. A line that doesn't fit in the
+    blocks (because poll() hasn't been called often enough) is discarded.
+*/
+class serialMonLogFileClass {
+  Print *fileP;                       // file (NULL until set by begin())
+  uint8_t buf[2 * fileBlockLen];      // the two blocks
+  uint8_t cur;                        // index of the block being filled
+  uint16_t fill;                      // number of bytes in the block being filled
+  uint16_t sent;                      // number of bytes of that block already written (by a partial flush)
+  bool waiting;                       // indicates that the other block is full and waiting to be written
+  uint16_t waitingSent;               // number of bytes of the waiting block already written
+  uint32_t firstMs;                   // time (millis()) at which the oldest unwritten byte of the block was copied
+  void sendWaiting();
+public:
+  uint32_t flushMs;                   // max time (ms) a partial block is held before poll() writes it (0 = no limit)
+  uint32_t blockCount;                // number of whole blocks written
+  uint32_t writeCount;                // number of write() calls made to the file
+  serialMonLogFileClass() {
+    fileP = NULL; cur = 0; fill = sent = waitingSent = 0; waiting = false; firstMs = 0; flushMs = 1000;
+    blockCount = writeCount = 0;
+  }
+  void begin(Print *fileP);
+  bool write(const char *line, uint8_t len);
+  void poll();
+  void flush();
+  uint16_t pending() { return ((waiting ? (fileBlockLen - waitingSent) : 0) + fill - sent); }
+};
+
+  // ready-made sink functions for LOG_SINK_INIT (the stream or object written to is the sink's context)
+bool logSinkStream(logSinkStruct *sink, const char *line, uint8_t len);  // Stream *: written if there is room
+bool logSinkRing(logSinkStruct *sink, const char *line, uint8_t len);    // serialMonLogRingClass *
+bool logSinkFile(logSinkStruct *sink, const char *line, uint8_t len);    // serialMonLogFileClass *
+
+#endif  // _SERIALMONSINK_TYPES
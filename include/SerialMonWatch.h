@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+
+#ifndef _SERIALMONWATCH_TYPES     // prevent multiple redefinition of types in this header
+#define _SERIALMONWATCH_TYPES
+
+const uint8_t maxWatchSel = 16;     // max number of variables selected for streaming at one time
+  // size of the buffer used to assemble a frame or CSV line, which is borrowed from the scratch arena (see
+  // SerialMonScratch.h) for each sample: streaming more than 10 variables as CSV needs a SERIALMON_SCRATCH_LEN of
+  // more than the default 256 bytes
+constexpr uint16_t watchBufLen(uint8_t selCount, bool binary) { return (16 + selCount * (binary ? 5 : maxNumLen)); }
+
+  // enum indicating the type of a watched variable (see smWatchTypeOf())
+enum watchTypeEnum {WATCH_INT8, WATCH_UINT8, WATCH_INT16, WATCH_UINT16, WATCH_INT32, WATCH_UINT32,
+                    WATCH_BOOL,       // sent as 0 or 1
+                    WATCH_FLOAT,
+                    WATCH_DOUBLE};    // sent as a float
+
+  // record type codes used by the binary watch output format (see serialMonWatchClass::sample()). The binary format
+  // can share a stream with the binary log format (see logRecordEnum in SerialMonLog.h), and is decoded by the same
+  // host program (tools/smlogdecode.cpp)
+enum watchRecordEnum {WATCH_REC_SYNC = 0xA5,  // start of stream: followed by "SMW1" (same code as LOG_REC_SYNC)
+                      WATCH_REC_DEF = 0x10,   // selected variables: timestamp (varint), count, then type and name of each
+                      WATCH_REC_FRAME = 0x11};  // sample frame: timestamp delta, changed bitmap, changed values
+
+  // a single watchable variable. A program registers its variables with a (constant) table of these, e.g.
+  //    constexpr watchVarStruct watchVars[] = {WATCH_VAR(speed), WATCH_VAR(setPoint)};
+struct watchVarStruct {
+  const char *name;                 // variable name, used to select it and in CSV/binary headers
+  const volatile void *ptr;         // pointer to the variable
+  uint8_t type;                     // watchTypeEnum
+};
+
+/* smWatchTypeOf() [constexpr]
+    Determines the watchTypeEnum of a variable from a pointer to it: 8, 16 and 32-bit integers, bool, float and double
+    are supported (a compile-time error is reported for any other type). Used by the WATCH_VAR macro.
+*/
+template <typename T>
+constexpr uint8_t smWatchTypeOf(const volatile T *) {
+  static_assert(((T) 0.5 != (T) 0) || (sizeof(T) <= 4), "watch variables must be integers of up to 32 bits, bool, float or double");
+  return (((T) 0.5 != (T) 0) ? ((sizeof(T) == 4) ? WATCH_FLOAT : WATCH_DOUBLE) :
+          (sizeof(T) == 1) ? (((T) -1 < 0) ? WATCH_INT8 : WATCH_UINT8) :
+          (sizeof(T) == 2) ? (((T) -1 < 0) ? WATCH_INT16 : WATCH_UINT16) : (((T) -1 < 0) ? WATCH_INT32 : WATCH_UINT32));
+}
+constexpr uint8_t smWatchTypeOf(const volatile bool *) { return (WATCH_BOOL); }
+
+/* WATCH_VAR(), WATCH_VAR_NAMED() [Macros]
+    Initializers for a watchVarStruct, named after the variable (WATCH_VAR) or explicitly (WATCH_VAR_NAMED)
+  Parameters:
+    var: a global or static variable
+    const char *name: variable name (a string literal)
+*/
+#define WATCH_VAR(var) {#var, &(var), smWatchTypeOf(&(var))}
+#define WATCH_VAR_NAMED(name, var) {(name), &(var), smWatchTypeOf(&(var))}
+
+class serialMonWatchClass {
+  Stream *streamP;                  // stream used for output (Serial unless changed by setStream())
+  const watchVarStruct *vars;       // table of registered variables
+  uint8_t varCount;                 // number of entries in vars
+  uint8_t sel[maxWatchSel];         // indices (in vars) of the selected variables
+  uint32_t last[maxWatchSel];       // raw value of each selected variable in the previous binary frame
+  uint32_t lastSampleMs;            // time (millis()) of the previous sample period
+  uint32_t lastFrameMs;             // timestamp of the previous frame that was sent
+  bool headerSent;                  // indicates that the header (binary sync/definitions or CSV names) has been sent
+  uint32_t readRaw(uint8_t index);
+  bool sendHeader(uint32_t now, uint8_t *buf);
+  bool sendFrame(uint32_t now, uint8_t *buf);
+public:
+  bool active;                      // indicates that the selected variables are being streamed
+  bool binary;                      // if true, frames are output in the binary format instead of CSV
+  uint32_t periodMs;                // sample period (0 = sample on every call to sample())
+  uint8_t csvDecimals;              // number of decimal places for float and double values in CSV lines
+  uint8_t selCount;                 // number of selected variables
+  uint32_t frameCount;              // number of frames sent
+  uint32_t skipCount;               // number of frames skipped because there was no room in the output buffer (or
+                                    //    in the scratch arena)
+  serialMonWatchClass() {
+    streamP = &Serial; vars = NULL; varCount = 0; selCount = 0; active = false; binary = false;
+    periodMs = 100; csvDecimals = 3; frameCount = skipCount = 0; headerSent = false; lastSampleMs = 0;
+  }
+  void init(const watchVarStruct *vars, uint8_t count);
+  void setStream(Stream *streamP);
+  Stream *getStream() { return (streamP); }
+  int16_t find(const char *name);
+  const watchVarStruct *getVar(uint8_t index) { return ((index < varCount) ? &vars[index] : NULL); }
+  uint8_t count() { return (varCount); }
+  bool isSelected(uint8_t index);
+  bool select(const char *name);
+  bool deselect(const char *name);
+  void clear();
+  void start(uint32_t periodMs);
+  void stop();
+  void resync() { headerSent = false; }
+  void sample();
+  uint8_t formatValue(char *buf, uint8_t index);
+};
+
+/* Built-in watch menu
+    A command table (see SerialMonCmd.h) for selecting and streaming watched variables. To use it, define a
+    cmdTableStruct with the serialMonWatchClass object as its context, and enter it from another menu with a submenu
+    entry (see CMD_SUBMENU) or serialMonCmdClass::nextMenu() (<ESC> returns to the previous menu), e.g.
+      constexpr cmdTableStruct watchMenu = {"Watch", watchMenuEntries, watchMenuCount, &smWatch};
+    Commands:
+      a <name>          add a variable to the selection
+      c                 clear the selection (and stop streaming)
+      d <name>          remove a variable from the selection
+      f <csv|bin>       set the output format
+      l                 list all variables with their current values (selected variables are marked with '*')
+      s [period]        start streaming the selected variables, with an optional sample period in ms
+      t                 stop streaming
+*/
+void watchMenuAdd(cmdArgsStruct *args);
+void watchMenuClear(cmdArgsStruct *args);
+void watchMenuDelete(cmdArgsStruct *args);
+void watchMenuFormat(cmdArgsStruct *args);
+void watchMenuList(cmdArgsStruct *args);
+void watchMenuStart(cmdArgsStruct *args);
+void watchMenuStop(cmdArgsStruct *args);
+
+constexpr cmdEntryStruct watchMenuEntries[] = {
+  {"a", "w", watchMenuAdd, "<name>"},
+  {"c", "", watchMenuClear, NULL},
+  {"d", "w", watchMenuDelete, "<name>"},
+  {"f", "w", watchMenuFormat, "<csv|bin>"},
+  {"l", "", watchMenuList, NULL},
+  {"s", "I", watchMenuStart, "[period]"},
+  {"t", "", watchMenuStop, NULL}
+};
+CMD_TABLE_SORTED(watchMenuEntries);
+const uint8_t watchMenuCount = sizeof(watchMenuEntries) / sizeof(watchMenuEntries[0]);
+
+#endif  // _SERIALMONWATCH_TYPES
@@ -19,6 +19,22 @@
       ESCAPE - The menu function should take appropriate actions to exit the current menu, such as to "pop up" a level in 
                   a multi-level menu structure. This is triggered when the user presses the <ESC> key when the command
                   line is empty. 
+    As an alternative to writing a user menu function, a menu can be defined as a command table (cmdTableStruct) that
+    lists each command's keyword, parameter signature and handler function. The dispatch() function looks up the
+    command keyword using a binary search of the (sorted) table, parses and validates the parameters, and calls the
+    handler. The cue string that lists the available commands is generated from the table by tablePrompt(). A table
+    menu can be activated with nextMenu(), or called from a user menu function using tableMenu(). 
+    Table menus can be nested into a menu tree, by entries that enter a submenu (see CMD_SUBMENU). The table menus that
+    have been entered are kept on a navigation stack of up to maxMenuDepth levels, so <ESC> returns to the previous
+    menu automatically, the prompt shows the path from the root menu, and a path of submenus can be entered in one line.
+    A command that takes a long time (e.g. a sweep, a large dump, or waiting for hardware) can be made resumable, so
+    that it doesn't stall the main loop: its handler calls resume() with a step function, which processCommands() then
+    calls repeatedly, within a time budget per call, until the command has finished or is cancelled with <ESC>.
+    For machine-driven control, a session can be switched to frame mode (see SerialMonFrame.h), in which the same menus
+    are driven by COBS-framed, CRC-checked requests and replies, with no echo or prompts.
+    A sequence of commands can be executed as a batch, with no echo or prompts, and a summary of the execution time of
+    each command at the end: either typed or pasted between a "{" line and a "}" line, or run from a named script (see
+    runScript() and the built-in script menu).
 */
 #include <Arduino.h>
 #include "SerialMonInput.h"
@@ -27,54 +43,578 @@
 
 /* serialMonCmdClass::processCommands()
     Called periodically from the main loop (at least 5 times/sec). If menu command mode (cmdMode) is not currently active,
-    processCommands() checks if a character is available to read from the Serial Monitor keyboard. If not, the function 
-    returns immediately. If a character is available, it is read and compared to the defined "command mode trigger" character,
-    (cmdModeChar) which by default is the <ESC> character. If commmand mode is triggered, the top-level menu function previously
-    specified using serialMonClass::initMenu() is executed. 
-    If command mode is already active, the available character is read and appended to the current command line using 
-    serialMonInputClass::getCmdLine(). If this function indicates that a complete line has been assembled, the current 
-    user menu function is called to execute the command. 
+    processCommands() reads any characters available from the Serial Monitor keyboard, discarding them until the defined
+    "command mode trigger" character (cmdModeChar, which by default is the <ESC> character) is found. If commmand mode is
+    triggered, the top-level menu function previously specified using serialMonClass::initMenu() is executed. 
+    Once command mode is active, the available characters are read and appended to the current command line using 
+    serialMonInputClass::getCmdLine(). Each time this function indicates that a complete line has been assembled, the
+    current user menu function is called to execute the command. Several complete lines may be processed in a single
+    call. The number of characters read and the time spent reading per call are limited by the input budget (see 
+    serialMonInputClass::maxBytesPerCall and maxMicrosPerCall). While a resumable command is in progress (see resume()),
+    it is run for up to maxStepMicrosPerCall per call instead, and no other command lines are read until it finishes;
+    the same applies to a script (see runScript()). A line containing only "{" (or "{!", to stop at the first command
+    that fails) starts a batch: the following lines are executed without echo or prompts, each from the menu in which
+    the batch was started, until a line containing only "}", which prints the batch summary. <ESC> stops a batch (the
+    remaining lines up to "}" are skipped), and a second <ESC> ends it immediately.
+    If the frame mode magic sequence is received (in or out of command mode), frame mode is entered, and requests are
+    read and executed by processFrames() instead.
 
   Parameters: 
     bool enable: if true, all command processing is inhibited and the function returns immediately
   Returns: None
 */
 void serialMonCmdClass::processCommands(bool enable) {
+  char c;
+
   if (!enable)  // if command mode is globally disabled, return immediately
     return;
-  if (!cmdMode) {     // if not already in command mode
-    if (Serial.available()) {               // if a char is availbale to read
-      if (Serial.read() == cmdModeChar) {   // check if it's the "command mode trigger" char
-        if (initMenuFuncP == NULL) {        // return if no top-level user menu fucntion has been specified
-          Serial.println("\nRoot command menu has not been set!");
-          return;
-        }
-        cmdMode = true;             // now in command mode  
-        menuFuncP = initMenuFuncP;  // continue executing top-level menu until soemthing else is specified
-        (*menuFuncP)(PROMPT);       // print the top-level menu prompt
+  input.startBudget();            // start a new input budget period
+  if (busy()) {                   // if a resumable command or a script is in progress
+    if (!runCommand())            // run it; return if it hasn't finished
+      return;
+    if (frameMode) {              // send the (rest of the) reply, now that the command has finished
+      frame.endReply(cmdOk ? FRAME_OK : FRAME_ERROR);
+      if (frameCancel) {          // then answer the request that cancelled it
+        frameCancel = false;
+        frame.startReply();
+        frame.endReply(FRAME_OK);
       }
-      else return;  // not in command mode. Received char, but not the one to trigger command mode
     }
-    else return;  // not in command mode. No character received
+    else if (cmdMode && !batch.active)
+      callMenu(PROMPT);           // print the menu prompt, now that the command has finished
+  }
+  if (frameMode) {
+    processFrames();
+    return;
   }
-  else {    // already in command mode
-    if (input.getCmdLine()) {     // terminated command line has been received
-      if (menuFuncP == NULL) {
-        Serial.println("\nCommand menu has not been initialized!");
+  while (!cmdMode) {              // if not already in command mode
+    if (!input.readChar(&c))      // no character received (or budget used up)
+      return;
+    if (matchMagic(c)) {          // frame mode magic sequence received
+      startFrames();
+      processFrames();
+      return;
+    }
+    if (c == cmdModeChar) {       // check if it's the "command mode trigger" char
+      if ((initMenuFuncP == NULL) && (initMenuTableP == NULL)) {  // return if no top-level user menu has been specified
+        streamP->println("\nRoot command menu has not been set!");
         return;
       }
-      if (input.escape) {         // if escape char received to pop up a menu level
-        Serial.println();         // start new line to prepare for new prompt
-        (*menuFuncP)(ESCAPE);     // call current menu to determine "next level up" menu
-        (*menuFuncP)(PROMPT);     // print the prompt for the new menu
+      cmdMode = true;             // now in command mode  
+      rootMenu();                 // continue executing top-level menu until soemthing else is specified
+      input.resetLine();          // start with an empty command line
+      callMenu(PROMPT);           // print the top-level menu prompt
+    }
+  }
+  while (cmdMode && input.getCmdLine()) {   // for each terminated command line that has been received
+    if ((menuFuncP == NULL) && (menuDepth == 0)) {
+      streamP->println("\nCommand menu has not been initialized!");
+      return;
+    }
+    if (batch.active) {         // command line of a batch, or <ESC> which stops it (or ends it, if already stopped)
+      if (input.escape && !batch.stopped)
+        stopBatch();
+      else if (input.escape || lineIs(batchEndLine))
+        endBatch();
+      else
+        batchCommand();
+      if (busy())               // if the command is resumable, it continues in the next calls
+        return;
+      if (!batch.active && cmdMode)
+        callMenu(PROMPT);
+    }
+    else if (input.escape) {    // if escape char received to pop up a menu level
+      streamP->println();       // start new line to prepare for new prompt
+      callMenu(ESCAPE);         // call current menu to determine "next level up" menu
+      callMenu(PROMPT);         // print the prompt for the new menu
+    }
+    else if (lineIs(frameMagic)) {  // frame mode requested
+      startFrames();
+      processFrames();
+      return;
+    }
+    else if (lineIs(batchStartLine) || lineIs(batchStopLine))
+      startBatch(NULL, lineIs(batchStopLine));
+    else {                      // command line received, no escape char
+      callMenu(COMMAND);        // call the menu to execute the command
+      if (busy())               // if the command is resumable (or started a script), it continues in the next calls
+        return;
+      if (cmdMode)              // if command didn't result in exit from command mode
+        callMenu(PROMPT);       // call the menu to print the menu prompt
+    }
+  }
+}
+
+
+/* serialMonCmdClass::lineIs()
+    Checks whether the command line consists of a single word
+  Parameters: 
+    const char *text: word
+  Returns: 
+    bool: true if the command line is the word
+*/
+bool serialMonCmdClass::lineIs(const char *text) {
+  return ((input.tokenCount() == 1) && (strcmp(input.tokenText(0), text) == 0));
+}
+
+
+/* serialMonCmdClass::callMenu()
+    Calls the current menu, which is either the command table on top of the navigation stack, or a user menu function
+  Parameters: 
+    execTypeEnum execType: type of call (see SerialMonCmd.h)
+  Returns: None
+*/
+void serialMonCmdClass::callMenu(execTypeEnum execType) {
+  if (menuDepth > 0)
+    tableMenu(execType, menuStack[menuDepth - 1]);
+  else if (menuFuncP != NULL)
+    (*menuFuncP)(execType);
+}
+
+
+/* serialMonCmdClass::matchMagic()
+    Checks whether a character received outside of command mode completes the frame mode magic sequence (frameMagic
+    followed by '\n')
+  Parameters: 
+    char c: character received
+  Returns: 
+    bool: true if the magic sequence is complete
+*/
+bool serialMonCmdClass::matchMagic(char c) {
+  if (frameMagic[magicIdx] == '\0') {     // all of frameMagic has been matched; only the '\n' is missing
+    magicIdx = 0;
+    if (c == '\n')
+      return (true);
+  }
+  if (c == frameMagic[magicIdx])
+    magicIdx++;
+  else
+    magicIdx = (c == frameMagic[0]) ? 1 : 0;
+  return (false);
+}
+
+
+/* serialMonCmdClass::startFrames()
+    Enters frame mode: the command object's stream is replaced by the frame reply encoder (so that the output of the
+    menu handlers becomes the reply text), command mode is entered (at the root menu, if it wasn't already active),
+    and a FRAME_READY reply is sent
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::startFrames() {
+  if (!cmdMode) {
+    cmdMode = true;
+    rootMenu();
+  }
+  input.resetLine();
+  framePending = frameCancel = false;
+  frame.begin(streamP);
+  streamP = &frame;
+  frameMode = true;
+  frame.sendReady();
+}
+
+
+/* serialMonCmdClass::processFrames()
+    Reads request frames (within the input budget, see serialMonInputClass::readChar()), and executes each one as soon
+    as it is complete, using the current menu, as a command line or (if it is a single <ESC> character) as an <ESC>
+    that returns to the previous menu. A request that was received while a command was in progress (see
+    cancelReceived()) is executed first. The reply is sent when the command has finished, with status FRAME_ERROR if
+    it was a table menu command that failed. Frame mode ends when command mode is exited, after the reply has been
+    sent.
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::processFrames() {
+  char c;
+
+  while (cmdMode && (framePending || input.readChar(&c))) {
+    if (!framePending && !frame.receive(c))   // no complete request yet (or an invalid one, which has been answered)
+      continue;
+    framePending = false;
+    frame.startReply();
+    cmdOk = true;
+    if (frame.isEscape())
+      callMenu(ESCAPE);
+    else {
+      input.setLine(frame.text());
+      callMenu(COMMAND);
+      if (busy())                       // resumable command or script: the reply is sent when it has finished
+        return;
+    }
+    frame.endReply(cmdOk ? FRAME_OK : FRAME_ERROR);
+  }
+  if (!cmdMode) {                       // command mode has been exited: return to text mode
+    streamP = frame.getPort();
+    frameMode = false;
+  }
+}
+
+
+/* serialMonCmdClass::resume()
+    Called by a command handler to make the command resumable: instead of doing all of its work in the handler, the
+    command continues in the following calls to processCommands(), each of which calls the step function repeatedly
+    (at least once) for up to maxStepMicrosPerCall, until it returns CMD_WAIT or CMD_DONE. Each call of the step
+    function should do a small, bounded amount of work, keeping its progress in the state object. No other command
+    lines are read until the command has finished. If the next input character is <ESC> (in frame mode, the next
+    request is a single <ESC>, see SerialMonFrame.h), the command is cancelled: the step function is called once more
+    with args->cancel set, so that it can clean up, and the command counts as failed. The handler's parameters
+    are passed to the step function, except for 'w' (word) parameters, which should be copied to the state object if
+    they are needed. A step function reports that the command failed by calling args->cmd->fail() (see dispatch()).
+    E.g.
+      void cmdSweep(cmdArgsStruct *args) {
+        sweep.pos = 0; sweep.end = args->param[0].i; args->cmd->resume(args, sweepStep, &sweep);
       }
-      else {                      // command line received, no escape char
-        (*menuFuncP)(COMMAND);    // call the menu to execute the command
-        input.clearLine();        // clear the command line
-        if (*menuFuncP != NULL)   // if command didn't result in exit from command mode
-          (*menuFuncP)(PROMPT);   // call the menu to print the menu prompt
+  Parameters: 
+    cmdArgsStruct *args: parameters received by the handler
+    cmdStepEnum (*stepP)(cmdArgsStruct *): step function
+    void *state: state object, passed to the step function in args->state (must remain valid until the command ends)
+  Returns: None
+*/
+void serialMonCmdClass::resume(cmdArgsStruct *args, cmdStepEnum (*stepP)(cmdArgsStruct *args), void *state) {
+  stepArgs = *args;
+  stepArgs.state = state;
+  stepArgs.cancel = false;
+  stepFuncP = stepP;
+}
+
+
+/* serialMonCmdClass::cancelReceived()
+    Checks whether the command (or script) in progress should be cancelled. In text mode, this is the case if the next
+    input character is <ESC>, which is read; any other input is left unread. In frame mode, input is read (within the
+    input budget) until a complete request has been received: if it is a single <ESC> character, it cancels the
+    command (and is answered after it, see processCommands()), otherwise it is held (framePending) and executed when
+    the command has finished (see processFrames()).
+  Parameters: None
+  Returns: 
+    bool: true if the command should be cancelled
+*/
+bool serialMonCmdClass::cancelReceived() {
+  char c;
+
+  if (!frameMode) {
+    if ((streamP->available() == 0) || (streamP->peek() != escChar))
+      return (false);
+    streamP->read();
+    return (true);
+  }
+  while (!framePending && input.readChar(&c))
+    framePending = frame.receive(c);
+  if (!framePending || !frame.isEscape())
+    return (false);
+  framePending = false;
+  frameCancel = true;
+  return (true);
+}
+
+
+/* serialMonCmdClass::runCommand()
+    Runs the resumable command in progress (see resume()) and/or the lines of the script in progress (see runScript())
+    for up to maxStepMicrosPerCall, or cancels them if requested (see cancelReceived()). Any other input is left
+    unread until the command (or script) has finished.
+  Parameters: None
+  Returns: 
+    bool: true if the command (or script) has finished, or has been cancelled
+*/
+bool serialMonCmdClass::runCommand() {
+  uint32_t startMicros = micros();
+
+  if (cancelReceived()) {
+    if (stepFuncP != NULL) {
+      stepArgs.cancel = true;
+      (*stepFuncP)(&stepArgs);
+      stepFuncP = NULL;
+      cmdOk = false;
+      streamP->println("Cancelled");
+      if (batch.active)
+        endBatchCommand();
+    }
+    if (batch.active)
+      stopBatch();
+    return (!busy());
+  }
+  do {
+    if (stepFuncP != NULL) {
+      switch ((*stepFuncP)(&stepArgs)) {
+        case CMD_WAIT:
+          return (false);
+        case CMD_DONE:
+          stepFuncP = NULL;
+          if (batch.active)
+            endBatchCommand();
+        break;
+        default:
+        break;
       }
     }
+    else
+      runScriptLine();
+  } while (busy() && ((uint32_t) (micros() - startMicros) < maxStepMicrosPerCall));
+  return (!busy());
+}
+
+
+/* serialMonCmdClass::runScript()
+    Starts running a script: a sequence of command lines, each terminated by '\n', which are executed as a batch, each
+    from the root menu (so a line can give a menu path, see CMD_SUBMENU), with no echo or prompts. Empty lines, and lines
+    starting with '#' (comments) are ignored. The script is run by the following calls to processCommands(), for up to
+    maxStepMicrosPerCall per call, and <ESC> stops it. At the end, a summary with the execution time of each command
+    is printed, and the menu (and command mode) that was active when the script was started is restored. May be
+    called from a command handler (see the built-in script menu), or by the program, e.g. to apply a configuration at
+    startup, when no command is in progress.
+  Parameters: 
+    const char *script: command lines (must remain valid until the script has finished, e.g. a string constant)
+    bool stopOnError: stop at the first command that fails
+  Returns: 
+    bool: false if the script couldn't be started (a batch is already in progress, or no root menu has been set)
+*/
+bool serialMonCmdClass::runScript(const char *script, bool stopOnError) {
+  if (batch.active || (stepFuncP != NULL)) {
+    streamP->println("Batch already in progress");
+    return (false);
+  }
+  if ((initMenuFuncP == NULL) && (initMenuTableP == NULL)) {
+    streamP->println("Root command menu has not been set!");
+    return (false);
+  }
+  startBatch(script, stopOnError);
+  return (true);
+}
+
+
+/* serialMonCmdClass::setBatchLog()
+    Sets the array in which the execution time, result and start of each command of a batch is recorded, to be
+    listed in the batch summary (see endBatch()). Without a batch log (the default), the summary only has the totals.
+    The inline template version takes the number of entries from the array, e.g.
+      batchCmdStruct batchLog[16];
+      smCmd.setBatchLog(batchLog);
+  Parameters: 
+    batchCmdStruct *cmds: array of records (NULL for no batch log)
+    uint8_t len: number of records (the first len commands of each batch are listed)
+  Returns: None
+*/
+void serialMonCmdClass::setBatchLog(batchCmdStruct *cmds, uint8_t len) {
+  batch.cmds = cmds;
+  batch.cmdsLen = (cmds != NULL) ? len : 0;
+}
+
+
+/* serialMonCmdClass::startBatch()
+    Starts a batch of commands, read from the stream (see processCommands()) or from a script (see runScript()). The
+    command mode, menu and echo state are saved, to be restored by endBatch(), and echo is disabled. A script is run
+    from the root menu.
+  Parameters: 
+    const char *script: command lines of a script, or NULL for a batch read from the stream
+    bool stopOnError: stop at the first command that fails
+  Returns: None
+*/
+void serialMonCmdClass::startBatch(const char *script, bool stopOnError) {
+  batch.savedCmdMode = cmdMode;
+  batch.savedEcho = input.echoEnabled;
+  batch.savedFuncP = menuFuncP;
+  batch.savedDepth = menuDepth;
+  memcpy(batch.savedStack, menuStack, sizeof(menuStack));
+  batch.active = true;
+  batch.stopOnError = stopOnError;
+  batch.stopped = false;
+  batch.scriptP = script;
+  batch.count = batch.errors = batch.skipped = 0;
+  batch.execMicros = 0;
+  batch.startMicros = micros();
+  input.echoEnabled = false;
+  if (script != NULL) {
+    cmdMode = true;
+    rootMenu();
+  }
+}
+
+
+/* serialMonCmdClass::batchCommand()
+    Executes the command line that has been received (or set from a script) as a command of the batch, and starts
+    timing it. Each command is executed from the menu in which the batch was started (the root menu, for a script),
+    so that lines don't depend on the menus entered by the previous ones. Empty lines are ignored, and lines are
+    skipped (and counted) once the batch has been stopped.
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::batchCommand() {
+  batchCmdStruct *rec;
+  uint8_t len = 0;
+  const char *textP;
+
+  if (input.tokenCount() == 0)
+    return;
+  if (batch.stopped) {
+    batch.skipped++;
+    return;
+  }
+  if (batch.count < batch.cmdsLen) {    // save the start of the command line (its tokens, separated by blanks)
+    rec = &batch.cmds[batch.count];
+    for (uint8_t i = 0; i < input.tokenCount(); i++) {
+      if ((i > 0) && (len < (maxBatchText - 1)))
+        rec->text[len++] = ' ';
+      for (textP = input.tokenText(i); (*textP != '\0') && (len < (maxBatchText - 1)); textP++)
+        rec->text[len++] = *textP;
+    }
+    rec->text[len] = '\0';
+  }
+  if (batch.scriptP != NULL)
+    rootMenu();
+  else
+    restoreMenu();
+  cmdOk = true;
+  batch.cmdMicros = micros();
+  callMenu(COMMAND);
+  if (stepFuncP == NULL)                // resumable commands are timed until they finish
+    endBatchCommand();
+}
+
+
+/* serialMonCmdClass::endBatchCommand()
+    Records the execution time and result of the command of the batch that has just finished. The batch is stopped
+    if the command failed and stopOnError is set, and ended if the command exited command mode.
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::endBatchCommand() {
+  uint32_t us = micros() - batch.cmdMicros;
+
+  if (batch.count < batch.cmdsLen) {
+    batch.cmds[batch.count].micros = us;
+    batch.cmds[batch.count].ok = cmdOk;
+  }
+  batch.count++;
+  batch.execMicros += us;
+  if (!cmdOk) {
+    batch.errors++;
+    if (batch.stopOnError)
+      stopBatch();
+  }
+  if (!cmdMode)
+    endBatch();
+}
+
+
+/* serialMonCmdClass::runScriptLine()
+    Executes the next line of the script in progress (see runScript()), or ends the batch at the end of the script
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::runScriptLine() {
+  char line[maxInputLen];
+  uint8_t len = 0;
+  const char *p = batch.scriptP;
+
+  if ((*p == '\0') || batch.stopped) {
+    endBatch();
+    return;
+  }
+  for (; (*p != '\0') && (*p != '\n'); p++) {
+    if ((*p != '\r') && (len < (maxInputLen - 1)))
+      line[len++] = *p;
+  }
+  line[len] = '\0';
+  batch.scriptP = (*p == '\n') ? (p + 1) : p;
+  if (line[0] == '#')                   // comment
+    return;
+  input.setLine(line);
+  batchCommand();
+}
+
+
+/* serialMonCmdClass::stopBatch()
+    Stops the batch in progress: a script is ended, and the remaining lines of a batch read from the stream are skipped
+    (up to the "}" line that ends it)
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::stopBatch() {
+  batch.stopped = true;
+  if (batch.scriptP != NULL)
+    endBatch();
+  else
+    streamP->println("Batch stopped: skipping to }");
+}
+
+
+/* serialMonCmdClass::endBatch()
+    Ends the batch in progress, prints its summary (the number of commands executed, failed and skipped, the total
+    execution and elapsed time, and the execution time of each command recorded in the batch log), and restores the
+    command mode, menu and echo state that were active when the batch was started. If a command of the batch exited
+    command mode, command mode remains inactive. cmdOk is set to indicate whether all commands succeeded.
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::endBatch() {
+  batchCmdStruct *rec;
+  char buf[maxBatchText + 40];
+
+  snprintf(buf, sizeof(buf), "Batch%s: %u commands, %u failed, %u skipped", batch.stopped ? " stopped" : "",
+            batch.count, batch.errors, batch.skipped);
+  streamP->println(buf);
+  for (uint16_t i = 0; (i < batch.count) && (i < batch.cmdsLen); i++) {
+    rec = &batch.cmds[i];
+    snprintf(buf, sizeof(buf), "%4u %8lu us  %-4s  %s", i + 1, (unsigned long) rec->micros, rec->ok ? "ok" : "FAIL",
+              rec->text);
+    streamP->println(buf);
+  }
+  if ((batch.cmdsLen != 0) && (batch.count > batch.cmdsLen)) {
+    snprintf(buf, sizeof(buf), "  (%u more)", batch.count - batch.cmdsLen);
+    streamP->println(buf);
+  }
+  snprintf(buf, sizeof(buf), "Total: %lu us executing, %lu us elapsed", (unsigned long) batch.execMicros,
+            (unsigned long) (micros() - batch.startMicros));
+  streamP->println(buf);
+  batch.active = false;
+  batch.scriptP = NULL;
+  input.echoEnabled = batch.savedEcho;
+  cmdOk = (batch.errors == 0) && !batch.stopped;
+  if (!cmdMode)                         // a command exited command mode
+    return;
+  if (!batch.savedCmdMode) {            // a script run outside of command mode
+    cmdMode = false;
+    menuFuncP = NULL;
+    menuDepth = 0;
+    return;
+  }
+  restoreMenu();
+}
+
+
+/* serialMonCmdClass::restoreMenu()
+    Makes the menu that was active when the batch was started the current menu again
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::restoreMenu() {
+  menuFuncP = batch.savedFuncP;
+  menuDepth = batch.savedDepth;
+  memcpy(menuStack, batch.savedStack, sizeof(menuStack));
+}
+
+
+/* putStr()
+    Appends a string to an output buffer, first writing the buffer to the stream if it is full. Used to assemble a
+    complete prompt, so that it is sent with a single write() call. Without a buffer (if the scratch arena had no room
+    for one), the string is written immediately.
+  Parameters: 
+    Stream *streamP: stream
+    scratchBufClass *buf: output buffer (up to maxPromptLen characters)
+    uint16_t *len: referenced number of characters in the buffer
+    const char *s: string to append
+  Returns: None
+*/
+static void putStr(Stream *streamP, scratchBufClass *buf, uint16_t *len, const char *s) {
+  if (buf->len == 0) {
+    streamP->write(s);
+    return;
+  }
+  while (*s != '\0') {
+    if (*len >= buf->len) {
+      streamP->write((const uint8_t *) buf->p, *len);
+      *len = 0;
+    }
+    buf->p[(*len)++] = *s++;
   }
 }
 
@@ -83,18 +623,24 @@ void serialMonCmdClass::processCommands(bool enable) {
     Prints two strings as a prompt for the user to enter a comand line for a specific menu level. The "cue" string is
     printed first (on a separate line), and can be used to list the commands that are available for this menu. The 
     "prompt" string is printed as "<prompt>-> ", without a CR/NL, and can be used to indicate the menu name or any
-    type of context information. 
+    type of context information. The complete prompt is sent as a single write (if it fits in maxPromptLen). 
   Parameters: 
     const char *prompt: pointer to a string (may be empty) containing a menu-specific prompt string
     const char *cue: pointer to a string (may be empty) containing a menu-specific cue string
   Returns: None
 */
 void serialMonCmdClass::menuPrompt(const char *prompt, const char *cue) {
-  if (strlen(cue) > 0) 
-    Serial.println(cue);
-  Serial.print('<');
-  Serial.print(prompt);
-  Serial.print(">-> ");
+  scratchBufClass buf(maxPromptLen, 1);
+  uint16_t len = 0;
+
+  if (strlen(cue) > 0) {
+    putStr(streamP, &buf, &len, cue);
+    putStr(streamP, &buf, &len, "\r\n");
+  }
+  putStr(streamP, &buf, &len, "<");
+  putStr(streamP, &buf, &len, prompt);
+  putStr(streamP, &buf, &len, ">-> ");
+  streamP->write((const uint8_t *) buf.p, len);
 }
 
 
@@ -108,6 +654,49 @@ void serialMonCmdClass::menuPrompt(const char *prompt, const char *cue) {
 */
 void serialMonCmdClass::initMenu(void (*fP)(execTypeEnum)) {
   initMenuFuncP = fP;
+  initMenuTableP = NULL;
+}
+
+
+/* serialMonCmdClass::initMenu()
+    Used to specify a command table as the root menu, instead of a user menu function. Since a table menu receives the
+    command object that dispatched it (cmdArgsStruct::cmd), this allows several command objects (sessions) to share
+    the same menu tables. <ESC> is ignored in the root table menu. 
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table
+  Returns: None
+*/
+void serialMonCmdClass::initMenu(const cmdTableStruct *table) {
+  initMenuTableP = table;
+  initMenuFuncP = NULL;
+}
+
+
+/* serialMonCmdClass::rootMenu()
+    Makes the root menu (either a user menu function or a command table, see initMenu()) the current menu, and clears
+    the navigation stack (leaving only the root table, if the root menu is a table)
+  Parameters: None
+  Returns: None
+*/
+void serialMonCmdClass::rootMenu() {
+  menuFuncP = initMenuFuncP;
+  menuDepth = 0;
+  if (initMenuTableP != NULL)
+    nextMenu(initMenuTableP);
+}
+
+
+/* serialMonCmdClass::setStream()
+    Specifies the stream (e.g. Serial, or a hardware serial port such as Serial1) used for all menu input and output,
+    which is Serial by default. Each command object has its own stream, so several independent menu sessions can be
+    run from the same main loop. 
+  Parameters: 
+    Stream *streamP: pointer to the stream
+  Returns: None
+*/
+void serialMonCmdClass::setStream(Stream *streamP) {
+  this->streamP = streamP;
+  input.setStream(streamP);
 }
 
 
@@ -115,13 +704,270 @@ void serialMonCmdClass::initMenu(void (*fP)(execTypeEnum)) {
     Causes an immediate transition to a specified user menu function (other than the current one). Typically 
     used to transition to a sub-menu (in a multi-level menu tree) as part of executing a menu command. Also
     used to "pop up" a menu level when handling a menu ESCAPE condition. The specified function is called with 
-    a parameter value (execTypeEnum) of PROMPT. 
+    a parameter value (execTypeEnum) of PROMPT. Since user menu functions do their own navigation, the navigation
+    stack of table menus is cleared. 
   Parameters: 
     void (*fp)(execTypeEnum): pointer to a user menu function that accepts an execTypeEnum parameter
   Returns: None
 */
 void serialMonCmdClass::nextMenu(void (*fP)(execTypeEnum)) {
   menuFuncP = fP;
+  menuDepth = 0;
+}
+
+
+/* serialMonCmdClass::nextMenu()
+    Causes an immediate transition to a menu defined by a command table, which is pushed on the navigation stack.
+    <ESC> (with an empty command line) in a table menu pops it, returning to the previous menu. 
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table
+  Returns: 
+    bool: false if the navigation stack is full (in which case the current menu doesn't change)
+*/
+bool serialMonCmdClass::nextMenu(const cmdTableStruct *table) {
+  if ((menuDepth > 0) && (menuStack[menuDepth - 1] == table))  // already the current menu
+    return (true);
+  if (menuDepth >= maxMenuDepth) {
+    streamP->println("Menu tree too deep");
+    return (false);
+  }
+  menuStack[menuDepth++] = table;
+  return (true);
+}
+
+
+/* serialMonCmdClass::popMenu()
+    Returns to the previous menu, by popping the current table menu from the navigation stack. The root table menu
+    (see initMenu()) is never popped.
+  Parameters: None
+  Returns: 
+    bool: false if there is no previous menu
+*/
+bool serialMonCmdClass::popMenu() {
+  if ((menuDepth == 0) || ((menuDepth == 1) && (menuStack[0] == initMenuTableP)))
+    return (false);
+  menuDepth--;
+  return (true);
+}
+
+
+/* serialMonCmdClass::tableMenu()
+    Implements a complete user menu from a command table. May be called from a user menu function with the execType
+    parameter that function received, or used implicitly by activating the table with nextMenu(). 
+  Parameters: 
+    execTypeEnum execType: type of call (see SerialMonCmd.h)
+    const cmdTableStruct *table: pointer to the command table
+  Returns: None
+*/
+void serialMonCmdClass::tableMenu(execTypeEnum execType, const cmdTableStruct *table) {
+  switch (execType) {
+    case PROMPT:
+      tablePrompt(table);
+    break;
+    case COMMAND:
+      cmdOk = dispatch(table);
+    break;
+    case ESCAPE:
+      if ((menuDepth > 0) && (table == menuStack[menuDepth - 1]))   // table is on the navigation stack; return to the
+        popMenu();                                                // previous menu
+    break;
+    default:
+    break;
+  }
+}
+
+
+/* serialMonCmdClass::tablePrompt()
+    Prints the cue and prompt strings for a command table menu (see menuPrompt()). The cue string lists each command
+    in the table with a description of its parameters, e.g. "Commands: cfg/, f <float> <float>, i <int>, x", where a
+    trailing '/' marks a submenu. If the table is the current menu, the prompt is the path of the table menus on the
+    navigation stack, e.g. "<Main/Config>-> ". The cue and prompt are assembled and sent as a single write (if they
+    fit in maxPromptLen).
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table
+  Returns: None
+*/
+void serialMonCmdClass::tablePrompt(const cmdTableStruct *table) {
+  const cmdEntryStruct *entry;
+  const char *sigP;
+  scratchBufClass buf(maxPromptLen, 1);
+  uint16_t len = 0;
+
+  putStr(streamP, &buf, &len, "Commands: ");
+  for (uint8_t i = 0; i < table->count; i++) {
+    entry = &table->entries[i];
+    if (i > 0)
+      putStr(streamP, &buf, &len, ", ");
+    putStr(streamP, &buf, &len, entry->key);
+    if (entry->submenu != NULL) {
+      putStr(streamP, &buf, &len, "/");
+      continue;
+    }
+    if (entry->help != NULL) {
+      putStr(streamP, &buf, &len, " ");
+      putStr(streamP, &buf, &len, entry->help);
+      continue;
+    }
+    for (sigP = entry->params; *sigP != '\0'; sigP++) {
+      putStr(streamP, &buf, &len, isupper(*sigP) ? " [" : " ");
+      switch (tolower(*sigP)) {
+        case 'f':
+          putStr(streamP, &buf, &len, "<float>");
+        break;
+        case 'i':
+          putStr(streamP, &buf, &len, "<int>");
+        break;
+        default:
+          putStr(streamP, &buf, &len, "<word>");
+        break;
+      }
+      if (isupper(*sigP))
+        putStr(streamP, &buf, &len, "]");
+    }
+  }
+  putStr(streamP, &buf, &len, "\r\n<");     // same as menuPrompt(), in the same write
+  if ((menuDepth > 0) && (table == menuStack[menuDepth - 1])) {
+    for (uint8_t i = 0; i < menuDepth; i++) {
+      if (i > 0)
+        putStr(streamP, &buf, &len, "/");
+      putStr(streamP, &buf, &len, menuStack[i]->prompt);
+    }
+  }
+  else
+    putStr(streamP, &buf, &len, table->prompt);
+  putStr(streamP, &buf, &len, ">-> ");
+  streamP->write((const uint8_t *) buf.p, len);
+}
+
+
+/* serialMonCmdClass::dispatch()
+    Parses and executes a command line using a command table. The first word in the command line is looked up in
+    the table; the parameters are then parsed according to the entry's parameter signature, and the entry's handler
+    function is called. Error messages are printed for an unknown command or an invalid/missing parameter, in which
+    case the handler isn't called. The handler (or the step function, if the command is resumable) reports that the
+    command failed, after printing its own error message, by calling fail(); a failed command counts as an error in
+    a batch (see processCommands()), and is answered with FRAME_ERROR in frame mode. An empty command line is
+    ignored. If the entry is a submenu (see CMD_SUBMENU), the
+    submenu is entered, and the rest of the line is dispatched from it, so that a path of submenus (optionally
+    followed by a command) can be given in one line. A path alone (e.g. "cfg motor pid") navigates to its last
+    submenu; a path followed by a command (e.g. "cfg set gain 2") executes the command from the submenu, and then
+    returns to the current menu, so that every line of a pasted list of such commands is dispatched from the same
+    menu. If any part of the line fails, the current menu is left unchanged. 
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table
+  Returns: 
+    bool: false if the command couldn't be executed due to an error, or its handler called fail()
+*/
+bool serialMonCmdClass::dispatch(const cmdTableStruct *table) {
+  const cmdEntryStruct *entry;
+  cmdArgsStruct args;
+  const char *sigP;
+  const char *key;
+  uint8_t depth;
+  bool path;
+  bool batchActive;
+  bool ok;
+  bool error;
+
+  key = input.getWordParam(&error);   // find the command keyword
+  if (error)                          // empty line: discard line and do nothing
+    return (true);
+  entry = findCmd(table, key);
+  if (entry == NULL) {
+    streamP->print("Unknown command: ");
+    streamP->println(key);
+    return (false);
+  }
+  if (entry->submenu != NULL) {       // enter the submenu, and dispatch the rest of the line from it
+    depth = menuDepth;
+    path = isPath(entry->submenu);
+    batchActive = batch.active;
+    ok = nextMenu(entry->submenu) && dispatch(entry->submenu);
+    if (!ok || !path) {               // failed, or a command followed the path: return to the current menu
+      menuDepth = depth;
+      if (batch.active && !batchActive)   // the command started a script: also return to it when the script ends
+        batch.savedDepth = depth;
+    }
+    return (ok);
+  }
+  args.cmd = this;
+  args.context = table->context;
+  args.count = 0;
+  args.state = NULL;
+  args.cancel = false;
+  for (sigP = entry->params; (*sigP != '\0') && (args.count < maxCmdParams); sigP++) {
+    switch (tolower(*sigP)) {
+      case 'f':
+        args.param[args.count].f = input.getFloatParam(&error);
+      break;
+      case 'i':
+        args.param[args.count].i = input.getIntParam(&error);
+      break;
+      default:
+        args.param[args.count].s = input.getWordParam(&error);
+      break;
+    }
+    if (error) {
+      if (isupper(*sigP))             // optional parameter is missing; stop parsing
+        break;
+      streamP->print("Invalid or missing parameter ");
+      streamP->println(args.count + 1);
+      return (false);
+    }
+    args.count++;
+  }
+  cmdOk = true;
+  (*entry->handler)(&args);
+  return (cmdOk);
+}
+
+
+/* serialMonCmdClass::isPath()
+    Checks whether the rest of the command line is only a path of submenus (see dispatch())
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table from which the rest of the line is dispatched
+  Returns: 
+    bool: true if each remaining word (if any) is a submenu of the table entered with the one before it, false if
+      the line ends with a command (or an unknown keyword)
+*/
+bool serialMonCmdClass::isPath(const cmdTableStruct *table) {
+  const cmdEntryStruct *entry;
+
+  for (uint8_t n = input.tokenCount() - input.tokensLeft(); n < input.tokenCount(); n++) {
+    entry = findCmd(table, input.tokenText(n));
+    if ((entry == NULL) || (entry->submenu == NULL))
+      return (false);
+    table = entry->submenu;
+  }
+  return (true);
+}
+
+
+/* serialMonCmdClass::findCmd()
+    Looks up a command keyword in a command table using a binary search
+  Parameters: 
+    const cmdTableStruct *table: pointer to the command table (entries sorted by key)
+    const char *key: command keyword
+  Returns: 
+    const cmdEntryStruct *: pointer to the matching entry, or NULL if not found
+*/
+const cmdEntryStruct *serialMonCmdClass::findCmd(const cmdTableStruct *table, const char *key) {
+  int16_t lo = 0;
+  int16_t hi = table->count - 1;
+  int16_t mid;
+  int cmp;
+
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    cmp = strcmp(key, table->entries[mid].key);
+    if (cmp == 0)
+      return (&table->entries[mid]);
+    if (cmp < 0)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+  return (NULL);
 }
 
 
@@ -131,8 +977,46 @@ void serialMonCmdClass::nextMenu(void (*fP)(execTypeEnum)) {
   Returns: None
 */
 void serialMonCmdClass::exit() {
-  Serial.println("Exiting command mode");
+  streamP->println("Exiting command mode");
   cmdMode = false;
   menuFuncP = NULL;
+  menuDepth = 0;
 }
 
+
+
+/* Command handler functions for the script menu (see SerialMonCmd.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters, and prints to the stream of the dispatching command object.
+  Parameters:
+    cmdArgsStruct *args: parsed parameters; args->context points to the cmdScriptTableStruct
+  Returns: None
+*/
+void scriptMenuList(cmdArgsStruct *args) {
+  const cmdScriptTableStruct *table = (const cmdScriptTableStruct *) args->context;
+
+  for (uint8_t i = 0; i < table->count; i++)
+    args->cmd->getStream()->println(table->scripts[i].name);
+}
+
+static void scriptMenuStart(cmdArgsStruct *args, bool stopOnError) {
+  const cmdScriptTableStruct *table = (const cmdScriptTableStruct *) args->context;
+
+  for (uint8_t i = 0; i < table->count; i++) {
+    if (strcmp(table->scripts[i].name, args->param[0].s) == 0) {
+      if (!args->cmd->runScript(table->scripts[i].text, stopOnError))
+        args->cmd->fail();
+      return;
+    }
+  }
+  args->cmd->getStream()->print("Unknown script: ");
+  args->cmd->getStream()->println(args->param[0].s);
+  args->cmd->fail();
+}
+
+void scriptMenuRun(cmdArgsStruct *args) {
+  scriptMenuStart(args, false);
+}
+
+void scriptMenuStop(cmdArgsStruct *args) {
+  scriptMenuStart(args, true);
+}
@@ -0,0 +1,212 @@
+/* SerialMonFrame
+    SerialMonFrame.h and SerialMonFrame.cpp implement frame mode, a binary command session mode for machine-driven
+    control (see SerialMonFrame.h), with the COBS framing and CRC-16 functions it uses. Frame mode is entered and run
+    by serialMonCmdClass::processCommands(); the serialMonFrameClass receives request frames and assembles the replies.
+*/
+#include <Arduino.h>
+#include "SerialMonFrame.h"
+
+
+/* smCrc16()
+    Calculates the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of a block of bytes, four bits at a
+    time using a 16-entry table
+  Parameters:
+    const uint8_t *data: bytes
+    uint16_t len: number of bytes
+  Returns:
+    uint16_t: CRC
+*/
+uint16_t smCrc16(const uint8_t *data, uint16_t len) {
+  static const uint16_t nibbleTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  uint16_t crc = 0xFFFF;
+
+  while (len-- > 0) {
+    crc = (crc << 4) ^ nibbleTable[(crc >> 12) ^ (*data >> 4)];
+    crc = (crc << 4) ^ nibbleTable[(crc >> 12) ^ (*data++ & 0x0F)];
+  }
+  return (crc);
+}
+
+
+/* smCobsEncode()
+    Encodes a block of bytes with COBS (Consistent Overhead Byte Stuffing), so that the result contains no zero bytes
+    and can be terminated by a zero byte. The result is at most len + len / 254 + 1 bytes long.
+  Parameters:
+    const uint8_t *src: bytes to encode
+    uint16_t len: number of bytes
+    uint8_t *dst: output buffer (must not overlap src)
+  Returns:
+    uint16_t: number of bytes written to dst (not including a terminator, which isn't written)
+*/
+uint16_t smCobsEncode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+  uint16_t codeIdx = 0;       // index of the code byte of the current block
+  uint16_t out = 1;
+  uint8_t code = 1;           // code of the current block: 1 + number of non-zero bytes in it
+
+  for (uint16_t i = 0; i < len; i++) {
+    if (src[i] == 0) {        // zero byte: end the block
+      dst[codeIdx] = code;
+      codeIdx = out++;
+      code = 1;
+      continue;
+    }
+    dst[out++] = src[i];
+    if (++code == 0xFF) {     // block of 254 non-zero bytes: end it (with no implied zero)
+      dst[codeIdx] = code;
+      codeIdx = out++;
+      code = 1;
+    }
+  }
+  dst[codeIdx] = code;
+  return (out);
+}
+
+
+/* smCobsDecode()
+    Decodes a COBS-encoded block of bytes in place (see smCobsEncode())
+  Parameters:
+    uint8_t *buf: encoded bytes (without the zero terminator), replaced by the decoded bytes
+    uint16_t len: number of encoded bytes
+  Returns:
+    int16_t: number of decoded bytes, or -1 if the block isn't valid COBS
+*/
+int16_t smCobsDecode(uint8_t *buf, uint16_t len) {
+  uint16_t in = 0;
+  uint16_t out = 0;
+  uint8_t code;
+
+  while (in < len) {
+    code = buf[in++];
+    if ((code == 0) || ((in + code - 1) > len))
+      return (-1);
+    for (uint8_t i = 1; i < code; i++)
+      buf[out++] = buf[in++];
+    if ((code != 0xFF) && (in < len))   // each block but the last (or a full one) is followed by a zero
+      buf[out++] = 0;
+  }
+  return (out);
+}
+
+
+/* serialMonFrameClass::writeFrame()
+    Appends a CRC to a reply frame, and writes it to the port, COBS-encoded and terminated by a zero byte, in a single
+    write() call
+  Parameters:
+    uint8_t *data: seq, status and text, with room for the CRC after them (at most sizeof(reply) bytes in all)
+    uint16_t len: number of bytes, without the CRC
+  Returns: None
+*/
+void serialMonFrameClass::writeFrame(uint8_t *data, uint16_t len) {
+  uint8_t buf[sizeof(reply) + 2];             // encoded frame (one code byte of overhead) and terminator
+  uint16_t crc;
+
+  crc = smCrc16(data, len);
+  data[len++] = crc & 0xFF;
+  data[len++] = crc >> 8;
+  len = smCobsEncode(data, len, buf);
+  buf[len++] = 0;
+  portP->write(buf, len);
+  txFrames++;
+}
+
+
+/* serialMonFrameClass::sendFrame()
+    Completes the reply frame being assembled (with the given status), and writes it to the port. The text is then
+    cleared for the next frame.
+  Parameters:
+    uint8_t status: frameStatusEnum
+  Returns: None
+*/
+void serialMonFrameClass::sendFrame(uint8_t status) {
+  reply[1] = status;
+  writeFrame(reply, replyLen + 2);
+  replyLen = 0;
+}
+
+
+/* serialMonFrameClass::receive()
+    Processes a byte received from the port. When a zero byte completes a request frame, the frame is decoded and its
+    CRC is checked: a valid request is made available by text(), with its sequence number saved for its reply (see
+    startReply()), and an invalid one is answered immediately with a FRAME_BAD reply. The reply being assembled (for
+    a command that is still in progress) isn't affected.
+  Parameters:
+    uint8_t c: byte received
+  Returns:
+    bool: true if a valid request has been received, and should be executed (and answered with endReply())
+*/
+bool serialMonFrameClass::receive(uint8_t c) {
+  int16_t len;
+  uint8_t bad[4];                       // FRAME_BAD reply: seq, status and crc16
+
+  if (c != 0) {
+    if (rxLen < maxFrameCode)
+      rxBuf[rxLen++] = c;
+    else
+      rxOverflow = true;
+    return (false);
+  }
+  if ((rxLen == 0) && !rxOverflow)      // empty frame (e.g. a leading terminator, sent to resynchronize)
+    return (false);
+  len = rxOverflow ? -1 : smCobsDecode(rxBuf, rxLen);
+  rxLen = 0;
+  rxOverflow = false;
+  if ((len < 3) || (smCrc16(rxBuf, len - 2) != (rxBuf[len - 2] | (rxBuf[len - 1] << 8)))) {
+    bad[0] = (len >= 3) ? rxBuf[0] : 0;
+    bad[1] = FRAME_BAD;
+    rxErrors++;
+    writeFrame(bad, 2);
+    return (false);
+  }
+  rxSeq = rxBuf[0];
+  rxBuf[len - 2] = '\0';                // terminate the command line (in place of the CRC)
+  rxFrames++;
+  return (true);
+}
+
+
+/* serialMonFrameClass::write()
+    Adds output of the command being executed to the reply text. When the text is full, it is sent as a reply frame
+    with status FRAME_PARTIAL.
+  Parameters:
+    const uint8_t *data: bytes to write
+    size_t size: number of bytes
+  Returns:
+    size_t: number of bytes written (always size)
+*/
+size_t serialMonFrameClass::write(const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (replyLen >= maxFrameText)
+      sendFrame(FRAME_PARTIAL);
+    reply[2 + replyLen++] = data[i];
+  }
+  return (size);
+}
+
+
+/* serialMonFrameClass::endReply()
+    Sends the last reply frame for the request that was received last, with the remaining text (if any)
+  Parameters:
+    frameStatusEnum status: FRAME_OK or FRAME_ERROR
+  Returns: None
+*/
+void serialMonFrameClass::endReply(frameStatusEnum status) {
+  sendFrame(status);
+}
+
+
+/* serialMonFrameClass::sendReady()
+    Sends a FRAME_READY reply (with sequence number 0), preceded by a zero byte so that the receiver discards anything
+    received before it, to indicate that frame mode has been entered
+  Parameters: None
+  Returns: None
+*/
+void serialMonFrameClass::sendReady() {
+  portP->write((uint8_t) 0);
+  reply[0] = 0;
+  replyLen = 0;
+  write(frameMagic + 1);
+  sendFrame(FRAME_READY);
+}
@@ -7,17 +7,40 @@
       serialMonInputClass::getCmdChar() - fetch the next single-character command from a previously assembled command line.
       serialMonInputClass::getFloatParam() - fetch the next floating point parameter fromn the command line
       serialMonInputClass::getIntParam() - fetch the next integer parameter from the command line
+      serialMonInputClass::getFixedParam() - fetch the next number as a scaled (e.g. milli-unit) fixed-point integer
+      serialMonInputClass::getWordParam() - fetch the next blank-delimited word from the command line
+    When a command line is complete, it is split into tokens in a single pass (see tokenize()). Each token is recorded
+    as an (offset, length, type) span within the command line buffer, and is null-terminated in place, so the parameter
+    functions never copy or rescan the line. Each getXxxParam() function reads the next token, and fails (without
+    consuming the token) if it isn't of a suitable type. Tokens can also be inspected without consuming them using
+    tokensLeft(), peekType(), tokenType() and tokenText(). 
 */
 
 #include <Arduino.h>
 #include "SerialMonInput.h"
+#include "SerialMonNum.h"
+
+/* serialMonInputClass::setStream()
+    Specifies the stream used to read command lines and echo characters, which is Serial by default
+  Parameters: 
+    Stream *streamP: pointer to the stream
+  Returns: None
+*/
+void serialMonInputClass::setStream(Stream *streamP) {
+  this->streamP = streamP;
+}
+
 
 /* serialMonInputClass::getCmdLine()
-    Reads a single character from the serial monitor input (if available) and appends it to the end of the command line
-    buffer (buf). Prior to the first call, assumes that bufP has been previously initialized to point to the head of 
-    the buffer. If a newline ('\n') character is received, the function return value indicates that a complete command 
-    line has been assembled and is ready for processing. Note: Pressing the <Return> key results in the two-character 
-    sequence <CR><NL> = "\r\n". 
+    Reads all available characters from the serial monitor input (subject to the per-call budget, see readChar()) and
+    appends them to the end of the command line buffer (buf), until a complete line has been assembled. If a newline 
+    ('\n') character is received, the function return value indicates that a complete command line has been assembled
+    and is ready for processing, and any remaining characters are left to be read by the next call. This allows several
+    lines that arrive back-to-back (e.g. pasted text) to be processed in a single call to processCommands(). The 
+    completed line is discarded by the next call. Note: Pressing the <Return> key results in the two-character 
+    sequence <CR><NL> = "\r\n". Characters beyond the capacity of the buffer (maxInputLen - 1) are discarded.
+    All characters echoed by a single call are sent to the stream in a single write (see echo()), from a buffer that
+    is borrowed from the scratch arena for the duration of the call.
     If an <ESC> character is received, the response depends on whether or not the command line is currently empty. 
     If non-empty, the entire contents of the command buffer are deleted from the buffer and erased from the serial 
     monitor output. If empty, the return value indicates an end-of-line condition and also sets the boolean class
@@ -25,16 +48,34 @@
   Parameters: None
   Returns: 
     bool: True when a complete line has been received and is ready to be processed. The boolean class variable "escape"
-          indicates that special processing is required. False if no character is available to read, or if any character
-          other than '\n' is received.
+          indicates that special processing is required. False if no complete line has been received before the input
+          was exhausted or the budget ran out.
 */
 bool serialMonInputClass::getCmdLine() {
-  bool eol;   // flag to indicate end-of-line detected
+  scratchBufClass scratch(maxEchoLen, 1);
+  bool done;
+
+  echoBuf = scratch.p;
+  echoBufLen = scratch.len;
+  done = readLine();
+  flushEcho();                // echo everything read by this call in a single write
+  echoBufLen = 0;
+  return (done);
+}
+
+
+/* serialMonInputClass::readLine()
+    Reads characters and assembles the command line for getCmdLine(), which writes the characters echoed by it
+  Parameters: None
+  Returns: 
+    bool: True when a complete line has been received (see getCmdLine())
+*/
+bool serialMonInputClass::readLine() {
   char c;
 
-  eol = false;                // no eol detected yet
-  if (Serial.available()) {   // If anything is available to read
-    c = Serial.read();        // read one char
+  if (lineDone)               // discard the previously completed line
+    resetLine();
+  while (readChar(&c)) {      // while anything is available to read, within the budget
     switch (c) {
       case '\r':              // don't do anything if <CR> or <TAB> is read
       case '\t':
@@ -43,179 +84,468 @@ bool serialMonInputClass::getCmdLine() {
         eraseChar();
       break;
       case '\n':              // if <NEWLINE> received  
-        eol = true;           // this indicates end of line
         escape = false;       // no special processing required
-        bufP = buf;           // reset bufP to the head of the buffer for the next command line
-        Serial.println();     // move output cursor to start of next line
-      break;
+        tokenize();           // split the line into tokens for parsing
+        lineDone = true;
+        echo("\r\n", 2);      // move output cursor to start of next line
+        return (true);        // this indicates end of line
       case escChar:           // if <ESC> char received
-        if (strlen(buf) > 0)  // if the buffer isn't empty
+        if (lineLen > 0)      // if the buffer isn't empty
           clearLine();        // delete/erase entire line, and contine assembling more chars
         else {                // <ESC> was pressed when buffer is empty
-          eol = true;         // indicate end-of-line condition
-          escape = true;      // with special processing
+          escape = true;      // indicate end-of-line condition with special processing
+          lineDone = true;
+          return (true);
         }
       break;
       default:                // any other character was received
-        *bufP = c;            // append it to the buffer
-        bufP++;               // advance the pointer
-        *bufP = '\0';         // add null terminator
-        Serial.print(c);      // echo the char to the serial monitor output
+        if (lineLen >= (maxInputLen - 1))   // no room in buffer; discard the character
+          break;
+        buf[lineLen++] = c;   // append it to the buffer
+        buf[lineLen] = '\0';  // add null terminator
+        echo(&c, 1);          // echo the char to the serial monitor output
       break;
     }
   }
-  return eol;                 // return value as determined above
+  return (false);
+}
+
+
+/* serialMonInputClass::setLine()
+    Sets the command line from a string, instead of reading it from the stream (nothing is echoed), and splits it into
+    tokens, as if it had been received by getCmdLine(). Used for command lines that arrive in binary frames (see
+    SerialMonFrame.h). Characters beyond the capacity of the buffer (maxInputLen - 1) are discarded.
+  Parameters: 
+    const char *text: null-terminated command line (without a terminating newline)
+  Returns: None
+*/
+void serialMonInputClass::setLine(const char *text) {
+  resetLine();
+  while ((*text != '\0') && (lineLen < (maxInputLen - 1)))
+    buf[lineLen++] = *text++;
+  buf[lineLen] = '\0';
+  escape = false;
+  tokenize();
+  lineDone = true;
+}
+
+
+/* serialMonInputClass::echo()
+    Adds characters to the echo buffer, which is written to the stream by flushEcho() (or when it is full), so that
+    the characters echoed by one call to getCmdLine() are sent in a single write rather than one write per character.
+    Without an echo buffer (e.g. if the scratch arena had no room for it), the characters are written immediately.
+    Nothing is echoed if echoEnabled is false.
+  Parameters: 
+    const char *s: characters to echo
+    uint8_t len: number of characters
+  Returns: None
+*/
+void serialMonInputClass::echo(const char *s, uint8_t len) {
+  if (!echoEnabled)
+    return;
+  if (echoBufLen == 0) {
+    streamP->write((const uint8_t *) s, len);
+    return;
+  }
+  while (len-- > 0) {
+    if (echoLen >= echoBufLen)
+      flushEcho();
+    echoBuf[echoLen++] = *s++;
+  }
+}
+
+
+/* serialMonInputClass::flushEcho()
+    Writes the contents of the echo buffer to the stream
+  Parameters: None
+  Returns: None
+*/
+void serialMonInputClass::flushEcho() {
+  if (echoLen > 0)
+    streamP->write((const uint8_t *) echoBuf, echoLen);
+  echoLen = 0;
+}
+
+
+/* serialMonInputClass::readChar()
+    Reads a single character from the serial monitor input, if one is available and the budget (maxBytesPerCall 
+    characters and maxMicrosPerCall microseconds since the last call to startBudget()) hasn't been used up.
+  Parameters: 
+    char *c: referenced char set to the character read
+  Returns: 
+    bool: True if a character was read
+*/
+bool serialMonInputClass::readChar(char *c) {
+  if ((maxBytesPerCall != 0) && (byteCount >= maxBytesPerCall))
+    return (false);
+  if ((maxMicrosPerCall != 0) && ((uint32_t) (micros() - startMicros) >= maxMicrosPerCall))
+    return (false);
+  if (!streamP->available())
+    return (false);
+  *c = streamP->read();
+  byteCount++;
+  return (true);
+}
+
+
+/* serialMonInputClass::startBudget()
+    Starts a new input budget period (see readChar()). Called at the start of each call to processCommands().
+  Parameters: None
+  Returns: None
+*/
+void serialMonInputClass::startBudget() {
+  byteCount = 0;
+  startMicros = micros();
+}
+
+
+/* classifyToken()
+    Determines the type of a (non-quoted) token from its characters
+  Parameters: 
+    const char *s: pointer to the first character of the token
+    uint8_t len: number of characters in the token
+  Returns: 
+    tokenTypeEnum: TOK_INT, TOK_FLOAT, TOK_HEX or TOK_WORD
+*/
+static tokenTypeEnum classifyToken(const char *s, uint8_t len) {
+  const char *endP = s + len;
+  uint8_t digits = 0;
+  bool isFloat = false;
+
+  if ((len > 2) && (s[0] == '0') && ((s[1] == 'x') || (s[1] == 'X'))) {   // hex integer
+    for (s += 2; (s < endP) && isxdigit(*s); s++)
+      ;
+    return ((s == endP) ? TOK_HEX : TOK_WORD);
+  }
+  if ((s < endP) && ((*s == '-') || (*s == '+')))
+    s++;
+  for (; (s < endP) && isdigit(*s); s++)
+    digits++;
+  if ((s < endP) && (*s == '.')) {
+    isFloat = true;
+    for (s++; (s < endP) && isdigit(*s); s++)
+      digits++;
+  }
+  if (digits == 0)
+    return (TOK_WORD);
+  if ((s < endP) && ((*s == 'e') || (*s == 'E'))) {   // exponent
+    isFloat = true;
+    s++;
+    if ((s < endP) && ((*s == '-') || (*s == '+')))
+      s++;
+    if ((s == endP) || !isdigit(*s))
+      return (TOK_WORD);
+    while ((s < endP) && isdigit(*s))
+      s++;
+  }
+  if (s != endP)
+    return (TOK_WORD);
+  return (isFloat ? TOK_FLOAT : TOK_INT);
+}
+
+
+/* serialMonInputClass::tokenize()
+    Splits the completed command line into tokens, recording the offset, length and type (tokenTypeEnum) of each. The
+    blank (or closing quote) that ends each token is replaced with '\0', so that each token is a null-terminated string
+    within the buffer. Tokens beyond maxTokens are ignored. 
+  Parameters: None
+  Returns: None
+*/
+void serialMonInputClass::tokenize() {
+  tokenStruct *tokP;
+  uint8_t i = 0;
+
+  numTokens = 0;
+  tokenIdx = 0;
+  while ((buf[i] != '\0') && (numTokens < maxTokens)) {
+    if (isblank(buf[i])) {      // skip blanks between tokens
+      i++;
+      continue;
+    }
+    tokP = &tokens[numTokens++];
+    if (buf[i] == '"') {        // quoted string; ends at the closing quote (or end of line)
+      tokP->offset = ++i;
+      while ((buf[i] != '\0') && (buf[i] != '"'))
+        i++;
+      tokP->type = TOK_STRING;
+    }
+    else {
+      tokP->offset = i;
+      while ((buf[i] != '\0') && !isblank(buf[i]))
+        i++;
+      tokP->type = classifyToken(buf + tokP->offset, i - tokP->offset);
+    }
+    tokP->len = i - tokP->offset;
+    if (buf[i] != '\0')         // terminate the token
+      buf[i++] = '\0';
+  }
 }
 
 
 /* serialMonInputClass::getCmdChar()
-    Returns the next non-blank character in the command line buffer (buf), assuming that bufP has previously been
-    set (by getCmdLine) to point to the first character in the buffer. Leaves bufP pointing to the next
-    character in the buffer.
+    Returns the first character of the next token in the command line, for use as a single-character command. If the
+    token has more characters, the rest of them are treated as the next token (so "f1.5" can be parsed as the command
+    'f' followed by the float parameter 1.5). 
   Parameters: None
   Returns: 
-    char: next non-blank character in the command line buffer past the current position of bufP. A null character
-      '\0' is returned if there are no more characters to read. 
+    char: next non-blank character in the command line. A null character '\0' is returned if there are no more
+      characters to read. 
 */
 char serialMonInputClass::getCmdChar() {
+  tokenStruct *tokP;
   char retVal;
-  skipBlanks();         // find next non-blank char
-  retVal = *bufP;       // get the char (which could be '\0')
-  if (*bufP != '\0') {  // if not at end of string
-    bufP++;             // advance pointer to next char
+
+  if (tokenIdx >= numTokens)    // no more tokens
+    return ('\0');
+  tokP = &tokens[tokenIdx];
+  retVal = buf[tokP->offset];
+  if ((tokP->type == TOK_STRING) && (tokP->len == 0))   // empty quoted string
+    retVal = '"';
+  if (tokP->len <= 1)           // single-character token
+    tokenIdx++;
+  else {                        // remaining characters become the next token
+    tokP->offset++;
+    tokP->len--;
+    if (tokP->type != TOK_STRING)
+      tokP->type = classifyToken(buf + tokP->offset, tokP->len);
   }
-  return retVal;        // return the character found
+  return (retVal);              // return the character found
 }
 
 
 /* serialMonInputClass::getFloatParam()
-    Finds and converts the next floating point value (string) in the command line buffer. Updates the bufP to the character
-      just past the float string. 
+    Converts the next token in the command line to a floating point value, if it is a decimal number (integer or float).
+    Uses smParseFloat() rather than atof()/strtof().
     Parameters: 
-      bool *error: referenced boolean set to true if no valid floating point value was found in buffer
+      bool *error: referenced boolean set to true if the next token isn't a valid floating point value
     Returns: 
-      float: Converted substring
+      float: Converted token
 */
 float serialMonInputClass::getFloatParam(bool *error) {
-  // char *endPtr;
+  tokenTypeEnum type = peekType();
   float retVal;
 
-  if (!scanToNum()) {   // scan in the buffer to find a valid floating point string
+  if (((type != TOK_FLOAT) && (type != TOK_INT)) || !smParseFloat(buf + tokens[tokenIdx].offset, &retVal)) {
     *error = true;      // no float value found
     return (0);         // return 0
   }
-  retVal = atof(bufP);  // convert the string found
-  // retVal = strtof(bufP, &endPtr);   // convert the string found, and get pointer to next char past the float
-  // bufP = endPtr;                    // move bufP past the float
-  skipPast();           // skip past the numerical string, in preparation for additional parameters
+  tokenIdx++;
   *error = false;       // no error
-  return (retVal);      // return converted value
+  return (retVal);
+}
+
+
+/* serialMonInputClass::getFixedParam()
+    Converts the next token in the command line, if it is a decimal number (integer or float, but without an exponent),
+    to a fixed-point integer value scaled by a power of ten. For example, with decimals = 3, the token "1.5" is returned
+    as 1500 (milli-units). No floating point operations are used. 
+    Parameters: 
+      uint8_t decimals: number of decimal places in the result (0 - 9)
+      bool *error: referenced boolean set to true if the next token isn't a valid number, or is out of range
+    Returns: 
+      int32_t: Converted token
+*/
+int32_t serialMonInputClass::getFixedParam(uint8_t decimals, bool *error) {
+  tokenTypeEnum type = peekType();
+  int32_t retVal;
+
+  if (((type != TOK_FLOAT) && (type != TOK_INT)) || !smParseFixed(buf + tokens[tokenIdx].offset, decimals, &retVal)) {
+    *error = true;
+    return (0);
+  }
+  tokenIdx++;
+  *error = false;
+  return (retVal);
+}
+
+
+/* serialMonInputClass::getQ16Param()
+    Converts the next token in the command line, if it is a decimal number (integer or float, but without an exponent),
+    to a Q16.16 fixed-point value. No floating point operations are used. 
+    Parameters: 
+      bool *error: referenced boolean set to true if the next token isn't a valid number, or is out of range
+    Returns: 
+      int32_t: Converted token
+*/
+int32_t serialMonInputClass::getQ16Param(bool *error) {
+  tokenTypeEnum type = peekType();
+  int32_t retVal;
+
+  if (((type != TOK_FLOAT) && (type != TOK_INT)) || !smParseQ16(buf + tokens[tokenIdx].offset, &retVal)) {
+    *error = true;
+    return (0);
+  }
+  tokenIdx++;
+  *error = false;
+  return (retVal);
 }
 
 
 /* serialMonInputClass::getIntParam()
-    Finds and converts the next integer value (string) in the command line buffer. Updates the bufP to the character
-      just past the integer string. 
+    Converts the next token in the command line to an int. Equivalent to getInt32Param(). 
     Parameters: 
-      bool *error: referenced boolean set to true if no valid floating point value was found in buffer
+      bool *error: referenced boolean set to true if the next token isn't a valid integer
     Returns: 
-      int: Converted substring
+      int: Converted token
 */
 int serialMonInputClass::getIntParam(bool *error) {
-  // char *endPtr;
-  float retVal;
+  return ((int) getInt32Param(error));
+}
 
-  if ((!scanToNum()) || (*bufP == '.')){   // scan in the buffer to find a valid integer string
-    *error = true;      // no integer value found
-    return (0);         // return 0
+
+/* serialMonInputClass::getInt32Param()
+    Converts the next token in the command line to a 32-bit integer, if it is a decimal integer in the range of
+    int32_t, or a hex integer of up to 32 bits (e.g. 0xFFFFFFFF is returned as -1). 
+    Parameters: 
+      bool *error: referenced boolean set to true if the next token isn't a valid integer
+    Returns: 
+      int32_t: Converted token
+*/
+int32_t serialMonInputClass::getInt32Param(bool *error) {
+  int64_t val;
+
+  *error = true;
+  if ((tokenIdx >= numTokens) || !tokenToInt64(&tokens[tokenIdx], &val))
+    return (0);
+  if (tokens[tokenIdx].type == TOK_HEX) {
+    if ((uint64_t) val > 0xFFFFFFFFULL)
+      return (0);
   }
-  retVal = atoi(bufP);  // convert the string found
-  // retVal = (int) strtol(bufP, &endPtr, 10);   // convert the string found, and get pointer to next char past the float
-  // bufP = endPtr;      // move bufP past the float
-  skipPast();           // skip past the numerical string, in preparation for additional parameters
-  *error = false;       // no error
-  return (retVal);      // return converted value
+  else if ((val < INT32_MIN) || (val > INT32_MAX))
+    return (0);
+  tokenIdx++;
+  *error = false;
+  return ((int32_t) val);
 }
 
 
-/* serialMonInputClass::eraseChar()
-    Deletes the character most recently added to the command line buffer (buf). Assumes that, if the buffer 
-    isn't empty, bufP points to the next index in the string (which contains a '\0' string terminator). 
-    This function also erases the character, which was previously printed (echoed) to the serial monitor 
-    output. 
-  Parameters: None
-  Returns: None
+/* serialMonInputClass::getInt64Param()
+    Converts the next token in the command line to a 64-bit integer, if it is a decimal integer in the range of
+    int64_t, or a hex integer of up to 64 bits. 
+    Parameters: 
+      bool *error: referenced boolean set to true if the next token isn't a valid integer
+    Returns: 
+      int64_t: Converted token
 */
-void serialMonInputClass::eraseChar() {
-  if (bufP > buf) {         // if the command buffer isn't empty
-    bufP--;                 // move pointer to the last non-null char in the buffer
-    *bufP = '\0';           // replace the character with the null string terminator
-    Serial.print("\b \b");  // <backspace><space><backspace> to erase character on output
+int64_t serialMonInputClass::getInt64Param(bool *error) {
+  int64_t val;
+
+  if ((tokenIdx >= numTokens) || !tokenToInt64(&tokens[tokenIdx], &val)) {
+    *error = true;
+    return (0);
   }
+  tokenIdx++;
+  *error = false;
+  return (val);
 }
 
 
-/* serialMonInputClass::clearLine()
-    Deletes the entire contents of the command line buffer (buf) and erases all characters that have been
-    previously echoed to the output
-  Parameters: None
-  Returns: None
+/* serialMonInputClass::tokenToInt64()
+    Converts an integer token to a 64-bit value, checking for overflow
+  Parameters: 
+    const tokenStruct *tokP: pointer to the token
+    int64_t *val: referenced value set to the converted token
+  Returns: 
+    bool: false if the token isn't an integer, or is out of range
 */
-void serialMonInputClass::clearLine() {
-  uint8_t n = strlen(buf);          // get the length of the command line buffer (not including terminator)
-  for (uint8_t i = 0; i < n; i++)   // for each char
-    eraseChar();                    // delete from buffer and erase previously-echoed output
+bool serialMonInputClass::tokenToInt64(const tokenStruct *tokP, int64_t *val) {
+  const char *s = buf + tokP->offset;
+  uint64_t mag = 0;
+  uint64_t limit;
+  uint8_t digit;
+  bool neg = false;
+
+  if (tokP->type == TOK_HEX) {
+    if (tokP->len > 18)                 // more than 16 hex digits
+      return (false);
+    for (s += 2; *s != '\0'; s++) {
+      digit = isdigit(*s) ? (*s - '0') : ((tolower(*s) - 'a') + 10);
+      mag = (mag << 4) | digit;
+    }
+    *val = (int64_t) mag;
+    return (true);
+  }
+  if (tokP->type != TOK_INT)
+    return (false);
+  if ((*s == '-') || (*s == '+'))
+    neg = (*s++ == '-');
+  limit = neg ? ((uint64_t) INT64_MAX + 1) : (uint64_t) INT64_MAX;
+  for (; *s != '\0'; s++) {
+    digit = *s - '0';
+    if (mag > ((limit - digit) / 10))   // overflow
+      return (false);
+    mag = (mag * 10) + digit;
+  }
+  *val = neg ? (int64_t) (0 - mag) : (int64_t) mag;
+  return (true);
 }
 
 
-/* serialMonInputClass::skipBlanks()
-    Advances bufP from its current position in the buffer to the position of the next non-blank character
-    or a null string terminator ('\0')
-  Parameters: None
-  Returns: None
+/* serialMonInputClass::getWordParam()
+    Returns the next token in the command line (of any type) as a null-terminated string. For a quoted string token,
+    the quotes are not included. 
+    Parameters: 
+      bool *error: referenced boolean set to true if there are no more tokens in the command line
+    Returns: 
+      char *: pointer to the token within the buffer (NULL if error)
 */
-void serialMonInputClass::skipBlanks() {
-  while (isblank(*bufP) && (*bufP != '\0')) {
-    bufP++;
+char *serialMonInputClass::getWordParam(bool *error) {
+  if (tokenIdx >= numTokens) {  // no more tokens
+    *error = true;
+    return (NULL);
   }
+  *error = false;
+  return (buf + tokens[tokenIdx++].offset);
 }
 
 
-/* serialMonInputClass::skipPast()
-    Advances bufP from its current position in the buffer to the position of the next blank character
-    or a null string terminator ('\0'). Used to skip past a numerical parameter string after it has been converted.
+/* serialMonInputClass::eraseChar()
+    Deletes the character most recently added to the command line buffer (buf). This function also erases the
+    character, which was previously printed (echoed) to the serial monitor output. The erase sequence is added to the
+    echo buffer (if any, see echo()), which is written by the next flushEcho().
   Parameters: None
   Returns: None
 */
-void serialMonInputClass::skipPast() {
-  while (!isblank(*bufP) && (*bufP != '\0')) {
-    bufP++;
+void serialMonInputClass::eraseChar() {
+  if (lineLen > 0) {        // if the command buffer isn't empty
+    lineLen--;              // move to the last non-null char in the buffer
+    buf[lineLen] = '\0';    // replace the character with the null string terminator
+    echo("\b \b", 3);      // <backspace><space><backspace> to erase character on output
   }
 }
 
 
-/* scriptLineBufferClass::scanToNum()
-    Moves the line buffer bufP until something that looks like the start of a floating point value is found. Some additional
-      validation is performed to ensure a successful conversion of the string to a float value.  
-    Parameters: None
-    Returns:
-      bool: True if a valid-looking float value is found
+/* serialMonInputClass::clearLine()
+    Deletes the entire contents of the command line buffer (buf) and erases all characters that have been
+    previously echoed to the output
+  Parameters: None
+  Returns: None
 */
-bool serialMonInputClass::scanToNum() {
-    // scan in buffer until a something looks like the start of a float (or end of line) is found
-  while (!isdigit(*bufP) && (*bufP != '.') && (*bufP != '-') && (*bufP != '\0'))
-    bufP++;
-  if (*bufP == '\0')   // if end of line was encountered without finding anything that looks like a float
-    return (false);
-  if (!isdigit(*bufP)) {   // must have found '.' or '-'
-    if (!isdigit(*(bufP+1)))
-      return (false);   // next char after '.' or '-' should have been a digit
-    else 
-      return (true);    // everything looks OK
-  }
-  else {
-    return (true);    // valid digit was found
+void serialMonInputClass::clearLine() {
+  scratchBufClass scratch((echoBufLen == 0) ? maxEchoLen : 0, 1);   // (getCmdLine() already has an echo buffer)
+
+  if (scratch.len != 0) {
+    echoBuf = scratch.p;
+    echoBufLen = scratch.len;
   }
+  while (lineLen > 0)               // for each char
+    eraseChar();                    // delete from buffer and erase previously-echoed output
+  flushEcho();                      // as few writes as possible for the whole line
+  if (scratch.len != 0)
+    echoBufLen = 0;
 }
 
 
+/* serialMonInputClass::resetLine()
+    Deletes the entire contents of the command line buffer (buf), without any output. Used to discard a command line
+    after it has been processed.
+  Parameters: None
+  Returns: None
+*/
+void serialMonInputClass::resetLine() {
+  lineLen = 0;
+  buf[0] = '\0';
+  lineDone = false;
+  numTokens = 0;
+  tokenIdx = 0;
+}
@@ -5,36 +5,1090 @@
     standard sprintf() function. As currently written (but easily modified), the LOGMSG macro requires the prior definition 
     of a serialMonLogClass object named "smLog". 
     The class data member logLevel (0 - 255) may be set to control which log messages are printed. For example, if 
-    logLevel = 2, only log messages with criticality 0, 1, and 2 will be printed. 
+    logLevel = 2, only log messages with criticality 0, 1, and 2 will be printed. Messages logged with LOGMSG_TAG belong
+    to a subsystem (tag), and are filtered by the tag's own level (tagLevel[tag]) instead, so that one subsystem can be
+    made verbose while the others stay quiet. 
     A boolean data member named "enable" may be set to globally enable or disable printing of all log messages regardless of
     criticality level. 
+    If the data member "deferred" is set, LOGMSG doesn't format or print anything. It captures the format string pointer,
+    timestamp and raw argument values into a fixed-size ring buffer, and the messages are formatted and printed later
+    (e.g. during idle time in the main loop) by calling drain(). String arguments of deferred messages must therefore
+    be static (see LOGMSG). 
+    Log output never blocks waiting for room in the Serial output buffer (unless dropPolicy is LOG_BLOCK, which waits
+    for a limited time). Messages that can't be printed immediately are queued in the ring buffer, and the dropPolicy
+    determines which messages are discarded when the ring buffer is full. Discarded messages are counted (dropCount,
+    dropBytes), and reported with a "[N log messages dropped]" line once output is possible again. The string
+    arguments of a queued message are copied to a small pool (see logTextPoolClass), since the caller's buffers may be
+    gone by the time it is printed. 
+    If the data member "binary" is set, messages are output in a compact binary format rather than text (see
+    printBinary() below). The tools/smlogdecode.cpp host program converts the binary stream back into the same text
+    that would otherwise have been printed. 
+    Noisy call sites can be limited with the LOGMSG_RL macro (a per-call-site token bucket), and if the data member
+    "collapseRepeats" is set, consecutive identical messages are replaced by a "[last message repeated N times]" line.
+    Interrupt handlers (or other contexts that may preempt the main loop) must use LOGISR instead of LOGMSG. LOGISR
+    only captures the message into a lock-free queue, which drain() moves to the ring buffer and prints, so drain()
+    should be called regularly from the main loop when LOGISR is used.
+    If the data member "history" is set, recent messages (including those that aren't printed because logging is
+    disabled, or because their level is above logLevel but within histLevel) are also kept in a history ring (an
+    array provided by the program, see setHistory()), in raw form, with copies of their string arguments in a text
+    pool (also provided by the program). They are only formatted when printed by dumpHistory() or replayHidden(),
+    which are available as menu commands (see SerialMonLogMenu.h). LOGISR messages are not recorded in the history.
+    Messages can also be written to sinks (see addSink() and SerialMonSink.h), e.g. to mirror the log to a second
+    serial port, or to keep it in memory or a file while nothing is printed. Each sink has its own level, and a
+    message is formatted only once for all of the sinks (and for the stream too, if it is printed immediately; a
+    message that is queued is formatted again from its captured arguments when it is printed).
 */
 #include <Arduino.h>
 #include <elapsedMillis.h>
 #include "SerialMonLog.h"
+#include "SerialMonNum.h"
 
 
-/* serialMonLogClass::printLog()
-    Prints the log message string that has been previously assembled in serialMonLogClass::buf[] by a call to the
-    LOGMSG macro. The message is prepended with a timestamp (in seconds), if setTimeStamp() has been previously called to define the 
-    timestamp variable.
+/* serialMonLogClass::printMsg()
+    Prints a log message string that has already been assembled (e.g. with snprintf()), without using the LOGMSG
+    macro. (It replaces printLog(), which printed the message that LOGMSG had assembled in msgBuf.) The message is
+    prepended with a timestamp (in seconds), if setTimeStamp() has been previously called to define the timestamp
+    variable. The message is dropped (and counted) if it can't be printed without blocking (see printLine()). It is
+    also written to the sinks (see addSink()), as a message of level 0.
+  Parameters: 
+    const char *text: message string (truncated to maxMsgLen - 1 characters)
+  Returns: None
+*/
+void serialMonLogClass::printMsg(const char *text) {
+  scratchBufClass line(logLineLen);
+  uint8_t len;
+
+  if (line.len != 0) {
+    len = formatTimestamp(line.p, (timeStampP != NULL) ? (uint32_t) *timeStampP : 0);
+    strncpy(line.p + len, text, maxMsgLen - 1);
+    line.p[len + maxMsgLen - 1] = '\0';
+    if (sinks != NULL)
+      writeSinks(0, line.p);
+    if (printLine(line.p))
+      return;
+  }
+  else if (sinks != NULL)
+    writeSinks(0, NULL);
+  countDrop(strlen(text));
+}
+
+
+/* serialMonLogClass::printLine()
+    Prints a log message line that has been assembled in a buffer of logLineLen characters (the timestamp, if any,
+    followed by the message), followed by <CR><NL>, as a single write to the stream. If there are dropped messages
+    that haven't yet been reported, a "[N log messages dropped]" line is printed first. Nothing is printed unless
+    there is room for the complete line in the output buffer. 
+  Parameters: 
+    char *line: null-terminated line (<CR><NL> is appended in place)
+  Returns: 
+    bool: true if the message was printed
+*/
+bool serialMonLogClass::printLine(char *line) {
+  uint8_t len = strlen(line);
+
+  if (!reportDrops())             // can't report dropped messages yet, so don't print anything else either
+    return (false);
+  line[len++] = '\r';
+  line[len++] = '\n';
+  if (!waitForRoom(len))
+    return (false);
+  streamP->write((const uint8_t *) line, len);
+  return (true);
+}
+
+
+/* serialMonLogClass::waitForRoom()
+    Checks whether the Serial output (TX) buffer can accept a specified number of bytes without blocking. If not, and
+    dropPolicy is LOG_BLOCK, waits up to blockMicros for room to become available. 
+  Parameters: 
+    uint16_t len: number of bytes to be written
+  Returns: 
+    bool: true if there is room for len bytes
+*/
+bool serialMonLogClass::waitForRoom(uint16_t len) {
+  uint32_t start;
+
+  if (streamP->availableForWrite() >= len)
+    return (true);
+  if (dropPolicy != LOG_BLOCK)
+    return (false);
+  start = micros();
+  while ((uint32_t) (micros() - start) < blockMicros) {
+    if (streamP->availableForWrite() >= len)
+      return (true);
+  }
+  return (false);
+}
+
+
+/* serialMonLogClass::countDrop()
+    Updates the dropped message counters
+  Parameters: 
+    uint16_t len: number of bytes in the dropped message (may be approximate)
+  Returns: None
+*/
+void serialMonLogClass::countDrop(uint16_t len) {
+  dropCount++;
+  dropBytes += len;
+  dropUnreported++;
+}
+
+
+/* serialMonLogClass::reportDrops()
+    If any messages have been dropped since the last report, prints a "[N log messages dropped]" line (or, in binary
+    mode, an equivalent LOG_REC_TEXT record) when there is room in the output buffer. 
+  Parameters: None
+  Returns: 
+    bool: true if there are no unreported drops (i.e. normal output may proceed)
+*/
+bool serialMonLogClass::reportDrops() {
+  char buf[40];
+  uint8_t len;
+  uint8_t hdrLen = binary ? 2 : 0;    // LOG_REC_TEXT type code and 1-byte length
+
+  if (dropUnreported == 0)
+    return (true);
+  len = snprintf(buf + hdrLen, sizeof(buf) - hdrLen, binary ? "[%lu log messages dropped]" : "[%lu log messages dropped]\r\n",
+                  (unsigned long) dropUnreported);
+  if (binary) {
+    if (!binarySynced)                // the decoder can't interpret anything before the sync record
+      return (true);
+    buf[0] = LOG_REC_TEXT;
+    buf[1] = len;
+  }
+  if (!waitForRoom(len + hdrLen))
+    return (false);
+  streamP->write((const uint8_t *) buf, len + hdrLen);
+  dropUnreported = 0;
+  return (true);
+}
+
+
+/* serialMonLogClass::formatTimestamp()
+    Assembles a timestamp string, in seconds, in the form "[s.mmm] " at the start of a line buffer, without using
+    floating point, if a timestamp timer has been defined (otherwise, the line is left empty)
+  Parameters: 
+    char *buf: line buffer (at least maxTimestampLen characters)
+    uint32_t ts: timestamp in ms
+  Returns: 
+    uint8_t: number of characters in the timestamp (0 if there is no timestamp timer)
+*/
+uint8_t serialMonLogClass::formatTimestamp(char *buf, uint32_t ts) {
+  if (timeStampP == NULL) {
+    buf[0] = '\0';
+    return (0);
+  }
+  return (smFormatTimestamp(buf, ts));  // integer formatting; no floating point required
+}
+
+
+/* serialMonLogClass::drain()
+    Formats and prints deferred log messages that were previously captured in the ring buffer by the LOGMSG macro,
+    or in the lock-free queue by the LOGISR macro. 
+    Intended to be called from the main loop when there is idle time available. The budget parameter limits the number
+    of messages printed per call, so that the time spent in a single call can be bounded. Messages are only printed
+    when there is room for them in the Serial output buffer (and for a line buffer in the scratch arena); otherwise
+    they remain queued for a later call. 
+  Parameters: 
+    uint8_t budget: maximum number of messages to print
+  Returns: 
+    uint8_t: number of messages printed
+*/
+uint8_t serialMonLogClass::drain(uint8_t budget) {
+  uint8_t n = 0;    // number of messages printed
+  bool printed;
+
+  drainIsr();                         // first move any LOGISR messages to the ring buffer
+  {
+    scratchBufClass line(logLineLen); // buffer in which each message is formatted or encoded (given back before the
+                                      //    reports below, which borrow one of their own)
+    while ((n < budget) && (ringTail != ringHead) && (line.len != 0)) {
+      if (binary)
+        printed = printBinary(&ring[ringTail], (uint8_t *) line.p);
+      else {
+        formatEntry(&ring[ringTail], line.p + formatTimestamp(line.p, ring[ringTail].ts), maxMsgLen);
+        printed = printLine(line.p);
+      }
+      if (!printed)                   // no room in the output buffer; leave the message queued
+        break;
+      popRing();
+      n++;
+    }
+  }
+  if (ringTail == ringHead)           // report drops even if there is nothing else to print
+    reportDrops();
+  if ((repeatCount != 0) && ((uint32_t) (millis() - repeatStartMs) >= repeatFlushMs))
+    reportRepeats();
+  return (n);
+}
+
+
+/* serialMonLogClass::drainIsr()
+    Moves messages captured by LOGISR (see logIsr()) from the lock-free queue to the ring buffer, in the order in which
+    their queue slots were reserved, for as long as there is room in the ring buffer. Messages that don't fit remain
+    in the queue. Messages for the sinks are formatted and written to them as they leave the queue; a message that is
+    only for the sinks doesn't need room in the ring buffer. Must only be called from the main loop (the queue's
+    single consumer).
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogClass::drainIsr() {
+  scratchBufClass line((sinks != NULL) ? logLineLen : 0);  // buffer in which messages are formatted for the sinks
+  isrSlotStruct *slot;
+
+  for (;;) {
+    slot = &isrQueue[isrTail % isrQueueLen];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != (isrTail + 1))   // empty, or next entry not yet published
+      return;
+    if (!slot->entry.hidden && (((ringHead + 1) % logRingLen) == ringTail))   // no room in ring buffer
+      return;
+    if (SMLOG_SINK_WANTED(*this, slot->entry.level)) {
+      if (line.len != 0)
+        formatEntry(&slot->entry, line.p + formatTimestamp(line.p, slot->entry.ts), maxMsgLen);
+      writeSinks(slot->entry.level, (line.len != 0) ? line.p : NULL);
+    }
+    if (!slot->entry.hidden) {
+      ring[ringHead] = slot->entry;
+      ringHead = (ringHead + 1) % logRingLen;
+    }
+    __atomic_store_n(&slot->seq, isrTail + isrQueueLen, __ATOMIC_RELEASE);   // release the slot for the next lap
+    isrTail++;
+  }
+}
+
+
+/* serialMonLogClass::queueFull()
+    Called when a message is to be captured but the ring buffer is full. Makes room in the ring buffer according to
+    dropPolicy: LOG_DROP_NEWEST discards the new message; LOG_DROP_OLDEST discards the oldest queued message;
+    LOG_BLOCK waits (up to blockMicros) to print the oldest queued message, and discards the new message if that fails.
+    The byte count of a discarded message is estimated from its format string, since it hasn't been formatted. 
+  Parameters: 
+    const char *fmt: format string of the new message
+  Returns: 
+    bool: true if there is now room in the ring buffer for the new message
+*/
+bool serialMonLogClass::queueFull(const char *fmt) {
+  if (!ringFull)                      // first dropped message since the ring last had room
+    overflowCount++;
+  ringFull = true;
+  if (dropPolicy == LOG_DROP_OLDEST) {
+    countDrop(strlen(ring[ringTail].fmt));
+    popRing();
+    return (true);
+  }
+  if ((dropPolicy == LOG_BLOCK) && (drain(1) == 1))
+    return (true);
+  countDrop(strlen(fmt));
+  return (false);
+}
+
+
+/* serialMonLogClass::keepQueued()
+    Called by outputMsg() for a message that isn't deferred, but has to be queued in the ring buffer (at ringHead):
+    copies its string arguments to the string pool. If the pool has no room for them, the oldest queued messages are
+    discarded to make room if dropPolicy is LOG_DROP_OLDEST; otherwise the new message is discarded. 
+  Parameters: 
+    logEntryStruct *entry: captured message
+    uint8_t strMask: arguments that are strings (see logStrArgs)
+  Returns: 
+    bool: true if the strings have been copied (false if the message has been discarded)
+*/
+bool serialMonLogClass::keepQueued(logEntryStruct *entry, uint8_t strMask) {
+  while (!ringPool.keep(entry, strMask)) {
+    if ((dropPolicy != LOG_DROP_OLDEST) || (ringTail == ringHead)) {
+      countDrop(strlen(entry->fmt));
+      return (false);
+    }
+    countDrop(strlen(ring[ringTail].fmt));
+    popRing();
+  }
+  return (true);
+}
+
+
+/* logTextPoolClass::take()
+    Takes a block of characters from the head of the pool. A block is never split: if it doesn't fit at the end of
+    the pool, it is taken from the start, and the end is left unused until the tail passes it.
+  Parameters: 
+    uint16_t len: number of characters
+  Returns: 
+    char *: the block, or NULL if the pool has no room for it
+*/
+char *logTextPoolClass::take(uint16_t len) {
+  char *p = buf + head;
+
+  if (head >= tail) {                   // free characters are from head to the end, and from the start to tail
+    if (((size - head) > len) || (((size - head) == len) && (tail != 0))) {
+      head = (head + len) % size;
+      return (p);
+    }
+    if (tail > len) {                   // (head must not catch up with tail, which would make the pool look empty)
+      head = len;
+      return (buf);
+    }
+  }
+  else if ((tail - head) > len) {       // free characters are from head to tail
+    head += len;
+    return (p);
+  }
+  return (NULL);
+}
+
+
+/* logTextPoolClass::keep()
+    Copies the string arguments of a captured log message (each up to maxMsgLen - 1 characters) to the pool, as a
+    single block, and points the arguments to the copies
+  Parameters: 
+    logEntryStruct *entry: captured message
+    uint8_t strMask: arguments that are strings (see logStrArgs)
+  Returns: 
+    bool: false if the pool has no room for the copies (in which case the message is unchanged)
+*/
+bool logTextPoolClass::keep(logEntryStruct *entry, uint8_t strMask) {
+  uint16_t len = 0;
+  uint8_t n;
+  char *p;
+
+  for (uint8_t i = 0; i < entry->numArgs; i++) {
+    if ((strMask & (1 << i)) && (entry->args[i].s != NULL))
+      len += strnlen(entry->args[i].s, maxMsgLen - 1) + 1;
+  }
+  if (len == 0)
+    return (true);
+  if ((p = take(len)) == NULL)
+    return (false);
+  for (uint8_t i = 0; i < entry->numArgs; i++) {
+    if ((strMask & (1 << i)) && (entry->args[i].s != NULL)) {
+      n = strnlen(entry->args[i].s, maxMsgLen - 1);
+      memcpy(p, entry->args[i].s, n);
+      p[n] = '\0';
+      entry->args[i].s = p;
+      p += n + 1;
+    }
+  }
+  return (true);
+}
+
+
+/* logTextPoolClass::release()
+    Releases the copies of the string arguments of a message that has been printed or discarded (which must be the
+    oldest message with copies in the pool). The copies are recognized by their address.
+  Parameters: 
+    const logEntryStruct *entry: message
+  Returns: None
+*/
+void logTextPoolClass::release(const logEntryStruct *entry) {
+  uintptr_t p;
+
+  if (head == tail)                     // nothing to release
+    return;
+  for (uint8_t i = entry->numArgs; i-- > 0; ) {   // the last copy ends the message's block
+    p = (uintptr_t) entry->args[i].s;
+    if ((((entry->argTypes >> (2 * i)) & 0x03) == LOG_ARG_PTR) && (p >= (uintptr_t) buf) &&
+          (p < (uintptr_t) (buf + size))) {
+      tail = ((p - (uintptr_t) buf) + strlen(entry->args[i].s) + 1) % size;
+      if (tail == head)                 // pool is empty: start again from the start
+        head = tail = 0;
+      return;
+    }
+  }
+}
+
+
+/* serialMonLogClass::isRepeat()
+    Used by logMsg() when collapseRepeats is set. Compares a message with the previous message, and counts it as a
+    repeat if the format string and argument values are the same (for string arguments, the characters they point
+    to, since the caller may log different contents from the same buffer). Otherwise, any repeats of the previous
+    message are reported, and the new message becomes the one to compare with; its strings are copied to lastText,
+    and if they don't fit, it is never counted as repeated. 
+  Parameters: 
+    const logEntryStruct *entry: new message (format and captured arguments; the timestamp is ignored)
+    uint8_t strMask: arguments that are strings (see logStrArgs)
+  Returns: 
+    bool: true if the message is a repeat, and shouldn't be printed
+*/
+bool serialMonLogClass::isRepeat(const logEntryStruct *entry, uint8_t strMask) {
+  bool same = (entry->fmt == lastEntry.fmt) && (entry->numArgs == lastEntry.numArgs) &&
+              (entry->argTypes == lastEntry.argTypes);
+
+  for (uint8_t i = 0; same && (i < entry->numArgs); i++) {
+    if ((strMask & (1 << i)) && (entry->args[i].s != NULL) && (lastEntry.args[i].s != NULL))
+      same = (strncmp(entry->args[i].s, lastEntry.args[i].s, maxMsgLen - 1) == 0);
+    else if (((entry->argTypes >> (2 * i)) & 0x03) == LOG_ARG_PTR)
+      same = (entry->args[i].s == lastEntry.args[i].s);
+    else
+      same = (entry->args[i].u == lastEntry.args[i].u);
+  }
+  if (same) {
+    if (repeatCount++ == 0)
+      repeatStartMs = millis();
+    else if ((uint32_t) (millis() - repeatStartMs) >= repeatFlushMs)
+      reportRepeats();
+    return (true);
+  }
+  if (repeatCount != 0)
+    reportRepeats();
+  lastEntry = *entry;
+  lastPool.clear();
+  if (!lastPool.keep(&lastEntry, strMask))  // strings too long to compare: nothing will match
+    lastEntry.fmt = NULL;
+  return (false);
+}
+
+
+/* serialMonLogClass::reportRepeats()
+    Prints a "[last message repeated N times]" line for the repeats counted by isRepeat(). The previous message is
+    kept, so that further repeats continue to be collapsed. 
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogClass::reportRepeats() {
+  uint32_t n = repeatCount;
+
+  repeatCount = 0;
+  outputMsg(0, enable, "[last message repeated %lu times]", (unsigned long) n);
+}
+
+
+/* serialMonLogClass::reportSuppressed()
+    Prints a "[N messages suppressed]" line for a LOGMSG_RL call site that is about to print again (see rateCheck())
+  Parameters: 
+    uint32_t n: number of messages suppressed by the call site
+  Returns: None
+*/
+void serialMonLogClass::reportSuppressed(uint32_t n) {
+  logMsg(0, "[%lu messages suppressed]", (unsigned long) n);
+}
+
+
+/* serialMonLogClass::pending()
+    Returns the number of deferred log messages waiting to be printed by drain()
+  Parameters: None
+  Returns: 
+    uint8_t: number of messages in the ring buffer and the LOGISR queue
+*/
+uint8_t serialMonLogClass::pending() {
+  uint32_t isrPending = __atomic_load_n(&isrHead, __ATOMIC_RELAXED) - isrTail;
+
+  return (((ringHead + logRingLen - ringTail) % logRingLen) + isrPending);
+}
+
+
+/* serialMonLogClass::binaryResync()
+    Forgets all interned format strings and restarts timestamp delta encoding, so that the next binary message is
+    preceded by a LOG_REC_SYNC record and fresh format definitions. Should be called when a host decoder (re)connects
+    part way through a session. 
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogClass::binaryResync() {
+  for (uint8_t i = 0; i < maxLogFormats; i++)
+    fmtTable[i] = NULL;
+  binarySynced = false;
+  binaryTs = 0;
+}
+
+
+/* serialMonLogClass::internFormat()
+    Finds the format ID of a format string in fmtTable, which is an open-addressed hash table keyed by the format
+    string pointer. If the format string hasn't been seen since the last resync, returns the ID of an empty slot; the
+    caller must store the pointer in fmtTable once the LOG_REC_FMT definition record has been sent. 
+  Parameters: 
+    const char *fmt: format string pointer
+    bool *isNew: referenced boolean set to true if the format string needs to be defined
+  Returns: 
+    int16_t: format ID (0 to maxLogFormats - 1), or -1 if the table is full
+*/
+int16_t serialMonLogClass::internFormat(const char *fmt, bool *isNew) {
+  uint8_t id = ((uintptr_t) fmt >> 2) & (maxLogFormats - 1);  // initial hash slot
+
+  *isNew = false;
+  for (uint8_t i = 0; i < maxLogFormats; i++, id = (id + 1) & (maxLogFormats - 1)) {
+    if (fmtTable[id] == fmt)        // already interned
+      return (id);
+    if (fmtTable[id] == NULL) {     // empty slot
+      *isNew = true;
+      return (id);
+    }
+  }
+  return (-1);                      // table full
+}
+
+
+/* serialMonLogClass::printBinary()
+    Outputs a captured log message in the binary log format, which consists of a sequence of records each starting 
+    with a logRecordEnum type code. A LOG_REC_SYNC record is sent at the start of the stream (and after binaryResync()),
+    and a LOG_REC_FMT record is sent the first time each format string is used. A message record contains:
+      format ID (1 byte)
+      timestamp delta in ms from the previous message (varint; LOG_REC_MSG only)
+      argument count (1 byte) and types (1 byte, 2 bits per argument as in logEntryStruct::argTypes)
+      arguments: LOG_ARG_INT zig-zag varint, LOG_ARG_UINT varint, LOG_ARG_FLOAT 4 bytes (little-endian IEEE float), 
+        LOG_ARG_PTR length (varint) followed by the characters of the string it points to
+    If the format table is full, the message is formatted (including its timestamp text) and sent as a LOG_REC_TEXT
+    record instead. Each record is only sent if there is room for all of it in the Serial output buffer. 
+  Parameters: 
+    const logEntryStruct *entry: pointer to the captured message
+    uint8_t *buf: buffer used to assemble the records (at least maxMsgLen bytes)
+  Returns: 
+    bool: true if the message record was sent
+*/
+bool serialMonLogClass::printBinary(const logEntryStruct *entry, uint8_t *buf) {
+  uint8_t *bP = buf;
+  uint8_t *endP = buf + maxMsgLen;
+  const logArgUnion *argP;
+  int16_t id;
+  bool isNew;
+  uint32_t val;
+  uint8_t len;
+
+  if (!binarySynced) {
+    if (!waitForRoom(5))
+      return (false);
+    streamP->write((uint8_t) LOG_REC_SYNC);
+    streamP->write((const uint8_t *) "SML1", 4);
+    binarySynced = true;
+  }
+  if (!reportDrops())
+    return (false);
+  id = internFormat(entry->fmt, &isNew);
+  if (isNew) {                                // send the format definition on its own
+    len = strnlen(entry->fmt, maxMsgLen - 3);
+    *bP++ = LOG_REC_FMT;
+    *bP++ = id;
+    smPutVarint(&bP, endP, len);                // always 1 byte, since len < 128
+    memcpy(bP, entry->fmt, len);
+    bP += len;
+    if (!waitForRoom(bP - buf))
+      return (false);
+    streamP->write(buf, bP - buf);
+    fmtTable[id] = entry->fmt;
+    bP = buf;
+  }
+  if (id < 0) {                               // no format ID available, send as text (timestamp and message)
+    val = formatTimestamp((char *) buf + 2, entry->ts);
+    formatEntry(entry, (char *) buf + 2 + val, maxMsgLen - 2 - val);
+    len = val + strlen((char *) buf + 2 + val);   // (at most maxMsgLen - 3)
+    buf[0] = LOG_REC_TEXT;
+    buf[1] = len;                             // 1-byte varint, since len < 128
+    if (!waitForRoom(len + 2))
+      return (false);
+    streamP->write(buf, len + 2);
+    return (true);
+  }
+  *bP++ = (timeStampP != NULL) ? LOG_REC_MSG : LOG_REC_MSG_NOTS;
+  *bP++ = id;
+  if (timeStampP != NULL)
+    smPutVarint(&bP, endP, entry->ts - binaryTs);
+  *bP++ = entry->numArgs;
+  *bP++ = entry->argTypes;
+  for (uint8_t i = 0; i < entry->numArgs; i++) {
+    argP = &entry->args[i];
+    switch ((entry->argTypes >> (2 * i)) & 0x03) {
+      case LOG_ARG_INT:
+        val = ((uint32_t) argP->i << 1) ^ (uint32_t) (argP->i >> 31);   // zig-zag encoding
+        smPutVarint(&bP, endP, val);
+      break;
+      case LOG_ARG_UINT:
+        smPutVarint(&bP, endP, argP->u);
+      break;
+      case LOG_ARG_FLOAT:
+        memcpy(&val, &argP->f, 4);
+        for (uint8_t j = 0; j < 4; j++, val >>= 8) {
+          if (bP < endP)
+            *bP++ = val & 0xFF;
+        }
+      break;
+      case LOG_ARG_PTR:
+        len = (argP->s == NULL) ? 0 : strnlen(argP->s, maxMsgLen / 2);
+        if ((endP - bP) < (len + 1))            // truncate strings that don't fit in the record
+          len = (endP - bP > 1) ? (endP - bP - 1) : 0;
+        smPutVarint(&bP, endP, len);              // always 1 byte, since len < 128
+        memcpy(bP, argP->s, len);
+        bP += len;
+      break;
+    }
+  }
+  if (!waitForRoom(bP - buf))
+    return (false);
+  streamP->write(buf, bP - buf);
+  if (timeStampP != NULL)
+    binaryTs = entry->ts;
+  return (true);
+}
+
+
+#ifdef SERIALMON_NO_FLOAT_PRINTF
+/* formatFloatSpec()
+    Formats a floating point value according to a printf-style conversion specification (e.g. "%-8.2f") using
+    smFormatFloat(), so that sprintf() floating point support isn't required. The '-', '+', ' ' and '0' flags, width
+    and precision are supported; %e and %g conversions are formatted the same as %f.
+  Parameters: 
+    char *dst: output buffer
+    size_t size: size of output buffer
+    const char *spec: conversion specification, starting with '%'
+    float val: value to format
+  Returns: 
+    int: length of the formatted value (which may be greater than size - 1 if truncated, like snprintf())
+*/
+static int formatFloatSpec(char *dst, size_t size, const char *spec, float val) {
+  char num[maxNumLen + 1];
+  char *numP = num + 1;         // leave room for a '+' or ' ' sign
+  bool leftAlign = false;
+  char signChar = '\0';
+  char padChar = ' ';
+  uint8_t width = 0;
+  uint8_t prec = 6;
+  uint8_t len;
+  int total;
+
+  for (spec++; strchr("-+ 0#", *spec) != NULL; spec++) {   // flags
+    if (*spec == '-')
+      leftAlign = true;
+    else if ((*spec == '+') || ((*spec == ' ') && (signChar == '\0')))
+      signChar = *spec;
+    else if (*spec == '0')
+      padChar = '0';
+  }
+  for (; isdigit(*spec); spec++)
+    width = (width * 10) + (*spec - '0');
+  if (*spec == '.') {
+    for (prec = 0, spec++; isdigit(*spec); spec++)
+      prec = (prec * 10) + (*spec - '0');
+  }
+  len = smFormatFloat(numP, val, prec);
+  if ((signChar != '\0') && (*numP != '-')) {
+    *--numP = signChar;
+    len++;
+  }
+  total = (width > len) ? width : len;
+  for (int i = 0; i < total; i++) {   // assemble into dst, with padding, truncated to fit
+    char c;
+    if (leftAlign)
+      c = (i < len) ? numP[i] : ' ';
+    else if (i < (total - len))     // leading padding
+      c = ((padChar == '0') && (i == 0) && ((*numP == '-') || (*numP == '+') || (*numP == ' '))) ? *numP : padChar;
+    else if ((padChar == '0') && (i == (total - len)) && (total > len) &&
+              ((*numP == '-') || (*numP == '+') || (*numP == ' ')))
+      c = '0';                      // sign was moved ahead of the zero padding
+    else
+      c = numP[i - (total - len)];
+    if ((size_t) i < (size - 1))
+      dst[i] = c;
+  }
+  dst[((size_t) total < size) ? total : (size - 1)] = '\0';
+  return (total);
+}
+#endif
+
+
+/* serialMonLogClass::formatEntry()
+    Formats a captured log message into a buffer. The format string is scanned once; literal text is copied and each
+    conversion specification is passed to snprintf() along with the corresponding captured argument, cast to the type
+    implied by the conversion character. Length modifiers (h, l, ll, etc.) are ignored, since all integer arguments are
+    captured as 32-bit values. The '*' width/precision is not supported. If SERIALMON_NO_FLOAT_PRINTF is defined (see
+    SerialMonNum.h), floating point conversions are formatted by formatFloatSpec() instead of snprintf(). 
+  Parameters: 
+    const logEntryStruct *entry: pointer to the captured message
+    char *buf: output buffer
+    uint8_t size: size of the output buffer (normally maxMsgLen)
+  Returns: None
+*/
+void serialMonLogClass::formatEntry(const logEntryStruct *entry, char *buf, uint8_t size) {
+  const char *fP = entry->fmt;    // pointer to current position in the format string
+  char *bP = buf;                 // pointer to the next free position in buf
+  char *endP = buf + size - 1;    // last usable position in buf (reserved for '\0')
+  char spec[16];                  // a single conversion specification, stripped of length modifiers
+  uint8_t specLen;
+  uint8_t argNum = 0;             // index of the next captured argument
+  logArgTypeEnum argType;
+  const logArgUnion *argP;
+  char conv;
+  int n;
+
+  while ((*fP != '\0') && (bP < endP)) {
+    if (*fP != '%') {             // literal character
+      *bP++ = *fP++;
+      continue;
+    }
+    if (*(fP + 1) == '%') {       // "%%"
+      *bP++ = '%';
+      fP += 2;
+      continue;
+    }
+    specLen = 0;                  // collect the conversion specification
+    spec[specLen++] = *fP++;
+    while ((*fP != '\0') && (strchr("diouxXcsfFeEgGaAp", *fP) == NULL)) {
+      if ((strchr("hlLqjzt", *fP) == NULL) && (specLen < (sizeof(spec) - 2)))
+        spec[specLen++] = *fP;    // keep flags, width and precision
+      fP++;
+    }
+    if (*fP == '\0')              // incomplete specification at end of format string
+      break;
+    conv = *fP++;
+    spec[specLen++] = conv;
+    spec[specLen] = '\0';
+    if (argNum >= entry->numArgs) { // more conversions than captured arguments
+      n = snprintf(bP, endP - bP + 1, "(?)");
+    }
+    else {
+      argP = &entry->args[argNum];
+      argType = (logArgTypeEnum) ((entry->argTypes >> (2 * argNum)) & 0x03);
+      argNum++;
+      switch (conv) {
+        case 'd':
+        case 'i':
+        case 'c':
+          n = snprintf(bP, endP - bP + 1, spec, (argType == LOG_ARG_FLOAT) ? (int) argP->f : (int) argP->i);
+        break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+          n = snprintf(bP, endP - bP + 1, spec, (argType == LOG_ARG_FLOAT) ? (unsigned) argP->f : (unsigned) argP->u);
+        break;
+        case 's':
+        case 'p':
+          if (argType == LOG_ARG_PTR)
+            n = snprintf(bP, endP - bP + 1, spec, argP->s);
+          else
+            n = snprintf(bP, endP - bP + 1, "(?)");
+        break;
+        default:                  // floating point conversions
+#ifdef SERIALMON_NO_FLOAT_PRINTF
+          if (argType == LOG_ARG_FLOAT)
+            n = formatFloatSpec(bP, endP - bP + 1, spec, argP->f);
+          else if (argType == LOG_ARG_INT)
+            n = formatFloatSpec(bP, endP - bP + 1, spec, (float) argP->i);
+          else
+            n = formatFloatSpec(bP, endP - bP + 1, spec, (float) argP->u);
+#else
+          if (argType == LOG_ARG_FLOAT)
+            n = snprintf(bP, endP - bP + 1, spec, (double) argP->f);
+          else if (argType == LOG_ARG_INT)
+            n = snprintf(bP, endP - bP + 1, spec, (double) argP->i);
+          else
+            n = snprintf(bP, endP - bP + 1, spec, (double) argP->u);
+#endif
+        break;
+      }
+    }
+    if (n < 0)
+      break;
+    bP = ((bP + n) > endP) ? endP : (bP + n);   // snprintf returns the untruncated length
+  }
+  *bP = '\0';
+}
+
+
+/* serialMonLogClass::dumpHistory()
+    Formats and prints the most recent entries in the history ring (see logMsg()), oldest first, each with its
+    original timestamp. Intended for use by a command menu (see SerialMonLogMenu.h), so the output is printed to a
+    specified stream and may block (unlike normal log output) until the stream has room for it. 
+  Parameters: 
+    Stream *outP: stream to print to
+    uint8_t count: max number of entries to print (the most recent matching entries are printed)
+    uint8_t maxLevel: only entries with a criticality level no greater than maxLevel are printed
+    bool hiddenOnly: if true, only entries that were hidden because logging was disabled are printed
+  Returns: 
+    uint8_t: number of entries printed
+*/
+uint8_t serialMonLogClass::dumpHistory(Stream *outP, uint8_t count, uint8_t maxLevel, bool hiddenOnly) {
+  uint8_t first = (histCount == 0) ? 0 : ((histHead + histLen - histCount) % histLen);  // index of the oldest entry
+  scratchBufClass line(logLineLen);
+  const logEntryStruct *entry;
+  uint8_t matches = 0;
+  uint8_t skip;
+  uint8_t n = 0;
+
+  if (line.len == 0)
+    return (0);
+  for (uint8_t i = 0; i < histCount; i++) {
+    entry = &hist[(first + i) % histLen];
+    if ((entry->level <= maxLevel) && (!hiddenOnly || entry->hidden))
+      matches++;
+  }
+  skip = (matches > count) ? (matches - count) : 0;   // skip the older matching entries
+  for (uint8_t i = 0; i < histCount; i++) {
+    entry = &hist[(first + i) % histLen];
+    if ((entry->level > maxLevel) || (hiddenOnly && !entry->hidden))
+      continue;
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    formatEntry(entry, line.p + formatTimestamp(line.p, entry->ts), maxMsgLen);
+    outP->println(line.p);
+    n++;
+  }
+  return (n);
+}
+
+
+/* serialMonLogClass::replayHidden()
+    Prints all of the history entries that were hidden because logging was disabled (e.g. while a command menu was
+    active), and then marks them as no longer hidden, so that each is only replayed once. 
+  Parameters: 
+    Stream *outP: stream to print to
+  Returns: 
+    uint8_t: number of entries printed
+*/
+uint8_t serialMonLogClass::replayHidden(Stream *outP) {
+  uint8_t n = dumpHistory(outP, histLen, 255, true);
+
+  for (uint8_t i = 0; i < histLen; i++)
+    hist[i].hidden = false;
+  return (n);
+}
+
+
+/* serialMonLogClass::historyCount()
+    Returns the number of entries in the history ring
+  Parameters: 
+    bool hiddenOnly: if true, only entries that were hidden because logging was disabled are counted
+  Returns: 
+    uint8_t: number of entries
+*/
+uint8_t serialMonLogClass::historyCount(bool hiddenOnly) {
+  uint8_t first = (histCount == 0) ? 0 : ((histHead + histLen - histCount) % histLen);
+  uint8_t n = 0;
+
+  if (!hiddenOnly)
+    return (histCount);
+  for (uint8_t i = 0; i < histCount; i++) {
+    if (hist[(first + i) % histLen].hidden)
+      n++;
+  }
+  return (n);
+}
+
+
+/* serialMonLogClass::setHistory()
+    Sets the array used as the history ring (see logMsg()), and the text pool for copies of the string arguments of
+    its entries, and clears the history. Each logger has its own history ring, sized by the program for what that
+    logger needs (28 bytes per entry on 32-bit targets), or none at all (the default), in which case nothing is
+    recorded even if history is set. Since history entries are formatted long after they were logged, their string
+    arguments are copied: when the text pool is full, the oldest entries are discarded to make room. Without a text
+    pool (or if the strings don't fit in it), string arguments are recorded as "(?)". The inline template versions
+    take the number of entries (and characters) from the arrays, e.g.
+      logEntryStruct logHist[32];
+      char logHistText[512];
+      smLog.setHistory(logHist, logHistText);
+  Parameters: 
+    logEntryStruct *entries: array of entries (NULL for no history ring)
+    uint8_t len: number of entries
+    char *text: text pool for string arguments (NULL for none)
+    uint16_t textLen: number of characters in text
+  Returns: None
+*/
+void serialMonLogClass::setHistory(logEntryStruct *entries, uint8_t len, char *text, uint16_t textLen) {
+  hist = entries;
+  histLen = (entries != NULL) ? len : 0;
+  histHead = histCount = 0;
+  histPool.setBuffer(text, textLen);
+}
+
+
+/* serialMonLogClass::keepHistory()
+    Called by logMsgLimit() for a message recorded in the history ring (at histHead, not yet counted in histCount):
+    copies its string arguments to the history text pool, discarding the oldest entries if necessary to make room.
+    If the strings can't be copied, they are replaced by "(?)".
+  Parameters: 
+    logEntryStruct *entry: captured message
+    uint8_t strMask: arguments that are strings (see logStrArgs)
+  Returns: None
+*/
+void serialMonLogClass::keepHistory(logEntryStruct *entry, uint8_t strMask) {
+  while ((histPool.bufSize() == 0) || !histPool.keep(entry, strMask)) {
+    if ((histPool.bufSize() == 0) || (histCount == 0)) {
+      for (uint8_t i = 0; i < entry->numArgs; i++) {
+        if ((strMask & (1 << i)) && (entry->args[i].s != NULL))
+          entry->args[i].s = "(?)";
+      }
+      return;
+    }
+    histPool.release(&hist[(histHead + histLen - histCount) % histLen]);   // discard the oldest entry
+    histCount--;
+  }
+}
+
+
+/* serialMonLogClass::clearHistory()
+    Discards all entries in the history ring
   Parameters: None
   Returns: None
 */
-void serialMonLogClass::printLog() {
-  float ts;   // temp timestamp value
+void serialMonLogClass::clearHistory() {
+  histHead = histCount = 0;
+  histPool.clear();
+}
 
-  if (timeStampP != NULL) {           // if a timestamp timer variable has been defined
-    ts = (float) *timeStampP / 1000;  // convert elapedMillis timer value into seconds
-    sprintf(tsBuf, "[%5.3f] ", ts);   // assemble the timestamp string
-    Serial.print(tsBuf);              // print the timestamp
+
+/* serialMonLogClass::setTagName()
+    Names a message tag (see LOGMSG_TAG), so that its level can be set by name from the log menu
+  Parameters: 
+    uint8_t tag: message tag (0 - maxLogTags-1)
+    const char *name: tag name (must remain valid, e.g. a string literal)
+  Returns: None
+*/
+void serialMonLogClass::setTagName(uint8_t tag, const char *name) {
+  if (tag < maxLogTags)
+    tagName[tag] = name;
+}
+
+
+/* serialMonLogClass::findTag()
+    Looks up a message tag by name (see setTagName()) or number
+  Parameters: 
+    const char *name: tag name, or tag number (0 - maxLogTags-1)
+  Returns: 
+    int16_t: tag, or -1 if not found
+*/
+int16_t serialMonLogClass::findTag(const char *name) {
+  const char *p;
+  int16_t tag = 0;
+
+  for (uint8_t i = 0; i < maxLogTags; i++) {
+    if ((tagName[i] != NULL) && (strcmp(tagName[i], name) == 0))
+      return (i);
+  }
+  for (p = name; isdigit(*p) && (tag < maxLogTags); p++)
+    tag = (tag * 10) + (*p - '0');
+  return (((p != name) && (*p == '\0') && (tag < maxLogTags)) ? tag : -1);
+}
+
+
+/* serialMonLogClass::setTagLevels()
+    Sets the logging level of all message tags
+  Parameters: 
+    uint8_t level: logging level
+  Returns: None
+*/
+void serialMonLogClass::setTagLevels(uint8_t level) {
+  for (uint8_t i = 0; i < maxLogTags; i++)
+    tagLevel[i] = level;
+}
+
+
+/* serialMonLogClass::addSink()
+    Adds a sink (see SerialMonSink.h) to the logger. Each message with a criticality level no greater than the sink's
+    level is formatted and written to the sink when it is logged (or, for a LOGISR message, when drainIsr() takes it
+    from the queue), whether or not it is printed. The line is formatted once for all of the sinks, and is also the
+    line printed if the message is printed immediately; otherwise (in deferred or binary mode, while earlier messages
+    are queued, and for LOGISR messages), the message is formatted again when it is printed (see outputMsg()), e.g.
+      logSinkStruct fileSink = LOG_SINK_INIT("file", logSinkFile, &logFile, 3);
+      smLog.addSink(&fileSink);
+    A sink must only be added to one logger.
+  Parameters: 
+    logSinkStruct *sink: sink (must remain valid, e.g. a global variable)
+  Returns: None
+*/
+void serialMonLogClass::addSink(logSinkStruct *sink) {
+  logSinkStruct **sinkP = &sinks;
+
+  while ((*sinkP != NULL) && (*sinkP != sink))  // add at the end of the list (unless already added)
+    sinkP = &(*sinkP)->next;
+  if (*sinkP == NULL) {
+    sink->next = NULL;
+    *sinkP = sink;
+  }
+  updateSinkLevel();
+}
+
+
+/* serialMonLogClass::removeSink()
+    Removes a sink that was added by addSink()
+  Parameters: 
+    logSinkStruct *sink: sink
+  Returns: None
+*/
+void serialMonLogClass::removeSink(logSinkStruct *sink) {
+  for (logSinkStruct **sinkP = &sinks; *sinkP != NULL; sinkP = &(*sinkP)->next) {
+    if (*sinkP == sink) {
+      *sinkP = sink->next;
+      break;
+    }
+  }
+  updateSinkLevel();
+}
+
+
+/* serialMonLogClass::setSinkLevel()
+    Sets the criticality level of a sink (the max level of the messages written to it). The level of a sink that has
+    been added to the logger must be changed with this function, so that the logger's sinkLevel is kept up to date.
+  Parameters: 
+    logSinkStruct *sink: sink
+    uint8_t level: level
+  Returns: None
+*/
+void serialMonLogClass::setSinkLevel(logSinkStruct *sink, uint8_t level) {
+  sink->level = level;
+  updateSinkLevel();
+}
+
+
+/* serialMonLogClass::updateSinkLevel()
+    Sets sinkLevel to the highest level of the sinks, so that the LOGMSG macros can check with a single comparison
+    whether a message is wanted by any sink
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogClass::updateSinkLevel() {
+  sinkLevel = -1;
+  for (logSinkStruct *sink = sinks; sink != NULL; sink = sink->next) {
+    if (sink->level > sinkLevel)
+      sinkLevel = sink->level;
+  }
+}
+
+
+/* serialMonLogClass::findSink()
+    Looks up a sink by name
+  Parameters: 
+    const char *name: sink name
+  Returns: 
+    logSinkStruct *: sink, or NULL if not found
+*/
+logSinkStruct *serialMonLogClass::findSink(const char *name) {
+  for (logSinkStruct *sink = sinks; sink != NULL; sink = sink->next) {
+    if (strcmp(sink->name, name) == 0)
+      return (sink);
+  }
+  return (NULL);
+}
+
+
+/* serialMonLogClass::writeSinks()
+    Writes a formatted log message line to each of the sinks whose level is no lower than the message level. <CR><NL>
+    is appended to the line (in place) for the sinks, and then removed again, so that the line can then be printed.
+    If the message couldn't be formatted (because the scratch arena had no room for a line buffer), it is counted as
+    dropped by each of these sinks.
+  Parameters: 
+    uint8_t level: message criticality level
+    char *line: null-terminated line in a buffer of logLineLen characters, or NULL if the message wasn't formatted
+  Returns: None
+*/
+void serialMonLogClass::writeSinks(uint8_t level, char *line) {
+  uint8_t len = (line != NULL) ? strlen(line) : 0;
+
+  if (line != NULL) {
+    line[len++] = '\r';
+    line[len++] = '\n';
   }
-  Serial.println(msgBuf);             // print the log message
+  for (logSinkStruct *sink = sinks; sink != NULL; sink = sink->next) {
+    if (level > sink->level)
+      continue;
+    if ((line != NULL) && sink->func(sink, line, len))
+      sink->lines++;
+    else
+      sink->drops++;
+  }
+  if (line != NULL)
+    line[len - 2] = '\0';
 }
 
 
 /* serialMonLogClass::setTimeStamp()
-    Stores a pointer to an elapsedMillis timer, to be used as a timestamp by printLog()
+    Stores a pointer to an elapsedMillis timer, to be used for log message timestamps
   Parameters: 
     elapsedMillis *timeStampP: pointer to timestamp timer
   Returns: None
@@ -42,3 +1096,16 @@ void serialMonLogClass::printLog() {
 void serialMonLogClass::setTimeStamp(elapsedMillis *timeStampP) {
   this->timeStampP = timeStampP;
 }
+
+
+/* serialMonLogClass::setStream()
+    Specifies the stream used for log output, which is Serial by default. Each serialMonLogClass object has its own
+    stream, so that (for example) one logger can print to USB serial and another to a hardware serial port, each with
+    its own logLevel (see LOGMSG_TO). 
+  Parameters: 
+    Stream *streamP: pointer to the stream
+  Returns: None
+*/
+void serialMonLogClass::setStream(Stream *streamP) {
+  this->streamP = streamP;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+/* SerialMonLogMenu
+    SerialMonLogMenu.h and SerialMonLogMenu.cpp implement a built-in command table menu for a serialMonLogClass
+    object (passed as the table's context pointer), for dumping, filtering and replaying its history ring and for
+    changing its logging levels (global, per message tag and per sink). Output is printed to the stream of the command
+    object that dispatched the command. 
+*/
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonLog.h"
+#include "SerialMonLogMenu.h"
+
+
+/* Command handler functions for the log menu (see SerialMonLogMenu.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters.
+  Parameters: 
+    cmdArgsStruct *args: parsed parameters; args->context points to the serialMonLogClass object
+  Returns: None
+*/
+void logMenuClear(cmdArgsStruct *args) {
+  ((serialMonLogClass *) args->context)->clearHistory();
+  args->cmd->getStream()->println("History cleared");
+}
+
+void logMenuDump(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (serialMonLogClass *) args->context;
+  int32_t count = (args->count > 0) ? args->param[0].i : logP->historySize();
+  int32_t level = (args->count > 1) ? args->param[1].i : 255;
+
+  if ((count < 0) || (level < 0)) {
+    args->cmd->getStream()->println("Count and level must not be negative");
+    args->cmd->fail();
+    return;
+  }
+  logP->dumpHistory(args->cmd->getStream(), (count > logP->historySize()) ? logP->historySize() : count,
+                    (level > 255) ? 255 : level, false);
+}
+
+void logMenuHistory(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (serialMonLogClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+  char buf[80];
+
+  if (args->count > 0) {
+    logP->history = (args->param[0].i >= 0);
+    if (logP->history)
+      logP->histLevel = (args->param[0].i > 255) ? 255 : args->param[0].i;
+  }
+  snprintf(buf, sizeof(buf), "History %s, level %u: %u of %u entries (%u hidden), %u bytes/entry",
+            logP->history ? "on" : "off", logP->histLevel, logP->historyCount(false), logP->historySize(),
+            logP->historyCount(true), (unsigned int) sizeof(logEntryStruct));
+  outP->println(buf);
+}
+
+void logMenuLevel(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (serialMonLogClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+
+  if (args->count > 0) {
+    if ((args->param[0].i < 0) || (args->param[0].i > 255)) {
+      outP->println("Level must be 0 - 255");
+      args->cmd->fail();
+      return;
+    }
+    logP->logLevel = args->param[0].i;
+  }
+  outP->print("Log level ");
+  outP->println(logP->logLevel);
+}
+
+void logMenuReplay(cmdArgsStruct *args) {
+  if (((serialMonLogClass *) args->context)->replayHidden(args->cmd->getStream()) == 0)
+    args->cmd->getStream()->println("No hidden messages");
+}
+
+void logMenuSinks(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (serialMonLogClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+  logSinkStruct *sink = NULL;
+  char buf[60];
+
+  if ((args->count > 0) && ((sink = logP->findSink(args->param[0].s)) == NULL)) {
+    outP->print("Unknown sink: ");
+    outP->println(args->param[0].s);
+    args->cmd->fail();
+    return;
+  }
+  if (args->count > 1) {
+    if ((args->param[1].i < 0) || (args->param[1].i > 255)) {
+      outP->println("Level must be 0 - 255");
+      args->cmd->fail();
+      return;
+    }
+    logP->setSinkLevel(sink, args->param[1].i);
+  }
+  if (logP->firstSink() == NULL)
+    outP->println("No sinks");
+  for (sink = logP->firstSink(); sink != NULL; sink = sink->next) {
+    snprintf(buf, sizeof(buf), "%-8s %3u %8lu lines %6lu dropped", sink->name, sink->level, (unsigned long) sink->lines,
+              (unsigned long) sink->drops);
+    outP->println(buf);
+  }
+}
+
+void logMenuTags(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (serialMonLogClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+  bool all = (args->count > 0) && (strcmp(args->param[0].s, "*") == 0);
+  int16_t tag = -1;
+  char buf[40];
+
+  if ((args->count > 0) && !all && ((tag = logP->findTag(args->param[0].s)) < 0)) {
+    outP->print("Unknown tag: ");
+    outP->println(args->param[0].s);
+    args->cmd->fail();
+    return;
+  }
+  for (uint8_t i = 1; i < args->count; i++) {
+    if ((args->param[i].i < 0) || (args->param[i].i > 255)) {
+      outP->println("Level must be 0 - 255");
+      args->cmd->fail();
+      return;
+    }
+  }
+  if ((all && (args->count > 1)) || (args->count > 2)) {   // all levels, or all others (if given)
+    logP->logLevel = args->param[all ? 1 : 2].i;
+    logP->setTagLevels(logP->logLevel);
+  }
+  if ((tag >= 0) && (args->count > 1))
+    logP->tagLevel[tag] = args->param[1].i;
+  snprintf(buf, sizeof(buf), "untagged   %u", logP->logLevel);
+  outP->println(buf);
+  for (uint8_t i = 0; i < maxLogTags; i++) {
+    if ((logP->tagName[i] == NULL) && (i != tag))    // unnamed tags are only listed if given
+      continue;
+    snprintf(buf, sizeof(buf), "%2u %-7s %u", i, (logP->tagName[i] != NULL) ? logP->tagName[i] : "", logP->tagLevel[i]);
+    outP->println(buf);
+  }
+}
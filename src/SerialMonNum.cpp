@@ -0,0 +1,545 @@
+/* SerialMonNum
+    SerialMonNum.h and SerialMonNum.cpp implement integer and fixed-point number formatting and parsing functions
+    that are used by the other SerialMonUtils classes in place of the (much larger and slower) floating point
+    capabilities of sprintf() and atof()/strtof().
+    The formatting functions write a null-terminated string into a caller-provided buffer of at least maxNumLen
+    characters, and return the number of characters written (not including the '\0').
+    The parsing functions convert a complete null-terminated string (such as a command line token), and return false
+    if the string isn't a valid number or the value is out of range.
+    Fixed-point values are represented either as integers scaled by a power of ten (e.g. "milli-units", for which
+    1.234 is represented as 1234 with decimals = 3), or in Q16.16 format (16 integer bits, 16 fraction bits).
+    smPutVarint() encodes an integer for the binary output formats (see serialMonLogClass::printBinary()).
+*/
+#include <Arduino.h>
+#include <float.h>
+#include <math.h>
+#include "SerialMonNum.h"
+
+static const uint32_t pow10Table[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+static const double pow10Pos[] = {1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256};  // 10^(2^i)
+static const double pow10Low[] = {0, 0, 0, 0, 0, -5366162204393472.0,   // 10^(2^i) - pow10Pos[i]
+                                  -2.1320419009454396e+47, -7.51744869165182e+111, -3.012765990014054e+239};
+
+
+/* mulDD(), divDD()
+    Multiply or divide a double-double value (the unevaluated sum hi + lo, with about 32 significant digits) by
+    another, for scalePow10()
+  Parameters:
+    double *hi, double *lo: referenced value, set to the result
+    double bh, double bl: multiplier or divisor
+*/
+static void mulDD(double *hi, double *lo, double bh, double bl) {
+  double p = *hi * bh;
+  double e = fma(*hi, bh, -p) + ((*hi * bl) + (*lo * bh));   // fma() gives the exact rounding error of p
+
+  *hi = p + e;
+  *lo = e - (*hi - p);
+}
+
+static void divDD(double *hi, double *lo, double bh, double bl) {
+  double q = *hi / bh;
+  double p = q * bh;
+  double r = (((*hi - p) - fma(q, bh, -p)) + *lo) - (q * bl);   // remainder (hi + lo) - q * (bh + bl)
+  double e = r / bh;
+
+  *hi = q + e;
+  *lo = e - (*hi - q);
+}
+
+
+/* scalePow10()
+    Multiplies a double-double value by a power of ten, for the float formatting and parsing functions. The power is
+    assembled from pow10Pos[] and pow10Low[], and applied with a single multiplication or division, unless it would
+    overflow, in which case it is applied in parts. The result is accurate to about 30 digits (short of overflow or
+    underflow), so rounding it to a double is nearly always exact.
+  Parameters:
+    double *hi, double *lo: referenced value (hi + lo), set to the result
+    int16_t exp10: decimal exponent (-511 to 511)
+*/
+static void scalePow10(double *hi, double *lo, int16_t exp10) {
+  bool neg = (exp10 < 0);
+  uint16_t e = neg ? -exp10 : exp10;
+  double ph = 1;
+  double pl = 0;
+
+  for (uint8_t i = 0; e != 0; i++, e >>= 1) {
+    if ((e & 1) == 0)
+      continue;
+    if (ph > (DBL_MAX / pow10Pos[i])) {   // p would overflow: apply it first
+      if (neg)
+        divDD(hi, lo, ph, pl);
+      else
+        mulDD(hi, lo, ph, pl);
+      ph = 1;
+      pl = 0;
+    }
+    mulDD(&ph, &pl, pow10Pos[i], pow10Low[i]);
+  }
+  if (neg)
+    divDD(hi, lo, ph, pl);
+  else
+    mulDD(hi, lo, ph, pl);
+}
+
+
+/* smFormatUint()
+    Formats an unsigned integer as decimal digits
+  Parameters:
+    char *buf: output buffer
+    uint32_t val: value to format
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatUint(char *buf, uint32_t val) {
+  char tmp[10];     // digits in reverse order
+  uint8_t n = 0;
+  uint8_t len = 0;
+
+  do {
+    tmp[n++] = '0' + (val % 10);
+    val /= 10;
+  } while (val != 0);
+  while (n > 0)
+    buf[len++] = tmp[--n];
+  buf[len] = '\0';
+  return (len);
+}
+
+
+/* smFormatInt()
+    Formats a signed integer as decimal digits, with a leading '-' if negative
+  Parameters:
+    char *buf: output buffer
+    int32_t val: value to format
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatInt(char *buf, int32_t val) {
+  if (val < 0) {
+    *buf = '-';
+    return (1 + smFormatUint(buf + 1, 0 - (uint32_t) val));
+  }
+  return (smFormatUint(buf, val));
+}
+
+
+/* smFormatFixed()
+    Formats a fixed-point value that is scaled by a power of ten, e.g. smFormatFixed(buf, -1234, 3) produces "-1.234"
+  Parameters:
+    char *buf: output buffer
+    int32_t val: scaled value to format
+    uint8_t decimals: number of decimal places represented by val (0 - 9)
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatFixed(char *buf, int32_t val, uint8_t decimals) {
+  uint32_t mag = (val < 0) ? (0 - (uint32_t) val) : val;
+  uint32_t frac;
+  uint8_t len = 0;
+
+  if (decimals > 9)
+    decimals = 9;
+  if (val < 0)
+    buf[len++] = '-';
+  len += smFormatUint(buf + len, mag / pow10Table[decimals]);
+  if (decimals > 0) {
+    buf[len++] = '.';
+    frac = mag % pow10Table[decimals];
+    for (uint8_t i = decimals; i > 0; i--) {    // fraction digits, including leading zeros
+      buf[len++] = '0' + ((frac / pow10Table[i - 1]) % 10);
+    }
+    buf[len] = '\0';
+  }
+  return (len);
+}
+
+
+/* smFormatFloat()
+    Formats a floating point value with a fixed number of decimal places, rounded to nearest (equivalent to the
+    sprintf() "%.<decimals>f" format for values whose magnitude is less than 1e12). Larger values are formatted
+    as "ovf".
+  Parameters:
+    char *buf: output buffer
+    float val: value to format
+    uint8_t decimals: number of decimal places (0 - 6)
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatFloat(char *buf, float val, uint8_t decimals) {
+  double mag = (val < 0) ? -(double) val : (double) val;
+  uint64_t scaled;
+  uint64_t intPart;
+  uint32_t frac;
+  uint8_t len = 0;
+
+  if (val != val) {               // NaN
+    strcpy(buf, "nan");
+    return (3);
+  }
+  if (decimals > 6)
+    decimals = 6;
+  if (mag >= 1e12) {              // also catches +/- infinity
+    strcpy(buf, "ovf");
+    return (3);
+  }
+  scaled = (uint64_t) ((mag * pow10Table[decimals]) + 0.5);
+  intPart = scaled / pow10Table[decimals];
+  frac = scaled % pow10Table[decimals];
+  if ((val < 0) && (scaled != 0))
+    buf[len++] = '-';
+  if (intPart >= 1000000000) {    // more than 9 integer digits: format the high part first
+    len += smFormatUint(buf + len, intPart / 1000000000);
+    for (uint8_t i = 9; i > 0; i--)   // low part, including leading zeros
+      buf[len++] = '0' + ((intPart / pow10Table[i - 1]) % 10);
+  }
+  else
+    len += smFormatUint(buf + len, intPart);
+  if (decimals > 0) {
+    buf[len++] = '.';
+    for (uint8_t i = decimals; i > 0; i--)
+      buf[len++] = '0' + ((frac / pow10Table[i - 1]) % 10);
+  }
+  buf[len] = '\0';
+  return (len);
+}
+
+
+/* formatDigits()
+    Formats a mantissa of a number of significant digits and its decimal exponent for smFormatSig()
+  Parameters:
+    char *buf: output buffer
+    uint64_t mant: mantissa (exactly digits long)
+    int16_t exp10: decimal exponent of the first significant digit
+    uint8_t digits: number of significant digits (1 - 17)
+  Returns:
+    uint8_t: number of characters written
+*/
+static uint8_t formatDigits(char *buf, uint64_t mant, int16_t exp10, uint8_t digits) {
+  char dig[17];                   // significant digits
+  uint8_t nd;                     // number of significant digits, without trailing zeros
+  uint8_t len = 0;
+
+  for (uint8_t i = digits; i > 0; i--, mant /= 10)
+    dig[i - 1] = '0' + (mant % 10);
+  for (nd = digits; (nd > 1) && (dig[nd - 1] == '0'); nd--)
+    ;
+  if ((exp10 < -5) || (exp10 >= digits)) {  // exponent notation
+    buf[len++] = dig[0];
+    if (nd > 1)
+      buf[len++] = '.';
+    for (uint8_t i = 1; i < nd; i++)
+      buf[len++] = dig[i];
+    buf[len++] = 'e';
+    if (exp10 < 0)
+      buf[len++] = '-';
+    len += smFormatUint(buf + len, (exp10 < 0) ? -exp10 : exp10);
+    return (len);
+  }
+  if (exp10 < 0) {                // "0.", then zeros up to the first significant digit
+    buf[len++] = '0';
+    buf[len++] = '.';
+    for (int16_t i = -1; i > exp10; i--)
+      buf[len++] = '0';
+  }
+  for (uint8_t i = 0; (i < nd) || ((int16_t) i <= exp10); i++) {
+    if ((exp10 >= 0) && (i == (exp10 + 1)))
+      buf[len++] = '.';
+    buf[len++] = (i < nd) ? dig[i] : '0';
+  }
+  buf[len] = '\0';
+  return (len);
+}
+
+
+/* smFormatSig()
+    Formats a floating point value with a number of significant digits, like the sprintf() "%.<digits>g" format:
+    trailing zeros are removed, and exponent notation (e.g. "1.5e-7", "3e12") is used for values whose decimal
+    exponent is less than -5 or at least digits. With 9 digits for a float, or 17 for a double, the result converts
+    back to the same value (see smParseFloat() and smParseDouble()): with 17 digits, the last digit is stepped until
+    it does, as neither conversion is exactly rounded for every double.
+  Parameters:
+    char *buf: output buffer
+    double val: value to format
+    uint8_t digits: number of significant digits (1 - 17)
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatSig(char *buf, double val, uint8_t digits) {
+  double mag = (val < 0) ? -val : val;
+  double hi, lo;                  // mag scaled to a mantissa of the given number of digits
+  double back;                    // value parsed back from the digits
+  uint64_t low = 1;               // smallest mantissa with the given number of digits
+  uint64_t mant;
+  int16_t exp10;                  // decimal exponent of the first significant digit
+  int e2;
+  uint8_t sign = 0;
+  uint8_t len;
+
+  if (val != val) {               // NaN
+    strcpy(buf, "nan");
+    return (3);
+  }
+  digits = (digits < 1) ? 1 : ((digits > 17) ? 17 : digits);
+  if (val < 0)
+    buf[sign++] = '-';
+  if (mag > DBL_MAX) {
+    strcpy(buf + sign, "inf");
+    return (sign + 3);
+  }
+  if (mag == 0) {
+    strcpy(buf + sign, "0");
+    return (sign + 1);
+  }
+  for (uint8_t i = 1; i < digits; i++)
+    low *= 10;
+  frexp(mag, &e2);
+  exp10 = (int16_t) floor((e2 - 1) * 0.30102999566398120);   // estimate (log10(2) * binary exponent), may be 1 low
+  for (;;) {
+    hi = mag;
+    lo = 0;
+    scalePow10(&hi, &lo, digits - 1 - exp10);
+    mant = (uint64_t) floor(hi);
+    mant += (int64_t) floor((hi - floor(hi)) + lo + 0.5);   // round, including the low part
+    if (mant >= (low * 10))       // estimate was low, or the value rounded up to the next power of 10
+      exp10++;
+    else if (mant < low)
+      exp10--;
+    else
+      break;
+  }
+  len = sign + formatDigits(buf + sign, mant, exp10, digits);
+  for (uint8_t i = 0; (digits == 17) && (i < 32); i++) {
+    smParseDouble(buf + sign, &back);
+    if (back == mag)
+      break;
+    mant += (back < mag) ? 1 : -1;
+    if ((mant < low) || (mant >= (low * 10)))   // don't step across a power of 10
+      break;
+    len = sign + formatDigits(buf + sign, mant, exp10, digits);
+  }
+  return (len);
+}
+
+
+/* smFormatTimestamp()
+    Formats a log message timestamp in seconds, in the form "[s.mmm] ", from an integer number of ms
+  Parameters:
+    char *buf: output buffer
+    uint32_t ms: timestamp in ms
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smFormatTimestamp(char *buf, uint32_t ms) {
+  uint8_t len = 0;
+
+  buf[len++] = '[';
+  len += smFormatUint(buf + len, ms / 1000);
+  buf[len++] = '.';
+  ms %= 1000;
+  buf[len++] = '0' + (ms / 100);
+  buf[len++] = '0' + ((ms / 10) % 10);
+  buf[len++] = '0' + (ms % 10);
+  buf[len++] = ']';
+  buf[len++] = ' ';
+  buf[len] = '\0';
+  return (len);
+}
+
+
+/* parseDecimal()
+    Parses a decimal number (optional sign, digits, optional decimal point and fraction digits) into an integer
+    mantissa and the number of fraction digits. Digits beyond the 19th significant digit are ignored, and counted as
+    an adjustment to the decimal exponent.
+  Parameters:
+    const char **sP: pointer to the string pointer, which is advanced past the number
+    uint64_t *mant: referenced mantissa (all digits, without the decimal point)
+    int16_t *exp10: referenced decimal exponent (negative number of fraction digits, plus any ignored digits)
+    bool *neg: referenced boolean set to true if there was a '-' sign
+  Returns:
+    bool: false if no digits were found
+*/
+static bool parseDecimal(const char **sP, uint64_t *mant, int16_t *exp10, bool *neg) {
+  const char *s = *sP;
+  uint8_t digits = 0;
+  uint8_t sigDigits = 0;
+  bool frac = false;
+
+  *mant = 0;
+  *exp10 = 0;
+  *neg = false;
+  if ((*s == '-') || (*s == '+'))
+    *neg = (*s++ == '-');
+  for (;; s++) {
+    if ((*s == '.') && !frac) {
+      frac = true;
+      continue;
+    }
+    if (!isdigit(*s))
+      break;
+    digits++;
+    if ((sigDigits < 19) && ((*mant != 0) || (*s != '0'))) {
+      *mant = (*mant * 10) + (*s - '0');
+      sigDigits++;
+      if (frac)
+        (*exp10)--;
+    }
+    else if (sigDigits < 19) {    // leading zero
+      if (frac)
+        (*exp10)--;
+    }
+    else if (!frac)               // ignored integer digit
+      (*exp10)++;
+  }
+  *sP = s;
+  return (digits > 0);
+}
+
+
+/* smParseFloat(), smParseDouble()
+    Convert a decimal number, with an optional exponent (e.g. "-1.5e-3"), to a float or double without using
+    atof()/strtof(). The conversion is made with about 30 digits of precision (see scalePow10()), so the result is
+    the nearest double to the number, except very rarely in the last bit (or for values below DBL_MIN).
+  Parameters:
+    const char *s: null-terminated string
+    float *val, double *val: referenced value set to the converted number
+  Returns:
+    bool: false if the string isn't a valid number
+*/
+bool smParseFloat(const char *s, float *val) {
+  double d;
+
+  if (!smParseDouble(s, &d))
+    return (false);
+  *val = (float) d;
+  return (true);
+}
+
+bool smParseDouble(const char *s, double *val) {
+  uint64_t mant;
+  int16_t exp10;
+  int16_t e;
+  bool neg;
+  bool expNeg = false;
+  double hi, lo;
+  double result;
+  int e2;
+
+  if (!parseDecimal(&s, &mant, &exp10, &neg))
+    return (false);
+  if ((*s == 'e') || (*s == 'E')) {   // exponent
+    s++;
+    if ((*s == '-') || (*s == '+'))
+      expNeg = (*s++ == '-');
+    if (!isdigit(*s))
+      return (false);
+    for (e = 0; isdigit(*s); s++) {
+      if (e < 1000)
+        e = (e * 10) + (*s - '0');
+    }
+    exp10 += expNeg ? -e : e;
+  }
+  if (*s != '\0')
+    return (false);
+  if ((exp10 < -400) || (exp10 > 400))  // far outside the range of a double
+    result = ((exp10 < 0) || (mant == 0)) ? 0 : INFINITY;
+  else {
+    e2 = (exp10 < -280) ? 128 : 0;  // scale very small values up by 2^e2, so that the low part doesn't underflow
+    hi = (double) mant;
+    lo = ldexp((double) (int64_t) (mant - (uint64_t) hi), e2);   // the part of the mantissa (over 53 bits) lost in hi
+    hi = ldexp(hi, e2);
+    scalePow10(&hi, &lo, exp10);
+    result = ldexp(hi + lo, -e2);
+  }
+  *val = neg ? -result : result;
+  return (true);
+}
+
+
+/* smParseFixed()
+    Converts a decimal number (no exponent) to a fixed-point value scaled by a power of ten, rounding any extra
+    fraction digits, e.g. smParseFixed("1.2345", 3, &val) sets val to 1235 (milli-units)
+  Parameters:
+    const char *s: null-terminated string
+    uint8_t decimals: number of decimal places in the result (0 - 9)
+    int32_t *val: referenced value set to the converted number
+  Returns:
+    bool: false if the string isn't a valid number, or the result is out of range
+*/
+bool smParseFixed(const char *s, uint8_t decimals, int32_t *val) {
+  uint64_t mant;
+  int16_t exp10;
+  bool neg;
+
+  if ((decimals > 9) || !parseDecimal(&s, &mant, &exp10, &neg) || (*s != '\0'))
+    return (false);
+  exp10 += decimals;                  // scale the mantissa to the requested number of decimals
+  for (; exp10 < -1; exp10++)
+    mant /= 10;
+  if (exp10 == -1)                    // round on the last extra digit
+    mant = (mant + 5) / 10;
+  for (; exp10 > 0; exp10--) {
+    if (mant > 0x80000000ULL)
+      return (false);
+    mant *= 10;
+  }
+  if (mant > (neg ? 0x80000000ULL : 0x7FFFFFFFULL))
+    return (false);
+  *val = neg ? (int32_t) (0 - mant) : (int32_t) mant;
+  return (true);
+}
+
+
+/* smParseQ16()
+    Converts a decimal number (no exponent) to a Q16.16 fixed-point value, rounded to the nearest 1/65536, e.g.
+    smParseQ16("1.5", &val) sets val to 0x00018000. The range is -32768 to +32767.99998.
+  Parameters:
+    const char *s: null-terminated string
+    int32_t *val: referenced value set to the converted number
+  Returns:
+    bool: false if the string isn't a valid number, or the result is out of range
+*/
+bool smParseQ16(const char *s, int32_t *val) {
+  uint64_t mant;
+  int16_t exp10;
+  bool neg;
+  uint64_t q;
+
+  if (!parseDecimal(&s, &mant, &exp10, &neg) || (*s != '\0'))
+    return (false);
+  for (; exp10 < -9; exp10++)         // keep at most 9 fraction digits
+    mant /= 10;
+  for (; exp10 > 0; exp10--) {
+    if (mant > 0x8000)
+      return (false);
+    mant *= 10;
+  }
+  if ((mant >> 48) != 0)              // integer part is far out of range
+    return (false);
+  q = (((mant << 16) + (pow10Table[-exp10] / 2)) / pow10Table[-exp10]);
+  if (q > (neg ? 0x80000000ULL : 0x7FFFFFFFULL))
+    return (false);
+  *val = neg ? (int32_t) (0 - q) : (int32_t) q;
+  return (true);
+}
+
+
+/* smPutVarint()
+    Appends an unsigned LEB128 varint (7 bits per byte, least significant first, high bit set on all but the last
+    byte) to a byte buffer, if there is room. 
+  Parameters: 
+    uint8_t **bPP: pointer to the buffer pointer, which is advanced past the varint
+    uint8_t *endP: pointer just past the end of the buffer
+    uint32_t val: value to encode
+  Returns: 
+    bool: true if the varint fit in the buffer
+*/
+bool smPutVarint(uint8_t **bPP, uint8_t *endP, uint32_t val) {
+  do {
+    if (*bPP >= endP)
+      return (false);
+    **bPP = (val & 0x7F) | ((val > 0x7F) ? 0x80 : 0);
+    (*bPP)++;
+    val >>= 7;
+  } while (val != 0);
+  return (true);
+}
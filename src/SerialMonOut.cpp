@@ -0,0 +1,93 @@
+/* SerialMonOut
+    SerialMonOut.h and SerialMonOut.cpp implement the serialMonOutClass, an output staging stream that coalesces
+    many small prints into writes of whole USB packets (see SerialMonOut.h). poll() must be called regularly (e.g.
+    once per main loop iteration), so that a partial packet is sent within flushMicros.
+*/
+#include <Arduino.h>
+#include "SerialMonOut.h"
+
+
+/* serialMonOutClass::send()
+    Writes bytes from the start of the staging buffer to the underlying stream, in a single write() call, and moves
+    any remaining bytes to the start of the buffer
+  Parameters:
+    uint16_t n: number of bytes to write
+  Returns: None
+*/
+void serialMonOutClass::send(uint16_t n) {
+  streamP->write(buf, n);
+  writeCount++;
+  len -= n;
+  memmove(buf, buf + n, len);
+}
+
+
+/* serialMonOutClass::write()
+    Adds bytes to the staging buffer. Whenever the buffer holds at least one complete packet, all of the complete
+    packets are written to the underlying stream if it has room for them. If the buffer is full, it is written even
+    if the underlying stream doesn't have room (so the underlying stream may block, as it would without staging).
+  Parameters:
+    const uint8_t *data: bytes to write
+    size_t size: number of bytes
+  Returns:
+    size_t: number of bytes written (always size)
+*/
+size_t serialMonOutClass::write(const uint8_t *data, size_t size) {
+  size_t n = size;
+  uint16_t chunk;
+  uint16_t aligned;
+
+  while (size > 0) {
+    if (len == 0)
+      firstMicros = micros();
+    chunk = ((size_t) (outBufLen - len) < size) ? (outBufLen - len) : size;
+    memcpy(buf + len, data, chunk);
+    len += chunk;
+    data += chunk;
+    size -= chunk;
+    if (len >= outPacketSize) {
+      aligned = len - (len % outPacketSize);
+      if ((len == outBufLen) || (streamP->availableForWrite() >= aligned))
+        send(aligned);
+    }
+  }
+  return (n);
+}
+
+
+/* serialMonOutClass::availableForWrite()
+    Returns the number of bytes that can be written without blocking: the free space in the staging buffer, or more
+    if the underlying stream has room for the staged bytes as well
+  Parameters: None
+  Returns:
+    int: number of bytes
+*/
+int serialMonOutClass::availableForWrite() {
+  int under = streamP->availableForWrite() - len;
+  int free = outBufLen - len;
+
+  return ((under > free) ? under : free);
+}
+
+
+/* serialMonOutClass::flush()
+    Writes all staged bytes to the underlying stream immediately
+  Parameters: None
+  Returns: None
+*/
+void serialMonOutClass::flush() {
+  if (len > 0)
+    send(len);
+}
+
+
+/* serialMonOutClass::poll()
+    Writes a partial packet to the underlying stream if it has been staged for at least flushMicros, and there is room
+    for it. Should be called regularly, e.g. once per main loop iteration.
+  Parameters: None
+  Returns: None
+*/
+void serialMonOutClass::poll() {
+  if ((len > 0) && ((uint32_t) (micros() - firstMicros) >= flushMicros) && (streamP->availableForWrite() >= len))
+    send(len);
+}
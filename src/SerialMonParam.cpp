@@ -0,0 +1,234 @@
+/* SerialMonParam
+    SerialMonParam.h and SerialMonParam.cpp implement a registry of named configuration parameters, so that a program
+    can make its settings readable and writable from the serial monitor without writing a menu command for each one.
+    The program defines a constexpr table of parameters (see PARAM), sorted by name, which is looked up with a binary
+    search. The built-in parameter menu provides get, set and list commands, and a dump command whose output can be
+    pasted back into the menu to restore the configuration.
+*/
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+#include "SerialMonParam.h"
+
+
+/* formatReal()
+    Formats a float or double value with the fewest significant digits (at least 6 for a float, or 15 for a double)
+    that convert back to the same value, so that a dumped configuration is restored exactly
+  Parameters:
+    char *buf: output buffer (at least maxNumLen characters)
+    double val: value to format
+    bool isFloat: true if the value is a float
+  Returns:
+    uint8_t: number of characters written
+*/
+static uint8_t formatReal(char *buf, double val, bool isFloat) {
+  uint8_t maxDigits = isFloat ? 9 : 17;   // enough for any value to convert back exactly
+  uint8_t len;
+  float f;
+  double d;
+
+  for (uint8_t digits = isFloat ? 6 : 15; ; digits++) {
+    len = smFormatSig(buf, val, digits);
+    if (digits == maxDigits)
+      return (len);
+    if (isFloat ? (smParseFloat(buf, &f) && (f == (float) val)) : (smParseDouble(buf, &d) && (d == val)))
+      return (len);
+  }
+}
+
+
+/* smParamFind()
+    Finds a parameter by name, using a binary search of the (sorted) parameter table
+  Parameters:
+    const paramTableStruct *table: pointer to the parameter table
+    const char *name: parameter name
+  Returns:
+    const paramEntryStruct *: pointer to the parameter's entry, or NULL if not found
+*/
+const paramEntryStruct *smParamFind(const paramTableStruct *table, const char *name) {
+  uint16_t lo = 0;
+  uint16_t hi = table->count;
+  uint16_t mid;
+  int cmp;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    cmp = strcmp(name, table->entries[mid].name);
+    if (cmp == 0)
+      return (&table->entries[mid]);
+    if (cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return (NULL);
+}
+
+
+/* smParamFormat()
+    Formats the current value of a parameter. Float and double values are formatted with as many significant digits
+    as they need to be set back to exactly the same value by smParamSet() (see formatReal()), in exponent notation if
+    they are very large or small (e.g. "1.5e-7"), and bool values as 0 or 1.
+  Parameters:
+    char *buf: output buffer (at least maxNumLen characters)
+    const paramEntryStruct *param: pointer to the parameter's entry
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t smParamFormat(char *buf, const paramEntryStruct *param) {
+  switch (param->type) {
+    case WATCH_INT8:
+      return (smFormatInt(buf, *(volatile int8_t *) param->ptr));
+    case WATCH_UINT8:
+      return (smFormatUint(buf, *(volatile uint8_t *) param->ptr));
+    case WATCH_INT16:
+      return (smFormatInt(buf, *(volatile int16_t *) param->ptr));
+    case WATCH_UINT16:
+      return (smFormatUint(buf, *(volatile uint16_t *) param->ptr));
+    case WATCH_INT32:
+      return (smFormatInt(buf, *(volatile int32_t *) param->ptr));
+    case WATCH_UINT32:
+      return (smFormatUint(buf, *(volatile uint32_t *) param->ptr));
+    case WATCH_BOOL:
+      return (smFormatUint(buf, *(volatile bool *) param->ptr ? 1 : 0));
+    case WATCH_FLOAT:
+      return (formatReal(buf, *(volatile float *) param->ptr, true));
+    default:                              // WATCH_DOUBLE
+      return (formatReal(buf, *(volatile double *) param->ptr, false));
+  }
+}
+
+
+/* smParamSet()
+    Sets a parameter from its text representation. Integer values may be decimal, or hexadecimal with a "0x" prefix,
+    and float values may have an exponent. A double value is converted with the full precision of a double. The value
+    must be within the parameter's range (min to max, which are floats, so a float or double value is compared with
+    them after conversion to a float).
+  Parameters:
+    const paramEntryStruct *param: pointer to the parameter's entry
+    const char *text: null-terminated value string
+  Returns:
+    bool: false if the string isn't a valid value for the parameter's type, or is out of range (in which case the
+      parameter isn't changed)
+*/
+bool smParamSet(const paramEntryStruct *param, const char *text) {
+  char *endP;
+  long long i;
+  double d;
+
+  if ((param->type == WATCH_FLOAT) || (param->type == WATCH_DOUBLE)) {
+    if (!smParseDouble(text, &d) || ((float) d < param->min) || ((float) d > param->max))
+      return (false);
+    if (param->type == WATCH_FLOAT)
+      *(volatile float *) param->ptr = (float) d;
+    else
+      *(volatile double *) param->ptr = d;
+    return (true);
+  }
+  i = strtoll(text, &endP, 0);
+  if ((*text == '\0') || (*endP != '\0') || ((float) i < param->min) || ((float) i > param->max))
+    return (false);
+  switch (param->type) {
+    case WATCH_INT8:
+      if ((i < INT8_MIN) || (i > INT8_MAX))
+        return (false);
+      *(volatile int8_t *) param->ptr = i;
+    break;
+    case WATCH_UINT8:
+      if ((i < 0) || (i > UINT8_MAX))
+        return (false);
+      *(volatile uint8_t *) param->ptr = i;
+    break;
+    case WATCH_INT16:
+      if ((i < INT16_MIN) || (i > INT16_MAX))
+        return (false);
+      *(volatile int16_t *) param->ptr = i;
+    break;
+    case WATCH_UINT16:
+      if ((i < 0) || (i > UINT16_MAX))
+        return (false);
+      *(volatile uint16_t *) param->ptr = i;
+    break;
+    case WATCH_INT32:
+      if ((i < INT32_MIN) || (i > INT32_MAX))
+        return (false);
+      *(volatile int32_t *) param->ptr = i;
+    break;
+    case WATCH_UINT32:
+      if ((i < 0) || (i > UINT32_MAX))
+        return (false);
+      *(volatile uint32_t *) param->ptr = i;
+    break;
+    case WATCH_BOOL:
+      if ((i < 0) || (i > 1))
+        return (false);
+      *(volatile bool *) param->ptr = (i != 0);
+    break;
+  }
+  return (true);
+}
+
+
+/* Command handler functions for the parameter menu (see SerialMonParam.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters, and prints to the stream of the dispatching command object.
+  Parameters:
+    cmdArgsStruct *args: parsed parameters; args->context points to the paramTableStruct
+  Returns: None
+*/
+void paramMenuDump(cmdArgsStruct *args) {
+  const paramTableStruct *table = (const paramTableStruct *) args->context;
+  Stream *outP = args->cmd->getStream();
+  char valBuf[maxNumLen];
+
+  for (uint16_t i = 0; i < table->count; i++) {
+    smParamFormat(valBuf, &table->entries[i]);
+    outP->print("set ");
+    outP->print(table->entries[i].name);
+    outP->print(' ');
+    outP->println(valBuf);
+  }
+}
+
+void paramMenuGet(cmdArgsStruct *args) {
+  const paramEntryStruct *param = smParamFind((const paramTableStruct *) args->context, args->param[0].s);
+  char valBuf[maxNumLen];
+
+  if (param == NULL) {
+    args->cmd->getStream()->println("No such parameter");
+    args->cmd->fail();
+    return;
+  }
+  smParamFormat(valBuf, param);
+  args->cmd->getStream()->println(valBuf);
+}
+
+void paramMenuList(cmdArgsStruct *args) {
+  const paramTableStruct *table = (const paramTableStruct *) args->context;
+  const paramEntryStruct *param;
+  Stream *outP = args->cmd->getStream();
+  char valBuf[maxNumLen], minBuf[maxNumLen], maxBuf[maxNumLen];
+  char buf[120];
+
+  for (uint16_t i = 0; i < table->count; i++) {
+    param = &table->entries[i];
+    if ((args->count > 0) && (strncmp(param->name, args->param[0].s, strlen(args->param[0].s)) != 0))
+      continue;
+    smParamFormat(valBuf, param);
+    formatReal(minBuf, param->min, true);
+    formatReal(maxBuf, param->max, true);
+    snprintf(buf, sizeof(buf), "%-20s %12s %-6s [%s, %s]", param->name, valBuf, param->units, minBuf, maxBuf);
+    outP->println(buf);
+  }
+}
+
+void paramMenuSet(cmdArgsStruct *args) {
+  const paramEntryStruct *param = smParamFind((const paramTableStruct *) args->context, args->param[0].s);
+
+  if (param == NULL)
+    args->cmd->getStream()->println("No such parameter");
+  else if (!smParamSet(param, args->param[1].s))
+    args->cmd->getStream()->println("Invalid or out of range value");
+  else
+    return;
+  args->cmd->fail();
+}
@@ -0,0 +1,179 @@
+/* SerialMonProbe
+    SerialMonProbe.h and SerialMonProbe.cpp implement lightweight profiling probes: scoped timers, sample values and
+    event counters (see the SMPROBE_xxx macros), each of which records its count, min/mean/max and a log2 histogram.
+    Timer probes use the Cortex-M7 DWT cycle counter on Teensy 4.x, so even very short scopes can be measured. 
+    All probes that have recorded something are kept in a linked list, which is used by the built-in probe menu
+    (probeMenu) to list, show and reset them. 
+*/
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+#include "SerialMonProbe.h"
+
+static probeStruct *probeList = NULL;     // first probe in the list of all probes
+
+
+/* smProbeRecord()
+    Records a sample value (or, for a timer probe, a duration in ticks) in a probe. Adds the probe to the list of all
+    probes the first time it is called for that probe. 
+  Parameters: 
+    probeStruct *probe: probe
+    uint32_t value: sample value (ignored by counter probes)
+  Returns: None
+*/
+void smProbeRecord(probeStruct *probe, uint32_t value) {
+  if (!probe->listed) {
+    probe->next = probeList;
+    probeList = probe;
+    probe->listed = true;
+  }
+  if (probe->type == PROBE_COUNTER) {
+    probe->count++;
+    return;
+  }
+  if ((probe->count == 0) || (value < probe->min))
+    probe->min = value;
+  if ((probe->count == 0) || (value > probe->max))
+    probe->max = value;
+  probe->count++;
+  probe->total += value;
+  probe->hist[(value == 0) ? 0 : (32 - __builtin_clz(value))]++;    // bin = number of significant bits
+}
+
+
+/* smProbeFirst()
+    Returns the first probe in the list of all probes (follow probeStruct::next for the rest)
+  Parameters: None
+  Returns: 
+    probeStruct *: first probe, or NULL if no probe has recorded anything yet
+*/
+probeStruct *smProbeFirst() {
+  return (probeList);
+}
+
+
+/* smProbeFind()
+    Finds a probe by name
+  Parameters: 
+    const char *name: probe name
+  Returns: 
+    probeStruct *: probe, or NULL if not found
+*/
+probeStruct *smProbeFind(const char *name) {
+  probeStruct *probe;
+
+  for (probe = probeList; probe != NULL; probe = probe->next) {
+    if (strcmp(probe->name, name) == 0)
+      return (probe);
+  }
+  return (NULL);
+}
+
+
+/* smProbeReset()
+    Clears the statistics of a probe (the probe remains in the list of all probes)
+  Parameters: 
+    probeStruct *probe: probe
+  Returns: None
+*/
+void smProbeReset(probeStruct *probe) {
+  probe->count = probe->min = probe->max = 0;
+  probe->total = 0;
+  for (uint8_t i = 0; i < probeHistBins; i++)
+    probe->hist[i] = 0;
+}
+
+
+/* formatProbeValue()
+    Formats a probe value: for a timer probe, a number of ticks is converted to us with 3 decimal places
+  Parameters: 
+    char *buf: output buffer (at least maxNumLen characters)
+    const probeStruct *probe: probe
+    uint64_t value: value to format
+  Returns: None
+*/
+static void formatProbeValue(char *buf, const probeStruct *probe, uint64_t value) {
+  if (probe->type == PROBE_TIMER) {
+    value = (value * 1000) / smProbeTicksPerUs();     // ticks to ns
+    smFormatFixed(buf, (value > 0x7FFFFFFF) ? 0x7FFFFFFF : (int32_t) value, 3);
+  }
+  else
+    smFormatUint(buf, (value > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) value);
+}
+
+
+/* Command handler functions for the probe menu (see SerialMonProbe.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters, and prints to the stream of the dispatching command object.
+  Parameters: 
+    cmdArgsStruct *args: parsed parameters
+  Returns: None
+*/
+void probeMenuList(cmdArgsStruct *args) {
+  Stream *outP = args->cmd->getStream();
+  probeStruct *probe;
+  char minBuf[maxNumLen], meanBuf[maxNumLen], maxBuf[maxNumLen];
+  char buf[140];
+
+  if (probeList == NULL)
+    outP->println("No probes");
+  for (probe = probeList; probe != NULL; probe = probe->next) {
+    if ((probe->type == PROBE_COUNTER) || (probe->count == 0))
+      snprintf(buf, sizeof(buf), "%-16s n=%lu", probe->name, (unsigned long) probe->count);
+    else {
+      formatProbeValue(minBuf, probe, probe->min);
+      formatProbeValue(meanBuf, probe, probe->total / probe->count);
+      formatProbeValue(maxBuf, probe, probe->max);
+      snprintf(buf, sizeof(buf), "%-16s n=%lu min=%s mean=%s max=%s%s", probe->name, (unsigned long) probe->count,
+                minBuf, meanBuf, maxBuf, (probe->type == PROBE_TIMER) ? " us" : "");
+    }
+    outP->println(buf);
+  }
+}
+
+void probeMenuHist(cmdArgsStruct *args) {
+  Stream *outP = args->cmd->getStream();
+  probeStruct *probe = smProbeFind(args->param[0].s);
+  uint32_t most = 0;
+  char lowBuf[maxNumLen];
+  char buf[100];
+  uint8_t len;
+
+  if ((probe == NULL) || (probe->type == PROBE_COUNTER)) {
+    outP->println("No such timer or value probe");
+    args->cmd->fail();
+    return;
+  }
+  for (uint8_t i = 0; i < probeHistBins; i++) {
+    if (probe->hist[i] > most)
+      most = probe->hist[i];
+  }
+  for (uint8_t i = 0; i < probeHistBins; i++) {
+    if (probe->hist[i] == 0)
+      continue;
+    formatProbeValue(lowBuf, probe, (i == 0) ? 0 : (1ULL << (i - 1)));   // lower bound of the bin
+    len = snprintf(buf, sizeof(buf), ">= %10s: %8lu ", lowBuf, (unsigned long) probe->hist[i]);
+    for (uint32_t n = ((uint64_t) probe->hist[i] * 40 + most - 1) / most; (n > 0) && (len < (sizeof(buf) - 1)); n--)
+      buf[len++] = '#';
+    buf[len] = '\0';
+    outP->println(buf);
+  }
+}
+
+void probeMenuReset(cmdArgsStruct *args) {
+  probeStruct *probe;
+
+  if (args->count > 0) {
+    probe = smProbeFind(args->param[0].s);
+    if (probe == NULL) {
+      args->cmd->getStream()->println("No such probe");
+      args->cmd->fail();
+      return;
+    }
+    smProbeReset(probe);
+  }
+  else {
+    for (probe = probeList; probe != NULL; probe = probe->next)
+      smProbeReset(probe);
+  }
+  args->cmd->getStream()->println("Reset");
+}
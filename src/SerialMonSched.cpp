@@ -0,0 +1,244 @@
+/* SerialMonSched
+    SerialMonSched.h and SerialMonSched.cpp implement the serialMonSchedClass, a cooperative scheduler that replaces
+    the usual hand-rolled elapsedMillis polling in the main loop. Tasks are kept in a timer wheel of schedWheelSlots
+    1-ms slots, each a doubly-linked list of the tasks that are due in that slot (modulo schedWheelSlots ms), so
+    starting or cancelling a task is O(1), and run() only looks at the slots for the ms that have elapsed. Each task
+    keeps statistics of how late it was started, how long it ran, and how many of its periods were missed, which can
+    be viewed with the built-in scheduler menu.
+*/
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonLog.h"
+#include "SerialMonSched.h"
+
+
+/* serialMonSchedClass::link()
+    Inserts a task at the head of the wheel slot for its due time. A task that is already due goes in the slot for
+    the next ms to be processed, so that it is run by the next call to run().
+  Parameters:
+    schedTaskStruct *task: pointer to the task
+  Returns: None
+*/
+void serialMonSchedClass::link(schedTaskStruct *task) {
+  uint32_t tick = ((int32_t) (task->due - curTick) < 0) ? curTick : task->due;
+  schedTaskStruct **slotP = &wheel[tick & (schedWheelSlots - 1)];
+
+  task->next = *slotP;
+  if (task->next != NULL)
+    task->next->prevP = &task->next;
+  task->prevP = slotP;
+  *slotP = task;
+  task->state = TASK_WAITING;
+}
+
+
+/* serialMonSchedClass::unlink()
+    Removes a task from the list it is in (a wheel slot, or the list of tasks that run() is about to execute)
+  Parameters:
+    schedTaskStruct *task: pointer to the task
+  Returns: None
+*/
+void serialMonSchedClass::unlink(schedTaskStruct *task) {
+  *task->prevP = task->next;
+  if (task->next != NULL)
+    task->next->prevP = task->prevP;
+  task->next = NULL;
+  task->prevP = NULL;
+}
+
+
+/* serialMonSchedClass::start()
+    Starts (or restarts) a task. May be called from a task function, including for the task itself.
+  Parameters:
+    schedTaskStruct *task: pointer to the task
+    uint32_t delayMs: time (ms) until the first execution
+    uint32_t periodMs: period (ms) of the following executions, or 0 for a one-shot task
+  Returns: None
+*/
+void serialMonSchedClass::start(schedTaskStruct *task, uint32_t delayMs, uint32_t periodMs) {
+  if (task->state == TASK_WAITING)
+    unlink(task);
+  if (!task->listed) {
+    task->nextTask = taskList;
+    taskList = task;
+    task->listed = true;
+  }
+  task->periodMs = periodMs;
+  task->due = millis() + delayMs;
+  link(task);
+}
+
+
+/* serialMonSchedClass::cancel()
+    Stops a task. May be called from a task function, including for the task itself. The task's statistics are kept.
+  Parameters:
+    schedTaskStruct *task: pointer to the task
+  Returns: None
+*/
+void serialMonSchedClass::cancel(schedTaskStruct *task) {
+  if (task->state == TASK_WAITING)
+    unlink(task);
+  task->state = TASK_IDLE;
+}
+
+
+/* serialMonSchedClass::execute()
+    Executes a task, updates its statistics, and reschedules it if it is periodic (and wasn't restarted or cancelled
+    by its function). A periodic task keeps a fixed rate: if it runs so late that its next due time has already
+    passed, the missed periods are skipped (and counted as overruns) rather than run in a burst.
+  Parameters:
+    schedTaskStruct *task: pointer to the task
+    uint32_t now: current time (ms)
+    uint32_t startUs: time (micros()) at which the task is started (the end time of the previous task, so that only
+      one call to micros() is needed per task)
+  Returns:
+    uint32_t: time (micros()) at which the task finished
+*/
+uint32_t serialMonSchedClass::execute(schedTaskStruct *task, uint32_t now, uint32_t startUs) {
+  uint32_t late = now - task->due;
+  uint32_t endUs;
+  uint32_t runUs;
+  uint32_t missed;
+
+  task->state = TASK_RUNNING;
+  task->func(task);
+  endUs = micros();
+  runUs = endUs - startUs;
+  dispatchCount++;
+  task->runs++;
+  task->lateTotal += late;
+  if (late > task->lateMax)
+    task->lateMax = late;
+  task->runTotalUs += runUs;
+  if (runUs > task->runMaxUs)
+    task->runMaxUs = runUs;
+  if (task->state != TASK_RUNNING)        // restarted or cancelled by its function
+    return (endUs);
+  if (task->periodMs == 0) {
+    task->state = TASK_IDLE;
+    return (endUs);
+  }
+  task->due += task->periodMs;
+  if ((int32_t) (task->due - now) < 0) {
+    missed = (now - task->due) / task->periodMs + 1;
+    task->overruns += missed;
+    task->due += missed * task->periodMs;
+  }
+  link(task);
+  return (endUs);
+}
+
+
+/* serialMonSchedClass::run()
+    Executes all tasks that are due. Should be called as often as possible from the main loop (see also the inline
+    run() with no parameters, which uses millis()). The wheel slots for each ms since the previous call are visited
+    once (all slots at most, if more than schedWheelSlots ms have elapsed), and the tasks that are due are moved to a
+    list of ready tasks before any of them is executed, so that task functions can safely start or cancel any task.
+  Parameters:
+    uint32_t now: current time (ms)
+  Returns: None
+*/
+void serialMonSchedClass::run(uint32_t now) {
+  schedTaskStruct *ready = NULL;
+  schedTaskStruct **tailP = &ready;
+  schedTaskStruct *task;
+  schedTaskStruct *next;
+  uint32_t steps;
+  uint32_t us;
+
+  if ((int32_t) (now - curTick) < 0)      // this ms has already been processed
+    return;
+  steps = now - curTick + 1;
+  ticks += steps;
+  if (steps > schedWheelSlots)
+    steps = schedWheelSlots;
+  for (uint32_t tick = curTick; steps > 0; tick++, steps--) {
+    for (task = wheel[tick & (schedWheelSlots - 1)]; task != NULL; task = next) {
+      next = task->next;
+      if ((int32_t) (task->due - now) <= 0) {   // due (tasks due a multiple of schedWheelSlots ms later stay)
+        unlink(task);
+        task->prevP = tailP;
+        *tailP = task;
+        tailP = &task->next;
+      }
+    }
+  }
+  curTick = now + 1;
+  if (ready == NULL)
+    return;
+  us = micros();
+  while ((task = ready) != NULL) {
+    unlink(task);
+    us = execute(task, now, us);
+  }
+}
+
+
+/* serialMonSchedClass::resetStats()
+    Resets the statistics of all tasks
+  Parameters: None
+  Returns: None
+*/
+void serialMonSchedClass::resetStats() {
+  for (schedTaskStruct *task = taskList; task != NULL; task = task->nextTask)
+    task->runs = task->lateMax = task->lateTotal = task->overruns = task->runMaxUs = task->runTotalUs = 0;
+  ticks = dispatchCount = 0;
+}
+
+
+/* schedTaskCmd(), schedTaskLogDrain(), schedTaskLogFile()
+    Task functions for the SerialMonUtils objects, e.g.
+      schedTaskStruct cmdTask = SCHED_TASK_INIT("cmd", schedTaskCmd, &smCmd);
+      smSched.every(&cmdTask, 10);
+  Parameters:
+    schedTaskStruct *task: pointer to the task; task->context points to the serialMonCmdClass, serialMonLogClass or
+      serialMonLogFileClass
+  Returns: None
+*/
+void schedTaskCmd(schedTaskStruct *task) {
+  ((serialMonCmdClass *) task->context)->processCommands(true);
+}
+
+void schedTaskLogDrain(schedTaskStruct *task) {
+  ((serialMonLogClass *) task->context)->drain(logRingLen);
+}
+
+void schedTaskLogFile(schedTaskStruct *task) {
+  ((serialMonLogFileClass *) task->context)->poll();
+}
+
+
+/* Command handler functions for the scheduler menu (see SerialMonSched.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters, and prints to the stream of the dispatching command object.
+  Parameters:
+    cmdArgsStruct *args: parsed parameters; args->context points to the serialMonSchedClass object
+  Returns: None
+*/
+void schedMenuList(cmdArgsStruct *args) {
+  static const char *const stateNames[] = {"idle", "waiting", "running"};   // by taskStateEnum
+  serialMonSchedClass *sched = (serialMonSchedClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+  char periodBuf[16];
+  char buf[140];
+
+  for (schedTaskStruct *task = sched->firstTask(); task != NULL; task = task->nextTask) {
+    if (task->periodMs == 0)
+      strcpy(periodBuf, "once");
+    else
+      snprintf(periodBuf, sizeof(periodBuf), "%lu ms", (unsigned long) task->periodMs);
+    snprintf(buf, sizeof(buf), "%-12s %-10s %-7s runs=%lu late=%lu/%lu ms over=%lu run=%lu/%lu us", task->name,
+              periodBuf, stateNames[task->state], (unsigned long) task->runs,
+              (unsigned long) ((task->runs > 0) ? task->lateTotal / task->runs : 0), (unsigned long) task->lateMax,
+              (unsigned long) task->overruns, (unsigned long) ((task->runs > 0) ? task->runTotalUs / task->runs : 0),
+              (unsigned long) task->runMaxUs);
+    outP->println(buf);
+  }
+  snprintf(buf, sizeof(buf), "%lu ms, %lu task executions", (unsigned long) sched->ticks,
+            (unsigned long) sched->dispatchCount);
+  outP->println(buf);
+}
+
+void schedMenuReset(cmdArgsStruct *args) {
+  ((serialMonSchedClass *) args->context)->resetStats();
+  args->cmd->getStream()->println("Reset");
+}
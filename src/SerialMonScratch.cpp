@@ -0,0 +1,51 @@
+/* SerialMonScratch
+    SerialMonScratch.h and SerialMonScratch.cpp implement the scratch arena that the SerialMonUtils objects (and
+    command handlers) borrow their temporary output buffers from, so that none of them needs buffers of its own for
+    output that is assembled and written within a single call (see SerialMonScratch.h). The arena is a stack: take()
+    allocates from the end of the bytes in use, and give() releases a buffer together with any taken after it.
+*/
+#include <Arduino.h>
+#include "SerialMonScratch.h"
+
+serialMonScratchClass smScratch;
+
+
+/* serialMonScratchClass::take()
+    Borrows a buffer from the arena. Normally called by the scratchBufClass constructor, which gives the buffer back
+    when it is destroyed.
+  Parameters:
+    uint16_t len: size of the buffer wanted
+    uint16_t minLen: smallest size that will do (e.g. a prompt can be written in several pieces); len if the full
+      size is needed
+    uint16_t *got: referenced variable set to the size of the buffer taken (0 if the request failed)
+  Returns:
+    char *: the buffer, or none (an empty string) if the request failed
+*/
+char *serialMonScratchClass::take(uint16_t len, uint16_t minLen, uint16_t *got) {
+  char *p = buf + used;
+
+  *got = 0;
+  if (len == 0)
+    return (none);
+  if ((scratchLen - used) < minLen) {
+    failCount++;
+    return (none);
+  }
+  *got = ((scratchLen - used) < len) ? (scratchLen - used) : len;
+  used += *got;
+  if (used > peak)
+    peak = used;
+  return (p);
+}
+
+
+/* serialMonScratchClass::give()
+    Gives back a buffer taken from the arena, and any buffers that were taken after it
+  Parameters:
+    char *p: buffer returned by take() (nothing is done if the request failed)
+  Returns: None
+*/
+void serialMonScratchClass::give(char *p) {
+  if ((p >= buf) && (p < (buf + used)))
+    used = p - buf;
+}
@@ -0,0 +1,219 @@
+/* SerialMonSink
+    SerialMonSink.h and SerialMonSink.cpp implement the log sinks that a serialMonLogClass object can copy its text
+    lines to, in addition to its own stream (see serialMonLogClass::addSink()): the ready-made sink functions, an
+    in-memory ring of recent lines (serialMonLogRingClass), and a block-buffered log file writer
+    (serialMonLogFileClass). Each line is formatted once by the logger, and passed to every sink whose level admits
+    it. Sink functions are called from the main loop, and must not block: a sink that has no room for a line discards
+    it (and the logger counts it in the sink's drops).
+*/
+#include <Arduino.h>
+#include "SerialMonSink.h"
+
+
+/* logSinkStream(), logSinkRing(), logSinkFile()
+    Ready-made sink functions (see LOG_SINK_INIT), which write a line to the sink's context: a Stream (e.g. a second
+    serial port, to mirror the log), a serialMonLogRingClass, or a serialMonLogFileClass. A line is only written to a
+    stream if there is room for all of it in the stream's output buffer.
+  Parameters:
+    logSinkStruct *sink: the sink
+    const char *line: text of the line, including its timestamp and the terminating <CR><NL>
+    uint8_t len: number of characters in the line
+  Returns:
+    bool: true if the line was written
+*/
+bool logSinkStream(logSinkStruct *sink, const char *line, uint8_t len) {
+  Stream *streamP = (Stream *) sink->context;
+
+  if (streamP->availableForWrite() < len)
+    return (false);
+  streamP->write((const uint8_t *) line, len);
+  return (true);
+}
+
+bool logSinkRing(logSinkStruct *sink, const char *line, uint8_t len) {
+  return (((serialMonLogRingClass *) sink->context)->write(line, len));
+}
+
+bool logSinkFile(logSinkStruct *sink, const char *line, uint8_t len) {
+  return (((serialMonLogFileClass *) sink->context)->write(line, len));
+}
+
+
+/* serialMonLogRingClass::setBuffer()
+    Sets the character array used as the ring, and clears it. The inline template version takes the size from the
+    array, e.g.
+      char logText[2048];
+      logRing.setBuffer(logText);
+  Parameters:
+    char *buf: array of characters (NULL for none, in which case nothing is kept)
+    uint16_t size: number of characters
+  Returns: None
+*/
+void serialMonLogRingClass::setBuffer(char *buf, uint16_t size) {
+  this->buf = buf;
+  this->size = (buf != NULL) ? size : 0;
+  head = used = 0;
+}
+
+
+/* serialMonLogRingClass::write()
+    Adds a line to the ring, overwriting the oldest characters if the ring is full
+  Parameters:
+    const char *line: text of the line
+    uint8_t len: number of characters in the line
+  Returns:
+    bool: true if the line was added (false if it is longer than the ring, or no array has been set)
+*/
+bool serialMonLogRingClass::write(const char *line, uint8_t len) {
+  uint16_t n;
+
+  if ((size == 0) || (len > size))
+    return (false);
+  n = ((size - head) < len) ? (size - head) : len;    // characters that fit before the end of the array
+  memcpy(buf + head, line, n);
+  memcpy(buf, line + n, len - n);
+  head = (head + len) % size;
+  used = ((size - used) < len) ? size : (used + len);
+  return (true);
+}
+
+
+/* serialMonLogRingClass::dump()
+    Prints the lines in the ring, oldest first. If the oldest line has been partly overwritten, the rest of it is
+    skipped.
+  Parameters:
+    Stream *outP: stream to print to
+  Returns:
+    uint16_t: number of characters printed
+*/
+uint16_t serialMonLogRingClass::dump(Stream *outP) {
+  uint16_t start;
+  uint16_t len = used;
+  uint16_t n;
+
+  if (used == 0)                      // (including a ring with no array, whose size is 0)
+    return (0);
+  start = (head + size - used) % size;
+  if (used == size) {                 // skip to the start of the first complete line
+    while ((len > 0) && (buf[start] != '\n')) {
+      start = (start + 1) % size;
+      len--;
+    }
+    if (len > 0) {
+      start = (start + 1) % size;
+      len--;
+    }
+  }
+  n = ((size - start) < len) ? (size - start) : len;
+  outP->write((const uint8_t *) buf + start, n);
+  outP->write((const uint8_t *) buf, len - n);
+  return (len);
+}
+
+
+/* serialMonLogFileClass::begin()
+    Sets the file that the blocks are written to, and discards anything not yet written to the previous file
+  Parameters:
+    Print *fileP: file (e.g. a File opened for writing, which is a Stream)
+  Returns: None
+*/
+void serialMonLogFileClass::begin(Print *fileP) {
+  this->fileP = fileP;
+  cur = 0;
+  fill = sent = waitingSent = 0;
+  waiting = false;
+}
+
+
+/* serialMonLogFileClass::write()
+    Copies a line into the block being filled. When that block becomes full, lines are copied into the other block,
+    unless it is still waiting to be written (see poll()). The line is copied in full or not at all.
+  Parameters:
+    const char *line: text of the line
+    uint8_t len: number of characters in the line
+  Returns:
+    bool: true if the line was copied (false if there was no room for it)
+*/
+bool serialMonLogFileClass::write(const char *line, uint8_t len) {
+  uint16_t room = (fileBlockLen - fill) + (waiting ? 0 : fileBlockLen);
+  uint16_t n;
+
+  if ((fileP == NULL) || (len > room))
+    return (false);
+  while (len > 0) {
+    if (fill == sent)                 // first unwritten byte of the block
+      firstMs = millis();
+    n = ((fileBlockLen - fill) < len) ? (fileBlockLen - fill) : len;
+    memcpy(buf + (cur * fileBlockLen) + fill, line, n);
+    fill += n;
+    line += n;
+    len -= n;
+    if ((fill == fileBlockLen) && !waiting) {   // block is full: continue in the other one
+      waiting = true;
+      waitingSent = sent;
+      cur ^= 1;
+      fill = sent = 0;
+    }
+  }
+  return (true);
+}
+
+
+/* serialMonLogFileClass::sendWaiting()
+    Writes the block that is waiting to be written (or the part of it not already written by a partial flush), and
+    then, if the block being filled has also become full, makes it the waiting block, and writes it too
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogFileClass::sendWaiting() {
+  while (waiting) {
+    fileP->write(buf + ((cur ^ 1) * fileBlockLen) + waitingSent, fileBlockLen - waitingSent);
+    writeCount++;
+    blockCount++;
+    waiting = false;
+    if (fill == fileBlockLen) {
+      waiting = true;
+      waitingSent = sent;
+      cur ^= 1;
+      fill = sent = 0;
+    }
+  }
+}
+
+
+/* serialMonLogFileClass::poll()
+    Writes any block that has become full, and the partial block being filled if its oldest unwritten byte has been
+    held for flushMs. Should be called regularly from the main loop (a full block is written in a single write() of
+    fileBlockLen bytes, which may take a few ms on an SD card).
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogFileClass::poll() {
+  if (fileP == NULL)
+    return;
+  sendWaiting();
+  if ((flushMs != 0) && (fill > sent) && ((uint32_t) (millis() - firstMs) >= flushMs)) {
+    fileP->write(buf + (cur * fileBlockLen) + sent, fill - sent);
+    writeCount++;
+    sent = fill;
+  }
+}
+
+
+/* serialMonLogFileClass::flush()
+    Writes everything that hasn't yet been written, including a partial block, and flushes the file (e.g. before it
+    is closed, or periodically, so that little is lost if power fails)
+  Parameters: None
+  Returns: None
+*/
+void serialMonLogFileClass::flush() {
+  if (fileP == NULL)
+    return;
+  sendWaiting();
+  if (fill > sent) {
+    fileP->write(buf + (cur * fileBlockLen) + sent, fill - sent);
+    writeCount++;
+    sent = fill;
+  }
+  fileP->flush();
+}
@@ -0,0 +1,456 @@
+/* SerialMonWatch
+    SerialMonWatch.h and SerialMonWatch.cpp implement the serialMonWatchClass, which streams the values of selected
+    program variables at a fixed sample rate, as a lighter-weight alternative to logging them with LOGMSG. The program
+    registers a constant table of watchable variables (see WATCH_VAR), and the operator selects a subset and starts
+    streaming with the built-in watch menu (or the program does so by calling select() and start()).
+    Each sample is output either as a CSV line ("ms,value,value,...", preceded by a "ms,name,name,..." header line)
+    or as a binary frame in which only the values that have changed since the previous frame are sent, as deltas.
+    The binary format is decoded by tools/smlogdecode.cpp, which reconstructs the CSV time series.
+    sample() is called from the main loop; it costs O(selected variables) per sample, and never waits for room in the
+    output buffer: a frame that doesn't fit is skipped (and counted in skipCount). Frames are assembled in a buffer
+    borrowed from the scratch arena, so an object needs no buffer of its own while it isn't streaming.
+*/
+#include <Arduino.h>
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+#include "SerialMonScratch.h"
+#include "SerialMonWatch.h"
+
+const uint8_t maxWatchNameLen = 31;     // names longer than this are truncated in binary definition records
+
+
+/* serialMonWatchClass::init()
+    Registers the table of watchable variables, and clears the selection
+  Parameters:
+    const watchVarStruct *vars: pointer to the table, which must remain valid (normally a constexpr array)
+    uint8_t count: number of entries in the table
+  Returns: None
+*/
+void serialMonWatchClass::init(const watchVarStruct *vars, uint8_t count) {
+  this->vars = vars;
+  varCount = count;
+  clear();
+}
+
+
+/* serialMonWatchClass::setStream()
+    Specifies the stream used for output, and restarts the output with a new header
+  Parameters:
+    Stream *streamP: pointer to the stream (e.g. &Serial1)
+  Returns: None
+*/
+void serialMonWatchClass::setStream(Stream *streamP) {
+  this->streamP = streamP;
+  headerSent = false;
+}
+
+
+/* serialMonWatchClass::find()
+    Finds a registered variable by name
+  Parameters:
+    const char *name: variable name
+  Returns:
+    int16_t: index of the variable in the table, or -1 if not found
+*/
+int16_t serialMonWatchClass::find(const char *name) {
+  for (uint8_t i = 0; i < varCount; i++) {
+    if (strcmp(vars[i].name, name) == 0)
+      return (i);
+  }
+  return (-1);
+}
+
+
+/* serialMonWatchClass::isSelected()
+    Returns true if a registered variable is selected for streaming
+  Parameters:
+    uint8_t index: index of the variable in the table
+  Returns:
+    bool: true if selected
+*/
+bool serialMonWatchClass::isSelected(uint8_t index) {
+  for (uint8_t i = 0; i < selCount; i++) {
+    if (sel[i] == index)
+      return (true);
+  }
+  return (false);
+}
+
+
+/* serialMonWatchClass::select()
+    Adds a variable to the selection (at the end). The output is restarted with a new header.
+  Parameters:
+    const char *name: variable name
+  Returns:
+    bool: false if the variable doesn't exist or the selection is full (selecting a selected variable is allowed)
+*/
+bool serialMonWatchClass::select(const char *name) {
+  int16_t index = find(name);
+
+  if (index < 0)
+    return (false);
+  if (isSelected(index))
+    return (true);
+  if (selCount >= maxWatchSel)
+    return (false);
+  sel[selCount++] = index;
+  headerSent = false;
+  return (true);
+}
+
+
+/* serialMonWatchClass::deselect()
+    Removes a variable from the selection. The output is restarted with a new header.
+  Parameters:
+    const char *name: variable name
+  Returns:
+    bool: false if the variable doesn't exist or isn't selected
+*/
+bool serialMonWatchClass::deselect(const char *name) {
+  int16_t index = find(name);
+  uint8_t i;
+
+  for (i = 0; (i < selCount) && (sel[i] != index); i++);
+  if ((index < 0) || (i >= selCount))
+    return (false);
+  for (selCount--; i < selCount; i++)
+    sel[i] = sel[i + 1];
+  headerSent = false;
+  return (true);
+}
+
+
+/* serialMonWatchClass::clear()
+    Clears the selection, and stops streaming
+  Parameters: None
+  Returns: None
+*/
+void serialMonWatchClass::clear() {
+  selCount = 0;
+  stop();
+}
+
+
+/* serialMonWatchClass::start()
+    Starts streaming the selected variables. The first sample is taken by the next call to sample(), preceded by a
+    header.
+  Parameters:
+    uint32_t periodMs: sample period in ms (0 = sample on every call to sample())
+  Returns: None
+*/
+void serialMonWatchClass::start(uint32_t periodMs) {
+  this->periodMs = periodMs;
+  lastSampleMs = millis() - periodMs;
+  headerSent = false;
+  active = true;
+}
+
+
+/* serialMonWatchClass::stop()
+    Stops streaming
+  Parameters: None
+  Returns: None
+*/
+void serialMonWatchClass::stop() {
+  active = false;
+  headerSent = false;
+}
+
+
+/* serialMonWatchClass::readRaw()
+    Reads the current value of a registered variable as a raw 32-bit word: integers are sign- or zero-extended, bool
+    is 0 or 1, and float and double values are stored as the bits of a float.
+  Parameters:
+    uint8_t index: index of the variable in the table
+  Returns:
+    uint32_t: raw value
+*/
+uint32_t serialMonWatchClass::readRaw(uint8_t index) {
+  const volatile void *ptr = vars[index].ptr;
+  uint32_t raw;
+  float f;
+
+  switch (vars[index].type) {
+    case WATCH_INT8:
+      return ((uint32_t) (int32_t) *(const volatile int8_t *) ptr);
+    case WATCH_UINT8:
+      return (*(const volatile uint8_t *) ptr);
+    case WATCH_INT16:
+      return ((uint32_t) (int32_t) *(const volatile int16_t *) ptr);
+    case WATCH_UINT16:
+      return (*(const volatile uint16_t *) ptr);
+    case WATCH_BOOL:
+      return (*(const volatile bool *) ptr ? 1 : 0);
+    case WATCH_FLOAT:
+      f = *(const volatile float *) ptr;
+    break;
+    case WATCH_DOUBLE:
+      f = (float) *(const volatile double *) ptr;
+    break;
+    default:                          // WATCH_INT32 or WATCH_UINT32
+      return (*(const volatile uint32_t *) ptr);
+  }
+  memcpy(&raw, &f, 4);
+  return (raw);
+}
+
+
+/* serialMonWatchClass::formatValue()
+    Formats the current value of a registered variable as text (float and double values with csvDecimals decimal
+    places)
+  Parameters:
+    char *buf: output buffer (at least maxNumLen characters)
+    uint8_t index: index of the variable in the table
+  Returns:
+    uint8_t: number of characters written
+*/
+uint8_t serialMonWatchClass::formatValue(char *buf, uint8_t index) {
+  uint32_t raw = readRaw(index);
+  float f;
+
+  switch (vars[index].type) {
+    case WATCH_INT8:
+    case WATCH_INT16:
+    case WATCH_INT32:
+      return (smFormatInt(buf, (int32_t) raw));
+    case WATCH_FLOAT:
+    case WATCH_DOUBLE:
+      memcpy(&f, &raw, 4);
+      return (smFormatFloat(buf, f, csvDecimals));
+    default:
+      return (smFormatUint(buf, raw));
+  }
+}
+
+
+/* serialMonWatchClass::sendHeader()
+    Outputs the header that precedes the sample frames, if there is room for all of it in the output buffer. For CSV
+    output, this is a line containing "ms" and the names of the selected variables. For binary output, it is a
+    WATCH_REC_SYNC record ("SMW1") followed by a WATCH_REC_DEF record containing the timestamp (varint), the number
+    of selected variables (1 byte), and for each variable, its watchTypeEnum (1 byte), name length (1 byte) and name.
+    The decoder's values and the delta encoding state (last[]) are both reset to 0 by the header.
+  Parameters:
+    uint32_t now: timestamp (millis())
+    uint8_t *buf: buffer used to assemble the records (watchBufLen() bytes)
+  Returns:
+    bool: true if the header was sent
+*/
+bool serialMonWatchClass::sendHeader(uint32_t now, uint8_t *buf) {
+  uint8_t *bP = buf;
+  uint16_t len;
+  uint8_t nameLen;
+
+  if (binary) {
+    *bP++ = WATCH_REC_SYNC;
+    memcpy(bP, "SMW1", 4);
+    bP += 4;
+    *bP++ = WATCH_REC_DEF;
+    smPutVarint(&bP, buf + watchBufLen(selCount, binary), now);
+    *bP++ = selCount;
+    len = bP - buf;
+    for (uint8_t i = 0; i < selCount; i++)
+      len += 2 + strnlen(vars[sel[i]].name, maxWatchNameLen);
+  }
+  else {
+    len = 4;                                  // "ms" and "\r\n"
+    for (uint8_t i = 0; i < selCount; i++)
+      len += 1 + strlen(vars[sel[i]].name);
+  }
+  if (streamP->availableForWrite() < len)
+    return (false);
+  if (binary) {
+    streamP->write(buf, bP - buf);
+    for (uint8_t i = 0; i < selCount; i++) {
+      nameLen = strnlen(vars[sel[i]].name, maxWatchNameLen);
+      buf[0] = vars[sel[i]].type;
+      buf[1] = nameLen;
+      streamP->write(buf, 2);
+      streamP->write((const uint8_t *) vars[sel[i]].name, nameLen);
+    }
+  }
+  else {
+    streamP->print("ms");
+    for (uint8_t i = 0; i < selCount; i++) {
+      streamP->print(',');
+      streamP->print(vars[sel[i]].name);
+    }
+    streamP->println();
+  }
+  for (uint8_t i = 0; i < selCount; i++)
+    last[i] = 0;
+  lastFrameMs = now;
+  headerSent = true;
+  return (true);
+}
+
+
+/* serialMonWatchClass::sendFrame()
+    Outputs a sample of the selected variables, if there is room for all of it in the output buffer. For CSV output,
+    this is a line containing the timestamp and the values of the selected variables. For binary output, it is a
+    WATCH_REC_FRAME record containing:
+      timestamp delta in ms from the previous frame (varint)
+      changed bitmap (varint): bit n is set if the value of the nth selected variable has changed since the previous
+        frame
+      for each changed variable: integers (and bool) as the zig-zag varint of the difference from the previous value,
+        float and double as 4 bytes (little-endian IEEE float)
+    So a variable that doesn't change costs nothing, and one that changes slowly typically costs one byte.
+  Parameters:
+    uint32_t now: timestamp (millis())
+    uint8_t *buf: buffer used to assemble the frame (watchBufLen() bytes)
+  Returns:
+    bool: true if the frame was sent
+*/
+bool serialMonWatchClass::sendFrame(uint32_t now, uint8_t *buf) {
+  uint8_t *bP = buf;
+  uint8_t *endP = buf + watchBufLen(selCount, binary);
+  uint32_t raw[maxWatchSel];
+  uint32_t changed = 0;
+  uint32_t val;
+
+  if (binary) {
+    for (uint8_t i = 0; i < selCount; i++) {
+      raw[i] = readRaw(sel[i]);
+      if (raw[i] != last[i])
+        changed |= (uint32_t) 1 << i;
+    }
+    *bP++ = WATCH_REC_FRAME;
+    smPutVarint(&bP, endP, now - lastFrameMs);
+    smPutVarint(&bP, endP, changed);
+    for (uint8_t i = 0; (i < selCount) && (changed >> i); i++) {
+      if ((changed & ((uint32_t) 1 << i)) == 0)
+        continue;
+      if ((vars[sel[i]].type == WATCH_FLOAT) || (vars[sel[i]].type == WATCH_DOUBLE)) {
+        val = raw[i];
+        for (uint8_t j = 0; j < 4; j++, val >>= 8)
+          *bP++ = val & 0xFF;
+      }
+      else {
+        val = raw[i] - last[i];
+        smPutVarint(&bP, endP, (val << 1) ^ (uint32_t) ((int32_t) val >> 31));  // zig-zag encoding
+      }
+    }
+  }
+  else {
+    bP += smFormatUint((char *) bP, now);
+    for (uint8_t i = 0; i < selCount; i++) {
+      *bP++ = ',';
+      bP += formatValue((char *) bP, sel[i]);
+    }
+    *bP++ = '\r';
+    *bP++ = '\n';
+  }
+  if (streamP->availableForWrite() < (bP - buf))
+    return (false);
+  streamP->write(buf, bP - buf);
+  if (binary) {
+    for (uint8_t i = 0; i < selCount; i++)
+      last[i] = raw[i];
+  }
+  lastFrameMs = now;
+  return (true);
+}
+
+
+/* serialMonWatchClass::sample()
+    Samples and outputs the selected variables, if streaming is active and the sample period has elapsed since the
+    previous sample. Should be called from the main loop at least as often as the sample period. If the program falls
+    more than one period behind, the missed samples are skipped rather than sent in a burst.
+  Parameters: None
+  Returns: None
+*/
+void serialMonWatchClass::sample() {
+  uint32_t now;
+
+  if (!active || (selCount == 0))
+    return;
+  now = millis();
+  if (periodMs != 0) {
+    if ((now - lastSampleMs) < periodMs)
+      return;
+    lastSampleMs = ((now - lastSampleMs) < (2 * periodMs)) ? (lastSampleMs + periodMs) : now;
+  }
+  scratchBufClass frame(watchBufLen(selCount, binary));
+
+  if ((frame.len == 0) || (!headerSent && !sendHeader(now, (uint8_t *) frame.p)) ||
+      !sendFrame(now, (uint8_t *) frame.p)) {
+    skipCount++;
+    return;
+  }
+  frameCount++;
+}
+
+
+/* Command handler functions for the watch menu (see SerialMonWatch.h). Each is called by
+    serialMonCmdClass::dispatch() with the parsed parameters, and prints to the stream of the dispatching command object.
+  Parameters:
+    cmdArgsStruct *args: parsed parameters; args->context points to the serialMonWatchClass object
+  Returns: None
+*/
+void watchMenuAdd(cmdArgsStruct *args) {
+  serialMonWatchClass *watchP = (serialMonWatchClass *) args->context;
+
+  if (!watchP->select(args->param[0].s)) {
+    args->cmd->getStream()->println((watchP->find(args->param[0].s) < 0) ? "No such variable" : "Selection is full");
+    args->cmd->fail();
+  }
+}
+
+void watchMenuClear(cmdArgsStruct *args) {
+  ((serialMonWatchClass *) args->context)->clear();
+}
+
+void watchMenuDelete(cmdArgsStruct *args) {
+  if (!((serialMonWatchClass *) args->context)->deselect(args->param[0].s)) {
+    args->cmd->getStream()->println("Not selected");
+    args->cmd->fail();
+  }
+}
+
+void watchMenuFormat(cmdArgsStruct *args) {
+  serialMonWatchClass *watchP = (serialMonWatchClass *) args->context;
+
+  if ((strcmp(args->param[0].s, "csv") != 0) && (strcmp(args->param[0].s, "bin") != 0)) {
+    args->cmd->getStream()->println("Format must be csv or bin");
+    args->cmd->fail();
+    return;
+  }
+  watchP->binary = (args->param[0].s[0] == 'b');
+  watchP->resync();
+}
+
+void watchMenuList(cmdArgsStruct *args) {
+  serialMonWatchClass *watchP = (serialMonWatchClass *) args->context;
+  Stream *outP = args->cmd->getStream();
+  char valBuf[maxNumLen];
+  char buf[100];
+
+  for (uint8_t i = 0; i < watchP->count(); i++) {
+    watchP->formatValue(valBuf, i);
+    snprintf(buf, sizeof(buf), "%c %-20s %s", watchP->isSelected(i) ? '*' : ' ', watchP->getVar(i)->name, valBuf);
+    outP->println(buf);
+  }
+  snprintf(buf, sizeof(buf), "%s, %u selected, %lu ms, %s: %lu frames, %lu skipped", watchP->active ? "Streaming" : "Stopped",
+            watchP->selCount, (unsigned long) watchP->periodMs, watchP->binary ? "bin" : "csv",
+            (unsigned long) watchP->frameCount, (unsigned long) watchP->skipCount);
+  outP->println(buf);
+}
+
+void watchMenuStart(cmdArgsStruct *args) {
+  serialMonWatchClass *watchP = (serialMonWatchClass *) args->context;
+
+  if ((args->count > 0) && (args->param[0].i < 0)) {
+    args->cmd->getStream()->println("Period must not be negative");
+    args->cmd->fail();
+    return;
+  }
+  if (watchP->selCount == 0) {
+    args->cmd->getStream()->println("No variables selected");
+    args->cmd->fail();
+    return;
+  }
+  watchP->start((args->count > 0) ? args->param[0].i : watchP->periodMs);
+}
+
+void watchMenuStop(cmdArgsStruct *args) {
+  ((serialMonWatchClass *) args->context)->stop();
+}
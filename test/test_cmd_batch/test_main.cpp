@@ -0,0 +1,140 @@
+/* test_cmd_batch
+    Host unit tests for the results of batch commands (see serialMonCmdClass::fail()): a command whose handler rejects
+    its input (here, a parameter set to a value out of range) counts as failed in the batch summary, and stops a batch
+    started with "{!" or a script started with the script menu's 's' command. A command given after a submenu path
+    (e.g. "c set gain 2") returns to the current menu, and a path alone enters the submenu.
+    Run with "pio test -e native_test -f test_cmd_batch".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonCmd.h"
+#include "SerialMonParam.h"
+
+serialMonCmdClass smCmd;
+uint32_t gain;
+uint32_t period;
+
+constexpr paramEntryStruct params[] = {
+  PARAM(gain, 0, 10, ""),
+  PARAM(period, 1, 1000, "ms")
+};
+PARAM_TABLE_SORTED(params);
+constexpr paramTableStruct paramTable = {params, sizeof(params) / sizeof(params[0])};
+
+constexpr cmdScriptStruct scripts[] = {
+  {"bad", "c set gain 2\nc set gain 99\nc set period 5\n"}
+};
+constexpr cmdScriptTableStruct scriptTable = {scripts, sizeof(scripts) / sizeof(scripts[0])};
+
+constexpr cmdTableStruct paramMenu = {"Config", paramMenuEntries, paramMenuCount, (void *) &paramTable};
+constexpr cmdTableStruct scriptMenu = {"Script", scriptMenuEntries, scriptMenuCount, (void *) &scriptTable};
+constexpr cmdEntryStruct mainEntries[] = {
+  CMD_SUBMENU("c", paramMenu),
+  CMD_SUBMENU("r", scriptMenu)
+};
+CMD_TABLE_SORTED(mainEntries);
+constexpr cmdTableStruct mainMenu = {"Main", mainEntries, sizeof(mainEntries) / sizeof(mainEntries[0]), NULL};
+static batchCmdStruct batchLog[8];
+
+  // feeds input, and processes it until the command (or script) started by it has finished
+static void run(const char *text) {
+  Serial.feed(text);
+  for (uint8_t i = 0; i < 10; i++)
+    smCmd.processCommands(true);
+  TEST_ASSERT_FALSE(smCmd.busy());
+}
+
+void setUp() {
+  gain = 1;
+  period = 100;
+  smCmd.initMenu(&mainMenu);
+  smCmd.setBatchLog(batchLog);
+  Serial.capture = true;
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);    // enter command mode
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smCmd.exit();
+  Serial.capture = false;
+}
+
+  // with "{!", a set that is out of range fails and stops the batch: the following commands are skipped
+void test_failed_set_stops_batch() {
+  run("{!\nc set gain 2\nc set gain 99\nc set period 5\n}\n");
+  TEST_ASSERT_EQUAL_UINT32(2, gain);
+  TEST_ASSERT_EQUAL_UINT32(100, period);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Invalid or out of range value\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Batch stopped: 2 commands, 1 failed, 1 skipped\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "FAIL  c set gain 99\r\n"));
+}
+
+  // with "{", the failed set is counted, and the batch continues
+void test_failed_set_counted() {
+  run("{\nc set gain 2\nc set gain 99\nc get nosuch\nc set period 5\n}\n");
+  TEST_ASSERT_EQUAL_UINT32(2, gain);
+  TEST_ASSERT_EQUAL_UINT32(5, period);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Batch: 4 commands, 2 failed, 0 skipped\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "ok    c set gain 2\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "FAIL  c get nosuch\r\n"));
+}
+
+  // a script started with 's' stops at the failed set
+void test_script_stops_on_failure() {
+  uint8_t depth = smCmd.getMenuDepth();
+
+  run("r s bad\n");
+  TEST_ASSERT_EQUAL_INT(depth, smCmd.getMenuDepth());   // back in the main menu once the script has stopped
+  TEST_ASSERT_EQUAL_UINT32(2, gain);
+  TEST_ASSERT_EQUAL_UINT32(100, period);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Batch stopped: 2 commands, 1 failed"));
+  Serial.output.clear();
+  run("r r bad\n");                // 'r' runs it to the end
+  TEST_ASSERT_EQUAL_UINT32(5, period);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Batch: 3 commands, 1 failed"));
+}
+
+  // an unknown script name fails the command that tried to start it
+void test_unknown_script_fails() {
+  run("{!\nr r nosuch\nc set period 7\n}\n");
+  TEST_ASSERT_EQUAL_UINT32(100, period);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Unknown script: nosuch\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Batch stopped: 1 commands, 1 failed, 1 skipped\r\n"));
+}
+
+  // a command given after a path returns to the current menu, so pasted lines are all dispatched from the same menu
+void test_path_command_returns() {
+  uint8_t depth = smCmd.getMenuDepth();
+
+  run("c set gain 3\nc set period 7\n");
+  TEST_ASSERT_EQUAL_UINT32(3, gain);
+  TEST_ASSERT_EQUAL_UINT32(7, period);
+  TEST_ASSERT_NULL(strstr(Serial.output.c_str(), "Unknown command"));
+  TEST_ASSERT_EQUAL_INT(depth, smCmd.getMenuDepth());
+  run("c set gain 99\n");          // failed
+  TEST_ASSERT_EQUAL_INT(depth, smCmd.getMenuDepth());
+}
+
+  // a path alone enters the submenu
+void test_bare_path_navigates() {
+  uint8_t depth = smCmd.getMenuDepth();
+
+  run("c\n");
+  TEST_ASSERT_EQUAL_INT(depth + 1, smCmd.getMenuDepth());
+  run("set gain 4\n");
+  TEST_ASSERT_EQUAL_UINT32(4, gain);
+  TEST_ASSERT_EQUAL_INT(depth + 1, smCmd.getMenuDepth());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_failed_set_stops_batch);
+  RUN_TEST(test_failed_set_counted);
+  RUN_TEST(test_script_stops_on_failure);
+  RUN_TEST(test_unknown_script_fails);
+  RUN_TEST(test_path_command_returns);
+  RUN_TEST(test_bare_path_navigates);
+  return (UNITY_END());
+}
@@ -0,0 +1,234 @@
+/* test_cmd_frame
+    Host unit tests for the status of frame mode replies (see SerialMonFrame.h): a command whose handler or step
+    function reports failure (see serialMonCmdClass::fail()) is answered with FRAME_ERROR, a resumable command is
+    cancelled by a single <ESC> request, and a request received while a command is in progress is executed after it.
+    Run with "pio test -e native_test -f test_cmd_frame".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "SerialMonCmd.h"
+#include "SerialMonParam.h"
+
+serialMonCmdClass smCmd;
+uint32_t gain;
+
+constexpr paramEntryStruct params[] = {
+  PARAM(gain, 0, 10, "")
+};
+constexpr paramTableStruct paramTable = {params, sizeof(params) / sizeof(params[0])};
+constexpr cmdTableStruct paramMenu = {"Config", paramMenuEntries, paramMenuCount, (void *) &paramTable};
+
+  // state of the long command
+struct longStruct {
+  uint32_t pos;                   // number of steps done
+  uint32_t end;                   // number of steps to do
+  bool cancelled;                 // set when the step function is called with args->cancel
+};
+static longStruct longCmd;
+
+static cmdStepEnum longStep(cmdArgsStruct *args) {
+  longStruct *st = (longStruct *) args->state;
+
+  if (args->cancel) {
+    st->cancelled = true;
+    return (CMD_DONE);
+  }
+  hostAdvanceTime(100);
+  if (++st->pos < st->end)
+    return (CMD_CONTINUE);
+  if (st->end == 13) {            // "r 13" fails when it ends
+    args->cmd->getStream()->println("Step failed");
+    args->cmd->fail();
+  }
+  return (CMD_DONE);
+}
+
+  // "r <steps>" runs a resumable command
+static void cmdRun(cmdArgsStruct *args) {
+  longCmd.pos = 0;
+  longCmd.end = args->param[0].i;
+  longCmd.cancelled = false;
+  args->cmd->resume(args, longStep, &longCmd);
+}
+
+static void cmdEcho(cmdArgsStruct *args) {
+  args->cmd->getStream()->print("echo ");
+  args->cmd->getStream()->println(args->param[0].i);
+}
+
+constexpr cmdEntryStruct mainEntries[] = {
+  CMD_SUBMENU("c", paramMenu),
+  {"e", "i", cmdEcho, NULL},
+  {"r", "i", cmdRun, NULL}
+};
+CMD_TABLE_SORTED(mainEntries);
+constexpr cmdTableStruct mainMenu = {"Main", mainEntries, sizeof(mainEntries) / sizeof(mainEntries[0]), NULL};
+
+  // a decoded reply frame
+struct replyStruct {
+  uint8_t seq;
+  uint8_t status;
+  std::string text;
+};
+
+  // sends a request frame
+static void request(uint8_t seq, const char *text) {
+  uint8_t frame[maxFrameLen];
+  uint8_t code[maxFrameCode + 1];
+  uint16_t len = 0;
+  uint16_t crc;
+
+  frame[len++] = seq;
+  memcpy(frame + len, text, strlen(text));
+  len += strlen(text);
+  crc = smCrc16(frame, len);
+  frame[len++] = crc & 0xFF;
+  frame[len++] = crc >> 8;
+  len = smCobsEncode(frame, len, code);
+  code[len++] = 0;
+  Serial.feed(code, len);
+}
+
+  // decodes the reply frames in the captured output (and clears it); a frame with a bad CRC has status 0xFF
+static std::vector<replyStruct> replies() {
+  std::vector<replyStruct> list;
+  const std::string &out = Serial.output;
+  uint8_t buf[256];
+  size_t end;
+  int16_t len;
+
+  for (size_t start = 0; (end = out.find('\0', start)) != std::string::npos; start = end + 1) {
+    if ((end == start) || ((end - start) > sizeof(buf)))
+      continue;
+    memcpy(buf, out.data() + start, end - start);
+    len = smCobsDecode(buf, end - start);
+    if ((len < 4) || (smCrc16(buf, len - 2) != (buf[len - 2] | (buf[len - 1] << 8))))
+      list.push_back({0, 0xFF, ""});
+    else
+      list.push_back({buf[0], buf[1], std::string((const char *) buf + 2, len - 4)});
+  }
+  Serial.output.clear();
+  return (list);
+}
+
+void setUp() {
+  gain = 1;
+  smCmd.initMenu(&mainMenu);
+  Serial.capture = true;
+  Serial.feed(frameMagic);
+  Serial.feed("\n");
+  smCmd.processCommands(true);    // enter frame mode
+  TEST_ASSERT_TRUE(smCmd.frameMode);
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smCmd.exit();
+  smCmd.processCommands(true);    // return to text mode
+  Serial.capture = false;
+}
+
+  // a command whose handler rejects its input is answered with FRAME_ERROR, with the handler's message as the text
+void test_handler_failure_is_error() {
+  std::vector<replyStruct> r;
+
+  request(1, "c set gain 5");
+  request(2, "c set gain 99");
+  request(3, "c get nosuch");
+  request(4, "x");
+  smCmd.processCommands(true);
+  r = replies();
+  TEST_ASSERT_EQUAL_UINT32(4, r.size());
+  TEST_ASSERT_EQUAL_UINT8(1, r[0].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_OK, r[0].status);
+  TEST_ASSERT_EQUAL_UINT8(2, r[1].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_ERROR, r[1].status);
+  TEST_ASSERT_EQUAL_STRING("Invalid or out of range value\r\n", r[1].text.c_str());
+  TEST_ASSERT_EQUAL_UINT8(FRAME_ERROR, r[2].status);
+  TEST_ASSERT_EQUAL_STRING("No such parameter\r\n", r[2].text.c_str());
+  TEST_ASSERT_EQUAL_UINT8(FRAME_ERROR, r[3].status);   // unknown command
+  TEST_ASSERT_EQUAL_UINT32(5, gain);
+}
+
+  // a resumable command whose step function fails is answered with FRAME_ERROR when it ends
+void test_step_failure_is_error() {
+  std::vector<replyStruct> r;
+
+  request(5, "r 13");
+  request(6, "r 12");
+  while ((Serial.available() > 0) || smCmd.busy())
+    smCmd.processCommands(true);
+  r = replies();
+  TEST_ASSERT_EQUAL_UINT32(2, r.size());
+  TEST_ASSERT_EQUAL_UINT8(5, r[0].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_ERROR, r[0].status);
+  TEST_ASSERT_EQUAL_STRING("Step failed\r\n", r[0].text.c_str());
+  TEST_ASSERT_EQUAL_UINT8(6, r[1].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_OK, r[1].status);
+}
+
+  // a single <ESC> request cancels the command in progress: the command is answered with FRAME_ERROR, then the
+  // <ESC> request with FRAME_OK, and the session accepts requests again
+void test_esc_request_cancels() {
+  std::vector<replyStruct> r;
+
+  request(7, "r 100000");
+  for (uint8_t i = 0; i < 5; i++)
+    smCmd.processCommands(true);
+  TEST_ASSERT_TRUE(smCmd.busy());
+  TEST_ASSERT_EQUAL_UINT32(0, replies().size());
+  request(8, "\x1B");
+  smCmd.processCommands(true);
+  TEST_ASSERT_FALSE(smCmd.busy());
+  TEST_ASSERT_TRUE(longCmd.cancelled);
+  request(9, "e 5");
+  smCmd.processCommands(true);
+  r = replies();
+  TEST_ASSERT_EQUAL_UINT32(3, r.size());
+  TEST_ASSERT_EQUAL_UINT8(7, r[0].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_ERROR, r[0].status);
+  TEST_ASSERT_EQUAL_STRING("Cancelled\r\n", r[0].text.c_str());
+  TEST_ASSERT_EQUAL_UINT8(8, r[1].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_OK, r[1].status);
+  TEST_ASSERT_EQUAL_STRING("", r[1].text.c_str());
+  TEST_ASSERT_EQUAL_UINT8(9, r[2].seq);
+  TEST_ASSERT_EQUAL_STRING("echo 5\r\n", r[2].text.c_str());
+  TEST_ASSERT_TRUE(smCmd.frameMode);
+}
+
+  // a request received while a command is in progress is executed after it, and bad frames are answered without
+  // disturbing the reply being assembled
+void test_request_held_while_busy() {
+  std::vector<replyStruct> r;
+  static const uint8_t junk[] = {0x03, 0x41, 0x42, 0x00};   // a frame with a bad CRC
+
+  request(10, "r 50");
+  smCmd.processCommands(true);
+  Serial.feed(junk, sizeof(junk));
+  request(11, "e 6");
+  smCmd.processCommands(true);
+  TEST_ASSERT_TRUE(smCmd.busy());
+  while (smCmd.busy() || (Serial.available() > 0))
+    smCmd.processCommands(true);
+  smCmd.processCommands(true);
+  r = replies();
+  TEST_ASSERT_FALSE(longCmd.cancelled);
+  TEST_ASSERT_EQUAL_UINT32(50, longCmd.pos);
+  TEST_ASSERT_EQUAL_UINT32(3, r.size());
+  TEST_ASSERT_EQUAL_UINT8(FRAME_BAD, r[0].status);
+  TEST_ASSERT_EQUAL_UINT8(10, r[1].seq);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_OK, r[1].status);
+  TEST_ASSERT_EQUAL_UINT8(11, r[2].seq);
+  TEST_ASSERT_EQUAL_STRING("echo 6\r\n", r[2].text.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_handler_failure_is_error);
+  RUN_TEST(test_step_failure_is_error);
+  RUN_TEST(test_esc_request_cancels);
+  RUN_TEST(test_request_held_while_busy);
+  return (UNITY_END());
+}
@@ -0,0 +1,179 @@
+/* test_cmd_resumable
+    Host unit tests for resumable commands (see serialMonCmdClass::resume()): while a long command runs, each call to
+    processCommands() returns within the time budget (maxStepMicrosPerCall, plus at most one step), so the main loop's
+    latency stays bounded; a step that waits ends the call; and <ESC> cancels the command, after which the session
+    accepts commands again.
+    Run with "pio test -e native_test -f test_cmd_resumable".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonCmd.h"
+
+serialMonCmdClass smCmd;
+
+static const uint32_t stepMicros = 100;   // simulated duration of each step (see hostAdvanceTime())
+
+  // state of the long command
+struct longStruct {
+  uint32_t pos;                   // number of steps done
+  uint32_t end;                   // number of steps to do
+  bool wait;                      // if true, each step returns CMD_WAIT
+  bool cancelled;                 // set when the step function is called with args->cancel
+};
+static longStruct longCmd;
+
+static cmdStepEnum longStep(cmdArgsStruct *args) {
+  longStruct *st = (longStruct *) args->state;
+
+  if (args->cancel) {
+    st->cancelled = true;
+    return (CMD_DONE);
+  }
+  hostAdvanceTime(stepMicros);    // the step's work, without waiting for it
+  if (++st->pos == st->end)
+    return (CMD_DONE);
+  return (st->wait ? CMD_WAIT : CMD_CONTINUE);
+}
+
+  // "r <steps>" runs a resumable command; "w <steps>" one whose steps wait for the next call
+static void cmdLong(cmdArgsStruct *args, bool wait) {
+  longCmd.pos = 0;
+  longCmd.end = args->param[0].i;
+  longCmd.wait = wait;
+  longCmd.cancelled = false;
+  args->cmd->resume(args, longStep, &longCmd);
+}
+
+static void cmdRun(cmdArgsStruct *args) {
+  cmdLong(args, false);
+}
+
+static void cmdWait(cmdArgsStruct *args) {
+  cmdLong(args, true);
+}
+
+static void cmdEcho(cmdArgsStruct *args) {
+  args->cmd->getStream()->print("echo ");
+  args->cmd->getStream()->println(args->param[0].i);
+}
+
+constexpr cmdEntryStruct longEntries[] = {
+  {"e", "i", cmdEcho, NULL},
+  {"r", "i", cmdRun, NULL},
+  {"w", "i", cmdWait, NULL}
+};
+CMD_TABLE_SORTED(longEntries);
+constexpr cmdTableStruct longTable = {"Long", longEntries, sizeof(longEntries) / sizeof(longEntries[0]), NULL};
+
+void setUp() {
+  smCmd.maxStepMicrosPerCall = 1000;
+  smCmd.initMenu(&longTable);
+  Serial.capture = true;
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);    // enter command mode
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smCmd.exit();
+  Serial.capture = false;
+}
+
+  // each call returns within the budget plus one step, and the command still runs to completion
+void test_latency_bounded() {
+  uint32_t start, latency;
+  uint32_t maxLatency = 0;
+  uint32_t calls = 0;
+  char msg[80];
+
+  Serial.feed("r 2000\n");
+  smCmd.processCommands(true);    // starts the command
+  TEST_ASSERT_TRUE(smCmd.busy());
+  while (smCmd.busy()) {
+    start = micros();
+    smCmd.processCommands(true);
+    latency = micros() - start;
+    if (latency > maxLatency)
+      maxLatency = latency;
+    calls++;
+  }
+  snprintf(msg, sizeof(msg), "max latency %u us over %u calls", maxLatency, calls);
+  TEST_ASSERT_EQUAL_UINT32(2000, longCmd.pos);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(smCmd.maxStepMicrosPerCall + stepMicros + 500, maxLatency, msg);
+  TEST_ASSERT_GREATER_OR_EQUAL(2000 * stepMicros / (smCmd.maxStepMicrosPerCall + stepMicros), calls);
+  TEST_ASSERT_FALSE(longCmd.cancelled);
+}
+
+  // the budget is a parameter: halving it doubles the number of calls needed
+void test_budget_adjustable() {
+  uint32_t calls;
+
+  smCmd.maxStepMicrosPerCall = 500;
+  Serial.feed("r 100\n");
+  smCmd.processCommands(true);
+  for (calls = 0; smCmd.busy(); calls++)
+    smCmd.processCommands(true);
+  TEST_ASSERT_EQUAL_UINT32(100, longCmd.pos);
+  TEST_ASSERT_EQUAL_UINT32(20, calls);        // 5 steps of 100 us per call
+}
+
+  // a step that returns CMD_WAIT ends the call, and the command continues in the next one
+void test_wait_ends_call() {
+  Serial.feed("w 3\n");
+  smCmd.processCommands(true);
+  smCmd.processCommands(true);
+  TEST_ASSERT_EQUAL_UINT32(1, longCmd.pos);
+  smCmd.processCommands(true);
+  TEST_ASSERT_EQUAL_UINT32(2, longCmd.pos);
+  smCmd.processCommands(true);
+  TEST_ASSERT_EQUAL_UINT32(3, longCmd.pos);
+  TEST_ASSERT_FALSE(smCmd.busy());
+}
+
+  // <ESC> cancels the command: the step function is told to clean up, and the session accepts commands again
+void test_esc_cancels() {
+  uint32_t calls;
+
+  Serial.feed("r 100000\n");
+  smCmd.processCommands(true);
+  for (calls = 0; calls < 5; calls++)
+    smCmd.processCommands(true);
+  TEST_ASSERT_TRUE(smCmd.busy());
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);
+  TEST_ASSERT_FALSE(smCmd.busy());
+  TEST_ASSERT_TRUE(longCmd.cancelled);
+  TEST_ASSERT_LESS_THAN(100000, longCmd.pos);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Cancelled\r\n"));
+  TEST_ASSERT_TRUE(smCmd.cmdMode);
+  Serial.output.clear();
+  Serial.feed("e 5\n");
+  smCmd.processCommands(true);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "echo 5\r\n"));
+}
+
+  // input other than <ESC> waits until the command has finished
+void test_input_held_while_busy() {
+  Serial.feed("r 50\n");
+  smCmd.processCommands(true);
+  Serial.feed("e 6\n");
+  smCmd.processCommands(true);    // 10 of the 50 steps
+  TEST_ASSERT_TRUE(smCmd.busy());
+  TEST_ASSERT_NULL(strstr(Serial.output.c_str(), "echo 6"));
+  while (smCmd.busy())
+    smCmd.processCommands(true);
+  smCmd.processCommands(true);
+  TEST_ASSERT_FALSE(longCmd.cancelled);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "echo 6\r\n"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_latency_bounded);
+  RUN_TEST(test_budget_adjustable);
+  RUN_TEST(test_wait_ends_call);
+  RUN_TEST(test_esc_cancels);
+  RUN_TEST(test_input_held_while_busy);
+  return (UNITY_END());
+}
@@ -0,0 +1,111 @@
+/* test_log_deferred
+    Host unit tests for deferred LOGMSG output (see serialMonLogClass::drain()): the cost of capturing a message
+    doesn't depend on its length, captured messages are printed in order within the drain budget, and messages that
+    don't fit in the ring buffer are counted and reported.
+    Run with "pio test -e native_test -f test_log_deferred".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+static const char shortFmt[] = "s %u %d %f";
+static const char longFmt[] = "a much longer message, of the kind that takes a while to format: sensor %u value %d "
+                              "temp %f";
+static_assert(sizeof(longFmt) < maxMsgLen, "longFmt must fit in a log message");
+
+void setUp() {
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  smLog.deferred = true;
+  smLog.dropPolicy = LOG_DROP_NEWEST;
+  smLog.dropCount = smLog.dropBytes = smLog.overflowCount = 0;
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  while (smLog.pending() > 0)
+    smLog.drain(logRingLen);
+  smLog.drain(0);                 // report any drops left over
+  Serial.capture = false;
+}
+
+  // shortest time (ns per message) to capture a full ring of messages with a format string, over several trials
+static double captureNs(const char *fmt) {
+  double best = 1e9;
+
+  Serial.capture = false;
+  for (uint8_t trial = 0; trial < 7; trial++) {
+    double totalNs = 0;
+    for (uint16_t round = 0; round < 2000; round++) {
+      auto start = std::chrono::steady_clock::now();
+      for (uint8_t i = 0; i < (logRingLen - 1); i++)
+        smLog.logMsg(1, fmt, round, -(int32_t) i, 21.5f);
+      totalNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      smLog.drain(logRingLen);
+    }
+    totalNs /= 2000.0 * (logRingLen - 1);
+    if (totalNs < best)
+      best = totalNs;
+  }
+  return (best);
+}
+
+  // capture cost is the same for a long message as for a short one (nothing is formatted or copied)
+void test_capture_cost_constant() {
+  double shortNs = captureNs(shortFmt);
+  double longNs = captureNs(longFmt);
+  char msg[80];
+
+  snprintf(msg, sizeof(msg), "capture: short %.1f ns, long %.1f ns", shortNs, longNs);
+  TEST_ASSERT_TRUE_MESSAGE(longNs < ((shortNs * 1.5) + 10.0), msg);
+  TEST_ASSERT_EQUAL_UINT32(0, smLog.dropCount);
+}
+
+  // nothing is printed until drain(), which prints in order, at most budget messages per call
+void test_drain_budget_and_order() {
+  for (uint8_t i = 0; i < 5; i++)
+    LOGMSG(1, "msg %u", i);
+  LOGMSG(2, "filtered %u", 9);
+  TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT8(5, smLog.pending());
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.drain(2));
+  TEST_ASSERT_EQUAL_STRING("msg 0\r\nmsg 1\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.drain(logRingLen));
+  TEST_ASSERT_EQUAL_STRING("msg 0\r\nmsg 1\r\nmsg 2\r\nmsg 3\r\nmsg 4\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT8(0, smLog.pending());
+}
+
+  // arguments are formatted as captured, including floats and strings (static ones, as required in deferred mode)
+void test_captured_arguments() {
+  LOGMSG(1, "%s %d %x %.2f", "pump", -42, 0xBEEFu, 2.5f);
+  LOGMSG(1, "%c %u %s", 'z', 42u, "x", 7);             // an unused argument is ignored
+  smLog.drain(logRingLen);
+  TEST_ASSERT_EQUAL_STRING("pump -42 beef 2.50\r\nz 42 x\r\n", Serial.output.c_str());
+}
+
+  // messages that don't fit in the ring are dropped, counted, and reported ahead of the next printed message
+void test_overflow_counters() {
+  for (uint8_t i = 0; i < (logRingLen + 3); i++)
+    LOGMSG(1, "msg %u", i);
+  TEST_ASSERT_EQUAL_UINT32(4, smLog.dropCount);       // the ring holds logRingLen - 1 messages
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.overflowCount);
+  TEST_ASSERT_EQUAL_UINT32(4 * strlen("msg %u"), smLog.dropBytes);
+  smLog.drain(1);
+  TEST_ASSERT_EQUAL_STRING("[4 log messages dropped]\r\nmsg 0\r\n", Serial.output.c_str());
+  smLog.drain(logRingLen);
+  LOGMSG(1, "msg %u", 99);                            // the ring has room again: no new overflow
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.overflowCount);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_capture_cost_constant);
+  RUN_TEST(test_drain_budget_and_order);
+  RUN_TEST(test_captured_arguments);
+  RUN_TEST(test_overflow_counters);
+  return (UNITY_END());
+}
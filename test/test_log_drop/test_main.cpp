@@ -0,0 +1,240 @@
+/* test_log_drop
+    Host unit tests for LOGMSG output to a slow (throttled) Serial port (see serialMonLogClass::outputMsg()): messages
+    that can't be printed immediately are queued, the drop policies decide which messages are discarded when the
+    queue is full, and discarded messages are reported with a "[N log messages dropped]" line. The string arguments of
+    queued messages are copied, so the caller's buffers may be reused or go out of scope.
+    Run with "pio test -e native_test -f test_log_drop".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+static const uint32_t txLen = 128;  // size of the simulated Serial TX buffer (room for the longest line)
+
+void setUp() {
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  smLog.deferred = false;
+  smLog.dropPolicy = LOG_DROP_NEWEST;
+  smLog.blockMicros = 0;
+  smLog.dropCount = smLog.dropBytes = smLog.overflowCount = 0;
+  Serial.txBufSize = txLen;
+  Serial.txBytesPerMs = 1;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  Serial.txBufSize = 0;           // unthrottled, so everything left can be printed
+  while (smLog.pending() > 0)
+    smLog.drain(logRingLen);
+  smLog.drain(0);                 // report any drops left over
+  Serial.capture = false;
+}
+
+  // fills the TX buffer (without capturing the filler), so that nothing more can be printed for a while
+static void fillTx() {
+  char filler[txLen];
+
+  hostAdvanceTime(1000000);       // let the TX buffer empty first
+  memset(filler, '.', sizeof(filler));
+  Serial.capture = false;
+  Serial.write((const uint8_t *) filler, sizeof(filler));
+  Serial.capture = true;
+  TEST_ASSERT_EQUAL_INT(0, Serial.availableForWrite());
+}
+
+  // lets the TX buffer empty as often as needed to print everything queued
+static void openTx() {
+  do {
+    hostAdvanceTime(1000000);
+    smLog.drain(logRingLen);
+  } while (smLog.pending() > 0);
+}
+
+  // expected output for "msg %u" messages from first to last
+static std::string msgLines(uint8_t first, uint8_t last) {
+  std::string s;
+  char line[16];
+
+  for (uint8_t i = first; i <= last; i++) {
+    snprintf(line, sizeof(line), "msg %u\r\n", i);
+    s += line;
+  }
+  return (s);
+}
+
+  // a message that can't be printed is queued, and printed in order once there is room
+void test_queued_when_throttled() {
+  fillTx();
+  LOGMSG(1, "msg %u", 0);
+  LOGMSG(1, "msg %u", 1);
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.pending());
+  TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str());
+  openTx();
+  TEST_ASSERT_EQUAL_STRING(msgLines(0, 1).c_str(), Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, smLog.dropCount);
+}
+
+  // LOG_DROP_NEWEST keeps the queued messages, and reports the discarded new ones ahead of them
+void test_drop_newest() {
+  std::string expected;
+
+  fillTx();
+  for (uint8_t i = 0; i < (logRingLen + 2); i++)
+    LOGMSG(1, "msg %u", i);
+  TEST_ASSERT_EQUAL_UINT32(3, smLog.dropCount);     // the ring holds logRingLen - 1 messages
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.overflowCount);
+  TEST_ASSERT_EQUAL_UINT32(3 * strlen("msg %u"), smLog.dropBytes);
+  openTx();
+  expected = "[3 log messages dropped]\r\n" + msgLines(0, logRingLen - 2);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // LOG_DROP_OLDEST discards the oldest queued messages to make room for new ones
+void test_drop_oldest() {
+  std::string expected;
+
+  smLog.dropPolicy = LOG_DROP_OLDEST;
+  fillTx();
+  for (uint8_t i = 0; i < (logRingLen + 2); i++)
+    LOGMSG(1, "msg %u", i);
+  TEST_ASSERT_EQUAL_UINT32(3, smLog.dropCount);
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.overflowCount);
+  openTx();
+  expected = "[3 log messages dropped]\r\n" + msgLines(3, logRingLen + 1);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // LOG_BLOCK waits for the TX buffer to drain, so nothing is lost if it drains within blockMicros
+void test_block_waits() {
+  std::string expected;
+
+  smLog.dropPolicy = LOG_BLOCK;
+  fillTx();
+  for (uint8_t i = 0; i < (logRingLen - 1); i++)    // fill the ring without waiting
+    LOGMSG(1, "msg %u", i);
+  smLog.blockMicros = 200000;
+  LOGMSG(1, "msg %u", logRingLen - 1);              // waits to print the oldest (then the rest) at 1 byte/ms
+  TEST_ASSERT_EQUAL_UINT32(0, smLog.dropCount);
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.overflowCount);
+  TEST_ASSERT_EQUAL_UINT8(0, smLog.pending());
+  expected = msgLines(0, logRingLen - 1);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // LOG_BLOCK discards the new message if the TX buffer doesn't drain within blockMicros
+void test_block_timeout() {
+  std::string expected;
+  uint32_t start;
+
+  smLog.dropPolicy = LOG_BLOCK;
+  fillTx();
+  for (uint8_t i = 0; i < (logRingLen - 1); i++)
+    LOGMSG(1, "msg %u", i);
+  smLog.blockMicros = 2000;                         // only 2 bytes drain in that time
+  start = micros();
+  LOGMSG(1, "msg %u", logRingLen - 1);
+  TEST_ASSERT_GREATER_OR_EQUAL(2000, micros() - start);
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.dropCount);
+  TEST_ASSERT_EQUAL_UINT8(logRingLen - 1, smLog.pending());
+  openTx();
+  expected = "[1 log messages dropped]\r\n" + msgLines(0, logRingLen - 2);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // logs a state from a stack buffer, which is gone (and its memory reused) by the time the message is printed
+__attribute__((noinline)) static void logState(const char *state) {
+  char buf[16];
+
+  strncpy(buf, state, sizeof(buf));
+  LOGMSG(1, "valve %s %s", buf, "(static)");
+}
+
+__attribute__((noinline)) static void clobberStack() {
+  volatile char junk[256];
+
+  for (uint16_t i = 0; i < sizeof(junk); i++)
+    junk[i] = 'X';
+}
+
+  // the string arguments of a queued message are copied: reusing or leaving the caller's buffer doesn't change it
+void test_queued_strings_copied() {
+  char buf[16];
+
+  fillTx();
+  logState("OPEN");
+  clobberStack();
+  strcpy(buf, "CLOSED");
+  LOGMSG(1, "valve %s", buf);
+  strcpy(buf, "FAULT");
+  LOGMSG(1, "valve %s", buf);
+  strcpy(buf, "????");
+  openTx();
+  TEST_ASSERT_EQUAL_STRING("valve OPEN (static)\r\nvalve CLOSED\r\nvalve FAULT\r\n", Serial.output.c_str());
+}
+
+  // if the string pool is full, the new message is discarded (or, with LOG_DROP_OLDEST, the oldest queued ones)
+void test_string_pool_full() {
+  char big[(logTextLen / 2) + 8];
+  std::string expected;
+
+  memset(big, 'a', sizeof(big) - 1);
+  big[sizeof(big) - 1] = '\0';
+  fillTx();
+  LOGMSG(1, "1 %s", big);
+  LOGMSG(1, "2 %s", big);                           // no room for a second copy
+  TEST_ASSERT_EQUAL_UINT32(1, smLog.dropCount);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.pending());
+  openTx();
+  expected = "[1 log messages dropped]\r\n1 " + std::string(big) + "\r\n";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+
+  Serial.output.clear();
+  smLog.dropPolicy = LOG_DROP_OLDEST;
+  fillTx();
+  LOGMSG(1, "msg %u", 0);
+  LOGMSG(1, "1 %s", big);
+  LOGMSG(1, "2 %s", big);                           // oldest messages are discarded until the copy fits
+  TEST_ASSERT_EQUAL_UINT32(3, smLog.dropCount);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.pending());
+  openTx();
+  expected = "[2 log messages dropped]\r\n2 " + std::string(big) + "\r\n";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // the pool is reused as messages come and go, with copies wrapping around its end
+void test_string_pool_wraps() {
+  char name[16];
+  std::string expected;
+
+  fillTx();
+  LOGMSG(1, "%s=%s", "first", "ok");
+  expected = "first=ok\r\n";
+  for (uint8_t i = 0; i < 200; i++) {     // one message stays queued while the next one is captured
+    snprintf(name, sizeof(name), "s%u-%.*s", i, i % 9, "xxxxxxxx");
+    fillTx();
+    LOGMSG(1, "%s=%s", name, "ok");
+    expected += std::string(name) + "=ok\r\n";
+    hostAdvanceTime(1000000);
+    TEST_ASSERT_EQUAL_UINT8(1, smLog.drain(1));
+  }
+  openTx();
+  TEST_ASSERT_EQUAL_UINT32(0, smLog.dropCount);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_queued_when_throttled);
+  RUN_TEST(test_drop_newest);
+  RUN_TEST(test_drop_oldest);
+  RUN_TEST(test_block_waits);
+  RUN_TEST(test_block_timeout);
+  RUN_TEST(test_queued_strings_copied);
+  RUN_TEST(test_string_pool_full);
+  RUN_TEST(test_string_pool_wraps);
+  return (UNITY_END());
+}
@@ -0,0 +1,146 @@
+/* test_log_history
+    Host unit tests for the history ring (see serialMonLogClass::setHistory() and dumpHistory()): messages are
+    recorded whether or not they are printed, hidden messages are replayed once, and the string arguments of recorded
+    messages are copied, so that buffers that have since changed or gone out of scope don't affect them.
+    Run with "pio test -e native_test -f test_log_history".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+static logEntryStruct hist[8];
+static char histText[128];
+
+void setUp() {
+  smLog.enable = false;           // as while a command menu is active
+  smLog.logLevel = 1;
+  smLog.history = true;
+  smLog.histLevel = 2;
+  smLog.setHistory(hist, histText);
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smLog.history = false;
+  smLog.setHistory(NULL, 0);
+  Serial.capture = false;
+}
+
+  // logs a state from a stack buffer, which is gone (and its memory reused) by the time the history is dumped
+__attribute__((noinline)) static void logState(const char *state) {
+  char buf[16];
+
+  strncpy(buf, state, sizeof(buf));
+  LOGMSG(1, "valve %s", buf);
+}
+
+__attribute__((noinline)) static void clobberStack() {
+  volatile char junk[256];
+
+  for (uint16_t i = 0; i < sizeof(junk); i++)
+    junk[i] = 'X';
+}
+
+  // messages up to histLevel are recorded and dumped oldest first, with level and count filters
+void test_dump_order_and_levels() {
+  LOGMSG(0, "a %u", 0);
+  LOGMSG(2, "b %u", 2);
+  LOGMSG(3, "c %u", 3);           // above histLevel
+  LOGMSG(1, "d %u", 1);
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.historyCount(false));
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.dumpHistory(&Serial, 8, 255, false));
+  TEST_ASSERT_EQUAL_STRING("a 0\r\nb 2\r\nd 1\r\n", Serial.output.c_str());
+  Serial.output.clear();
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.dumpHistory(&Serial, 1, 1, false));   // the most recent at level 1 or below
+  TEST_ASSERT_EQUAL_STRING("d 1\r\n", Serial.output.c_str());
+}
+
+  // string arguments are copied when the message is recorded
+void test_strings_copied() {
+  char buf[16];
+
+  logState("OPEN");
+  clobberStack();
+  strcpy(buf, "CLOSED");
+  LOGMSG(1, "valve %s", buf);
+  strcpy(buf, "FAULT");
+  LOGMSG(1, "valve %s", buf);
+  strcpy(buf, "????");
+  smLog.dumpHistory(&Serial, 8, 255, false);
+  TEST_ASSERT_EQUAL_STRING("valve OPEN\r\nvalve CLOSED\r\nvalve FAULT\r\n", Serial.output.c_str());
+}
+
+  // hidden messages (which would have been printed if enabled) are replayed once, with their strings intact
+void test_hidden_replayed_once() {
+  logState("OPEN");
+  LOGMSG(2, "detail %s", "x");    // above logLevel, so it wasn't hidden, just not wanted
+  logState("SHUT");
+  clobberStack();
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.historyCount(true));
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.replayHidden(&Serial));
+  TEST_ASSERT_EQUAL_STRING("valve OPEN\r\nvalve SHUT\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT8(0, smLog.replayHidden(&Serial));
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.historyCount(false));
+}
+
+  // when the ring wraps, overwritten entries release their copies
+void test_ring_wraps() {
+  char buf[16];
+  char line[24];
+  std::string expected;
+
+  for (uint8_t i = 0; i < 50; i++) {
+    snprintf(buf, sizeof(buf), "n%u", i);
+    LOGMSG(1, "%s=%u", buf, i);
+    if (i >= (50 - 8)) {
+      snprintf(line, sizeof(line), "n%u=%u\r\n", i, i);
+      expected += line;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(8, smLog.historyCount(false));
+  smLog.dumpHistory(&Serial, 8, 255, false);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+  // when the text pool is full, the oldest entries are discarded to make room
+void test_text_pool_full() {
+  char buf[48];
+  std::string expected;
+
+  for (uint8_t i = 0; i < 6; i++) {
+    snprintf(buf, sizeof(buf), "%u-%.*s", i, 37, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+    LOGMSG(1, "%s", buf);
+    if (i >= 4)
+      expected += std::string(buf) + "\r\n";
+  }
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.historyCount(false));   // copies of 40 characters, wrapping around the pool
+  smLog.dumpHistory(&Serial, 8, 255, false);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+  smLog.clearHistory();
+  LOGMSG(1, "%s", buf);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.historyCount(false));
+}
+
+  // without a text pool, string arguments are recorded as "(?)", never as pointers to the caller's buffers
+void test_no_text_pool() {
+  smLog.setHistory(hist);
+  logState("OPEN");
+  LOGMSG(1, "n %d", 5);
+  smLog.dumpHistory(&Serial, 8, 255, false);
+  TEST_ASSERT_EQUAL_STRING("valve (?)\r\nn 5\r\n", Serial.output.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dump_order_and_levels);
+  RUN_TEST(test_strings_copied);
+  RUN_TEST(test_hidden_replayed_once);
+  RUN_TEST(test_ring_wraps);
+  RUN_TEST(test_text_pool_full);
+  RUN_TEST(test_no_text_pool);
+  return (UNITY_END());
+}
@@ -0,0 +1,133 @@
+/* test_log_isr
+    Host unit tests for LOGISR (see serialMonLogClass::logIsr()): messages are queued without being printed, a full
+    queue drops and counts new messages, and under a stress test with several producer threads (standing in for
+    interrupts) enqueueing while the main thread drains, every record is printed whole and in order, and every
+    message is either printed or counted as dropped.
+    Run with "pio test -e native_test -f test_log_isr".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+void setUp() {
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  smLog.isrDropCount = 0;
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  do {
+    smLog.drain(logRingLen);
+  } while (smLog.pending() > 0);
+  Serial.capture = false;
+}
+
+  // messages are only printed by drain(), in order
+void test_queued_until_drain() {
+  LOGISR(1, "isr %u", 1);
+  LOGISR(1, "isr %s %d", "two", -2);
+  LOGISR(2, "filtered");
+  TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.pending());
+  smLog.drain(logRingLen);
+  TEST_ASSERT_EQUAL_STRING("isr 1\r\nisr two -2\r\n", Serial.output.c_str());
+}
+
+  // when the queue is full, new messages are dropped and counted; the queued ones are all printed
+void test_queue_full() {
+  std::string expected;
+  char line[16];
+
+  for (uint8_t i = 0; i < (isrQueueLen + 3); i++)
+    LOGISR(1, "isr %u", i);
+  TEST_ASSERT_EQUAL_UINT32(3, smLog.isrDropCount);
+  do {
+    smLog.drain(logRingLen);
+  } while (smLog.pending() > 0);
+  for (uint8_t i = 0; i < isrQueueLen; i++) {
+    snprintf(line, sizeof(line), "isr %u\r\n", i);
+    expected += line;
+  }
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), Serial.output.c_str());
+}
+
+static const uint32_t checkMul = 2654435761u;   // spreads the check value of a record over all its bits
+static uint32_t producersDone;                  // number of producer threads that have finished
+
+  // a producer thread: logs count records, each with its id, sequence number and a check value
+static void producer(uint32_t id, uint32_t count) {
+  for (uint32_t seq = 0; seq < count; seq++) {
+    LOGISR(1, "isr %u %u %u", id, seq, (id * checkMul) ^ seq);
+    if ((seq % 8) == 7)                         // give the consumer a chance to run, even on a single core
+      std::this_thread::yield();
+  }
+  __atomic_fetch_add(&producersDone, 1, __ATOMIC_RELEASE);
+}
+
+  // runs numThreads producers of perThread records each while draining, and checks every printed record
+static void stress(uint32_t numThreads, uint32_t perThread, bool slowConsumer) {
+  std::vector<std::thread> threads;
+  std::vector<int64_t> lastSeq(numThreads, -1);
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  unsigned int id, seq, check;
+  const char *lineP;
+  char msg[80];
+
+  producersDone = 0;
+  for (uint32_t i = 0; i < numThreads; i++)
+    threads.push_back(std::thread(producer, i, perThread));
+  while (__atomic_load_n(&producersDone, __ATOMIC_ACQUIRE) < numThreads) {
+    smLog.drain(slowConsumer ? 1 : logRingLen);
+    if (slowConsumer)
+      std::this_thread::yield();
+  }
+  for (uint32_t i = 0; i < numThreads; i++)
+    threads[i].join();
+  do {                                          // print anything left in the queue and ring buffer
+    smLog.drain(logRingLen);
+  } while (smLog.pending() > 0);
+  for (lineP = Serial.output.c_str(); (lineP = strstr(lineP, "isr ")) != NULL; lineP++) {
+    if ((sscanf(lineP, "isr %u %u %u", &id, &seq, &check) != 3) || (id >= numThreads) ||
+          (check != ((id * checkMul) ^ seq)) || ((int64_t) seq <= lastSeq[id]))
+      torn++;
+    else
+      lastSeq[id] = seq;
+    received++;
+  }
+  snprintf(msg, sizeof(msg), "%u threads: received %u, dropped %u, torn %u", numThreads, received,
+            smLog.isrDropCount, torn);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, torn, msg);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(numThreads * perThread, received + smLog.isrDropCount, msg);   // none lost
+  TEST_ASSERT_GREATER_THAN(0, received);
+}
+
+void test_stress_1_thread() {
+  stress(1, 20000, false);
+}
+
+void test_stress_4_threads() {
+  stress(4, 20000, false);
+}
+
+  // with a consumer that can't keep up, messages are dropped, but never torn or lost
+void test_stress_4_threads_slow_consumer() {
+  stress(4, 5000, true);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_queued_until_drain);
+  RUN_TEST(test_queue_full);
+  RUN_TEST(test_stress_1_thread);
+  RUN_TEST(test_stress_4_threads);
+  RUN_TEST(test_stress_4_threads_slow_consumer);
+  return (UNITY_END());
+}
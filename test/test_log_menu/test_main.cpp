@@ -0,0 +1,103 @@
+/* test_log_menu
+    Host unit tests for the tag command of the built-in log menu (see SerialMonLogMenu.h): "t <tag> <level>" sets the
+    level of one tag, "t <tag> <level> <others>" also sets all other levels, "t * <level>" sets all levels, and "t *"
+    alone (like "t") only prints the levels, without changing any of them.
+    Run with "pio test -e native_test -f test_log_menu".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonCmd.h"
+#include "SerialMonLog.h"
+#include "SerialMonLogMenu.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+serialMonCmdClass smCmd;
+
+constexpr cmdTableStruct logMenu = {"Log", logMenuEntries, logMenuCount, &smLog};
+
+enum {tagMotor = 1, tagComms = 2};
+
+  // executes a command line from the log menu
+static void command(const char *line) {
+  Serial.output.clear();
+  Serial.feed(line);
+  Serial.feed("\n");
+  smCmd.processCommands(true);
+}
+
+void setUp() {
+  smLog.logLevel = 1;
+  smLog.setTagLevels(1);
+  smLog.setTagName(tagMotor, "motor");
+  smLog.setTagName(tagComms, "comms");
+  smCmd.initMenu(&logMenu);
+  Serial.capture = true;
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);    // enter command mode
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smCmd.exit();
+  Serial.capture = false;
+}
+
+  // a tag is set by name or number, and the others are left alone
+void test_set_one_tag() {
+  command("t motor 3");
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.tagLevel[tagMotor]);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.tagLevel[tagComms]);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.logLevel);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), " 1 motor   3\r\n"));
+  command("t 5 4");
+  TEST_ASSERT_EQUAL_UINT8(4, smLog.tagLevel[5]);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), " 5         4\r\n"));   // unnamed, but listed since given
+}
+
+  // a third parameter sets all of the other levels
+void test_set_tag_and_others() {
+  command("t motor 3 9");
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.tagLevel[tagMotor]);
+  TEST_ASSERT_EQUAL_UINT8(9, smLog.tagLevel[tagComms]);
+  TEST_ASSERT_EQUAL_UINT8(9, smLog.tagLevel[0]);
+  TEST_ASSERT_EQUAL_UINT8(9, smLog.logLevel);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "untagged   9\r\n"));
+}
+
+  // "t * <level>" sets every level; "t *" alone leaves them as they were
+void test_star() {
+  command("t motor 3 9");
+  command("t *");
+  TEST_ASSERT_EQUAL_UINT8(3, smLog.tagLevel[tagMotor]);
+  TEST_ASSERT_EQUAL_UINT8(9, smLog.tagLevel[tagComms]);
+  TEST_ASSERT_EQUAL_UINT8(9, smLog.logLevel);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), " 1 motor   3\r\n"));
+  command("t * 2");
+  for (uint8_t i = 0; i < maxLogTags; i++)
+    TEST_ASSERT_EQUAL_UINT8(2, smLog.tagLevel[i]);
+  TEST_ASSERT_EQUAL_UINT8(2, smLog.logLevel);
+}
+
+  // an unknown tag or a level out of range is an error, and changes nothing
+void test_errors() {
+  command("t nosuch 3");
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Unknown tag: nosuch\r\n"));
+  command("t 16 3");
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Unknown tag: 16\r\n"));
+  command("t motor 256");
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Level must be 0 - 255\r\n"));
+  command("t * -1");
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "Level must be 0 - 255\r\n"));
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.tagLevel[tagMotor]);
+  TEST_ASSERT_EQUAL_UINT8(1, smLog.logLevel);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_set_one_tag);
+  RUN_TEST(test_set_tag_and_others);
+  RUN_TEST(test_star);
+  RUN_TEST(test_errors);
+  return (UNITY_END());
+}
@@ -0,0 +1,157 @@
+/* test_log_ratelimit
+    Host unit tests for the LOGMSG_RL token bucket (see serialMonLogClass::rateCheck()) and for the collapsing of
+    repeated messages (see serialMonLogClass::isRepeat()): suppressed messages are counted and reported, tokens are
+    earned back over time, only messages with the same contents (including the characters of string arguments) are
+    collapsed, and repeats are reported even when the scratch arena has room for only one line at a time.
+    Run with "pio test -e native_test -f test_log_ratelimit".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+static const uint16_t periodMs = 10000;   // long enough that the test's own run time doesn't earn tokens
+
+void setUp() {
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  smLog.deferred = false;
+  smLog.collapseRepeats = false;
+  smLog.suppressCount = 0;
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smLog.collapseRepeats = false;
+  Serial.capture = false;
+}
+
+  // a single rate limited call site: 2 messages back-to-back, then one per periodMs
+static void logLimited(uint8_t n) {
+  LOGMSG_RL(1, 2, periodMs, "rl %u", n);
+}
+
+  // the burst is printed, further messages are suppressed and counted, and reported when the call site prints again
+void test_burst_then_suppressed() {
+  for (uint8_t i = 0; i < 5; i++)
+    logLimited(i);
+  TEST_ASSERT_EQUAL_STRING("rl 0\r\nrl 1\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT32(3, smLog.suppressCount);
+
+  Serial.output.clear();
+  hostAdvanceTime(periodMs * 1000UL);   // earns one token
+  logLimited(5);
+  logLimited(6);
+  TEST_ASSERT_EQUAL_STRING("[3 messages suppressed]\r\nrl 5\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT32(4, smLog.suppressCount);
+
+  Serial.output.clear();
+  hostAdvanceTime(5 * periodMs * 1000UL);   // earns tokens up to the burst size only
+  for (uint8_t i = 7; i < 10; i++)
+    logLimited(i);
+  TEST_ASSERT_EQUAL_STRING("[1 messages suppressed]\r\nrl 7\r\nrl 8\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT32(5, smLog.suppressCount);
+}
+
+  // a partly earned token isn't lost when a whole one is spent
+void test_refill_keeps_partial_period() {
+  hostAdvanceTime(5 * periodMs * 1000UL); // start with a full bucket
+  for (uint8_t i = 0; i < 3; i++)         // then empty it (the third message is suppressed)
+    logLimited(i);
+  hostAdvanceTime((periodMs * 3000UL) / 2);   // 1.5 periods: one token, and half of the next
+  logLimited(3);
+  logLimited(4);
+  Serial.output.clear();
+  hostAdvanceTime((periodMs * 1000UL) / 2);   // the other half
+  logLimited(5);
+  TEST_ASSERT_EQUAL_STRING("[1 messages suppressed]\r\nrl 5\r\n", Serial.output.c_str());
+}
+
+  // identical consecutive messages are counted, and reported when a different message is logged
+void test_repeats_collapsed() {
+  smLog.collapseRepeats = true;
+  for (uint8_t i = 0; i < 3; i++)
+    LOGMSG(1, "temp %d", 21);
+  LOGMSG(1, "temp %d", 22);
+  TEST_ASSERT_EQUAL_STRING("temp 21\r\n[last message repeated 2 times]\r\ntemp 22\r\n", Serial.output.c_str());
+}
+
+  // repeats aren't held for longer than repeatFlushMs
+void test_repeats_flushed() {
+  smLog.collapseRepeats = true;
+  smLog.repeatFlushMs = 1000;
+  LOGMSG(1, "level %u", 7);
+  LOGMSG(1, "level %u", 7);
+  smLog.drain(0);
+  TEST_ASSERT_EQUAL_STRING("level 7\r\n", Serial.output.c_str());
+  hostAdvanceTime(1000000);
+  smLog.drain(0);
+  TEST_ASSERT_EQUAL_STRING("level 7\r\n[last message repeated 1 times]\r\n", Serial.output.c_str());
+}
+
+  // with room in the scratch arena for only one line, drain() gives its line back before reporting repeats, so the
+  // report is printed at once rather than queued for lack of a line of its own
+void test_repeats_flushed_one_line_arena() {
+  uint32_t fails = smScratch.failCount;
+
+  smLog.collapseRepeats = true;
+  smLog.repeatFlushMs = 1000;
+  LOGMSG(1, "level %u", 8);
+  LOGMSG(1, "level %u", 8);
+  hostAdvanceTime(1000000);
+  {
+    scratchBufClass rest(smScratch.available() - logLineLen);   // leaves room for one line
+
+    smLog.drain(logRingLen);
+  }
+  TEST_ASSERT_EQUAL_STRING("level 8\r\n[last message repeated 1 times]\r\n", Serial.output.c_str());
+  TEST_ASSERT_EQUAL_UINT32(fails, smScratch.failCount);
+  TEST_ASSERT_EQUAL_UINT8(0, smLog.pending());
+}
+
+  // a string argument is compared by contents: the same buffer with new contents is a new message
+void test_string_contents_compared() {
+  char state[16];
+  static const char *states[] = {"OPEN", "CLOSED", "FAULT", "FAULT"};
+
+  smLog.collapseRepeats = true;
+  for (uint8_t i = 0; i < 4; i++) {
+    strcpy(state, states[i]);
+    LOGMSG(1, "valve %s", state);
+  }
+  strcpy(state, "x");                     // the copy of the last message's string is unaffected
+  LOGMSG(1, "valve %s", "FAULT");
+  LOGMSG(1, "valve done");
+  TEST_ASSERT_EQUAL_STRING("valve OPEN\r\nvalve CLOSED\r\nvalve FAULT\r\n[last message repeated 2 times]\r\n"
+                           "valve done\r\n", Serial.output.c_str());
+}
+
+  // messages whose strings are too long to keep a copy of are never collapsed
+void test_long_strings_not_collapsed() {
+  char big[maxMsgLen - 20];
+  std::string line;
+
+  smLog.collapseRepeats = true;
+  memset(big, 'b', sizeof(big) - 1);
+  big[sizeof(big) - 1] = '\0';
+  LOGMSG(1, "%s%s", big, big);
+  LOGMSG(1, "%s%s", big, big);
+  line = (std::string(big) + big).substr(0, maxMsgLen - 1) + "\r\n";
+  line += line;
+  TEST_ASSERT_EQUAL_STRING(line.c_str(), Serial.output.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_then_suppressed);
+  RUN_TEST(test_refill_keeps_partial_period);
+  RUN_TEST(test_repeats_collapsed);
+  RUN_TEST(test_repeats_flushed);
+  RUN_TEST(test_repeats_flushed_one_line_arena);
+  RUN_TEST(test_string_contents_compared);
+  RUN_TEST(test_long_strings_not_collapsed);
+  return (UNITY_END());
+}
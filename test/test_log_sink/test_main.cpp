@@ -0,0 +1,197 @@
+/* test_log_sink
+    Host unit tests for the in-memory ring sink (see serialMonLogRingClass): a ring with no array set can be dumped
+    and written to (lines are discarded, and counted as drops by the logger), lines are dumped oldest first, and when
+    the ring has wrapped, a partly overwritten oldest line is skipped. And for the log file writer (see
+    serialMonLogFileClass): the file only sees whole-block writes, a partial block written after flushMs is followed
+    by a write that brings the file back to a block boundary, and lines are dropped while both blocks are full.
+    Run with "pio test -e native_test -f test_log_sink".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "SerialMonLog.h"
+#include "SerialMonSink.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+
+  // a file that keeps what is written to it, and the size of each write() call
+class recordFileClass : public Print {
+public:
+  std::string data;
+  std::vector<size_t> writes;
+  using Print::write;
+  size_t write(uint8_t c) { return (write(&c, 1)); }
+  size_t write(const uint8_t *buf, size_t len) {
+    data.append((const char *) buf, len);
+    writes.push_back(len);
+    return (len);
+  }
+};
+
+  // returns a line of 100 characters (including <CR><NL>), made distinct by its number
+static std::string fileLine(uint8_t n) {
+  std::string line(98, 'a' + (n % 26));
+
+  return (line + "\r\n");
+}
+
+void setUp() {
+  smLog.enable = true;
+  smLog.logLevel = 1;
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  Serial.capture = false;
+}
+
+  // a ring with no array holds nothing: dump() prints nothing, and write() discards every line
+void test_no_buffer() {
+  serialMonLogRingClass ring;
+
+  TEST_ASSERT_EQUAL_UINT16(0, ring.dump(&Serial));
+  TEST_ASSERT_FALSE(ring.write("a\r\n", 3));
+  TEST_ASSERT_FALSE(ring.write("", 0));
+  TEST_ASSERT_EQUAL_UINT16(0, ring.dump(&Serial));
+  TEST_ASSERT_EQUAL_UINT16(0, ring.count());
+  ring.setBuffer(NULL, 64);
+  TEST_ASSERT_EQUAL_UINT16(0, ring.dump(&Serial));
+  TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str());
+}
+
+  // a logger's ring sink with no array counts each line as a drop
+void test_sink_without_buffer() {
+  static serialMonLogRingClass ring;
+  static logSinkStruct ringSink = LOG_SINK_INIT("ring", logSinkRing, &ring, 1);
+
+  smLog.addSink(&ringSink);
+  LOGMSG(1, "x %u", 1);
+  LOGMSG(1, "x %u", 2);
+  TEST_ASSERT_EQUAL_UINT32(0, ringSink.lines);
+  TEST_ASSERT_EQUAL_UINT32(2, ringSink.drops);
+  TEST_ASSERT_EQUAL_STRING("x 1\r\nx 2\r\n", Serial.output.c_str());
+  Serial.output.clear();
+  TEST_ASSERT_EQUAL_UINT16(0, ring.dump(&Serial));
+  TEST_ASSERT_EQUAL_STRING("", Serial.output.c_str());
+}
+
+  // lines are dumped oldest first; after the ring wraps, the partly overwritten oldest line is skipped
+void test_dump_wraps() {
+  serialMonLogRingClass ring;
+  char text[16];
+
+  ring.setBuffer(text);
+  ring.write("one\r\n", 5);
+  ring.write("two\r\n", 5);
+  TEST_ASSERT_EQUAL_UINT16(10, ring.dump(&Serial));
+  TEST_ASSERT_EQUAL_STRING("one\r\ntwo\r\n", Serial.output.c_str());
+  Serial.output.clear();
+  ring.write("three\r\n", 7);       // overwrites the start of "one"
+  TEST_ASSERT_EQUAL_UINT16(12, ring.dump(&Serial));
+  TEST_ASSERT_EQUAL_STRING("two\r\nthree\r\n", Serial.output.c_str());
+  TEST_ASSERT_FALSE(ring.write("0123456789abcdefg", 17));   // longer than the ring
+  ring.clear();
+  TEST_ASSERT_EQUAL_UINT16(0, ring.dump(&Serial));
+}
+
+  // without flushMs, the file only receives whole blocks, written by poll() once they are full
+void test_file_block_writes() {
+  static serialMonLogFileClass logFile;
+  recordFileClass file;
+  std::string text;
+
+  logFile.flushMs = 0;
+  logFile.begin(&file);
+  for (uint8_t i = 0; i < 5; i++) {
+    text += fileLine(i);
+    TEST_ASSERT_TRUE(logFile.write(fileLine(i).c_str(), 100));
+  }
+  logFile.poll();
+  TEST_ASSERT_EQUAL_UINT32(0, file.writes.size());
+  for (uint8_t i = 5; i < 11; i++) {
+    text += fileLine(i);
+    TEST_ASSERT_TRUE(logFile.write(fileLine(i).c_str(), 100));
+    logFile.poll();
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, file.writes.size());
+  TEST_ASSERT_EQUAL_UINT32(fileBlockLen, file.writes[0]);
+  TEST_ASSERT_EQUAL_UINT32(fileBlockLen, file.writes[1]);
+  TEST_ASSERT_TRUE(file.data == text.substr(0, 2 * fileBlockLen));
+  TEST_ASSERT_EQUAL_UINT32(2, logFile.blockCount);
+  TEST_ASSERT_EQUAL_UINT16(1100 - (2 * fileBlockLen), logFile.pending());
+  logFile.flush();                  // the rest, as a partial block
+  TEST_ASSERT_TRUE(file.data == text);
+}
+
+  // a partial block held for flushMs is written by poll(); the rest of that block is written when it is full, so
+  // the following writes are whole blocks at block boundaries of the file again
+void test_file_partial_flush_realigns() {
+  static serialMonLogFileClass logFile;
+  recordFileClass file;
+  std::string text;
+
+  logFile.flushMs = 1000;
+  logFile.begin(&file);
+  text = fileLine(0);
+  logFile.write(text.c_str(), 100);
+  hostAdvanceTime(999000);
+  logFile.poll();
+  TEST_ASSERT_EQUAL_UINT32(0, file.writes.size());
+  hostAdvanceTime(1000);
+  logFile.poll();                   // held for flushMs
+  TEST_ASSERT_EQUAL_UINT32(1, file.writes.size());
+  TEST_ASSERT_EQUAL_UINT32(100, file.writes[0]);
+  for (uint8_t i = 1; i < 11; i++) {
+    text += fileLine(i);
+    logFile.write(fileLine(i).c_str(), 100);
+    logFile.poll();
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, file.writes.size());
+  TEST_ASSERT_EQUAL_UINT32(fileBlockLen - 100, file.writes[1]);   // the rest of the first block
+  TEST_ASSERT_EQUAL_UINT32(fileBlockLen, file.writes[2]);
+  TEST_ASSERT_EQUAL_UINT32(2 * fileBlockLen, file.data.size());
+  TEST_ASSERT_TRUE(file.data == text.substr(0, 2 * fileBlockLen));
+  TEST_ASSERT_EQUAL_UINT32(2, logFile.blockCount);
+}
+
+  // while both blocks are full (poll() not called), lines are dropped, and counted as drops by the logger
+void test_file_drops_when_full() {
+  static serialMonLogFileClass logFile;
+  static logSinkStruct fileSink = LOG_SINK_INIT("file", logSinkFile, &logFile, 1);
+  recordFileClass file;
+  std::string text;
+
+  logFile.flushMs = 0;
+  logFile.begin(&file);
+  for (uint8_t i = 0; i < 10; i++) {
+    text += fileLine(i);
+    TEST_ASSERT_TRUE(logFile.write(fileLine(i).c_str(), 100));
+  }
+  TEST_ASSERT_FALSE(logFile.write(fileLine(10).c_str(), 100));   // only 24 bytes left
+  TEST_ASSERT_TRUE(logFile.write("0123456789012345678901\r\n", 24));
+  TEST_ASSERT_FALSE(logFile.write("x\r\n", 3));
+  smLog.addSink(&fileSink);
+  LOGMSG(1, "dropped %u", 1);
+  TEST_ASSERT_EQUAL_UINT32(0, fileSink.lines);
+  TEST_ASSERT_EQUAL_UINT32(1, fileSink.drops);
+  TEST_ASSERT_EQUAL_UINT32(0, file.writes.size());
+  logFile.poll();                   // both blocks are written
+  TEST_ASSERT_EQUAL_UINT32(2, file.writes.size());
+  TEST_ASSERT_TRUE(file.data == text + "0123456789012345678901\r\n");
+  LOGMSG(1, "kept %u", 2);
+  TEST_ASSERT_EQUAL_UINT32(1, fileSink.lines);
+  TEST_ASSERT_EQUAL_UINT16(8, logFile.pending());   // "kept 2\r\n"
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_buffer);
+  RUN_TEST(test_sink_without_buffer);
+  RUN_TEST(test_dump_wraps);
+  RUN_TEST(test_file_block_writes);
+  RUN_TEST(test_file_partial_flush_realigns);
+  RUN_TEST(test_file_drops_when_full);
+  return (UNITY_END());
+}
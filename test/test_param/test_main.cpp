@@ -0,0 +1,183 @@
+/* test_param
+    Host unit tests for parameter formatting (see smParamFormat() and smParamSet()): the output of the parameter
+    menu's dump command, pasted back into the menu, restores every parameter exactly, including very large and very
+    small float values and doubles, and ranges are listed in a form that can be read back.
+    Run with "pio test -e native_test -f test_param".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <random>
+#include "SerialMonCmd.h"
+#include "SerialMonNum.h"
+#include "SerialMonParam.h"
+
+serialMonCmdClass smCmd;
+float big, gain, tiny;
+double exact, third, wee;
+int16_t offset;
+bool on;
+uint32_t period;
+
+constexpr paramEntryStruct params[] = {
+  PARAM(big, -1e30, 1e30, ""),
+  PARAM(exact, -1e30, 1e30, ""),
+  PARAM(gain, 0.1f, 10, ""),
+  PARAM(offset, -1000, 1000, "mm"),
+  PARAM(on, 0, 1, ""),
+  PARAM(period, 1, 100000, "ms"),
+  PARAM(third, -1, 1, ""),
+  PARAM(tiny, -1, 1, ""),
+  PARAM(wee, -1, 1, "")
+};
+PARAM_TABLE_SORTED(params);
+constexpr paramTableStruct paramTable = {params, sizeof(params) / sizeof(params[0])};
+constexpr cmdTableStruct paramMenu = {"Config", paramMenuEntries, paramMenuCount, (void *) &paramTable};
+
+  // executes command lines from the parameter menu, and returns their output
+static std::string command(const std::string &lines) {
+  Serial.output.clear();
+  Serial.feed(lines.c_str());
+  for (uint8_t i = 0; i < 10; i++)
+    smCmd.processCommands(true);
+  return (Serial.output);
+}
+
+static void setValues() {
+  big = 3e12f;
+  exact = 0.1;
+  gain = 0.1f;
+  offset = -250;
+  on = true;
+  period = 99999;
+  third = 1.0 / 3;
+  tiny = 1.5e-7f;
+  wee = -2.5e-300;
+}
+
+void setUp() {
+  setValues();
+  smCmd.initMenu(&paramMenu);
+  smCmd.input.echoEnabled = false;
+  Serial.capture = true;
+  Serial.feed("\x1B");
+  smCmd.processCommands(true);    // enter command mode
+  Serial.output.clear();
+}
+
+void tearDown() {
+  smCmd.exit();
+  Serial.capture = false;
+}
+
+  // values are dumped with the digits they need, in exponent notation if very large or small
+void test_dump_format() {
+  std::string out = command("dump\n");
+
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set big 3e12\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set exact 0.1\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set gain 0.1\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set offset -250\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set on 1\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set third 0.3333333333333333\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set tiny 1.5e-7\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "set wee -2.5e-300\r\n"));
+}
+
+  // the dump, pasted back into the menu, restores every parameter exactly
+void test_dump_round_trip() {
+  std::string out = command("dump\n");
+  std::string dump;
+
+  for (size_t pos = 0, end; (end = out.find('\n', pos)) != std::string::npos; pos = end + 1) {
+    if (out.compare(pos, 4, "set ") == 0)   // only the "set" lines, without the prompt and help
+      dump += out.substr(pos, end + 1 - pos);
+  }
+  big = exact = gain = third = tiny = wee = 1;
+  offset = 0;
+  on = false;
+  period = 1;
+  out = command(dump);
+  TEST_ASSERT_NULL(strstr(out.c_str(), "Invalid"));
+  TEST_ASSERT_NULL(strstr(out.c_str(), "Unknown"));
+  TEST_ASSERT_TRUE(big == 3e12f);
+  TEST_ASSERT_TRUE(exact == 0.1);
+  TEST_ASSERT_TRUE(gain == 0.1f);
+  TEST_ASSERT_TRUE(third == (1.0 / 3));
+  TEST_ASSERT_TRUE(tiny == 1.5e-7f);
+  TEST_ASSERT_TRUE(wee == -2.5e-300);
+  TEST_ASSERT_EQUAL_INT(-250, offset);
+  TEST_ASSERT_TRUE(on);
+  TEST_ASSERT_EQUAL_UINT32(99999, period);
+}
+
+  // a double is set with the precision of a double, and a value at the bottom of a float range is accepted
+void test_set_precision() {
+  command("set exact 0.30000000000000004\n");
+  TEST_ASSERT_TRUE(exact == (0.1 + 0.2));
+  command("set exact 0.1\n");
+  TEST_ASSERT_TRUE(exact == 0.1);
+  gain = 5;
+  TEST_ASSERT_NULL(strstr(command("set gain 0.1\n").c_str(), "Invalid"));
+  TEST_ASSERT_TRUE(gain == 0.1f);
+  TEST_ASSERT_NOT_NULL(strstr(command("set big 2e30\n").c_str(), "Invalid or out of range value"));
+}
+
+  // ranges are listed in the same form, so very large limits aren't shown as overflows
+void test_list_ranges() {
+  std::string out = command("list b\n");
+
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "[-1e30, 1e30]"));
+  out = command("list gain\n");
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "[0.1, 10]"));
+  out = command("list period\n");
+  TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "[1, 100000]"));
+}
+
+  // random float and double values (of every magnitude) are formatted and set back exactly
+void test_random_round_trip() {
+  std::mt19937_64 rng(12345);
+  char buf[maxNumLen];
+  uint32_t bad = 0;
+  float f;
+  double d;
+  uint32_t bits;
+  uint64_t dbits;
+
+  for (uint32_t i = 0; i < 200000; i++) {
+    bits = (uint32_t) rng();
+    memcpy(&f, &bits, sizeof(f));
+    if ((f != f) || (f > 1e30f) || (f < -1e30f))
+      continue;
+    big = f;
+    smParamFormat(buf, &params[0]);
+    TEST_ASSERT_LESS_THAN(maxNumLen, strlen(buf));   // with its terminator, fits in maxNumLen
+    big = 0;
+    if (!smParamSet(&params[0], buf) || (big != f))
+      bad++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, bad);
+  for (uint32_t i = 0; i < 200000; i++) {
+    dbits = rng();
+    memcpy(&d, &dbits, sizeof(d));
+    if ((d != d) || (d > 1e30) || (d < -1e30))
+      continue;
+    exact = d;
+    smParamFormat(buf, &params[1]);
+    TEST_ASSERT_LESS_THAN(maxNumLen, strlen(buf));   // with its terminator, fits in maxNumLen
+    exact = 0;
+    if (!smParamSet(&params[1], buf) || (exact != d))
+      bad++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, bad);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dump_format);
+  RUN_TEST(test_dump_round_trip);
+  RUN_TEST(test_set_precision);
+  RUN_TEST(test_list_ranges);
+  RUN_TEST(test_random_round_trip);
+  return (UNITY_END());
+}
@@ -0,0 +1,163 @@
+/* test_sched
+    Host unit tests for the scheduler (see serialMonSchedClass): a task due more than schedWheelSlots ms ahead stays
+    in its slot when run() visits it early, a task can start or cancel another task that is already on the list of
+    ready tasks, a late run() counts the missed periods of a periodic task as overruns, and the scheduler menu shows
+    the task that is executing as running.
+    Run with "pio test -e native_test -f test_sched".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonCmd.h"
+#include "SerialMonSched.h"
+
+serialMonCmdClass smCmd;
+serialMonSchedClass *schedP;      // scheduler of the test being run
+schedTaskStruct *otherP;          // task started or cancelled by the task functions
+std::string order;                // names of the tasks executed, in order
+
+  // appends the task's name to order
+static void taskNote(schedTaskStruct *task) {
+  order += task->name;
+}
+
+  // restarts the other task, due again 5 ms from now
+static void taskRestart(schedTaskStruct *task) {
+  order += task->name;
+  schedP->after(otherP, 5);
+}
+
+  // cancels the other task
+static void taskCancel(schedTaskStruct *task) {
+  order += task->name;
+  schedP->cancel(otherP);
+}
+
+  // lists the tasks with the scheduler menu
+static void taskList(schedTaskStruct *task) {
+  cmdArgsStruct args;
+
+  (void) task;
+  args.cmd = &smCmd;
+  args.context = schedP;
+  args.count = 0;
+  schedMenuList(&args);
+}
+
+  // calls run() for each ms up to a number of ms from now
+static void runFor(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    hostAdvanceTime(1000);
+    schedP->run();
+  }
+}
+
+void setUp() {
+  order.clear();
+  Serial.capture = true;
+  Serial.output.clear();
+}
+
+void tearDown() {
+  Serial.capture = false;
+}
+
+  // tasks due more than one turn of the wheel ahead are only run when they are due, not when their slot is visited
+void test_far_future() {
+  serialMonSchedClass sched;
+  schedTaskStruct far = SCHED_TASK_INIT("f", taskNote, NULL);
+  schedTaskStruct farther = SCHED_TASK_INIT("g", taskNote, NULL);
+
+  schedP = &sched;
+  sched.after(&far, schedWheelSlots + 36);
+  sched.after(&farther, (3 * schedWheelSlots) + 36);  // same slot
+  runFor(schedWheelSlots + 35);
+  TEST_ASSERT_EQUAL_STRING("", order.c_str());
+  TEST_ASSERT_EQUAL_UINT8(TASK_WAITING, far.state);
+  runFor(1);
+  TEST_ASSERT_EQUAL_STRING("f", order.c_str());
+  TEST_ASSERT_EQUAL_UINT8(TASK_IDLE, far.state);
+  hostAdvanceTime(schedWheelSlots * 1000);  // a single run() that skips a whole turn of the wheel
+  sched.run();
+  TEST_ASSERT_EQUAL_STRING("f", order.c_str());
+  runFor(schedWheelSlots - 1);
+  TEST_ASSERT_EQUAL_STRING("f", order.c_str());
+  runFor(1);
+  TEST_ASSERT_EQUAL_STRING("fg", order.c_str());
+}
+
+  // a task can restart or cancel a task that is due in the same run(), and already on the list of ready tasks
+void test_start_cancel_ready() {
+  serialMonSchedClass sched;
+  schedTaskStruct a = SCHED_TASK_INIT("a", taskRestart, NULL);
+  schedTaskStruct b = SCHED_TASK_INIT("b", taskNote, NULL);
+  schedTaskStruct c = SCHED_TASK_INIT("c", taskCancel, NULL);
+
+  schedP = &sched;
+  otherP = &b;
+  sched.after(&b, 10);
+  sched.after(&a, 10);              // a is ahead of b in the slot, so it runs first
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("a", order.c_str());   // b was restarted from the ready list
+  TEST_ASSERT_EQUAL_UINT8(TASK_WAITING, b.state);
+  runFor(4);
+  TEST_ASSERT_EQUAL_STRING("a", order.c_str());
+  runFor(1);
+  TEST_ASSERT_EQUAL_STRING("ab", order.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, b.runs);
+  sched.after(&b, 10);
+  sched.after(&c, 10);
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("abc", order.c_str());   // b was cancelled from the ready list
+  TEST_ASSERT_EQUAL_UINT8(TASK_IDLE, b.state);
+  runFor(20);
+  TEST_ASSERT_EQUAL_STRING("abc", order.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, b.runs);
+}
+
+  // a run() that comes several periods late runs a periodic task once, and counts the periods it missed
+void test_overruns() {
+  serialMonSchedClass sched;
+  schedTaskStruct p = SCHED_TASK_INIT("p", taskNote, NULL);
+
+  schedP = &sched;
+  sched.every(&p, 10);
+  hostAdvanceTime(35000);           // due at 10, run at 35: the periods due at 20 and 30 are missed
+  sched.run();
+  TEST_ASSERT_EQUAL_UINT32(1, p.runs);
+  TEST_ASSERT_EQUAL_UINT32(2, p.overruns);
+  TEST_ASSERT_EQUAL_UINT32(25, p.lateMax);
+  runFor(4);
+  TEST_ASSERT_EQUAL_UINT32(1, p.runs);
+  runFor(1);                        // at 40, on time
+  TEST_ASSERT_EQUAL_UINT32(2, p.runs);
+  TEST_ASSERT_EQUAL_UINT32(2, p.overruns);
+  TEST_ASSERT_EQUAL_STRING("pp", order.c_str());
+}
+
+  // the scheduler menu shows the executing task as running, and the others as waiting or idle
+void test_list_state() {
+  serialMonSchedClass sched;
+  schedTaskStruct lister = SCHED_TASK_INIT("lister", taskList, NULL);
+  schedTaskStruct waiter = SCHED_TASK_INIT("waiter", taskNote, NULL);
+  schedTaskStruct done = SCHED_TASK_INIT("done", taskNote, NULL);
+
+  schedP = &sched;
+  sched.after(&done, 1);
+  runFor(1);
+  sched.after(&lister, 1);
+  sched.after(&waiter, 100);
+  runFor(1);
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "lister       once       running"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "waiter       once       waiting"));
+  TEST_ASSERT_NOT_NULL(strstr(Serial.output.c_str(), "done         once       idle"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_far_future);
+  RUN_TEST(test_start_cancel_ready);
+  RUN_TEST(test_overruns);
+  RUN_TEST(test_list_state);
+  return (UNITY_END());
+}
@@ -0,0 +1,161 @@
+/* test_sessions
+    Host unit tests for two independent sessions (a serialMonCmdClass object and a serialMonLogClass object each) on
+    Serial and Serial1, driven from the same loop: each session's commands, menu output, menu state and log messages
+    stay on its own stream.
+    Run with "pio test -e native_test -f test_sessions".
+*/
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "SerialMonCmd.h"
+#include "SerialMonLog.h"
+
+serialMonLogClass smLog;        // [Don't change name!] (see LOGMSG)
+serialMonCmdClass usbCmd;
+serialMonCmdClass uartCmd;
+serialMonLogClass usbLog;
+serialMonLogClass uartLog;
+static uint32_t usbCount;       // number of "n" commands executed by each session
+static uint32_t uartCount;
+
+static void cmdSessionNum(cmdArgsStruct *args) {
+  bool usb = (args->cmd == &usbCmd);
+
+  if (usb)
+    usbCount++;
+  else
+    uartCount++;
+  args->cmd->getStream()->print(usb ? "ok usb " : "ok uart ");
+  args->cmd->getStream()->println(args->param[0].i);
+}
+
+  // logs at level 2, which only the UART session's logger prints
+static void cmdSessionLog(cmdArgsStruct *args) {
+  serialMonLogClass *logP = (args->cmd == &usbCmd) ? &usbLog : &uartLog;
+
+  LOGMSG_TO(*logP, 2, "log %s %d", (args->cmd == &usbCmd) ? "usb" : "uart", (int) args->param[0].i);
+}
+
+constexpr cmdEntryStruct sessionEntries[] = {
+  {"l", "i", cmdSessionLog, NULL},
+  {"n", "i", cmdSessionNum, NULL}
+};
+CMD_TABLE_SORTED(sessionEntries);
+const cmdTableStruct sessionTable = {"S", sessionEntries, sizeof(sessionEntries) / sizeof(sessionEntries[0]), NULL};
+
+  // counts the occurrences of a string in a stream's captured output
+static uint32_t countOf(const std::string &out, const char *s) {
+  uint32_t n = 0;
+
+  for (size_t pos = out.find(s); pos != std::string::npos; pos = out.find(s, pos + 1))
+    n++;
+  return (n);
+}
+
+static void processBoth() {
+  usbCmd.processCommands(true);
+  uartCmd.processCommands(true);
+}
+
+void setUp() {
+  usbCmd.setStream(&Serial);
+  uartCmd.setStream(&Serial1);
+  usbCmd.initMenu(&sessionTable);
+  uartCmd.initMenu(&sessionTable);
+  usbLog.setStream(&Serial);
+  uartLog.setStream(&Serial1);
+  usbLog.enable = uartLog.enable = true;
+  usbLog.logLevel = 1;
+  uartLog.logLevel = 2;
+  usbCount = uartCount = 0;
+  Serial.capture = Serial1.capture = true;
+  Serial.feed("\x1B");            // both sessions enter command mode
+  Serial1.feed("\x1B");
+  processBoth();
+  Serial.output.clear();
+  Serial1.output.clear();
+}
+
+void tearDown() {
+  usbCmd.exit();
+  uartCmd.exit();
+  Serial.capture = Serial1.capture = false;
+}
+
+  // commands are executed by the session that received them, and their output goes to that session's stream only
+void test_commands_stay_on_own_stream() {
+  char line[16];
+
+  for (uint16_t i = 0; i < 200; i++) {
+    snprintf(line, sizeof(line), "n %u\n", i);
+    Serial.feed(line);
+    snprintf(line, sizeof(line), "n %u\n", 1000 + i);
+    Serial1.feed(line);
+    processBoth();
+  }
+  TEST_ASSERT_EQUAL_UINT32(200, usbCount);
+  TEST_ASSERT_EQUAL_UINT32(200, uartCount);
+  TEST_ASSERT_EQUAL_UINT32(200, countOf(Serial.output, "ok usb "));
+  TEST_ASSERT_EQUAL_UINT32(200, countOf(Serial1.output, "ok uart "));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial.output, "uart"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial1.output, "usb"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial.output, " 1000"));
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial1.output, "ok uart 1199\r\n"));
+}
+
+  // a partly received command line on one session doesn't mix with the other session's input
+void test_partial_lines_kept_apart() {
+  Serial.feed("n 4");
+  Serial1.feed("n 5\n");
+  processBoth();
+  TEST_ASSERT_EQUAL_UINT32(0, usbCount);
+  TEST_ASSERT_EQUAL_UINT32(1, uartCount);
+  Serial.feed("2\n");
+  Serial1.feed("n");
+  processBoth();
+  Serial1.feed(" 6\n");
+  processBoth();
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial.output, "ok usb 42\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial1.output, "ok uart 5\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial1.output, "ok uart 6\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial.output, "uart"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial1.output, "usb"));
+}
+
+  // each session's log messages go to its own logger, with its own level
+void test_logs_stay_on_own_stream() {
+  for (uint16_t i = 0; i < 50; i++) {
+    Serial.feed("l 1\n");
+    Serial1.feed("l 2\n");
+    processBoth();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial.output, "log "));      // level 2 isn't printed by usbLog
+  TEST_ASSERT_EQUAL_UINT32(50, countOf(Serial1.output, "log uart 2\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial1.output, "usb"));
+  usbLog.logLevel = 2;
+  Serial.feed("l 3\n");
+  processBoth();
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial.output, "log usb 3\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(50, countOf(Serial1.output, "log "));
+}
+
+  // leaving command mode on one session doesn't affect the other
+void test_menu_state_independent() {
+  usbCmd.exit();                  // the USB session leaves command mode
+  Serial.feed("n 7\n");
+  Serial1.feed("n 8\n");
+  processBoth();
+  TEST_ASSERT_EQUAL_UINT32(0, usbCount);
+  TEST_ASSERT_EQUAL_UINT32(1, uartCount);
+  TEST_ASSERT_EQUAL_UINT32(1, countOf(Serial1.output, "ok uart 8\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, countOf(Serial.output, "ok "));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_commands_stay_on_own_stream);
+  RUN_TEST(test_partial_lines_kept_apart);
+  RUN_TEST(test_logs_stay_on_own_stream);
+  RUN_TEST(test_menu_state_independent);
+  return (UNITY_END());
+}
@@ -0,0 +1,391 @@
+/* smlogdecode
+    Host-side decoder for the binary log output format produced by serialMonLogClass when its "binary" data member is
+    set (see serialMonLogClass::printBinary() in src/SerialMonLog.cpp for a description of the format). Reads a captured
+    binary stream from a file (or stdin) and prints the same text lines that serialMonLogClass::printLog() would have
+    printed in text mode. Bytes preceding the first sync record are ignored, and decoding restarts at the next sync
+    record if a malformed record is encountered.
+    The stream may also contain (or consist only of) binary watch frames produced by serialMonWatchClass (see
+    serialMonWatchClass::sendFrame() in src/SerialMonWatch.cpp). These are reconstructed into CSV lines
+    ("ms,name,name,..." followed by one "ms,value,value,..." line per frame), which are printed with the log messages,
+    or written to a separate file with the -w option.
+    Build with any C++11 compiler, e.g.:
+      g++ -O2 -o smlogdecode tools/smlogdecode.cpp
+  Usage:
+    smlogdecode [-w watch-csv-file] [capture-file]
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+const uint8_t recSync = 0xA5;     // must match logRecordEnum in include/SerialMonLog.h
+const uint8_t recFmt = 0x01;
+const uint8_t recMsg = 0x02;
+const uint8_t recMsgNoTs = 0x03;
+const uint8_t recText = 0x04;
+const uint8_t recWatchDef = 0x10; // must match watchRecordEnum in include/SerialMonWatch.h
+const uint8_t recWatchFrame = 0x11;
+const uint8_t argInt = 0;         // must match logArgTypeEnum in include/SerialMonLog.h
+const uint8_t argUint = 1;
+const uint8_t argFloat = 2;
+const uint8_t argPtr = 3;
+const int maxFormats = 256;
+const size_t maxMsgLen = 100;     // must match maxMsgLen in include/SerialMonLog.h
+const uint8_t watchFloat = 7;     // must match watchTypeEnum in include/SerialMonWatch.h
+const uint8_t watchDouble = 8;
+const uint8_t watchUnsigned[] = {0, 1, 0, 1, 0, 1, 1};  // for the integer watch types
+const uint8_t maxWatchVars = 32;  // max number of variables in a watch definition record (bitmap size)
+
+  // a single decoded message argument
+struct argStruct {
+  uint8_t type;
+  int32_t i;
+  uint32_t u;
+  float f;
+  std::string s;
+};
+
+  // byte source used to parse records from the input file
+class inputClass {
+  FILE *fp;
+public:
+  inputClass(FILE *fp) { this->fp = fp; }
+  bool getByte(uint8_t *b) {
+    int c = fgetc(fp);
+    if (c == EOF)
+      return (false);
+    *b = (uint8_t) c;
+    return (true);
+  }
+  bool getVarint(uint32_t *val) {
+    uint8_t b;
+    *val = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      if (!getByte(&b))
+        return (false);
+      *val |= (uint32_t) (b & 0x7F) << shift;
+      if ((b & 0x80) == 0)
+        return (true);
+    }
+    return (false);
+  }
+  bool getBytes(std::string *s, uint32_t len) {
+    uint8_t b;
+    s->clear();
+    for (uint32_t i = 0; i < len; i++) {
+      if (!getByte(&b))
+        return (false);
+      s->push_back((char) b);
+    }
+    return (true);
+  }
+};
+
+
+/* formatMsg()
+    Formats a message from its format string and decoded arguments, the same way as serialMonLogClass::formatEntry()
+  Parameters:
+    const std::string &fmt: format string
+    const std::vector<argStruct> &args: decoded arguments
+  Returns:
+    std::string: formatted message, truncated to maxMsgLen - 1 characters
+*/
+static std::string formatMsg(const std::string &fmt, const std::vector<argStruct> &args) {
+  std::string out;
+  char buf[256];
+  size_t argNum = 0;
+  size_t p = 0;
+
+  while (p < fmt.size()) {
+    if (fmt[p] != '%') {
+      out.push_back(fmt[p++]);
+      continue;
+    }
+    if ((p + 1 < fmt.size()) && (fmt[p + 1] == '%')) {
+      out.push_back('%');
+      p += 2;
+      continue;
+    }
+    std::string spec(1, fmt[p++]);
+    while ((p < fmt.size()) && (strchr("diouxXcsfFeEgGaAp", fmt[p]) == NULL)) {
+      if ((strchr("hlLqjzt", fmt[p]) == NULL) && (spec.size() < 14))
+        spec.push_back(fmt[p]);
+      p++;
+    }
+    if (p >= fmt.size())
+      break;
+    char conv = fmt[p++];
+    spec.push_back(conv);
+    if (argNum >= args.size()) {
+      out += "(?)";
+      continue;
+    }
+    const argStruct &a = args[argNum++];
+    switch (conv) {
+      case 'd':
+      case 'i':
+      case 'c':
+        snprintf(buf, sizeof(buf), spec.c_str(), (a.type == argFloat) ? (int) a.f : (int) a.i);
+      break;
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        snprintf(buf, sizeof(buf), spec.c_str(), (a.type == argFloat) ? (unsigned) a.f : (unsigned) a.u);
+      break;
+      case 's':
+        if (a.type == argPtr)
+          snprintf(buf, sizeof(buf), spec.c_str(), a.s.c_str());
+        else
+          snprintf(buf, sizeof(buf), "(?)");
+      break;
+      case 'p':
+        snprintf(buf, sizeof(buf), "(?)");    // pointer values are not transmitted
+      break;
+      default:
+        if (a.type == argFloat)
+          snprintf(buf, sizeof(buf), spec.c_str(), (double) a.f);
+        else if (a.type == argInt)
+          snprintf(buf, sizeof(buf), spec.c_str(), (double) a.i);
+        else
+          snprintf(buf, sizeof(buf), spec.c_str(), (double) a.u);
+      break;
+    }
+    out += buf;
+  }
+  if (out.size() > maxMsgLen - 1)
+    out.resize(maxMsgLen - 1);
+  return (out);
+}
+
+
+/* printLine()
+    Prints a decoded message in the same form as the logger's text output (see serialMonLogClass::formatTimestamp()),
+    with the timestamp split into seconds and ms as integers, so that it is exact for any time
+*/
+static void printLine(bool hasTs, uint32_t ts, const std::string &msg) {
+  if (hasTs)
+    printf("[%u.%03u] ", (unsigned) (ts / 1000), (unsigned) (ts % 1000));
+  printf("%s\n", msg.c_str());
+}
+
+
+/* findSync()
+    Skips input bytes until a complete sync record (recSync followed by "SML1" for the log format, or "SMW1" for the
+    watch format) has been read
+  Parameters:
+    inputClass *in: input
+    bool *watch: referenced boolean set to true for a watch sync record
+  Returns:
+    bool: false if the end of the input was reached
+*/
+static bool findSync(inputClass *in, bool *watch) {
+  uint8_t b;
+  int matched = -1;     // -1: looking for recSync, 0-3: number of magic chars matched
+
+  while (in->getByte(&b)) {
+    if (b == recSync)
+      matched = 0;
+    else if ((matched == 2) && ((b == 'L') || (b == 'W'))) {
+      *watch = (b == 'W');
+      matched++;
+    }
+    else if ((matched >= 0) && (matched != 2) && (b == (uint8_t) "SM?1"[matched])) {
+      if (++matched == 4)
+        return (true);
+    }
+    else
+      matched = -1;
+  }
+  return (false);
+}
+
+
+  // state of the watch frame decoder, reset by a watch sync record
+struct watchStateStruct {
+  bool defined;                     // a definition record has been decoded
+  uint32_t ts;                      // timestamp of the previous frame
+  std::vector<uint8_t> types;       // watch type of each variable
+  std::vector<uint32_t> values;     // current raw value of each variable
+};
+
+
+/* decodeWatchDef(), decodeWatchFrame()
+    Decode a watch definition or frame record (following the record type code), and print the CSV header or line
+  Returns:
+    bool: false if the record is malformed
+*/
+static bool decodeWatchDef(inputClass *in, FILE *out, watchStateStruct *w) {
+  std::string name;
+  uint8_t count, type, len;
+
+  if (!in->getVarint(&w->ts) || !in->getByte(&count) || (count > maxWatchVars))
+    return (false);
+  w->types.assign(count, 0);
+  w->values.assign(count, 0);
+  fprintf(out, "ms");
+  for (uint8_t i = 0; i < count; i++) {
+    if (!in->getByte(&type) || (type > watchDouble) || !in->getByte(&len) || !in->getBytes(&name, len))
+      return (false);
+    w->types[i] = type;
+    fprintf(out, ",%s", name.c_str());
+  }
+  fprintf(out, "\n");
+  w->defined = true;
+  return (true);
+}
+
+static bool decodeWatchFrame(inputClass *in, FILE *out, watchStateStruct *w) {
+  std::string bytes;
+  uint32_t delta, changed, val;
+  float f;
+
+  if (!w->defined || !in->getVarint(&delta) || !in->getVarint(&changed))
+    return (false);
+  w->ts += delta;
+  for (size_t i = 0; i < w->types.size(); i++) {
+    if ((changed & ((uint32_t) 1 << i)) == 0)
+      continue;
+    if (w->types[i] >= watchFloat) {
+      if (!in->getBytes(&bytes, 4))
+        return (false);
+      w->values[i] = (uint8_t) bytes[0] | ((uint8_t) bytes[1] << 8) | ((uint8_t) bytes[2] << 16) | ((uint32_t) (uint8_t) bytes[3] << 24);
+    }
+    else {
+      if (!in->getVarint(&val))
+        return (false);
+      w->values[i] += (val >> 1) ^ (0 - (val & 1));   // undo zig-zag encoding
+    }
+  }
+  fprintf(out, "%u", w->ts);
+  for (size_t i = 0; i < w->types.size(); i++) {
+    if (w->types[i] >= watchFloat) {
+      memcpy(&f, &w->values[i], 4);
+      fprintf(out, ",%.9g", (double) f);
+    }
+    else if (watchUnsigned[w->types[i]])
+      fprintf(out, ",%u", w->values[i]);
+    else
+      fprintf(out, ",%d", (int32_t) w->values[i]);
+  }
+  fprintf(out, "\n");
+  return (true);
+}
+
+
+int main(int argc, char **argv) {
+  FILE *fp = stdin;
+  FILE *watchFp = stdout;
+  watchStateStruct watch;
+  std::vector<std::string> fmtTable(maxFormats);
+  std::vector<bool> fmtValid(maxFormats, false);
+  std::vector<argStruct> args;
+  std::string str;
+  uint32_t ts = 0;
+  uint32_t val;
+  uint8_t type, numArgs, argTypes;
+  uint8_t id = 0;
+  bool ok;
+  bool resync;
+  bool isWatch = false;
+  int argn = 1;
+
+  if ((argc > 2) && (strcmp(argv[1], "-w") == 0)) {
+    watchFp = fopen(argv[2], "w");
+    if (watchFp == NULL) {
+      perror(argv[2]);
+      return (1);
+    }
+    argn = 3;
+  }
+  if (argc > argn) {
+    fp = fopen(argv[argn], "rb");
+    if (fp == NULL) {
+      perror(argv[argn]);
+      return (1);
+    }
+  }
+  inputClass in(fp);
+  watch.defined = false;
+
+  while (findSync(&in, &isWatch)) {
+    if (isWatch)                  // a watch sync record only resets the watch decoder, and vice versa
+      watch.defined = false;
+    else {
+      ts = 0;
+      fmtValid.assign(maxFormats, false);
+    }
+    ok = true;
+    resync = false;
+    while (ok && !resync && in.getByte(&type)) {
+      switch (type) {
+        case recFmt:
+          ok = in.getByte(&id) && in.getVarint(&val) && in.getBytes(&fmtTable[id], val);
+          fmtValid[id] = ok;
+        break;
+        case recMsg:
+        case recMsgNoTs:
+          ok = in.getByte(&id) && fmtValid[id];
+          if (ok && (type == recMsg)) {
+            ok = in.getVarint(&val);
+            ts += val;
+          }
+          ok = ok && in.getByte(&numArgs) && in.getByte(&argTypes) && (numArgs <= 4);
+          args.assign(ok ? numArgs : 0, argStruct());
+          for (uint8_t i = 0; ok && (i < numArgs); i++) {
+            args[i].type = (argTypes >> (2 * i)) & 0x03;
+            switch (args[i].type) {
+              case argInt:
+                ok = in.getVarint(&val);
+                args[i].i = (int32_t) ((val >> 1) ^ (0 - (val & 1)));   // undo zig-zag encoding
+                args[i].u = (uint32_t) args[i].i;   // firmware stores both in the same union
+              break;
+              case argUint:
+                ok = in.getVarint(&args[i].u);
+                args[i].i = (int32_t) args[i].u;
+              break;
+              case argFloat:
+                ok = in.getBytes(&str, 4);
+                if (ok) {
+                  val = (uint8_t) str[0] | ((uint8_t) str[1] << 8) | ((uint8_t) str[2] << 16) | ((uint32_t) (uint8_t) str[3] << 24);
+                  memcpy(&args[i].f, &val, 4);
+                }
+              break;
+              case argPtr:
+                ok = in.getVarint(&val) && in.getBytes(&args[i].s, val);
+              break;
+            }
+          }
+          if (ok)
+            printLine(type == recMsg, ts, formatMsg(fmtTable[id], args));
+        break;
+        case recText:
+          ok = in.getVarint(&val) && in.getBytes(&str, val);
+          if (ok)
+            printLine(false, 0, str);
+        break;
+        case recWatchDef:
+          ok = decodeWatchDef(&in, watchFp, &watch);
+        break;
+        case recWatchFrame:
+          ok = decodeWatchFrame(&in, watchFp, &watch);
+        break;
+        case recSync:             // a new sync record; restart decoding after the magic characters
+          ungetc(recSync, fp);
+          resync = true;
+        break;
+        default:
+          ok = false;
+        break;
+      }
+    }
+    if (!ok)
+      fprintf(stderr, "smlogdecode: malformed record, resynchronizing\n");
+  }
+  if (fp != stdin)
+    fclose(fp);
+  if (watchFp != stdout)
+    fclose(watchFp);
+  return (0);
+}